@@ -0,0 +1,88 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   agent_cache.cpp
+*/
+#include "pch.h"
+
+#include "agent_cache.h"
+
+#include <iterator>
+
+agent_cache_t::entry_t::entry_t(const string_t& agent) :
+      agent(agent),
+      robot(nullptr),
+      group(nullptr),
+      mangled_set(false),
+      robot_set(false),
+      group_set(false)
+{
+}
+
+void agent_cache_t::entry_t::reset(const string_t& agent)
+{
+   this->agent = agent;
+   mangled.reset();
+   robot = group = nullptr;
+   mangled_set = robot_set = group_set = false;
+}
+
+agent_cache_t::agent_cache_t(size_t max_size) :
+      max_size(max_size),
+      scratch(string_t()),
+      hits(0),
+      misses(0)
+{
+   if(max_size)
+      index.reserve(max_size);
+}
+
+///
+/// @brief  Returns the cache entry for `agent`, creating a new one if the user
+///         agent is not in the cache.
+///
+/// The returned reference remains valid until the next call to `get_entry`.
+///
+agent_cache_t::entry_t& agent_cache_t::get_entry(const string_t& agent)
+{
+   std::unordered_map<std::string_view, lru_list_t::iterator>::iterator iter;
+
+   if(!max_size) {
+      misses++;
+      scratch.reset(agent);
+      return scratch;
+   }
+
+   if((iter = index.find(std::string_view(agent.c_str(), agent.length()))) != index.end()) {
+      hits++;
+
+      // move the entry to the front of the list
+      if(iter->second != entries.begin())
+         entries.splice(entries.begin(), entries, iter->second);
+
+      return entries.front();
+   }
+
+   misses++;
+
+   // reuse the least recently used entry if the cache is full
+   if(entries.size() == max_size) {
+      lru_list_t::iterator last = std::prev(entries.end());
+
+      index.erase(std::string_view(last->agent.c_str(), last->agent.length()));
+
+      last->reset(agent);
+
+      entries.splice(entries.begin(), entries, last);
+   }
+   else
+      entries.emplace_front(agent);
+
+   index.emplace(std::string_view(entries.front().agent.c_str(), entries.front().agent.length()), entries.begin());
+
+   return entries.front();
+}
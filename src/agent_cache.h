@@ -0,0 +1,89 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   agent_cache.h
+*/
+#ifndef AGENT_CACHE_H
+#define AGENT_CACHE_H
+
+#include "tstring.h"
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <string_view>
+
+///
+/// @brief  A bounded cache of results of user agent processing, keyed by the
+///         original user agent string
+///
+/// Log files contain relatively few distinct user agents, each of which appears
+/// in many log records. Each cache entry keeps the mangled user agent and the
+/// robot and group names the user agent matched, so repeat user agents are not
+/// mangled and matched against `Robot` and `GroupAgent` patterns again. Entry
+/// values are evaluated by the caller when they are needed for the first time
+/// and are tracked by the `*_set` flags.
+///
+/// When the cache is full, the least recently used entry is reused for a new user
+/// agent. If the maximum cache size is zero, every look-up returns an empty entry
+/// that is reset on the next look-up.
+///
+/// This class is not thread-safe.
+///
+class agent_cache_t {
+   public:
+      ///
+      /// @brief  A cache entry for a single user agent
+      ///
+      struct entry_t {
+         string_t       agent;            ///< Original user agent.
+         string_t       mangled;          ///< Mangled user agent, if `mangled_set` is `true`.
+         const string_t *robot;           ///< Matching robot name, if `robot_set` is `true`.
+         const string_t *group;           ///< Matching group name, if `group_set` is `true`.
+
+         bool           mangled_set;      ///< Has the user agent been mangled?
+         bool           robot_set;        ///< Has the user agent been matched against robot patterns?
+         bool           group_set;        ///< Has the mangled user agent been matched against group patterns?
+
+         public:
+            entry_t(const string_t& agent);
+
+            void reset(const string_t& agent);
+      };
+
+   private:
+      typedef std::list<entry_t> lru_list_t;
+
+   private:
+      size_t         max_size;            ///< Maximum number of entries (0=no caching).
+
+      lru_list_t     entries;             ///< Cache entries, the most recently used first.
+
+      std::unordered_map<std::string_view, lru_list_t::iterator> index;   ///< Entries keyed by `entry_t::agent`.
+
+      entry_t        scratch;             ///< An entry returned when caching is disabled.
+
+      uint64_t       hits;                ///< Number of look-ups that found an entry.
+      uint64_t       misses;              ///< Number of look-ups that created a new entry.
+
+   public:
+      agent_cache_t(size_t max_size);
+
+      agent_cache_t(const agent_cache_t&) = delete;
+
+      agent_cache_t& operator = (const agent_cache_t&) = delete;
+
+      entry_t& get_entry(const string_t& agent);
+
+      size_t size(void) const {return entries.size();}
+
+      uint64_t get_hits(void) const {return hits;}
+
+      uint64_t get_misses(void) const {return misses;}
+};
+
+#endif // AGENT_CACHE_H
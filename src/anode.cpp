@@ -27,6 +27,13 @@ anode_t::anode_t(const string_t& agent, bool robot) : base_node<anode_t>(agent),
    xfer = 0;
 }
 
+void anode_t::merge(const anode_t& anode)
+{
+   count += anode.count;
+   visits += anode.visits;
+   xfer += anode.xfer;
+}
+
 //
 // serialization
 //
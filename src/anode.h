@@ -41,6 +41,9 @@ struct anode_t : public base_node<anode_t> {
          /// Constructs an instance of a user agent node with the `agent` string.
          anode_t(const string_t& agent, bool robot);
 
+         /// Adds counters of another node for the same user agent to this node.
+         void merge(const anode_t& anode);
+
          ///
          /// @name   Serialization
          ///
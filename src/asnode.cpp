@@ -36,6 +36,15 @@ asnode_t::asnode_t(asnode_t&& asnode) :
 {
 }
 
+void asnode_t::merge(const asnode_t& asnode)
+{
+   hits += asnode.hits;
+   files += asnode.files;
+   pages += asnode.pages;
+   visits += asnode.visits;
+   xfer += asnode.xfer;
+}
+
 size_t asnode_t::s_pack_data(void *buffer, size_t bufsize) const
 {
    serializer_t sr(buffer, bufsize);
@@ -113,7 +122,7 @@ asnode_t& as_hash_table::get_asnode(uint32_t as_num, const string_t& as_org, int
    if((asnode = find_node(hashval, OBJ_REG, tstamp, as_num)) != nullptr)
       return *asnode;
 
-   return *put_node(hashval, new storable_t<asnode_t>(as_num, as_org), tstamp);
+   return *put_node(hashval, new_node(as_num, as_org), tstamp);
 }
 
 //
@@ -42,6 +42,9 @@ struct asnode_t : htab_obj_t<uint32_t>, keynode_t<uint32_t>, datanode_t<asnode_t
 
       asnode_t(asnode_t&& ctnode);
 
+      /// Adds counters of another node for the same autonomous system to this node.
+      void merge(const asnode_t& asnode);
+
       ///
       /// @name   Hash table interface
       ///
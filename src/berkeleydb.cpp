@@ -27,6 +27,7 @@
 #include <type_traits>
 #include <utility>
 #include <algorithm>
+#include <memory>
 
 // -----------------------------------------------------------------------
 //
@@ -34,14 +35,22 @@
 //
 // -----------------------------------------------------------------------
 
-berkeleydb_t::cursor_iterator_base::cursor_iterator_base(Db *db) 
+thread_local size_t berkeleydb_t::cursor_iterator_base::open_cursors = 0;
+
+///
+/// A cursor iterator constructed with an error doesn't open a cursor and reports
+/// this error instead of records.
+///
+berkeleydb_t::cursor_iterator_base::cursor_iterator_base(Db *db, int error) 
 {
    cursor = nullptr;
-   error = 0;
+   this->error = error;
 
-   if(db) {
-      if((error = db->cursor(nullptr, &cursor, 0)) != 0)
+   if(db && !error) {
+      if((this->error = db->cursor(nullptr, &cursor, 0)) != 0)
          cursor = nullptr;
+      else
+         open_cursors++;
    }
 }
 
@@ -52,8 +61,10 @@ berkeleydb_t::cursor_iterator_base::~cursor_iterator_base(void)
 
 void berkeleydb_t::cursor_iterator_base::close(void) 
 {
-   if(cursor)
+   if(cursor) {
       error = cursor->close();
+      open_cursors--;
+   }
    cursor = nullptr;
 }
 
@@ -89,11 +100,72 @@ bool berkeleydb_t::cursor_dup_iterator::next(Dbt& key, Dbt& data, Dbt *pkey)
    return !error;
 }
 
+berkeleydb_t::cursor_iterator::cursor_iterator(Db *db, bool bulk, int error) :
+      cursor_iterator_base(db, error),
+      bulkptr(nullptr)
+{
+#if DB_VERSION_MAJOR > 4 || DB_VERSION_MAJOR == 4 && DB_VERSION_MINOR >= 8
+   if(bulk && cursor) {
+      this->bulk.resize(DBBUFSIZE + BULKBUFSIZE);
+
+      bulkkey.set_flags(DB_DBT_USERMEM);
+      bulkkey.set_data(&this->bulk[0]);
+      bulkkey.set_ulen(DBBUFSIZE);
+
+      bulkdata.set_flags(DB_DBT_USERMEM);
+      bulkdata.set_data(&this->bulk[DBBUFSIZE]);
+      bulkdata.set_ulen(BULKBUFSIZE);
+   }
+#endif
+}
+
+///
+/// @brief  Returns the next record from the bulk buffer, fetching the next page of
+///         records when the buffer runs out.
+///
+/// `key` and `data` are pointed into the bulk buffer and remain valid until the
+/// next call.
+///
+bool berkeleydb_t::cursor_iterator::next_bulk(Dbt& key, Dbt& data)
+{
+#if DB_VERSION_MAJOR > 4 || DB_VERSION_MAJOR == 4 && DB_VERSION_MINOR >= 8
+   void *kptr, *dptr;
+   u_int32_t ksize, dsize;
+
+   while(true) {
+      if(bulkptr) {
+         DB_MULTIPLE_KEY_NEXT(bulkptr, bulkdata.get_DBT(), kptr, ksize, dptr, dsize);
+
+         if(bulkptr) {
+            key.set_data(kptr);
+            key.set_size(ksize);
+
+            data.set_data(dptr);
+            data.set_size(dsize);
+
+            return true;
+         }
+      }
+
+      // fetch as many of the following records as fit into the bulk buffer
+      if((error = cursor->get(&bulkkey, &bulkdata, DB_NEXT | DB_MULTIPLE_KEY)) != 0)
+         return false;
+
+      DB_MULTIPLE_INIT(bulkptr, bulkdata.get_DBT());
+   }
+#else
+   return false;
+#endif
+}
+
 bool berkeleydb_t::cursor_iterator::next(Dbt& key, Dbt& data, Dbt *pkey)
 {
    if(!cursor || is_error())
       return false;
 
+   if(!bulk.empty() && !pkey)
+      return next_bulk(key, data);
+
    if(pkey)
       error = cursor->pget(&key, pkey, &data, DB_NEXT);
    else
@@ -127,15 +199,21 @@ bool berkeleydb_t::cursor_reverse_iterator::prev(Dbt& key, Dbt& data, Dbt *pkey)
 //
 // -----------------------------------------------------------------------
 
-berkeleydb_t::table_t::table_t(const config_t& config, DbEnv& dbenv, Db& seqdb, buffer_allocator_t& buffer_allocator) :
+berkeleydb_t::table_t::table_t(const config_t& config, DbEnv& dbenv, Db& seqdb, Db& filterdb, buffer_allocator_t& buffer_allocator) :
       config(config),
       dbenv(&dbenv),
       table(new_db(&dbenv, DBFLAGS)),
       values(nullptr),
       seqdb(&seqdb),
       sequence(nullptr),
+      filterdb(&filterdb),
+      values_scxcb(nullptr),
+      filter_skips(0),
+      filter_false_positives(0),
       buffer_allocator(&buffer_allocator),
-      threaded(false)
+      threaded(false),
+      write_queue(nullptr),
+      write_error(0)
 {
 }
 
@@ -146,16 +224,29 @@ berkeleydb_t::table_t::table_t(table_t&& other) noexcept :
       values(other.values),
       seqdb(other.seqdb),
       sequence(other.sequence),
+      filterdb(other.filterdb),
       indexes(std::move(other.indexes)),
+      values_scxcb(other.values_scxcb),
+      filter(std::move(other.filter)),
+      filter_name(std::move(other.filter_name)),
+      filter_skips(other.filter_skips),
+      filter_false_positives(other.filter_false_positives),
       buffer_allocator(other.buffer_allocator),
-      threaded(other.threaded)
+      threaded(other.threaded),
+      write_queue(other.write_queue),
+      write_error(other.write_error),
+      batch(std::move(other.batch)),
+      batch_data(std::move(other.batch_data))
 {
    other.dbenv = nullptr;
    other.table = nullptr;
    other.values = nullptr;
    other.seqdb = nullptr;
    other.sequence = nullptr;
+   other.filterdb = nullptr;
+   other.values_scxcb = nullptr;
    other.buffer_allocator = nullptr;
+   other.write_queue = nullptr;
 }
 
 berkeleydb_t::table_t::~table_t(void)
@@ -180,7 +271,17 @@ berkeleydb_t::table_t& berkeleydb_t::table_t::operator = (table_t&& other) noexc
    seqdb = other.seqdb;
    sequence = other.sequence;
    buffer_allocator = other.buffer_allocator;
+   filterdb = other.filterdb;
    indexes = std::move(other.indexes);
+   values_scxcb = other.values_scxcb;
+   filter = std::move(other.filter);
+   filter_name = std::move(other.filter_name);
+   filter_skips = other.filter_skips;
+   filter_false_positives = other.filter_false_positives;
+   write_queue = other.write_queue;
+   write_error = other.write_error;
+   batch = std::move(other.batch);
+   batch_data = std::move(other.batch_data);
 
    threaded = other.threaded;
 
@@ -189,7 +290,10 @@ berkeleydb_t::table_t& berkeleydb_t::table_t::operator = (table_t&& other) noexc
    other.values = nullptr;
    other.seqdb = nullptr;
    other.sequence = nullptr;
+   other.filterdb = nullptr;
+   other.values_scxcb = nullptr;
    other.buffer_allocator = nullptr;
+   other.write_queue = nullptr;
 
    return *this;
 }
@@ -303,7 +407,16 @@ int berkeleydb_t::table_t::open(const char *dbname, bt_compare_cb_t btcb)
 
 int berkeleydb_t::table_t::close(void)
 {
-   int error;
+   int error, batch_error;
+
+   // batched records must be written before the filter is saved, but the table is closed even if they cannot be written
+   batch_error = write_batch();
+
+   write_error = 0;
+
+   // the filter must be saved while the sequence is open
+   if((error = save_filter()) != 0)
+      return error;
 
    for(u_int index = 0; index < indexes.size(); index++) {
       if(indexes[index].scdb) {
@@ -316,6 +429,7 @@ int berkeleydb_t::table_t::close(void)
    indexes.clear();
 
    values = nullptr;
+   values_scxcb = nullptr;
 
    if(sequence) {
       if((error = sequence->close(0)) != 0)
@@ -324,12 +438,86 @@ int berkeleydb_t::table_t::close(void)
       sequence = nullptr;
    }
 
-   return table->close(0);
+   if((error = table->close(0)) != 0)
+      return error;
+
+   return batch_error;
+}
+
+///
+/// Returns the error of writing batched or queued records. The write queue reports
+/// errors as messages, which are returned when the database is flushed or closed,
+/// so the table latches `EIO` for them and returns it from all subsequent calls.
+///
+int berkeleydb_t::table_t::wait_writes(void) const
+{
+   if(write_queue && !write_error && !write_queue->wait().success())
+      write_error = EIO;
+
+   if(write_error)
+      return write_error;
+
+   return write_batch();
+}
+
+///
+/// Writes records in the put batch with `put_records`, which packs them into bulk
+/// buffers. The batch is emptied even if records cannot be written, but the error
+/// is latched and returned from all subsequent calls, so it cannot be missed by a
+/// caller that checks a later write.
+///
+int berkeleydb_t::table_t::write_batch(void) const
+{
+   std::vector<batch_record_t*> records;
+   std::vector<u_char> bulk;
+   int error = 0;
+
+   if(write_error)
+      return write_error;
+
+   if(batch.empty())
+      return 0;
+
+   records.reserve(batch.size());
+
+   // batch data doesn't move until the batch is emptied
+   for(size_t i = 0; i < batch.size(); i++) {
+      batch[i].buffer = batch_data.data() + batch[i].offset;
+      records.push_back(&batch[i]);
+   }
+
+   bulk.resize(BULKBUFSIZE);
+
+   try {
+      error = put_records(records.data(), records.size(), bulk);
+   }
+   catch (const DbException& err) {
+      error = err.get_errno() ? err.get_errno() : EINVAL;
+   }
+
+   batch.clear();
+   batch_data.clear();
+
+   write_error = error;
+
+   return error;
 }
 
 int berkeleydb_t::table_t::truncate(u_int32_t *count)
 {
    u_int32_t temp;
+   int error;
+
+   // records waiting to be written would be erased anyway
+   batch.clear();
+   batch_data.clear();
+
+   if((error = wait_writes()) != 0)
+      return error;
+
+   if(filter.is_ready())
+      filter.clear();
+
    return table->truncate(nullptr, count ? count : &temp, 0);
 }
 
@@ -341,6 +529,9 @@ int berkeleydb_t::table_t::compact(u_int& bytes)
    
    bytes = 0;
 
+   if((error = wait_writes()) != 0)
+      return error;
+
    // first, compact all index databases
    for(u_int index = 0; index < indexes.size(); index++) {
       // get the page size
@@ -376,6 +567,9 @@ int berkeleydb_t::table_t::sync(void)
 {
    int error;
 
+   if((error = wait_writes()) != 0)
+      return error;
+
    for(u_int index = 0; index < indexes.size(); index++) {
       if((error = indexes[index].scdb->sync(0)) != 0)
          return error;
@@ -459,6 +653,10 @@ int berkeleydb_t::table_t::associate(const char *dbname, sc_extract_cb_t scxcb,
    if(!desc || desc->scxcb)
       return 0;
 
+   // the new index must include all queued and batched records
+   if((error = wait_writes()) != 0)
+      return error;
+
    if(rebuild) {
       // make sure the secondary database is empty
       if((error = desc->scdb->truncate(nullptr, &temp, 0)) != 0)
@@ -475,6 +673,19 @@ int berkeleydb_t::table_t::associate(const char *dbname, sc_extract_cb_t scxcb,
    return 0;
 }
 
+///
+/// The value hash extraction callback of the values database is also used to obtain
+/// value hashes of records queued for the write-behind thread, so value look-ups can
+/// find nodes that have not been written yet.
+///
+void berkeleydb_t::table_t::set_values_db(const char *dbname)
+{
+   const db_desc_t *desc = get_sc_desc(dbname);
+
+   values = desc ? desc->scdb : nullptr;
+   values_scxcb = desc ? desc->scxcb : nullptr;
+}
+
 Db *berkeleydb_t::table_t::secondary_db(const char *dbname) const
 {
    const db_desc_t *desc;
@@ -537,12 +748,196 @@ db_seq_t berkeleydb_t::table_t::query_seq_id(void)
    return cur_seq_id;
 }
 
+///
+/// Returns `false` if the table has no values database or if the value hash cannot
+/// be extracted from the serialized record.
+///
+bool berkeleydb_t::table_t::get_value_hash(const Dbt& key, const Dbt& data, uint64_t& hashval) const
+{
+   Dbt result;
+
+   if(!values_scxcb)
+      return false;
+
+   // extract the value hash in the same way the values database does
+   if(values_scxcb(values, &key, &data, &result) || result.get_size() != sizeof(uint64_t))
+      return false;
+
+   memcpy(&hashval, result.get_data(), sizeof(uint64_t));
+
+   return true;
+}
+
+///
+/// A stored filter is removed from the filter database after it has been read, so if
+/// the database is not closed properly, the filter is rebuilt next time. Otherwise it
+/// would be missing values of nodes stored after the filter was read.
+///
+int berkeleydb_t::table_t::open_filter(const char *name)
+{
+   Dbt key, data;
+   db_seq_t seq_id;
+   uint64_t filter_seq_id;
+   bool loaded = false;
+   int error;
+
+   // without a sequence there's no way to tell whether the filter is up to date
+   if(!values || !values_scxcb || !sequence)
+      throw std::logic_error("A value filter requires a values database and a sequence");
+
+   if((seq_id = query_seq_id()) == -1)
+      return EINVAL;
+
+   filter_skips = filter_false_positives = 0;
+
+   key.set_data(const_cast<char*>(name));
+   key.set_size((u_int32_t) strlen(name));
+
+   data.set_flags(DB_DBT_MALLOC);
+
+   if((error = filterdb->get(nullptr, &key, &data, 0)) == 0) {
+      serializer_t sr(data.get_data(), data.get_size());
+
+      // a filter saved with a different sequence ID is missing nodes added without the filter
+      try {
+         const void *ptr = sr.deserialize(data.get_data(), filter_seq_id);
+
+         if(filter_seq_id == (uint64_t) seq_id)
+            loaded = filter.s_unpack_data(ptr, data.get_size() - sr.data_size(ptr)) != 0;
+      }
+      catch (const std::invalid_argument&) {
+         loaded = false;
+      }
+
+      free(data.get_data());
+
+      if((error = filterdb->del(nullptr, &key, 0)) != 0)
+         return error;
+   }
+   else if(error != DB_NOTFOUND)
+      return error;
+
+   if(!loaded) {
+      if((error = build_filter(seq_id)) != 0)
+         return error;
+   }
+
+   filter_name = name;
+
+   return 0;
+}
+
+///
+/// Node IDs are assigned sequentially, so the last sequence ID is a good estimate of the
+/// number of nodes in the table. The filter is sized for twice as many values to leave
+/// room for new nodes.
+///
+int berkeleydb_t::table_t::build_filter(db_seq_t seq_id)
+{
+   Dbc *cursor;
+   Dbt key, data;
+   uint64_t hashval;
+   int error;
+
+   filter.reset(seq_id > 0 ? (uint64_t) seq_id * 2 : 0);
+
+   if((error = values->cursor(nullptr, &cursor, 0)) != 0)
+      return error;
+
+   key.set_data(&hashval);
+   key.set_ulen(sizeof(hashval));
+   key.set_flags(DB_DBT_USERMEM);
+
+   // only value hashes in secondary keys are needed, so don't retrieve any data
+   data.set_flags(DB_DBT_PARTIAL);
+   data.set_dlen(0);
+
+   try {
+      while((error = cursor->get(&key, &data, DB_NEXT_NODUP)) == 0) {
+         if(key.get_size() == sizeof(hashval))
+            filter.add(hashval);
+      }
+   }
+   catch (const DbException& err) {
+      error = err.get_errno() ? err.get_errno() : EINVAL;
+   }
+
+   cursor->close();
+
+   if(error != DB_NOTFOUND) {
+      filter.release();
+      return error;
+   }
+
+   return 0;
+}
+
+///
+/// A filter that holds more values than it was sized for lets through more and more
+/// look-ups of values that are not in the table. Such filter is rebuilt from the values
+/// database, sized for the current number of nodes, after all pending records of this
+/// table are written.
+///
+int berkeleydb_t::table_t::rebuild_filter(void)
+{
+   db_seq_t seq_id;
+   int error;
+
+   if((error = wait_writes()) != 0)
+      return error;
+
+   if((seq_id = query_seq_id()) == -1)
+      return EINVAL;
+
+   return build_filter(seq_id);
+}
+
+///
+/// A filter that contains more values than it was sized for is not saved, so it will
+/// be rebuilt with a larger size next time. The filter is released after it is saved.
+///
+int berkeleydb_t::table_t::save_filter(void)
+{
+   Dbt key, data;
+   db_seq_t seq_id;
+   int error = 0;
+
+   if(!filter.is_ready())
+      return 0;
+
+   if(filter.get_count() <= filter.get_capacity() && (seq_id = query_seq_id()) != -1) {
+      std::vector<u_char> buffer(serializer_t::s_size_of<uint64_t>() + filter.s_data_size());
+      serializer_t sr(buffer.data(), buffer.size());
+
+      void *ptr = sr.serialize(buffer.data(), (uint64_t) seq_id);
+
+      filter.s_pack_data(ptr, buffer.size() - sr.data_size(ptr));
+
+      key.set_data(const_cast<char*>(filter_name.c_str()));
+      key.set_size((u_int32_t) filter_name.length());
+
+      data.set_data(buffer.data());
+      data.set_size((u_int32_t) buffer.size());
+
+      error = filterdb->put(nullptr, &key, &data, 0);
+   }
+
+   filter.release();
+   filter_name.reset();
+
+   return error;
+}
+
 uint64_t berkeleydb_t::table_t::count(const char *dbname) const
 {
    DB_BTREE_STAT *stats;
    Db *dbptr = table;
    uint64_t nkeys;
 
+   // records that cannot be written would not be counted
+   if(wait_writes())
+      return 0;
+
    if(dbname && *dbname) {
       if((dbptr = secondary_db(dbname)) == nullptr)
          return 0;
@@ -577,6 +972,10 @@ bool berkeleydb_t::table_t::delete_node(const keynode_t<uint64_t>& node)
    if(node.s_pack_key(buffer, keysize) != keysize)
       return false;
 
+   // a queued or batched record would bring the node back after it was deleted
+   if(wait_writes())
+      return false;
+
    key.set_data(buffer);
    key.set_size((u_int32_t) keysize);
 
@@ -586,6 +985,289 @@ bool berkeleydb_t::table_t::delete_node(const keynode_t<uint64_t>& node)
    return true;
 }
 
+// -----------------------------------------------------------------------
+//
+// berkeleydb_t::write_queue_t
+//
+// -----------------------------------------------------------------------
+
+berkeleydb_t::write_queue_t::write_queue_t(void) :
+      qsize(0),
+      writing(0),
+      writer_stop(false)
+{
+}
+
+berkeleydb_t::write_queue_t::~write_queue_t(void)
+{
+   abort();
+}
+
+void berkeleydb_t::write_queue_t::start(void)
+{
+   if(writer_thread.joinable())
+      throw std::logic_error("The write-behind thread is already running");
+
+   writer_stop = false;
+   write_error.reset();
+
+   writer_thread = std::thread(&write_queue_t::writer_thread_proc, this);
+}
+
+berkeleydb_t::status_t berkeleydb_t::write_queue_t::stop(void)
+{
+   // make sure the writer thread is or was running
+   if(writer_thread.joinable()) {
+      // signal the thread to stop after all queued records are written
+      queue_mtx.lock();
+      writer_stop = true;
+      writer_cv.notify_one();
+      queue_mtx.unlock();
+
+      // and wait for it
+      writer_thread.join();
+   }
+
+   if(!write_error.isempty())
+      return write_error.c_str();
+
+   return status_t();
+}
+
+void berkeleydb_t::write_queue_t::abort(void)
+{
+   queue_mtx.lock();
+   discard_records();
+   writer_stop = true;
+   writer_cv.notify_one();
+   queue_mtx.unlock();
+
+   if(writer_thread.joinable())
+      writer_thread.join();
+}
+
+///
+/// Removes a written or discarded record from record indexes and deletes it. The
+/// queue must be locked by the caller.
+///
+void berkeleydb_t::write_queue_t::remove_record(record_t *rec)
+{
+   std::pair<record_index_t::iterator, record_index_t::iterator> range;
+
+   for(range = ids.equal_range(rec->nodeid); range.first != range.second; ++range.first) {
+      if(range.first->second == rec) {
+         ids.erase(range.first);
+         break;
+      }
+   }
+
+   if(rec->hashed) {
+      for(range = hashes.equal_range(rec->hashval); range.first != range.second; ++range.first) {
+         if(range.first->second == rec) {
+            hashes.erase(range.first);
+            break;
+         }
+      }
+   }
+
+   qsize -= rec->buffer.size();
+
+   delete rec;
+}
+
+///
+/// Removes all records waiting to be written. Records in the batch being written are
+/// removed by the writer thread. The queue must be locked by the caller.
+///
+void berkeleydb_t::write_queue_t::discard_records(void)
+{
+   while(!records.empty()) {
+      remove_record(records.front());
+      records.pop_front();
+   }
+
+   written_cv.notify_all();
+}
+
+///
+/// If there are two records for the same node, one is being written and the other one
+/// is waiting in the queue and was queued later. The queue must be locked by the caller.
+///
+const berkeleydb_t::write_queue_t::record_t *berkeleydb_t::write_queue_t::find_by_id(const table_t *table, uint64_t nodeid) const
+{
+   const record_t *found = nullptr;
+
+   for(std::pair<record_index_t::const_iterator, record_index_t::const_iterator> range = ids.equal_range(nodeid); range.first != range.second; ++range.first) {
+      const record_t *rec = range.first->second;
+
+      if(rec->table == table && (!found || !rec->writing))
+         found = rec;
+   }
+
+   return found;
+}
+
+bool berkeleydb_t::write_queue_t::push(record_t *rec)
+{
+   std::unique_ptr<record_t> recptr(rec);
+   std::unique_lock<std::mutex> lock(queue_mtx);
+
+   // if the queue is full, wait for the writer thread to catch up, unless this thread holds
+   // open cursors, which may keep the writer thread waiting for database locks indefinitely
+   if(!cursor_iterator_base::has_open_cursors())
+      written_cv.wait(lock, [this] {return qsize < WRITE_QUEUE_SIZE || !write_error.isempty();});
+
+   if(!write_error.isempty())
+      return false;
+
+   // if there's a record for this node waiting in the queue, replace its data
+   for(std::pair<record_index_t::iterator, record_index_t::iterator> range = ids.equal_range(rec->nodeid); range.first != range.second; ++range.first) {
+      record_t *qrec = range.first->second;
+
+      if(qrec->table != rec->table || qrec->writing)
+         continue;
+
+      if(qrec->hashed != rec->hashed || qrec->hashval != rec->hashval) {
+         if(qrec->hashed) {
+            for(std::pair<record_index_t::iterator, record_index_t::iterator> hrange = hashes.equal_range(qrec->hashval); hrange.first != hrange.second; ++hrange.first) {
+               if(hrange.first->second == qrec) {
+                  hashes.erase(hrange.first);
+                  break;
+               }
+            }
+         }
+
+         if(rec->hashed)
+            hashes.emplace(rec->hashval, qrec);
+
+         qrec->hashed = rec->hashed;
+         qrec->hashval = rec->hashval;
+      }
+
+      qsize = qsize - qrec->buffer.size() + rec->buffer.size();
+
+      qrec->keysize = rec->keysize;
+      qrec->buffer.swap(rec->buffer);
+
+      return true;
+   }
+
+   ids.emplace(rec->nodeid, rec);
+
+   if(rec->hashed)
+      hashes.emplace(rec->hashval, rec);
+
+   qsize += rec->buffer.size();
+
+   records.push_back(recptr.release());
+
+   writer_cv.notify_one();
+
+   return true;
+}
+
+berkeleydb_t::status_t berkeleydb_t::write_queue_t::wait(void)
+{
+   std::unique_lock<std::mutex> lock(queue_mtx);
+
+   written_cv.wait(lock, [this] {return (records.empty() && !writing) || !write_error.isempty();});
+
+   if(!write_error.isempty())
+      return write_error.c_str();
+
+   return status_t();
+}
+
+bool berkeleydb_t::write_queue_t::copy_by_id(const table_t *table, uint64_t nodeid, buffer_t& buffer, size_t& datasize)
+{
+   std::lock_guard<std::mutex> lock(queue_mtx);
+   const record_t *rec;
+
+   if((rec = find_by_id(table, nodeid)) == nullptr)
+      return false;
+
+   datasize = rec->datasize();
+
+   if(buffer.capacity() < datasize)
+      buffer.resize(datasize, 0);
+
+   memcpy(buffer, rec->data(), datasize);
+
+   return true;
+}
+
+void berkeleydb_t::write_queue_t::writer_thread_proc(void)
+{
+   std::vector<record_t*> batch;
+   std::vector<u_char> bulk(BULKBUFSIZE);
+   string_t errmsg;
+   size_t first, last;
+   int error = 0;
+
+   batch.reserve(WRITE_BATCH_SIZE);
+
+   std::unique_lock<std::mutex> lock(queue_mtx);
+
+   while(!error) {
+      writer_cv.wait(lock, [this] {return writer_stop || !records.empty();});
+
+      // all queued records are written before the thread stops
+      if(records.empty())
+         break;
+
+      while(!records.empty() && batch.size() < WRITE_BATCH_SIZE) {
+         batch.push_back(records.front());
+         batch.back()->writing = true;
+         records.pop_front();
+      }
+
+      writing = batch.size();
+
+      //
+      // Records in the batch remain in the indexes while they are being written, so
+      // look-ups in the main thread can find them. New records for the same nodes are
+      // queued separately and will be written in the next batch.
+      //
+      lock.unlock();
+
+      //
+      // A batch never has two records for the same node, so records may be grouped by
+      // table in any order and each group is written in as few calls as possible.
+      //
+      std::stable_sort(batch.begin(), batch.end(), [] (const record_t *r1, const record_t *r2) {return r1->table < r2->table;});
+
+      try {
+         for(first = 0; first < batch.size() && !error; first = last) {
+            for(last = first + 1; last < batch.size() && batch[last]->table == batch[first]->table; last++);
+
+            if((error = batch[first]->table->put_records(&batch[first], last - first, bulk)) != 0)
+               errmsg.format("Failed to write queued records to the database (%s)", db_strerror(error));
+         }
+      }
+      catch (const DbException& err) {
+         error = err.get_errno() ? err.get_errno() : -1;
+         errmsg.format("Failed to write queued records to the database (%s)", err.what());
+      }
+
+      lock.lock();
+
+      for(size_t i = 0; i < batch.size(); i++)
+         remove_record(batch[i]);
+
+      batch.clear();
+
+      writing = 0;
+
+      // records that cannot be written are discarded and waiting threads will see the error
+      if(error) {
+         write_error = errmsg;
+         discard_records();
+      }
+
+      written_cv.notify_all();
+   }
+}
+
 // -----------------------------------------------------------------------
 //
 // berkeleydb_t
@@ -594,7 +1276,8 @@ bool berkeleydb_t::table_t::delete_node(const keynode_t<uint64_t>& node)
 berkeleydb_t::berkeleydb_t(config_t&& config) :
       config(config.clone()),
       dbenv(DBENVFLAGS),
-      sequences(&dbenv, DBFLAGS)
+      sequences(&dbenv, DBFLAGS),
+      filters(&dbenv, DBFLAGS)
 {
    // configure the environment to use the correct memory manager
    if(dbenv.set_alloc(berkeleydb_t::malloc, berkeleydb_t::realloc, berkeleydb_t::free))
@@ -604,6 +1287,14 @@ berkeleydb_t::berkeleydb_t(config_t&& config) :
    trickle_thread_stop = false;
 
    trickle = false;
+
+   write_behind = false;
+
+   value_filters = false;
+
+   parallel_indexes = false;
+
+   filter_skips = filter_false_positives = 0;
 }
 
 berkeleydb_t::~berkeleydb_t()
@@ -617,6 +1308,10 @@ berkeleydb_t::~berkeleydb_t()
    if(!config.is_db_path_empty() && trickle)
       stop_trickle_thread();
 
+   // tables may be destroyed at this point, so queued records cannot be written
+   if(!config.is_db_path_empty() && write_behind)
+      write_queue.abort();
+
    config.release();
 }
 
@@ -632,15 +1327,17 @@ void berkeleydb_t::reset_db_handles(void)
    for(size_t i = 0; i < tables.size(); i++)
       tables[i]->destroy_db_handles();
 
-   // destroy the sequences database
+   // destroy the sequences and filters databases
    sequences.Db::~Db();
+   filters.Db::~Db();
    
    // reconstruct the environment 
    dbenv.~DbEnv();
    new (&dbenv) DbEnv(DBENVFLAGS);
 
-   // construct the sequence database
+   // construct the sequence and filters databases
    new (&sequences) Db(&dbenv, DBFLAGS);
+   new (&filters) Db(&dbenv, DBFLAGS);
 
    // construct table databases
    for(size_t i = 0; i < tables.size(); i++)
@@ -731,14 +1428,14 @@ berkeleydb_t::status_t berkeleydb_t::open(table_t * const tblist[], size_t tblcn
       return string_t::_format("Berkeley DB must be v4.4 or newer (found v%d.%d.%d).\n", major, minor, patch);
 
    // do some additional initialization for threaded environment
-   if(!config.is_db_path_empty() && trickle) {
+   if(!config.is_db_path_empty() && (trickle || write_behind || parallel_indexes)) {
       // initialize the environment and databases as thread-safe and with a single writer
       dbflags |= DB_THREAD;
       envflags |= DB_THREAD | DB_INIT_CDB;
 
       // initialize table databases as free-threaded
-      for(size_t i = 0; i < tables.size(); i++)
-         tables[i]->set_threaded(true);
+      for(size_t i = 0; i < tblcnt; i++)
+         tblist[i]->set_threaded(true);
    }
 
    // set the temporary directory if requested
@@ -775,6 +1472,19 @@ berkeleydb_t::status_t berkeleydb_t::open(table_t * const tblist[], size_t tblcn
    if(!(status = sequences.open(nullptr, config.get_db_name_ptr(), "sequences", DB_HASH, dbflags, FILEMASK)).success())
       return status;
 
+   //
+   // create the value filters database (Bloom filters of value hashes)
+   //
+   if(value_filters) {
+      if(config.is_db_path_empty()) {
+         if(!(status = filters.get_mpf()->set_flags(DB_MPOOL_NOFILE, true)).success())
+            return status;
+      }
+
+      if(!(status = filters.open(nullptr, config.get_db_name_ptr(), "filters", DB_HASH, dbflags, FILEMASK)).success())
+         return status;
+   }
+
    // hold onto all the tables for subsequent operations
    tables.assign(tblist, tblist + tblcnt);
 
@@ -782,6 +1492,14 @@ berkeleydb_t::status_t berkeleydb_t::open(table_t * const tblist[], size_t tblcn
    if(!config.is_db_path_empty() && trickle)
       trickle_thread = std::thread(&berkeleydb_t::trickle_thread_proc, this);
 
+   // start the write-behind thread and let tables queue their records
+   if(!config.is_db_path_empty() && write_behind) {
+      write_queue.start();
+
+      for(size_t i = 0; i < tables.size(); i++)
+         tables[i]->set_write_queue(&write_queue);
+   }
+
    return status;
 }
 
@@ -789,13 +1507,25 @@ berkeleydb_t::status_t berkeleydb_t::close(void)
 {
    u_int errcnt = 0;
    int error = 0;
-   status_t status;
+   status_t status, write_status;
+
+   // write all queued records before tables are closed
+   if(!config.is_db_path_empty() && write_behind) {
+      write_status = write_queue.stop();
+
+      for(size_t i = 0; i < tables.size(); i++)
+         tables[i]->set_write_queue(nullptr);
+   }
 
    if(!config.is_db_path_empty() && trickle)
       stop_trickle_thread();
 
    // close all table databases
    for(size_t i = 0; i < tables.size(); i++) {
+      // keep filter counters of closed tables
+      filter_skips += tables[i]->get_filter_skips();
+      filter_false_positives += tables[i]->get_filter_false_positives();
+
       if((error = tables[i]->close()) != 0)
          errcnt++;
 
@@ -811,6 +1541,21 @@ berkeleydb_t::status_t berkeleydb_t::close(void)
    if(errcnt == 1)
       status = error;
 
+   //
+   // Close the filters database if it was opened. A handle that was never opened
+   // still must be closed before the environment, which otherwise reports it as
+   // an open database handle, but closing it cannot fail in a way that matters.
+   //
+   if(value_filters) {
+      if((error = filters.close(0)) != 0)
+         errcnt++;
+
+      if(errcnt == 1)
+         status = error;
+   }
+   else
+      filters.close(0);
+
    // finally, close the environment
    if((error = dbenv.close(0)) != 0)
       errcnt++;
@@ -822,6 +1567,10 @@ berkeleydb_t::status_t berkeleydb_t::close(void)
 
    tables.clear();
 
+   // records that could not be written are reported ahead of other errors
+   if(!write_status.success())
+      return write_status;
+
    return status;
 }
 
@@ -858,6 +1607,9 @@ berkeleydb_t::status_t berkeleydb_t::flush(void)
 {
    status_t status;
 
+   if(!(status = wait_writes()).success())
+      return status;
+
    if(!(status = dbenv.memp_sync(nullptr)).success())
       return status;
 
@@ -869,6 +1621,51 @@ berkeleydb_t::status_t berkeleydb_t::flush(void)
    return status;
 }
 
+berkeleydb_t::status_t berkeleydb_t::write_batches(void)
+{
+   status_t status;
+
+   for(size_t i = 0; i < tables.size(); i++) {
+      if(!(status = tables[i]->write_batch()).success())
+         return status;
+   }
+
+   return status;
+}
+
+berkeleydb_t::status_t berkeleydb_t::wait_writes(void)
+{
+   status_t status;
+
+   if(!(status = write_batches()).success())
+      return status;
+
+   if(config.is_db_path_empty() || !write_behind)
+      return status;
+
+   return write_queue.wait();
+}
+
+uint64_t berkeleydb_t::get_filter_skips(void) const
+{
+   uint64_t skips = filter_skips;
+
+   for(size_t i = 0; i < tables.size(); i++)
+      skips += tables[i]->get_filter_skips();
+
+   return skips;
+}
+
+uint64_t berkeleydb_t::get_filter_false_positives(void) const
+{
+   uint64_t false_positives = filter_false_positives;
+
+   for(size_t i = 0; i < tables.size(); i++)
+      false_positives += tables[i]->get_filter_false_positives();
+
+   return false_positives;
+}
+
 void berkeleydb_t::stop_trickle_thread(void)
 {
    // make sure the trickle thread is or was running
@@ -17,12 +17,15 @@
 #include "char_buffer.h"
 #include "char_buffer_stack.h"
 #include "storable.h"
+#include "bloom_filter.h"
 
 #include "thread.h"
 
 #include <db_cxx.h>
 
 #include <vector>
+#include <deque>
+#include <unordered_map>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -46,6 +49,13 @@ class berkeleydb_t {
    private:
       static const size_t        DBBUFSIZE = 32768;
 
+      static const size_t        WRITE_QUEUE_SIZE = 8 * 1024 * 1024; ///< Maximum size of queued records, in bytes.
+      static const size_t        WRITE_BATCH_SIZE = 4096; ///< Maximum number of records written in one batch.
+
+      static const size_t        BULKBUFSIZE = 1024 * 1024; ///< Size of bulk buffers for multiple records.
+
+      static const size_t        PUT_BATCH_SIZE = 1024 * 1024; ///< Maximum size of records batched by a table, in bytes.
+
       static const u_int32_t     DBFLAGS = 0;            ///< Berkeley DB database flags.
       static const u_int32_t     DBENVFLAGS = 0;         ///< Berkeley DB environment flags.
 
@@ -262,15 +272,21 @@ class berkeleydb_t {
 
             int          error;
 
+         private:
+            static thread_local size_t open_cursors;  ///< The number of cursors open in the current thread.
+
          private:
             // do not allow assignments
             cursor_iterator_base& operator = (const cursor_iterator_base&) = delete;
 
          public:
-            cursor_iterator_base(Db *db);
+            cursor_iterator_base(Db *db, int error = 0);
             
             ~cursor_iterator_base(void);
 
+            /// Returns `true` if the current thread holds any open cursors.
+            static bool has_open_cursors(void) {return open_cursors != 0;}
+
             bool is_error(void) const {return (error && error != DB_NOTFOUND) ? true : false;}
 
             int get_error(void) const {return error;}
@@ -296,9 +312,25 @@ class berkeleydb_t {
       ///
       /// @brief  A forward Berkeley DB cursor iterator
       ///
+      /// A bulk iterator fetches pages of records from the database into a bulk buffer
+      /// (`DB_MULTIPLE_KEY`) and returns records from the buffer until it runs out, and
+      /// the `key` and `data` arguments of `next` point into the buffer, instead of their
+      /// own memory, until the next call. Berkeley DB only supports bulk retrieval with
+      /// `Dbc::get`, so bulk iterators cannot retrieve primary keys for secondary database
+      /// records.
+      ///
       class cursor_iterator : public cursor_iterator_base {
+         private:
+            std::vector<u_char>  bulk;       ///< A key buffer, followed by the bulk buffer (empty if not a bulk iterator).
+            Dbt                  bulkkey;    ///< The key buffer at the start of `bulk`.
+            Dbt                  bulkdata;   ///< Records in the bulk buffer.
+            void                 *bulkptr;   ///< The next record in the bulk buffer or `nullptr` if there is none.
+
+         private:
+            bool next_bulk(Dbt& key, Dbt& data);
+
          public:
-            cursor_iterator(Db *db) : cursor_iterator_base(db) {}
+            cursor_iterator(Db *db, bool bulk = false, int error = 0);
 
             bool next(Dbt& key, Dbt& data, Dbt *pkey);
       };
@@ -306,14 +338,21 @@ class berkeleydb_t {
       ///
       /// @brief  A reverse Berkeley DB cursor iterator
       ///
+      /// Berkeley DB only supports bulk retrieval (`DB_MULTIPLE_KEY`) with cursor moves
+      /// forward and cannot return primary keys in bulk, so reverse iterators, which TSV
+      /// dumps and all-items report pages use to traverse secondary indexes from the
+      /// largest value, fetch one record at a time.
+      ///
       class cursor_reverse_iterator : public cursor_iterator_base {
          public:
-            cursor_reverse_iterator(Db *db) : cursor_iterator_base(db) {}
+            cursor_reverse_iterator(Db *db, int error = 0) : cursor_iterator_base(db, error) {}
 
             bool prev(Dbt& key, Dbt& data, Dbt *pkey);
       };
 
    protected:
+      class write_queue_t;
+
       ///
       /// @brief  A table object stores data along with accompanying indexes
       ///
@@ -369,8 +408,50 @@ class berkeleydb_t {
       /// buffers in `const` `table_t` methods. The assumption is that buffer 
       /// allocators are safe for the current threading model.
       ///
+      /// 4. If a write queue is set, `put_node` serializes nodes into the queue and
+      /// node look-ups check queued records before the database. All other table
+      /// operations wait until all queued records are written and fail if any of
+      /// them could not be written.
+      ///
+      /// Otherwise `put_node` serializes nodes into a put batch, which is written
+      /// with `put_records` when it grows over `PUT_BATCH_SIZE`. Node look-ups and
+      /// all other table operations write the batch first, so they never see an
+      /// older record. The first error writing the batch is latched and reported by
+      /// all subsequent table operations, including `close`, and no more nodes are
+      /// put into the table.
+      ///
+      /// 5. If a value filter is open, value hashes of all nodes put into the table
+      /// are added to a Bloom filter and value look-ups for hashes that are not in
+      /// the filter return without querying the values database. The filter is saved
+      /// in a shared filter database when the table is closed and is rebuilt from the
+      /// values database if it is missing or if new nodes were added to the table
+      /// without updating the filter, which is detected by comparing the sequence ID
+      /// saved with the filter against the current one. A filter that outgrows its
+      /// capacity while nodes are put into the table is rebuilt with a larger size.
+      ///
       class table_t {
+         friend class sswtest::BerkeleyDBTest;
+
          private:
+            ///
+            /// @brief  A serialized record in the put batch
+            ///
+            /// Records are kept in one buffer, so the key pointer is only set when the
+            /// batch is written.
+            ///
+            struct batch_record_t {
+               u_char   *buffer;    ///< The serialized key, followed by serialized data.
+               size_t   offset;     ///< The offset of the serialized key in `batch_data`.
+               size_t   keysize;    ///< The size of the serialized key.
+               size_t   size;       ///< The size of the serialized key and data.
+
+               u_char *key(void) {return buffer;}
+
+               u_char *data(void) {return buffer + keysize;}
+
+               size_t datasize(void) const {return size - keysize;}
+            };
+
             ///
             /// @brief  A secondary database descriptor
             ///
@@ -397,18 +478,51 @@ class berkeleydb_t {
 
             DbSequence           *sequence;  // source of primary keys
 
+            Db                   *filterdb;  // shared value filter database
+
             std::vector<db_desc_t> indexes;  // secondary databases
 
+            sc_extract_cb_t      values_scxcb; // extracts value hashes from serialized records
+
+            bloom_filter_t       filter;     // value hashes of all nodes in the table
+
+            string_t             filter_name; // value filter name in the filter database
+
+            mutable uint64_t     filter_skips; // value look-ups skipped by the filter
+
+            mutable uint64_t     filter_false_positives; // value look-ups not found in the database
+
             bool                 threaded;
 
             buffer_allocator_t   *buffer_allocator;
 
+            write_queue_t        *write_queue; // records being written by a background thread
+
+            mutable int          write_error; // the first error writing records of this table
+
+            mutable std::vector<batch_record_t> batch; // records put since the batch was last written
+
+            mutable std::vector<u_char> batch_data; // serialized keys and data of records in `batch`
+
          private:
             const db_desc_t *get_sc_desc(const char *dbname) const;
             db_desc_t *get_sc_desc(const char *dbname);
 
+            int wait_writes(void) const;
+
+            bool get_value_hash(const Dbt& key, const Dbt& data, uint64_t& hashval) const;
+
+            int build_filter(db_seq_t seq_id);
+
+            int rebuild_filter(void);
+
+            /// Returns `true` if the value filter outgrew its capacity and may be rebuilt (waiting for writes with open cursors may never finish).
+            bool filter_overflow(void) const {return filter.is_ready() && filter.get_count() > filter.get_capacity() && !cursor_iterator_base::has_open_cursors();}
+
+            int save_filter(void);
+
          public:
-            table_t(const config_t& config, DbEnv& env, Db& seqdb, buffer_allocator_t& buffer_allocator);
+            table_t(const config_t& config, DbEnv& env, Db& seqdb, Db& filterdb, buffer_allocator_t& buffer_allocator);
 
             table_t(table_t&& other) noexcept;
 
@@ -426,6 +540,9 @@ class berkeleydb_t {
             /// returns whether Berkeley DB was initialized for multi-thread calls
             bool get_threaded(void) const {return threaded;}
 
+            /// Sets a queue of records written by a background thread or `nullptr` to write synchronously.
+            void set_write_queue(write_queue_t *queue) {write_queue = queue;}
+
             void init_db_handles(void);
 
             void destroy_db_handles(void);
@@ -446,7 +563,7 @@ class berkeleydb_t {
             int sync(void);
 
             /// designates the specified secondary database name as the value database
-            void set_values_db(const char *dbname) {values = secondary_db(dbname);}
+            void set_values_db(const char *dbname);
 
             /// Prepares a named secondary database association with the primary database.
             int associate(const char *dbname, bt_compare_cb_t btcb, dup_compare_cb_t dpcb, sc_extract_cb_t scxcb = nullptr);
@@ -469,6 +586,15 @@ class berkeleydb_t {
             /// Queries the current sequence ID without incrementing it.
             db_seq_t query_seq_id(void);
 
+            /// Reads the named value filter from the filter database or builds it from the values database.
+            int open_filter(const char *name);
+
+            /// Returns the number of value look-ups that were skipped by the value filter.
+            uint64_t get_filter_skips(void) const {return filter_skips;}
+
+            /// Returns the number of value look-ups that passed the value filter, but were not found.
+            uint64_t get_filter_false_positives(void) const {return filter_false_positives;}
+
             /// Returns the number of unique keys in the primary or a named secondary database.
             uint64_t count(const char *dbname = nullptr) const;
 
@@ -476,6 +602,13 @@ class berkeleydb_t {
             template <typename node_t>
             bool put_node(const node_t& unode, storage_info_t& storage_info);
 
+            /// Puts serialized records into the primary database, packing them into bulk buffers.
+            template <typename record_t>
+            int put_records(record_t * const records[], size_t count, std::vector<u_char>& bulk) const;
+
+            /// Writes records batched by `put_node` into the primary database.
+            int write_batch(void) const;
+
             /// retrieves a node by its unique ID
             template <typename node_t, typename ... param_t>
             bool get_node_by_id(storable_t<node_t>& node, typename node_t::template s_unpack_cb_t<param_t ...> upcb = nullptr, param_t ... param) const;
@@ -487,7 +620,7 @@ class berkeleydb_t {
             template <typename node_t, typename ... param_t>
             bool get_node_by_value(storable_t<node_t>& node, typename node_t::template s_unpack_cb_t<param_t ...> upcb = nullptr, param_t ... param) const;
 
-            /// returns a forward table iterator
+            /// returns a forward table iterator, which reads the primary database in bulk
             template <typename node_t>
             iterator<node_t> begin(const char *dbname) const; 
 
@@ -496,6 +629,120 @@ class berkeleydb_t {
             reverse_iterator<node_t> rbegin(const char *dbname) const;
       };
 
+      ///
+      /// @brief  A queue of serialized table records that are written to the database 
+      ///         by a background thread
+      ///
+      /// Nodes are serialized into records in the context of the thread that puts them
+      /// into a table, so the caller may discard each node as soon as `table_t::put_node`
+      /// returns, and the writer thread puts queued records into their tables in batches.
+      ///
+      /// Records remain indexed by node ID and by value hash until they are written, so
+      /// tables can find nodes that have not reached the database yet. A record queued for
+      /// a node that already has a record waiting in the queue replaces the data of the
+      /// waiting record, so each node is written once for any number of queued updates.
+      ///
+      /// Each batch is sorted by table and written with `table_t::put_records`, which packs
+      /// as many records as fit into a bulk buffer into each Berkeley DB call.
+      ///
+      /// If the total size of queued records exceeds `WRITE_QUEUE_SIZE`, callers wait for
+      /// the writer thread to catch up, unless they hold open cursors, which may block the
+      /// writer thread when the environment uses Berkeley DB concurrent data store locking,
+      /// in which case the queue is allowed to grow past its limit until cursors are closed.
+      /// If a record cannot be written, the writer thread
+      /// discards all queued records and stops and subsequent records are rejected.
+      ///
+      class write_queue_t {
+         friend class sswtest::BerkeleyDBTest;
+
+         public:
+            ///
+            /// @brief  A serialized table record
+            ///
+            struct record_t {
+               table_t              *table;     ///< The table this record is written into.
+               uint64_t             nodeid;     ///< The ID of the serialized node.
+               uint64_t             hashval;    ///< The value hash, if `hashed` is `true`.
+               bool                 hashed;     ///< Was a value hash extracted from the record data?
+               bool                 writing;    ///< Is this record being written by the writer thread?
+               size_t               keysize;    ///< The size of the serialized key at the start of `buffer`.
+               std::vector<u_char>  buffer;     ///< The serialized key, followed by serialized data.
+
+               record_t(table_t *table, uint64_t nodeid, size_t keysize, size_t datasize) :
+                     table(table), nodeid(nodeid), hashval(0), hashed(false), writing(false),
+                     keysize(keysize), buffer(keysize + datasize)
+               {
+               }
+
+               u_char *key(void) {return buffer.data();}
+
+               u_char *data(void) {return buffer.data() + keysize;}
+
+               const u_char *data(void) const {return buffer.data() + keysize;}
+
+               size_t datasize(void) const {return buffer.size() - keysize;}
+            };
+
+         private:
+            typedef std::unordered_multimap<uint64_t, record_t*> record_index_t;
+
+         private:
+            std::mutex              queue_mtx;
+            std::condition_variable writer_cv;     ///< Signals the writer thread that records were queued or that it should stop.
+            std::condition_variable written_cv;    ///< Signals waiting threads that records were written.
+            std::thread             writer_thread;
+
+            std::deque<record_t*>   records;       ///< Records waiting to be written, in the order they were queued.
+            record_index_t          ids;           ///< All queued records, including those being written, by node ID.
+            record_index_t          hashes;        ///< All queued records with a value hash, by value hash.
+
+            size_t                  qsize;         ///< The total size of all queued records, in bytes.
+            size_t                  writing;       ///< The number of records being written.
+
+            string_t                write_error;
+            bool                    writer_stop;
+
+         private:
+            void writer_thread_proc(void);
+
+            void remove_record(record_t *rec);
+
+            void discard_records(void);
+
+            const record_t *find_by_id(const table_t *table, uint64_t nodeid) const;
+
+         public:
+            write_queue_t(void);
+
+            write_queue_t(const write_queue_t&) = delete;
+
+            ~write_queue_t(void);
+
+            write_queue_t& operator = (const write_queue_t&) = delete;
+
+            /// Starts the writer thread.
+            void start(void);
+
+            /// Writes all queued records and stops the writer thread.
+            status_t stop(void);
+
+            /// Discards queued records and stops the writer thread.
+            void abort(void);
+
+            /// Queues a record, taking ownership of it, and returns `false` if records cannot be written.
+            bool push(record_t *rec);
+
+            /// Waits until all queued records are written.
+            status_t wait(void);
+
+            /// Copies data of the most recent record queued for `nodeid` into `buffer`.
+            bool copy_by_id(const table_t *table, uint64_t nodeid, buffer_t& buffer, size_t& datasize);
+
+            /// Copies the key and data of the most recent record queued for the value of `node` into `buffer`.
+            template <typename node_t>
+            bool copy_by_value(const table_t *table, const node_t& node, uint64_t hashval, buffer_t& buffer, size_t& keysize, size_t& datasize);
+      };
+
    public:
       ///
       /// @brief  A public cursor iterator base class to traverse primary and secondary 
@@ -535,6 +782,9 @@ class berkeleydb_t {
       ///
       /// @tparam node_t   The node class to retrieve in each iteration
       ///
+      /// Iterators over primary databases fetch records in bulk and iterators over
+      /// secondary databases fetch one record at a time, along with its primary key.
+      ///
       template <typename node_t>
       class iterator : public iterator_base<node_t> {
          private:
@@ -550,7 +800,7 @@ class berkeleydb_t {
             iterator& operator = (const iterator&) = delete;
 
          public:
-            iterator(buffer_allocator_t& buffer_allocator, const table_t& table, const char *dbname);
+            iterator(buffer_allocator_t& buffer_allocator, const table_t& table, const char *dbname, int error = 0);
 
             template <typename ... param_t>
             bool next(storable_t<node_t>& node, typename node_t::template s_unpack_cb_t<param_t ...> upcb = nullptr, param_t ... param);
@@ -562,6 +812,8 @@ class berkeleydb_t {
       ///
       /// @tparam node_t   The node class to retrieve in each iteration
       ///
+      /// Reverse iterators always fetch one record at a time (see `cursor_reverse_iterator`).
+      ///
       template <typename node_t>
       class reverse_iterator : public iterator_base<node_t> {
          private:
@@ -577,7 +829,7 @@ class berkeleydb_t {
             reverse_iterator& operator = (const reverse_iterator&) = delete;
 
          public:
-            reverse_iterator(buffer_allocator_t& buffer_allocator, const table_t& table, const char *dbname);
+            reverse_iterator(buffer_allocator_t& buffer_allocator, const table_t& table, const char *dbname, int error = 0);
 
             template <typename ... param_t>
             bool prev(storable_t<node_t>& node, typename node_t::template s_unpack_cb_t<param_t...> upcb = nullptr, param_t ... param);
@@ -622,6 +874,7 @@ class berkeleydb_t {
    private:
       DbEnv             dbenv;
       Db                sequences;
+      Db                filters;
 
       buffer_stack_t    buffer_stack;
 
@@ -635,8 +888,25 @@ class berkeleydb_t {
 
       bool              trickle;
 
+      write_queue_t     write_queue;
+
+      bool              write_behind;
+
+      bool              value_filters;
+
+      bool              parallel_indexes;
+
+      uint64_t          filter_skips;           ///< Value look-ups skipped by filters of closed tables.
+      uint64_t          filter_false_positives; ///< Value look-ups that passed filters of closed tables, but were not found.
+
    protected:
-      table_t make_table(void) {return table_t(config, dbenv, sequences, buffer_stack);}
+      table_t make_table(void) {return table_t(config, dbenv, sequences, filters, buffer_stack);}
+
+      /// indicates whether tables with values and sequences should open value filters
+      bool get_value_filters(void) const {return value_filters;}
+
+      /// indicates whether indexes of different tables may be rebuilt concurrently (requires free-threaded tables)
+      bool get_parallel_indexes(void) const {return parallel_indexes && !tables.empty() && tables.front()->get_threaded();}
 
    public:
       berkeleydb_t(config_t&& config);
@@ -646,6 +916,15 @@ class berkeleydb_t {
       /// if trickle is enabled, dirty pages will be trickled to disk by a background thread
       void set_trickle(bool value) {trickle = value;}
 
+      /// if write-behind is enabled, nodes will be written to the database by a background thread
+      void set_write_behind(bool value) {write_behind = value;}
+
+      /// if value filters are enabled, value look-ups for values never stored in the database are skipped
+      void set_value_filters(bool value) {value_filters = value;}
+
+      /// if parallel indexes are enabled, indexes of different tables will be rebuilt on separate threads
+      void set_parallel_indexes(bool value) {parallel_indexes = value;}
+
       /// A convenience method that calls `berkeleydb_t::open` with a table array.
       status_t open(std::initializer_list<table_t*> tblist);
 
@@ -661,6 +940,18 @@ class berkeleydb_t {
       /// writes modified data pages to disk
       status_t flush(void);
 
+      /// writes nodes batched by tables into the database
+      status_t write_batches(void);
+
+      /// writes nodes batched by tables and waits until all nodes queued by table write-behind are written to the database
+      status_t wait_writes(void);
+
+      /// returns the number of value look-ups skipped by value filters in all tables
+      uint64_t get_filter_skips(void) const;
+
+      /// returns the number of value look-ups that passed value filters in all tables, but were not found
+      uint64_t get_filter_false_positives(void) const;
+
       /// rearranges data pages on disk to minimize unused space
       status_t compact(u_int& bytes);
 };
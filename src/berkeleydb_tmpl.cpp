@@ -26,6 +26,7 @@
 #include <type_traits>
 #include <utility>
 #include <algorithm>
+#include <memory>
 
 //
 // B-Tree comparison function template for BDB v6 and up (top) and for prior versions 
@@ -84,8 +85,8 @@ int sc_extract_cb(Db *secondary, const Dbt *key, const Dbt *data, Dbt *result)
 
 template <typename node_t>
 berkeleydb_t::iterator_base<node_t>::iterator_base(buffer_allocator_t& buffer_allocator, cursor_iterator_base& cursor) : 
-      buffer_allocator(&buffer_allocator), 
-      cursor(cursor)
+      cursor(cursor),
+      buffer_allocator(&buffer_allocator)
 {
 }
 
@@ -111,9 +112,9 @@ Dbt& berkeleydb_t::iterator_base<node_t>::set_dbt_buffer(Dbt& dbt, void *buffer,
 // -----------------------------------------------------------------------
 
 template <typename node_t>
-berkeleydb_t::iterator<node_t>::iterator(buffer_allocator_t& buffer_allocator, const table_t& table, const char *dbname) : 
+berkeleydb_t::iterator<node_t>::iterator(buffer_allocator_t& buffer_allocator, const table_t& table, const char *dbname, int error) : 
       iterator_base<node_t>(buffer_allocator, cursor),
-      cursor(dbname ? table.secondary_db(dbname) : table.primary_db())
+      cursor(dbname ? table.secondary_db(dbname) : table.primary_db(), dbname == nullptr, error)
 {
    primdb = (dbname == nullptr);
 }
@@ -163,9 +164,9 @@ bool berkeleydb_t::iterator<node_t>::next(storable_t<node_t>& node, typename nod
 // -----------------------------------------------------------------------
 
 template <typename node_t>
-berkeleydb_t::reverse_iterator<node_t>::reverse_iterator(buffer_allocator_t& buffer_allocator, const table_t& table, const char *dbname) : 
+berkeleydb_t::reverse_iterator<node_t>::reverse_iterator(buffer_allocator_t& buffer_allocator, const table_t& table, const char *dbname, int error) : 
       iterator_base<node_t>(buffer_allocator, cursor), 
-      cursor(dbname ? table.secondary_db(dbname) : table.primary_db())
+      cursor(dbname ? table.secondary_db(dbname) : table.primary_db(), error)
 {
    primdb = (dbname == nullptr);
 }
@@ -208,6 +209,44 @@ bool berkeleydb_t::reverse_iterator<node_t>::prev(storable_t<node_t>& node, type
    return true;
 }
 
+// -----------------------------------------------------------------------
+//
+// berkeleydb_t::write_queue_t
+//
+// -----------------------------------------------------------------------
+
+///
+/// Value hash collisions are resolved by comparing the value of `node` against queued
+/// records, in the same way as it is done for the values database.
+///
+template <typename node_t>
+bool berkeleydb_t::write_queue_t::copy_by_value(const table_t *table, const node_t& node, uint64_t hashval, buffer_t& buffer, size_t& keysize, size_t& datasize)
+{
+   std::lock_guard<std::mutex> lock(queue_mtx);
+   const record_t *found = nullptr;
+
+   for(std::pair<record_index_t::const_iterator, record_index_t::const_iterator> range = hashes.equal_range(hashval); range.first != range.second; ++range.first) {
+      const record_t *rec = range.first->second;
+
+      // a record waiting in the queue is more recent than the one being written
+      if(rec->table == table && (!found || !rec->writing) && !node.s_compare_value(rec->data(), rec->datasize()))
+         found = rec;
+   }
+
+   if(!found)
+      return false;
+
+   keysize = found->keysize;
+   datasize = found->datasize();
+
+   if(buffer.capacity() < found->buffer.size())
+      buffer.resize(found->buffer.size(), 0);
+
+   memcpy(buffer, found->buffer.data(), found->buffer.size());
+
+   return true;
+}
+
 // -----------------------------------------------------------------------
 //
 // berkeleydb_t::table_t
@@ -219,25 +258,73 @@ bool berkeleydb_t::table_t::put_node(const node_t& node, storage_info_t& storage
 {
    Dbt key, data;
    size_t keysize = node.s_key_size(), datasize = node.s_data_size();
-   buffer_holder_t buffer_holder(*buffer_allocator);
-   buffer_t& buffer = buffer_holder.buffer; 
+   uint64_t hashval;
 
-   if(buffer.capacity() < keysize+datasize)
-      buffer.resize(keysize+datasize, 0);
-
-   if(node.s_pack_key(buffer, keysize) != keysize)
+   // records would be lost after a write error
+   if(write_error)
       return false;
 
-   if(node.s_pack_data(buffer+keysize, datasize) != datasize)
+   // serialize the node into a record that will be written by the write-behind thread
+   if(write_queue) {
+      // records batched before the queue was set must not overwrite queued records later
+      if(!batch.empty() && write_batch())
+         return false;
+
+      std::unique_ptr<write_queue_t::record_t> rec(new write_queue_t::record_t(this, node.nodeid, keysize, datasize));
+
+      if(node.s_pack_key(rec->key(), keysize) != keysize)
+         return false;
+
+      if(node.s_pack_data(rec->data(), datasize) != datasize)
+         return false;
+
+      key.set_data(rec->key());
+      key.set_size((u_int32_t) keysize);
+
+      data.set_data(rec->data());
+      data.set_size((u_int32_t) datasize);
+
+      if((rec->hashed = get_value_hash(key, data, rec->hashval)) && filter.is_ready())
+         filter.add(rec->hashval);
+
+      if(!write_queue->push(rec.release()))
+         return false;
+
+      if(filter_overflow() && rebuild_filter())
+         return false;
+
+      // the node is in the queue, which is searched ahead of the database
+      storage_info.set_from_storage();
+
+      return true;
+   }
+
+   // serialize the node at the end of the put batch
+   size_t offset = batch_data.size();
+
+   batch_data.resize(offset + keysize + datasize);
+
+   if(node.s_pack_key(batch_data.data() + offset, keysize) != keysize || node.s_pack_data(batch_data.data() + offset + keysize, datasize) != datasize) {
+      batch_data.resize(offset);
       return false;
+   }
 
-   key.set_data(buffer);
+   batch.push_back({nullptr, offset, keysize, keysize + datasize});
+
+   key.set_data(batch_data.data() + offset);
    key.set_size((u_int32_t) keysize);
 
-   data.set_data(buffer+keysize);
+   data.set_data(batch_data.data() + offset + keysize);
    data.set_size((u_int32_t) datasize);
 
-   if(table->put(nullptr, &key, &data, 0)) 
+   if(filter.is_ready() && get_value_hash(key, data, hashval))
+      filter.add(hashval);
+
+   // write the batch once it holds enough records to fill a bulk buffer
+   if(batch_data.size() >= PUT_BATCH_SIZE && write_batch())
+      return false;
+
+   if(filter_overflow() && rebuild_filter())
       return false;
 
    // indicate that the node came from the database
@@ -246,6 +333,73 @@ bool berkeleydb_t::table_t::put_node(const node_t& node, storage_info_t& storage
    return true;
 }
 
+///
+/// Records are packed into `bulk` with `DbMultipleKeyDataBuilder` and each full buffer is
+/// put into the primary database in one call (`DB_MULTIPLE_KEY`). A record that doesn't
+/// fit into an empty bulk buffer is put on its own. Berkeley DB versions prior to v4.8
+/// don't support bulk puts and each record is put individually.
+///
+/// `record_t` must provide `key`, `keysize`, `data` and `datasize` members that describe
+/// a serialized node.
+///
+template <typename record_t>
+int berkeleydb_t::table_t::put_records(record_t * const records[], size_t count, std::vector<u_char>& bulk) const
+{
+   Dbt key, data;
+   size_t index = 0;
+   int error;
+
+#if DB_VERSION_MAJOR > 4 || DB_VERSION_MAJOR == 4 && DB_VERSION_MINOR >= 8
+   Dbt multiple;
+   size_t packed;
+
+   while(index < count) {
+      multiple.set_data(bulk.data());
+      multiple.set_ulen((u_int32_t) bulk.size());
+      multiple.set_flags(DB_DBT_USERMEM | DB_DBT_BULK);
+
+      {DbMultipleKeyDataBuilder builder(multiple);
+
+      for(packed = 0; index < count; index++, packed++) {
+         if(!builder.append(records[index]->key(), records[index]->keysize, records[index]->data(), records[index]->datasize()))
+            break;
+      }
+      }
+
+      if(packed) {
+         if((error = table->put(nullptr, &multiple, &data, DB_MULTIPLE_KEY)) != 0)
+            return error;
+
+         continue;
+      }
+
+      key.set_data(records[index]->key());
+      key.set_size((u_int32_t) records[index]->keysize);
+
+      data.set_data(records[index]->data());
+      data.set_size((u_int32_t) records[index]->datasize());
+
+      if((error = table->put(nullptr, &key, &data, 0)) != 0)
+         return error;
+
+      index++;
+   }
+#else
+   for(; index < count; index++) {
+      key.set_data(records[index]->key());
+      key.set_size((u_int32_t) records[index]->keysize);
+
+      data.set_data(records[index]->data());
+      data.set_size((u_int32_t) records[index]->datasize());
+
+      if((error = table->put(nullptr, &key, &data, 0)) != 0)
+         return error;
+   }
+#endif
+
+   return 0;
+}
+
 template <typename node_t, typename ... param_t>
 bool berkeleydb_t::table_t::get_node_by_id(storable_t<node_t>& node, typename node_t::template s_unpack_cb_t<param_t ...> upcb, param_t ... param) const
 {
@@ -257,6 +411,24 @@ bool berkeleydb_t::table_t::get_node_by_id(storable_t<node_t>& node, typename no
    if(buffer.capacity() < keysize+DBBUFSIZE)
       buffer.resize(keysize+DBBUFSIZE, 0);
 
+   // records waiting to be written are more recent than those in the database
+   if(write_queue) {
+      size_t datasize;
+
+      if(write_queue->copy_by_id(this, node.nodeid, buffer, datasize)) {
+         if(node.template s_unpack_data<param_t...>(buffer, datasize, upcb, std::forward<param_t>(param) ...) != datasize)
+            return false;
+
+         node.storage_info.set_from_storage();
+
+         return true;
+      }
+   }
+
+   // batched records are more recent than those in the database
+   if(!batch.empty() && write_batch())
+      return false;
+
    if(node.s_pack_key(buffer, keysize) != keysize)
       return false;
 
@@ -299,6 +471,33 @@ bool berkeleydb_t::table_t::get_node_by_value(storable_t<node_t>& node, typename
    hashkey = node.s_hash_value();
    keysize = (u_int32_t) node.s_hash_value_size();
 
+   // a value that was never put into this table cannot be found
+   if(filter.is_ready() && !filter.maybe_contains(hashkey)) {
+      filter_skips++;
+      return false;
+   }
+
+   // records waiting to be written are more recent than those in the database
+   if(write_queue) {
+      size_t pkeysize, datasize;
+
+      if(write_queue->copy_by_value(this, node, hashkey, buffer, pkeysize, datasize)) {
+         if(node.s_unpack_key(buffer, pkeysize) != pkeysize)
+            return false;
+
+         if(node.template s_unpack_data<param_t...>(buffer + pkeysize, datasize, upcb, std::forward<param_t>(param) ...) != datasize)
+            return false;
+
+         node.storage_info.set_from_storage();
+
+         return true;
+      }
+   }
+
+   // batched records are more recent than those in the database
+   if(!batch.empty() && write_batch())
+      return false;
+
    key.set_data(&hashkey);
    key.set_size(keysize);
 
@@ -315,8 +514,11 @@ bool berkeleydb_t::table_t::get_node_by_value(storable_t<node_t>& node, typename
    {cursor_dup_iterator cursor(values);
 
    // find the first value hash and get the primary key and value data
-   if(!cursor.set(key, data, &pkey))
+   if(!cursor.set(key, data, &pkey)) {
+      if(filter.is_ready() && cursor.get_error() == DB_NOTFOUND)
+         filter_false_positives++;
       return false;
+   }
 
    do {
       // if the node value matched, break out
@@ -326,9 +528,12 @@ bool berkeleydb_t::table_t::get_node_by_value(storable_t<node_t>& node, typename
    } while(cursor.next(key, data, &pkey));
 
    // the destructor will close the cursor
-   if(cursor.get_error())
+   if(cursor.get_error()) {
+      if(filter.is_ready() && cursor.get_error() == DB_NOTFOUND)
+         filter_false_positives++;
       return false;
    }
+   }
 
    // unpack the primary key
    if(node.s_unpack_key(pkey.get_data(), pkey.get_size()) != pkey.get_size())
@@ -346,11 +551,13 @@ bool berkeleydb_t::table_t::get_node_by_value(storable_t<node_t>& node, typename
 template <typename node_t>
 berkeleydb_t::iterator<node_t> berkeleydb_t::table_t::begin(const char *dbname) const 
 {
-   return iterator<node_t>(*buffer_allocator, *this, dbname);
+   // an iterator that would miss records reports the write error instead
+   return iterator<node_t>(*buffer_allocator, *this, dbname, wait_writes());
 }
 
 template <typename node_t>
 berkeleydb_t::reverse_iterator<node_t> berkeleydb_t::table_t::rbegin(const char *dbname) const 
 {
-   return reverse_iterator<node_t>(*buffer_allocator, *this, dbname);
+   // an iterator that would miss records reports the write error instead
+   return reverse_iterator<node_t>(*buffer_allocator, *this, dbname, wait_writes());
 }
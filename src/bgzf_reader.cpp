@@ -0,0 +1,381 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   bgzf_reader.cpp
+*/
+#include "pch.h"
+
+#include "bgzf_reader.h"
+#include "exception.h"
+
+#include <zlib.h>
+#include <errno.h>
+#include <cstring>
+#include <algorithm>
+
+bgzf_reader_t::block_t::block_t(void) :
+      cdata(new unsigned char[BGZF_MAX_BLOCK_SIZE]),
+      csize(0),
+      udata(new char[BGZF_MAX_BLOCK_SIZE]),
+      usize(0),
+      pos(0),
+      done(false),
+      error(0)
+{
+}
+
+bgzf_reader_t::bgzf_reader_t(size_t threads) :
+      file(nullptr),
+      thread_count(std::max(threads, (size_t) 1)),
+      stop_workers(false),
+      file_eof(false),
+      file_error(0),
+      skip(0)
+{
+}
+
+bgzf_reader_t::~bgzf_reader_t(void)
+{
+   close();
+}
+
+///
+/// @brief  Reads a gzip member header into `header` and returns the header size
+///         in `hdrsize` and the total member size from the `BC` subfield in
+///         `blksize`.
+///
+/// `header` must be at least `BGZF_MAX_BLOCK_SIZE` bytes long. Returns zero on
+/// success, in which case `blksize` is zero at the end of the file, or an error
+/// code if the file could not be read or if the member is not a BGZF block.
+///
+int bgzf_reader_t::read_block_size(FILE *file, unsigned char *header, size_t& hdrsize, size_t& blksize)
+{
+   const unsigned char *cp, *end;
+   size_t xlen, slen;
+
+   blksize = 0;
+
+   // ID1, ID2, CM, FLG, MTIME, XFL, OS and XLEN
+   if((hdrsize = fread(header, 1, 12, file)) == 0)
+      return ferror(file) ? (errno ? errno : EIO) : 0;
+
+   // deflate-compressed member with extra fields
+   if(hdrsize != 12 || header[0] != 0x1f || header[1] != 0x8b || header[2] != 8 || !(header[3] & 0x04))
+      return EILSEQ;
+
+   xlen = header[10] | header[11] << 8;
+
+   if(hdrsize + xlen > BGZF_MAX_BLOCK_SIZE || fread(header + hdrsize, 1, xlen, file) != xlen)
+      return EILSEQ;
+
+   hdrsize += xlen;
+
+   // look for the BC subfield, which contains the member size, less one
+   for(cp = header + 12, end = cp + xlen; cp + 4 <= end; cp += 4 + slen) {
+      slen = cp[2] | cp[3] << 8;
+
+      if(cp[0] == 'B' && cp[1] == 'C' && slen == 2 && cp + 6 <= end) {
+         blksize = (cp[4] | cp[5] << 8) + 1;
+         break;
+      }
+   }
+
+   // the member must be large enough for the header and the CRC32/ISIZE trailer
+   if(blksize < hdrsize + 8)
+      return EILSEQ;
+
+   return 0;
+}
+
+///
+/// @brief  Returns `true` if the file starts with a BGZF block.
+///
+/// The file position is moved to the start of the file.
+///
+bool bgzf_reader_t::is_bgzf(FILE *file)
+{
+   std::unique_ptr<unsigned char[]> header(new unsigned char[BGZF_MAX_BLOCK_SIZE]);
+   size_t hdrsize, blksize;
+   bool bgzf;
+
+   bgzf = read_block_size(file, header.get(), hdrsize, blksize) == 0 && blksize;
+
+   fseek(file, 0, SEEK_SET);
+
+   return bgzf;
+}
+
+///
+/// @brief  Reads the next compressed block from the file.
+///
+/// Returns zero on success, in which case `block.csize` is zero at the end of the
+/// file, or an error code if the block could not be read.
+///
+int bgzf_reader_t::read_block(block_t& block)
+{
+   size_t hdrsize;
+   int error;
+
+   if((error = read_block_size(file, block.cdata.get(), hdrsize, block.csize)) != 0)
+      return error;
+
+   if(!block.csize)
+      return 0;
+
+   if(fread(block.cdata.get() + hdrsize, 1, block.csize - hdrsize, file) != block.csize - hdrsize)
+      return ferror(file) ? (errno ? errno : EIO) : EILSEQ;
+
+   return 0;
+}
+
+///
+/// @brief  Moves the file position to the block containing the uncompressed
+///         `offset` and sets up the number of bytes to skip in this block.
+///
+/// Blocks are skipped using their header and trailer, without being inflated.
+///
+int bgzf_reader_t::seek(uint64_t offset)
+{
+   std::unique_ptr<unsigned char[]> header;
+   unsigned char isize[4];
+   uint64_t total = 0;
+   size_t hdrsize, blksize, usize;
+   int error;
+
+   skip = 0;
+
+   if(!offset)
+      return 0;
+
+   header.reset(new unsigned char[BGZF_MAX_BLOCK_SIZE]);
+
+   while(true) {
+      if((error = read_block_size(file, header.get(), hdrsize, blksize)) != 0)
+         return error;
+
+      // the offset is past the end of the file
+      if(!blksize)
+         return 0;
+
+      // ISIZE is in the last four bytes of the block
+      if(fseek(file, (long) (blksize - hdrsize - 4), SEEK_CUR) == -1 || fread(isize, 1, 4, file) != 4)
+         return errno ? errno : EIO;
+
+      usize = isize[0] | isize[1] << 8 | isize[2] << 16 | (size_t) isize[3] << 24;
+
+      // return to the start of the block containing the offset
+      if(total + usize > offset) {
+         if(fseek(file, -(long) blksize, SEEK_CUR) == -1)
+            return errno;
+
+         skip = (size_t) (offset - total);
+
+         return 0;
+      }
+
+      total += usize;
+   }
+}
+
+///
+/// @brief  Starts worker threads to inflate blocks of `file`, starting at the
+///         uncompressed `offset`.
+///
+/// The file must be opened in the binary mode and must remain open until `close`
+/// is called.
+///
+int bgzf_reader_t::open(FILE *file, uint64_t offset)
+{
+   int error;
+
+   close();
+
+   this->file = file;
+
+   file_eof = false;
+   file_error = 0;
+
+   if((error = seek(offset)) != 0)
+      return error;
+
+   stop_workers = false;
+
+   for(size_t index = 0; index < thread_count; index++)
+      workers.emplace_back(&bgzf_reader_t::worker_thread_proc, this);
+
+   return 0;
+}
+
+///
+/// @brief  Stops worker threads and discards all blocks that were not consumed.
+///
+void bgzf_reader_t::close(void)
+{
+   if(!workers.empty()) {
+      {
+         std::lock_guard<std::mutex> lock(block_mtx);
+         stop_workers = true;
+      }
+
+      work_cv.notify_all();
+
+      for(size_t index = 0; index < workers.size(); index++)
+         workers[index].join();
+
+      workers.clear();
+   }
+
+   pending.clear();
+
+   while(!window.empty()) {
+      free_blocks.push_back(window.front());
+      window.pop_front();
+   }
+
+   file = nullptr;
+}
+
+///
+/// @brief  Reads compressed blocks and queues them for inflating until there are
+///         enough blocks in flight to keep all worker threads busy.
+///
+void bgzf_reader_t::fill_window(void)
+{
+   block_t *block;
+
+   while(!file_eof && window.size() < thread_count * BLOCKS_PER_THREAD) {
+      if(free_blocks.empty()) {
+         blocks.emplace_back(new block_t());
+         block = blocks.back().get();
+      }
+      else {
+         block = free_blocks.back();
+         free_blocks.pop_back();
+      }
+
+      block->usize = block->pos = 0;
+      block->done = false;
+      block->error = 0;
+
+      if((file_error = read_block(*block)) != 0 || !block->csize) {
+         file_eof = true;
+         free_blocks.push_back(block);
+         break;
+      }
+
+      window.push_back(block);
+
+      {
+         std::lock_guard<std::mutex> lock(block_mtx);
+         pending.push_back(block);
+      }
+
+      work_cv.notify_one();
+   }
+}
+
+///
+/// @brief  Copies up to `bufsize` bytes of uncompressed data into `buffer`.
+///
+/// Returns zero on success or an error code if the file could not be read or
+/// inflated. The number of bytes copied is returned in `bytes` and will be zero
+/// at the end of the file. An error is reported only after all data preceding
+/// it was returned to the caller.
+///
+int bgzf_reader_t::read(char *buffer, size_t bufsize, size_t& bytes)
+{
+   block_t *block;
+   size_t count;
+
+   bytes = 0;
+
+   while(bytes < bufsize) {
+      fill_window();
+
+      if(window.empty())
+         return bytes ? 0 : file_error;
+
+      block = window.front();
+
+      {
+         std::unique_lock<std::mutex> lock(block_mtx);
+         done_cv.wait(lock, [block] {return block->done;});
+      }
+
+      if(block->error)
+         return bytes ? 0 : block->error;
+
+      // skip the data preceding the offset passed into open
+      if(skip) {
+         block->pos = std::min(skip, block->usize);
+         skip -= block->pos;
+      }
+
+      count = std::min(bufsize - bytes, block->usize - block->pos);
+
+      memcpy(buffer + bytes, block->udata.get() + block->pos, count);
+
+      block->pos += count;
+      bytes += count;
+
+      if(block->pos == block->usize) {
+         window.pop_front();
+         free_blocks.push_back(block);
+      }
+   }
+
+   return 0;
+}
+
+void bgzf_reader_t::worker_thread_proc(void)
+{
+   z_stream zs = {};
+   bool zinit;
+   block_t *block;
+
+   set_os_ex_translator();
+
+   // each block is a complete gzip member, so let zlib process the header and check CRC32
+   zinit = inflateInit2(&zs, 15 + 16) == Z_OK;
+
+   std::unique_lock<std::mutex> lock(block_mtx);
+
+   while(true) {
+      work_cv.wait(lock, [this] {return stop_workers || !pending.empty();});
+
+      if(stop_workers)
+         break;
+
+      block = pending.front();
+      pending.pop_front();
+
+      lock.unlock();
+
+      if(!zinit || inflateReset(&zs) != Z_OK)
+         block->error = ENOMEM;
+      else {
+         zs.next_in = block->cdata.get();
+         zs.avail_in = (uInt) block->csize;
+         zs.next_out = (Bytef*) block->udata.get();
+         zs.avail_out = (uInt) BGZF_MAX_BLOCK_SIZE;
+
+         if(inflate(&zs, Z_FINISH) == Z_STREAM_END && zs.avail_in == 0)
+            block->usize = BGZF_MAX_BLOCK_SIZE - zs.avail_out;
+         else
+            block->error = EILSEQ;
+      }
+
+      lock.lock();
+
+      block->done = true;
+
+      done_cv.notify_all();
+   }
+
+   if(zinit)
+      inflateEnd(&zs);
+}
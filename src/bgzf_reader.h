@@ -0,0 +1,105 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   bgzf_reader.h
+*/
+#ifndef BGZF_READER_H
+#define BGZF_READER_H
+
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+///
+/// @brief  A reader that inflates blocks of a BGZF-compressed file on multiple
+///         threads
+///
+/// A BGZF file is a series of gzip members, each of which holds up to 64 KB of
+/// uncompressed data and records its own compressed size in the `BC` subfield of
+/// the gzip header. Member boundaries can be found without inflating any data,
+/// so the reader reads compressed members sequentially and inflates them on worker
+/// threads, while the caller consumes uncompressed data in the original order.
+///
+/// Regular gzip files do not record member sizes and cannot be inflated this way.
+///
+class bgzf_reader_t {
+   public:
+      static constexpr size_t BGZF_MAX_BLOCK_SIZE = 65536;  ///< Maximum compressed or uncompressed block size.
+
+   private:
+      static constexpr size_t BLOCKS_PER_THREAD = 4;        ///< Number of blocks in flight per worker thread.
+
+      ///
+      /// @brief  A compressed BGZF block and its uncompressed data
+      ///
+      struct block_t {
+         std::unique_ptr<unsigned char[]> cdata;   ///< Compressed block, including the gzip header.
+         size_t      csize;                        ///< Compressed block size.
+
+         std::unique_ptr<char[]> udata;            ///< Uncompressed block data.
+         size_t      usize;                        ///< Uncompressed data size.
+         size_t      pos;                          ///< Number of uncompressed bytes consumed.
+
+         bool        done;                         ///< Has the block been inflated?
+         int         error;                        ///< An error code, if the block could not be inflated.
+
+         public:
+            block_t(void);
+      };
+
+   private:
+      FILE        *file;                  ///< Compressed file, not owned by the reader.
+
+      size_t      thread_count;           ///< Number of worker threads.
+      std::vector<std::thread> workers;   ///< Worker threads that inflate blocks.
+
+      std::mutex  block_mtx;              ///< Guards `pending`, `stop_workers` and `block_t::done`.
+      std::condition_variable work_cv;    ///< Signalled when a block is queued or workers are stopped.
+      std::condition_variable done_cv;    ///< Signalled when a block is inflated.
+
+      std::deque<block_t*> pending;       ///< Blocks waiting for a worker.
+      bool        stop_workers;
+
+      std::vector<std::unique_ptr<block_t>> blocks;   ///< Owns all blocks.
+      std::vector<block_t*> free_blocks;  ///< Blocks available for reuse.
+      std::deque<block_t*> window;        ///< Blocks in flight, in the file order.
+
+      bool        file_eof;               ///< Have all compressed blocks been read?
+      int         file_error;             ///< An error reading compressed blocks.
+      size_t      skip;                   ///< Uncompressed bytes to skip in the first block.
+
+   private:
+      static int read_block_size(FILE *file, unsigned char *header, size_t& hdrsize, size_t& blksize);
+
+      int read_block(block_t& block);
+
+      int seek(uint64_t offset);
+
+      void fill_window(void);
+
+      void worker_thread_proc(void);
+
+   public:
+      bgzf_reader_t(size_t threads);
+
+      ~bgzf_reader_t(void);
+
+      static bool is_bgzf(FILE *file);
+
+      int open(FILE *file, uint64_t offset);
+
+      void close(void);
+
+      int read(char *buffer, size_t bufsize, size_t& bytes);
+};
+
+#endif // BGZF_READER_H
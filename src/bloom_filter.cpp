@@ -0,0 +1,203 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   bloom_filter.cpp
+*/
+#include "pch.h"
+
+#include "bloom_filter.h"
+#include "serialize.h"
+
+#include <utility>
+
+bloom_filter_t::bloom_filter_t(void) :
+      mask(0),
+      capacity(0),
+      count(0)
+{
+}
+
+bloom_filter_t::bloom_filter_t(bloom_filter_t&& other) noexcept :
+      bits(std::move(other.bits)),
+      mask(other.mask),
+      capacity(other.capacity),
+      count(other.count)
+{
+   other.mask = 0;
+   other.capacity = 0;
+   other.count = 0;
+}
+
+bloom_filter_t& bloom_filter_t::operator = (bloom_filter_t&& other) noexcept
+{
+   bits = std::move(other.bits);
+   mask = other.mask;
+   capacity = other.capacity;
+   count = other.count;
+
+   other.mask = 0;
+   other.capacity = 0;
+   other.count = 0;
+
+   return *this;
+}
+
+///
+/// @brief  Spreads all bits of `hashval` over the entire 64-bit result (a SplitMix64
+///         finalizer).
+///
+uint64_t bloom_filter_t::mix(uint64_t hashval)
+{
+   hashval ^= hashval >> 30;
+   hashval *= UINT64_C(0xbf58476d1ce4e5b9);
+   hashval ^= hashval >> 27;
+   hashval *= UINT64_C(0x94d049bb133111eb);
+   hashval ^= hashval >> 31;
+
+   return hashval;
+}
+
+///
+/// The number of filter bits is rounded up to the next power of two, so bit positions
+/// can be computed with a bit mask.
+///
+void bloom_filter_t::reset(uint64_t capacity)
+{
+   uint64_t nbits = 64;
+
+   if(capacity < MIN_CAPACITY)
+      capacity = MIN_CAPACITY;
+
+   while(nbits < capacity * BITS_PER_VALUE)
+      nbits <<= 1;
+
+   bits.assign((size_t) (nbits / 64), 0);
+
+   mask = nbits - 1;
+   this->capacity = capacity;
+   count = 0;
+}
+
+void bloom_filter_t::clear(void)
+{
+   bits.assign(bits.size(), 0);
+   count = 0;
+}
+
+void bloom_filter_t::release(void)
+{
+   std::vector<uint64_t>().swap(bits);
+
+   mask = 0;
+   capacity = 0;
+   count = 0;
+}
+
+///
+/// Bit positions for each value are computed from two halves of the mixed hash value
+/// (double hashing). The step is odd, so all positions are different within a filter
+/// with the number of bits being a power of two.
+///
+/// Values are only counted if at least one of their bits was not set, so adding the
+/// same value more than once doesn't inflate the count.
+///
+bool bloom_filter_t::add(uint64_t hashval)
+{
+   uint64_t mixed = mix(hashval);
+   uint64_t pos = mixed & UINT32_MAX, step = (mixed >> 32) | 1;
+   uint64_t bit;
+   bool added = false;
+
+   for(u_int i = 0; i < HASH_COUNT; i++, pos += step) {
+      uint64_t& word = bits[(size_t) ((pos & mask) >> 6)];
+
+      bit = UINT64_C(1) << (pos & 63);
+
+      if(!(word & bit)) {
+         word |= bit;
+         added = true;
+      }
+   }
+
+   if(added)
+      count++;
+
+   return added;
+}
+
+bool bloom_filter_t::maybe_contains(uint64_t hashval) const
+{
+   uint64_t mixed = mix(hashval);
+   uint64_t pos = mixed & UINT32_MAX, step = (mixed >> 32) | 1;
+
+   for(u_int i = 0; i < HASH_COUNT; i++, pos += step) {
+      if(!(bits[(size_t) ((pos & mask) >> 6)] & (UINT64_C(1) << (pos & 63))))
+         return false;
+   }
+
+   return true;
+}
+
+size_t bloom_filter_t::s_data_size(void) const
+{
+   return serializer_t::s_size_of<u_short>() +     // version
+            serializer_t::s_size_of<uint64_t>() * 3 +  // capacity, count, word count
+            serializer_t::s_size_of<uint64_t>() * bits.size();
+}
+
+size_t bloom_filter_t::s_pack_data(void *buffer, size_t bufsize) const
+{
+   serializer_t sr(buffer, bufsize);
+   void *ptr = buffer;
+
+   ptr = sr.serialize(ptr, FILTER_VERSION);
+
+   ptr = sr.serialize(ptr, capacity);
+   ptr = sr.serialize(ptr, count);
+   ptr = sr.serialize(ptr, (uint64_t) bits.size());
+
+   for(size_t i = 0; i < bits.size(); i++)
+      ptr = sr.serialize(ptr, bits[i]);
+
+   return sr.data_size(ptr);
+}
+
+///
+/// Returns zero if the serialized filter has an unknown version or is not valid, in
+/// which case this filter is not changed.
+///
+size_t bloom_filter_t::s_unpack_data(const void *buffer, size_t bufsize)
+{
+   serializer_t sr(buffer, bufsize);
+   const void *ptr = buffer;
+   u_short version;
+   uint64_t fcapacity, fcount, nwords;
+
+   ptr = sr.deserialize(ptr, version);
+
+   if(version != FILTER_VERSION)
+      return 0;
+
+   ptr = sr.deserialize(ptr, fcapacity);
+   ptr = sr.deserialize(ptr, fcount);
+   ptr = sr.deserialize(ptr, nwords);
+
+   // the number of words must be a power of two and match the remaining data
+   if(!nwords || (nwords & (nwords - 1)) || nwords != (bufsize - sr.data_size(ptr)) / serializer_t::s_size_of<uint64_t>())
+      return 0;
+
+   bits.resize((size_t) nwords);
+
+   for(size_t i = 0; i < bits.size(); i++)
+      ptr = sr.deserialize(ptr, bits[i]);
+
+   mask = nwords * 64 - 1;
+   capacity = fcapacity;
+   count = fcount;
+
+   return sr.data_size(ptr);
+}
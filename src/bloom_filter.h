@@ -0,0 +1,95 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   bloom_filter.h
+*/
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include "types.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+///
+/// @brief  A Bloom filter of 64-bit hash values
+///
+/// A Bloom filter answers whether a hash value may have been added to the filter or
+/// was definitely never added. False positives are possible and their rate increases
+/// as more values than the filter was sized for are added, but false negatives are
+/// not, so a negative answer may be used to skip looking up a value elsewhere.
+///
+/// The filter is sized for an expected number of values at about 10-20 bits per value,
+/// which keeps the false positive rate under 1% until the expected number of values is
+/// exceeded. Hash values are mixed before bit positions are computed from them, so the
+/// filter may be used with hash values that don't spread well over all 64 bits.
+///
+/// This class is not thread-safe.
+///
+class bloom_filter_t {
+   private:
+      static const u_short FILTER_VERSION = 1;     ///< Serialized filter format version.
+
+      static const u_int   HASH_COUNT = 7;         ///< Bit positions computed for each value.
+
+      static const u_int   BITS_PER_VALUE = 10;    ///< Minimum number of bits for each expected value.
+
+      static const uint64_t MIN_CAPACITY = 65536;  ///< Minimum number of expected values.
+
+   private:
+      std::vector<uint64_t> bits;      ///< Filter bits, stored in 64-bit words.
+      uint64_t       mask;             ///< The number of filter bits, minus one (a power of two).
+      uint64_t       capacity;         ///< The number of values the filter was sized for.
+      uint64_t       count;            ///< The number of values added to the filter.
+
+   private:
+      static uint64_t mix(uint64_t hashval);
+
+   public:
+      bloom_filter_t(void);
+
+      bloom_filter_t(bloom_filter_t&& other) noexcept;
+
+      bloom_filter_t(const bloom_filter_t&) = delete;
+
+      bloom_filter_t& operator = (const bloom_filter_t&) = delete;
+
+      bloom_filter_t& operator = (bloom_filter_t&& other) noexcept;
+
+      /// Sizes the filter for `capacity` values and removes all values from the filter.
+      void reset(uint64_t capacity);
+
+      /// Removes all values from the filter, but keeps its size.
+      void clear(void);
+
+      /// Releases filter memory. The filter cannot be used until `reset` is called.
+      void release(void);
+
+      /// Returns `true` if the filter was sized via `reset` or read from storage.
+      bool is_ready(void) const {return !bits.empty();}
+
+      /// Adds a hash value to the filter and returns `true` if it was not in the filter.
+      bool add(uint64_t hashval);
+
+      /// Returns `false` if `hashval` was never added to the filter and `true` if it may have been.
+      bool maybe_contains(uint64_t hashval) const;
+
+      /// Returns the number of distinct values added to the filter (false positives are not counted).
+      uint64_t get_count(void) const {return count;}
+
+      /// Returns the number of values the filter was sized for.
+      uint64_t get_capacity(void) const {return capacity;}
+
+      size_t s_data_size(void) const;
+
+      size_t s_pack_data(void *buffer, size_t bufsize) const;
+
+      size_t s_unpack_data(const void *buffer, size_t bufsize);
+};
+
+#endif // BLOOM_FILTER_H
@@ -40,6 +40,15 @@ void ccnode_t::update(const ccnode_t& ccnode)
    xfer = ccnode.xfer;
 }
 
+void ccnode_t::merge(const ccnode_t& ccnode)
+{
+   count += ccnode.count; 
+   files += ccnode.files; 
+   pages += ccnode.pages; 
+   visits += ccnode.visits;
+   xfer += ccnode.xfer;
+}
+
 //
 // Encodes each character of a country code into five bits of the returned 64-bit 
 // integer that can be used as a database key without having to use Berkeley DB
@@ -56,6 +56,8 @@ struct ccnode_t : public htab_obj_t<const string_t&>, public keynode_t<uint64_t>
       
       void update(const ccnode_t& ccnode);
 
+      void merge(const ccnode_t& ccnode);
+
       virtual uint64_t get_hash(void) const override {return hash_ex(0, ccode);}
 
       ///
@@ -29,11 +29,14 @@
 #include "util_url.h"
 #include "util_ipaddr.h"
 #include "util_path.h"
+#include "hashtab.h"
 
 static const u_int DNS_CACHE_TTL       = 86400*30;    ///< Default TTL of an entry in the DNS cache (30 days, in seconds).
 
 static const u_int DNS_MAX_THREADS     = 100;         ///< Maximum number of DNS threads.
 
+static const u_int PARSER_MAX_THREADS  = 64;          ///< Maximum number of log record parser threads.
+
 static const double FONT_SIZE_SMALL    = 8.;          ///< Small font size for charts, in points.
 static const double FONT_SIZE_MEDIUM   = 10.;         ///< Medium font size for charts, in points.
 
@@ -82,6 +85,7 @@ config_t::config_t(void)
    prep_report = false;
    compact_db = false;
    db_info = false;
+   merge_db = false;
    end_month = false;
 
    pipe_log_names  = false;
@@ -145,6 +149,8 @@ config_t::config_t(void)
    db_cache_size = DB_DEF_CACHE_SIZE;
    db_seq_cache_size = 100;
    db_direct = false;
+   db_write_behind = false;                   // write swapped-out nodes on the main thread
+   db_value_filters = false;                  // look up all new values in the database
 
    http_port = DEF_HTTP_PORT;                 // HTTP port number
    https_port = DEF_HTTPS_PORT;               // HTTPS port number
@@ -155,6 +161,18 @@ config_t::config_t(void)
    graph_lines  = 2;                          /* graph lines (0=none)     */
    log_type = LOG_IIS;                        // (0=clf, 1=ftp, 2=squid, 3=iis, 4=apache, 5=w3c)
 
+   log_read_mode = LOG_READ_STDIO;            // read log files line by line
+   log_buf_size = logfile_t::LOG_DEF_BUF_SIZE;
+   log_read_ahead = 0;                        // read log files on the main thread
+   log_inflate_threads = 0;                   // inflate compressed log files on the reading thread
+
+   htab_load_factor = HTAB_DEF_LOAD_FACTOR;   // average number of nodes per bucket before hash tables are resized
+   htab_probing = false;                      // store hash table nodes in bucket chains
+
+   parser_threads = 0;                        // parse log records on the main thread
+
+   ua_cache_size = 10000;                     // cache results of user agent processing for 10K user agents
+
    graph_border_width = 0;
 
    graph_background_alpha = 0;                // percent: opaque=0, transparent=100
@@ -576,6 +594,16 @@ void config_t::prep_and_validate(void)
       batch = false;
    }
 
+   // the first database name after --merge-db is the database others are merged into
+   if(merge_db) {
+      if(merge_db_names.size() < 2)
+         errors.emplace_back("The --merge-db option requires a target database name and at least one database name to merge");
+      else {
+         report_db_name = merge_db_names.front();
+         merge_db_names.erase(merge_db_names.begin());
+      }
+   }
+
    //
    // If the UTC offset wasn't set and we weren't asked to skip this step, 
    // find out and use the UTC offset of the local machine.
@@ -669,6 +697,19 @@ void config_t::prep_and_validate(void)
    if(db_cache_size < DB_MIN_CACHE_SIZE)
       db_cache_size = DB_MIN_CACHE_SIZE;
 
+   if(parser_threads > PARSER_MAX_THREADS)
+      parser_threads = PARSER_MAX_THREADS;
+
+   if(log_read_ahead > logfile_t::LOG_MAX_READ_AHEAD)
+      log_read_ahead = logfile_t::LOG_MAX_READ_AHEAD;
+
+   if(log_inflate_threads > logfile_t::LOG_MAX_INFLATE_THREADS)
+      log_inflate_threads = logfile_t::LOG_MAX_INFLATE_THREADS;
+
+   // zero disables hash table resizing
+   if(htab_load_factor < 0.)
+      htab_load_factor = 0.;
+
    // check DNS/GeoIP settings
    if(dns_children) {
       if(dns_children > DNS_MAX_THREADS)
@@ -843,7 +884,7 @@ void config_t::get_config(const char *fname)
                      //
                      // This array *must* be sorted alphabetically
                      //
-                     // max key: 194; empty slots:
+                     // max key: 202; empty slots:
                      //
                      {"AcceptHostNames",     186},          // Accept host names instead of IP addresses?
                      {"AllAgents",           67},           // List all User Agents?
@@ -871,6 +912,8 @@ void config_t::get_config(const char *fname)
                      {"DbName",              145},          // State database file name
                      {"DbPath",              144},          // State database path
                      {"DbSeqCacheSize",      149},          // Database sequence cache size
+                     {"DbValueFilters",      204},          // Skip look-ups for values never stored in the database?
+                     {"DbWriteBehind",       203},          // Write swapped-out nodes on a background thread?
                      {"Debug",               8},            // Produce debug information
                      {"DecimalKBytes",       172},          // Use 1000, not 1024 as a transfer multiplier
                      {"DNSCache",            84},           // DNS Cache file name
@@ -941,6 +984,8 @@ void config_t::get_config(const char *fname)
                      {"GroupURL",            31},           // Group URL's
                      {"GroupURLDomains",     126},          // Group URL domains (proxy)
                      {"GroupUser",           74},           // Usernames to group
+                     {"HashTableLoadFactor", 200},          // Maximum hash table load factor
+                     {"HashTableProbing",    201},          // Open-addressing hash tables
                      {"HideAgent",           19},           // User Agents to hide
                      {"HideAllHosts",        63},
                      {"HideAllSites",        63},           // Hide ind. sites (0=no)
@@ -996,6 +1041,10 @@ void config_t::get_config(const char *fname)
                      {"LocalUTCOffset",      188},          // Do not use local UTC offset?
                      {"LogDir",              183},          // Log directory
                      {"LogFile",             2},            // Log file to use for input
+                     {"LogInflateThreads",   199},          // Number of threads inflating a compressed log file
+                     {"LogReadAhead",        198},          // Number of log file blocks to read ahead
+                     {"LogReadBufferSize",   196},          // Log file block buffer size
+                     {"LogReadMode",         195},          // Log file read mode (stdio, block, mmap)
                      {"LogType",             60},           // Log Type (clf/ftp/squid/iis)
                      {"MangleAgents",        24},           // Mangle User Agents
                      {"MaxAgents",           176},          // Maximum User Agents
@@ -1016,6 +1065,7 @@ void config_t::get_config(const char *fname)
                      {"PageEntryURL",        170},          // Show only pages in the entry report?
                      {"PageTitle",           194},          // URL patterns and matching page titles.
                      {"PageType",            49},           // Page Type (pageview)
+                     {"ParserThreads",       197},          // Number of log record parser threads
                      {"Quiet",               6},            // Run in quiet mode
                      {"ReallyQuiet",         29},           // Dont display ANY messages
                      {"ReportTitle",         3},            // Title for reports
@@ -1048,6 +1098,7 @@ void config_t::get_config(const char *fname)
                      {"UpstreamTraffic",     88},           // Track upstream traffic?
                      {"UseClassicMangleAgents",166},        // Use classic MangleAgents?
                      {"UseHTTPS",            44},           // Use https:// on URL's
+                     {"UserAgentCacheSize",  202},          // Number of cached user agents
                      {"UTCOffset",           160},          // UTC/local time difference
                      {"UTCTime",             30},           // Local or UTC time?
                      {"VisitTimeout",        50}            // Visit timeout (seconds)
@@ -1316,6 +1367,16 @@ void config_t::get_config(const char *fname)
          case 192: ntop_asn = atoi(value); break;
          case 193: dump_asn = (string_t::tolower(value[0]) == 'y'); break;
          case 194: page_titles.add_glist(value); break;
+         case 195: log_read_mode = get_log_read_mode(value); break;
+         case 196: log_buf_size = get_mem_size(value, logfile_t::LOG_DEF_BUF_SIZE, logfile_t::LOG_MIN_BUF_SIZE); break;
+         case 197: parser_threads = atoi(value); break;
+         case 198: log_read_ahead = atoi(value); break;
+         case 199: log_inflate_threads = atoi(value); break;
+         case 200: htab_load_factor = atof(value); break;
+         case 201: htab_probing = (string_t::tolower(value[0]) == 'y'); break;
+         case 202: ua_cache_size = atoi(value); break;
+         case 203: db_write_behind = (string_t::tolower(value[0]) == 'y'); break;
+         case 204: db_value_filters = (string_t::tolower(value[0]) == 'y'); break;
       }
    }
 
@@ -1498,7 +1559,9 @@ void config_t::proc_cmd_line(int argc, const char * const argv[])
       // check if a non-option
       if(*argv[optind] != '-') {
          // if there's no option, it's either a database name or the log file path
-         if(prep_report || compact_db || db_info)
+         if(merge_db)
+            merge_db_names.push_back(string_t(argv[optind]));
+         else if(prep_report || compact_db || db_info)
             report_db_name = argv[optind];
          else {
             // ignore the log file path if --end-month is found (use the default database)
@@ -1554,6 +1617,8 @@ void config_t::proc_cmd_line(int argc, const char * const argv[])
             end_month = true;
          else if(!string_t::compare_ci(nptr, "db-info", nlen))
             db_info = true;
+         else if(!string_t::compare_ci(nptr, "merge-db", nlen))
+            merge_db = true;
          else if(!string_t::compare_ci(nptr, "pipe-log-names", nlen))
             pipe_log_names  = true;
          else
@@ -1639,29 +1704,27 @@ void config_t::set_enable_phrase_values(bool enable)
 }
 
 ///
-/// @brief  Converts text representation of the state database cache size value 
-///         into a number in bytes.
+/// @brief  Converts text representation of a memory size value into a number in
+///         bytes.
 ///
 /// Suffixes `K`, `M` and `G` are interpreted as kilo, mega and giga multipliers.
 ///
-/// Values less than `DB_MIN_CACHE_SIZE` are ignored and `DB_MIN_CACHE_SIZE` is
-/// returned.
+/// Values less than `minsize` are ignored and `minsize` is returned.
 ///
-/// If the input value cannot be converted to a number, `DB_DEF_CACHE_SIZE` is
-/// returned. 
+/// If the input value cannot be converted to a number, `defsize` is returned. 
 ///
-uint32_t config_t::get_db_cache_size(const char *value) const
+uint32_t config_t::get_mem_size(const char *value, uint32_t defsize, uint32_t minsize) const
 {
-   unsigned long cachesize;
+   unsigned long memsize;
    char *cp1;
 
    if(value == nullptr)
-      return DB_DEF_CACHE_SIZE;
+      return defsize;
 
-   cachesize = strtoul(value, &cp1, 10);
+   memsize = strtoul(value, &cp1, 10);
 
-   if(cachesize == 0 || cachesize == ULONG_MAX)
-      return DB_DEF_CACHE_SIZE;
+   if(memsize == 0 || memsize == ULONG_MAX)
+      return defsize;
 
    // skip spaces, if any
    while(*cp1 == ' ') cp1++;
@@ -1670,30 +1733,69 @@ uint32_t config_t::get_db_cache_size(const char *value) const
    if(cp1) {
       switch(toupper(*cp1)) {
          case 'K':
-            cachesize *= 1024;
+            memsize *= 1024;
             break;
 
          case 'M':
-            cachesize *= 1024 * 1024;
+            memsize *= 1024 * 1024;
             break;
 
          case 'G':
-            cachesize *= 1024 * 1024 * 1024;
+            memsize *= 1024 * 1024 * 1024;
             break;
       }
    }
 
-   return cachesize < DB_MIN_CACHE_SIZE ? DB_MIN_CACHE_SIZE : (uint32_t) cachesize;
+   return memsize < minsize ? minsize : (uint32_t) memsize;
+}
+
+///
+/// @brief  Converts text representation of the state database cache size value 
+///         into a number in bytes.
+///
+/// See `get_mem_size` for details.
+///
+uint32_t config_t::get_db_cache_size(const char *value) const
+{
+   return get_mem_size(value, DB_DEF_CACHE_SIZE, DB_MIN_CACHE_SIZE);
+}
+
+///
+/// @brief  Converts text representation of a log file read mode into a read mode
+///         value.
+///
+/// Unknown values are interpreted as `LOG_READ_STDIO`, so log files are only read
+/// in blocks or mapped into memory when it is explicitly requested.
+///
+log_read_mode_t config_t::get_log_read_mode(const char *value) const
+{
+   if(!string_t::compare_ci(value, "block"))
+      return LOG_READ_BLOCK;
+
+   if(!string_t::compare_ci(value, "mmap"))
+      return LOG_READ_MMAP;
+
+   return LOG_READ_STDIO;
 }
 
 string_t config_t::get_db_path(void) const
 {
-   return make_path(db_path, (is_default_db()) ? db_fname : report_db_name) + '.' + db_fname_ext;
+   return get_db_path(is_default_db() ? db_fname : report_db_name);
+}
+
+string_t config_t::get_db_path(const string_t& db_fname) const
+{
+   return make_path(db_path, db_fname) + '.' + db_fname_ext;
 }
 
 string_t config_t::get_db_name(void) const
 {
-   return (is_default_db() ? db_fname : report_db_name) + '.' + db_fname_ext;
+   return get_db_name(is_default_db() ? db_fname : report_db_name);
+}
+
+string_t config_t::get_db_name(const string_t& db_fname) const
+{
+   return db_fname + '.' + db_fname_ext;
 }
 
 ///
@@ -1754,7 +1856,7 @@ void config_t::set_dns_db_path(const char *path)
 ///
 bool config_t::is_default_db(void) const
 {
-   return !prep_report && !compact_db && !db_info;
+   return !prep_report && !compact_db && !db_info && !merge_db;
 }
 
 ///
@@ -1815,7 +1917,7 @@ int config_t::get_interval(const char *value, std::vector<string_t>& errors) con
 ///
 bool config_t::is_maintenance(void) const
 {
-   return compact_db || end_month || prep_report || db_info;   // is it a maintenance run?
+   return compact_db || end_month || prep_report || db_info || merge_db;   // is it a maintenance run?
 }
 
 ///
@@ -19,6 +19,7 @@
 #include "tstamp.h"
 #include "tmranges.h"
 #include "logrec.h"
+#include "logfile.h"
 
 #include <vector>
 
@@ -83,6 +84,7 @@ class config_t {
       bool prep_report;                         ///< prepare a report from a database
       bool compact_db;                          ///< compact database
       bool db_info;                             ///< print database information
+      bool merge_db;                            ///< merge state databases into the report database
       bool end_month;                           ///< end active visits, update totals, etc for the current month
       
       // run flags
@@ -176,6 +178,18 @@ class config_t {
 
       log_type_t log_type;                      ///< Log file type
 
+      log_read_mode_t log_read_mode;            ///< Log file read mode (stdio, block, mmap)
+      uint32_t log_buf_size;                    ///< Log file block buffer size, in bytes
+      u_int log_read_ahead;                     ///< Number of log file blocks read ahead on a separate thread (0=none)
+      u_int log_inflate_threads;                ///< Number of threads inflating a BGZF log file (0=none)
+
+      double htab_load_factor;                  ///< Maximum average number of nodes per hash table bucket (0=fixed size)
+      bool htab_probing;                        ///< Store nodes of larger hash tables in open-addressing slots?
+
+      u_int parser_threads;                     ///< Number of log record parser threads (0=main thread)
+
+      size_t ua_cache_size;                     ///< Maximum number of cached user agent processing results (0=none)
+
       u_int graph_border_width;                 ///< PNG graph border width, in pixels
 
       u_int graph_background_alpha;             ///< PNG graph background transparency, in percent (opaque=0, transparent=100)
@@ -199,6 +213,8 @@ class config_t {
       uint32_t db_cache_size;                   ///< Database cache size, in bytes.
       uint32_t db_seq_cache_size;               ///< Database sequence cache size, in elements.
       bool db_direct;                           ///< use system buffering?
+      bool db_write_behind;                     ///< Write swapped-out nodes on a background thread?
+      bool db_value_filters;                    ///< Skip database look-ups for values never stored in the database?
 
       u_int visit_timeout;                      ///< visit timeout, in seconds (30 min)   
       u_int max_visit_length;                   ///< maximum visit length, in seconds
@@ -243,6 +259,7 @@ class config_t {
       string_t db_fname;                        ///< Monthly state database file name
       string_t db_fname_ext;                    ///< Monthly state database file extension
       string_t report_db_name;                  ///< Path to a state database file for a historical report
+      std::vector<string_t> merge_db_names;     ///< State database names merged into `report_db_name`
       string_t log_dir;                         ///< Optional log file directory
 
       string_t ext_map_url;                     ///< URL for a 3rd-party map service that can interpret latitude/longitude
@@ -349,8 +366,12 @@ class config_t {
 
       void set_enable_phrase_values(bool enable);
 
+      uint32_t get_mem_size(const char *value, uint32_t defsize, uint32_t minsize) const;
+
       uint32_t get_db_cache_size(const char *value) const;
 
+      log_read_mode_t get_log_read_mode(const char *value) const;
+
       int get_interval(const char *value, std::vector<string_t>& errors) const;
 
       bool process_includes(void);
@@ -395,9 +416,15 @@ class config_t {
       /// Concatenates all state database path and file components and returns the combined path.
       string_t get_db_path(void) const;
 
+      /// Concatenates the database directory, `db_fname` and the database extension and returns the combined path.
+      string_t get_db_path(const string_t& db_fname) const;
+
       /// Concatenates the current state database file name and extension and returns the combined database name.
       string_t get_db_name(void) const;
 
+      /// Concatenates `db_fname` and the database extension and returns the combined database name.
+      string_t get_db_name(const string_t& db_fname) const;
+
       bool is_default_db(void) const;
 
       void report_config(void) const;
@@ -39,6 +39,15 @@ ctnode_t::ctnode_t(ctnode_t&& ctnode) :
 {
 }
 
+void ctnode_t::merge(const ctnode_t& ctnode)
+{
+   hits += ctnode.hits;
+   files += ctnode.files;
+   pages += ctnode.pages;
+   visits += ctnode.visits;
+   xfer += ctnode.xfer;
+}
+
 uint64_t ctnode_t::make_nodeid(uint32_t geoname_id, const char *ccode)
 {
    // we shouldn't ever have a city without a country, so this should return a zero
@@ -171,7 +180,7 @@ ctnode_t& ct_hash_table::get_ctnode(uint32_t geoname_id, const string_t& city, c
    if((ctnode = find_node(hashval, OBJ_REG, tstamp, geoname_id, ccode)) != nullptr)
       return *ctnode;
 
-   return *put_node(hashval, new storable_t<ctnode_t>(geoname_id, city, ccode), tstamp);
+   return *put_node(hashval, new_node(geoname_id, city, ccode), tstamp);
 }
 
 //
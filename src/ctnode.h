@@ -60,6 +60,9 @@ struct ctnode_t : htab_obj_t<uint32_t, const string_t&>, keynode_t<uint64_t>, da
 
       ctnode_t(ctnode_t&& ctnode);
 
+      /// Adds counters of another node for the same city to this node.
+      void merge(const ctnode_t& ctnode);
+
       /// Returns the GeoName ID for this city.
       uint32_t geoname_id(void) const {return (uint32_t) nodeid;}
 
@@ -12,6 +12,8 @@
 #include "daily.h"
 #include "serialize.h"
 
+#include <algorithm>
+
 daily_t::daily_t(u_int day) : keynode_t<uint32_t>(day)
 {
    td_hours = 0;
@@ -37,6 +39,49 @@ void daily_t::reset(u_int day)
    h_hits_avg = h_files_avg = h_pages_avg = h_visits_avg = h_hosts_avg = .0;
 }
 
+///
+/// Adds daily totals in `daily` for the same day to this node.
+///
+/// Databases being merged are expected to contain logs that were processed in
+/// parallel for the same time period, so the number of hours processed in the
+/// merged day is the larger of the two and hourly averages are computed as the
+/// sum of hourly values in both nodes divided by this number. Values for each 
+/// individual hour are not stored, so hourly maximums are set to the larger of
+/// the two maximums.
+///
+void daily_t::merge(const daily_t& daily)
+{
+   u_short hours = std::max(td_hours, daily.td_hours);
+
+   auto merge_avg = [this, &daily, hours](double avg, double other_avg) -> double
+   {
+      return hours ? (avg * td_hours + other_avg * daily.td_hours) / hours : .0;
+   };
+
+   h_hits_avg = merge_avg(h_hits_avg, daily.h_hits_avg);
+   h_files_avg = merge_avg(h_files_avg, daily.h_files_avg);
+   h_pages_avg = merge_avg(h_pages_avg, daily.h_pages_avg);
+   h_visits_avg = merge_avg(h_visits_avg, daily.h_visits_avg);
+   h_hosts_avg = merge_avg(h_hosts_avg, daily.h_hosts_avg);
+   h_xfer_avg = merge_avg(h_xfer_avg, daily.h_xfer_avg);
+
+   h_hits_max = std::max(h_hits_max, daily.h_hits_max);
+   h_files_max = std::max(h_files_max, daily.h_files_max);
+   h_pages_max = std::max(h_pages_max, daily.h_pages_max);
+   h_visits_max = std::max(h_visits_max, daily.h_visits_max);
+   h_hosts_max = std::max(h_hosts_max, daily.h_hosts_max);
+   h_xfer_max = std::max(h_xfer_max, daily.h_xfer_max);
+
+   tm_hits += daily.tm_hits;
+   tm_files += daily.tm_files;
+   tm_pages += daily.tm_pages;
+   tm_hosts += daily.tm_hosts;
+   tm_visits += daily.tm_visits;
+   tm_xfer += daily.tm_xfer;
+
+   td_hours = hours;
+}
+
 //
 // serialization
 //
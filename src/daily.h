@@ -54,6 +54,8 @@ struct daily_t : public keynode_t<uint32_t>, public datanode_t<daily_t> {
 
          void reset(u_int day);
 
+         void merge(const daily_t& daily);
+
          //
          // serialization
          //
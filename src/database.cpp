@@ -26,6 +26,10 @@
 
 #include <type_traits>
 #include <utility>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <system_error>
 
 //
 // B-Tree group field extraction function template
@@ -273,7 +277,15 @@ const struct database_t::index_desc_t {
 //
 // -----------------------------------------------------------------------
 
-database_t::database_t(const ::config_t& config) : berkeleydb_t(db_config_t(config)),
+database_t::database_t(const ::config_t& config) : database_t(db_config_t(config))
+{
+}
+
+database_t::database_t(const ::config_t& config, const string_t& db_fname) : database_t(db_config_t(config, db_fname))
+{
+}
+
+database_t::database_t(db_config_t&& db_config) : berkeleydb_t(std::move(db_config)),
       system(make_table()),
       urls(make_table()),
       hosts(make_table()),
@@ -299,12 +311,24 @@ database_t::~database_t(void)
 {
 }
 
-berkeleydb_t::status_t database_t::attach_indexes(bool rebuild)
+///
+/// Indexes that are not attached are not maintained as their tables change and may
+/// not be traversed until they are attached with `rebuild` set to `true`. If indexes
+/// are rebuilt in parallel, `use_index_cb` may be called on multiple threads.
+///
+berkeleydb_t::status_t database_t::attach_indexes(bool rebuild, use_index_cb_t use_index_cb, void *arg)
 {
    status_t status;
 
-   // attach all registered indexes
+   // rebuilding indexes scans primary tables, which may be done for all tables at once
+   if(rebuild && get_parallel_indexes())
+      return attach_indexes_parallel(use_index_cb, arg);
+
+   // attach all requested indexes
    for(size_t i = 0; i < sizeof(index_desc)/sizeof(index_desc[0]); i++) {
+      if(use_index_cb && !use_index_cb(index_desc[i].index_db, arg))
+         continue;
+
       if(!(status = (this->*index_desc[i].table).associate(index_desc[i].index_db, index_desc[i].index_extract_cb, rebuild)).success())
          return status;
    }
@@ -312,6 +336,88 @@ berkeleydb_t::status_t database_t::attach_indexes(bool rebuild)
    return status;
 }
 
+///
+/// @brief  Associates and rebuilds all requested indexes of `table`, one after
+///         another.
+///
+/// This method may be called on any thread and reports Berkeley DB exceptions as
+/// errors, so they don't escape the thread.
+///
+berkeleydb_t::status_t database_t::attach_table_indexes(table_t database_t::*table, use_index_cb_t use_index_cb, void *arg)
+{
+   status_t status;
+   const char *index_db = nullptr;
+
+   try {
+      for(size_t i = 0; i < sizeof(index_desc)/sizeof(index_desc[0]); i++) {
+         if(index_desc[i].table == table && (!use_index_cb || use_index_cb(index_desc[i].index_db, arg))) {
+            index_db = index_desc[i].index_db;
+
+            if(!(status = (this->*table).associate(index_desc[i].index_db, index_desc[i].index_extract_cb, true)).success())
+               return status;
+         }
+      }
+   }
+   catch (const DbException& err) {
+      return string_t::_format("Cannot rebuild index %s (%s)", index_db, err.what());
+   }
+   catch (const std::exception& err) {
+      return err.what();
+   }
+
+   return status;
+}
+
+///
+/// @brief  Rebuilds all indexes on a separate thread for each indexed table.
+///
+/// Berkeley DB rebuilds a secondary database by scanning its primary database, so
+/// rebuilding indexes is mostly spent reading primary databases. Each table has its
+/// own primary database handle, so tables are scanned concurrently, while indexes
+/// of the same table are associated one after another on the same thread, so the
+/// same primary database handle is never associated concurrently.
+///
+/// If a thread cannot be started, indexes of that table are rebuilt on the calling
+/// thread. The first error in the order of index descriptors is returned.
+///
+berkeleydb_t::status_t database_t::attach_indexes_parallel(use_index_cb_t use_index_cb, void *arg)
+{
+   std::vector<table_t database_t::*> idx_tables;
+   std::vector<status_t> results;
+   std::vector<std::thread> threads;
+
+   // collect tables with requested indexes in the order of index descriptors
+   for(size_t i = 0; i < sizeof(index_desc)/sizeof(index_desc[0]); i++) {
+      if(use_index_cb && !use_index_cb(index_desc[i].index_db, arg))
+         continue;
+
+      if(std::find(idx_tables.begin(), idx_tables.end(), index_desc[i].table) == idx_tables.end())
+         idx_tables.push_back(index_desc[i].table);
+   }
+
+   results.resize(idx_tables.size());
+   threads.reserve(idx_tables.size());
+
+   for(size_t i = 0; i < idx_tables.size(); i++) {
+      try {
+         threads.emplace_back([this, &idx_tables, &results, i, use_index_cb, arg] {results[i] = attach_table_indexes(idx_tables[i], use_index_cb, arg);});
+      }
+      catch (const std::system_error&) {
+         results[i] = attach_table_indexes(idx_tables[i], use_index_cb, arg);
+      }
+   }
+
+   for(size_t i = 0; i < threads.size(); i++)
+      threads[i].join();
+
+   for(size_t i = 0; i < results.size(); i++) {
+      if(!results[i].success())
+         return std::move(results[i]);
+   }
+
+   return status_t();
+}
+
 berkeleydb_t::status_t database_t::open(void)
 {
    status_t status;
@@ -375,6 +481,12 @@ berkeleydb_t::status_t database_t::open(void)
       // open the primary database that contains all data
       if(!(status = (this->*table_desc[i].table).open(table_desc[i].primary_db, table_desc[i].key_compare_cb)).success())
          return status;
+
+      // set up a value filter to skip look-ups of values that were never stored in this table
+      if(get_value_filters() && table_desc[i].value_db && table_desc[i].sequence_db) {
+         if(!(status = (this->*table_desc[i].table).open_filter(table_desc[i].primary_db)).success())
+            return status;
+      }
    }
 
    return status;
@@ -35,7 +35,12 @@ class db_config_t : public berkeleydb_t::config_t {
       {
       }
 
-      const db_config_t& clone(void) const override {return *new db_config_t(config);}
+      db_config_t(const ::config_t& config, const string_t& db_fname) :
+            config(config), db_path(config.get_db_path(db_fname)), db_name(config.get_db_name(db_fname))
+      {
+      }
+
+      const db_config_t& clone(void) const override {return *new db_config_t(*this);}
 
       void release(void) const override {delete this;}
 
@@ -84,6 +89,10 @@ class system_database_t : public berkeleydb_t {
 /// @brief  Application-specific database management class
 ///
 class database_t : public berkeleydb_t {
+   public:
+      /// Returns `true` if the index `index_db` should be attached and `false` otherwise.
+      typedef bool (*use_index_cb_t)(const char *index_db, void *arg);
+
    private:
       struct table_desc_t;
       struct index_desc_t;
@@ -111,14 +120,25 @@ class database_t : public berkeleydb_t {
       table_t           cities;
       table_t           asn;
 
+   private:
+      database_t(db_config_t&& db_config);
+
+      status_t attach_table_indexes(table_t database_t::*table, use_index_cb_t use_index_cb, void *arg);
+
+      status_t attach_indexes_parallel(use_index_cb_t use_index_cb, void *arg);
+
    public:
       database_t(const ::config_t& config);
 
+      /// Constructs a database object for a state database file `db_fname` in the database directory.
+      database_t(const ::config_t& config, const string_t& db_fname);
+
       ~database_t(void);
 
       status_t open(void);
 
-      status_t attach_indexes(bool rebuild);
+      /// Attaches all indexes or, if `use_index_cb` is not `nullptr`, only those for which it returns `true`.
+      status_t attach_indexes(bool rebuild, use_index_cb_t use_index_cb = nullptr, void *arg = nullptr);
 
       // urls
       uint64_t get_unode_id(void) {return (uint64_t) urls.get_seq_id();}
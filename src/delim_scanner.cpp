@@ -0,0 +1,260 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   delim_scanner.cpp
+*/
+#include "pch.h"
+
+#include "delim_scanner.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DELIM_SCANNER_X86
+#endif
+
+#ifdef DELIM_SCANNER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+//
+// GCC and Clang require functions using SSE4.2 and AVX2 intrinsics to be compiled
+// for these instruction sets, so the rest of the code can run on any x86 CPU.
+// VC++ allows intrinsics for any instruction set in any function.
+//
+#if defined(__GNUC__)
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE42
+#define TARGET_AVX2
+#endif
+
+delim_scanner_t::isa_t delim_scanner_t::isa = delim_scanner_t::get_cpu_isa();
+
+#ifdef DELIM_SCANNER_X86
+
+static inline u_int bit_scan_forward(uint32_t mask)
+{
+#ifdef _MSC_VER
+   unsigned long index;
+   _BitScanForward(&index, mask);
+   return (u_int) index;
+#else
+   return (u_int) __builtin_ctz(mask);
+#endif
+}
+
+///
+/// @brief  Returns a bit mask of delimiter and zero characters in `data`.
+///
+/// `_mm_cmpistrm` stops comparing at the first zero character, which is included
+/// in the mask separately.
+///
+TARGET_SSE42 static inline uint32_t sse42_delim_mask(__m128i set, __m128i data)
+{
+   return (uint32_t) _mm_cvtsi128_si32(_mm_cmpistrm(set, data, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK)) |
+            (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(data, _mm_setzero_si128()));
+}
+
+///
+/// @brief  Returns a pointer to the first delimiter or zero character in the 16-byte
+///         blocks of `str` that end at or before `end`, or a pointer to the first
+///         character following the last of these blocks if there is none.
+///
+TARGET_SSE42 static const char *sse42_find(const char *str, const char *end, const char *delims)
+{
+   __m128i set = _mm_load_si128((const __m128i*) delims);
+   const char *block;
+   uint32_t mask;
+
+   if(end - str < 16)
+      return str;
+
+   // the first block is unaligned, so characters preceding the string are not evaluated
+   if((mask = sse42_delim_mask(set, _mm_loadu_si128((const __m128i*) str))) != 0)
+      return str + bit_scan_forward(mask);
+
+   for(block = (const char*) (((uintptr_t) str + 16) & ~(uintptr_t) 15); end - block >= 16; block += 16) {
+      if((mask = sse42_delim_mask(set, _mm_load_si128((const __m128i*) block))) != 0)
+         return block + bit_scan_forward(mask);
+   }
+
+   return block;
+}
+
+///
+/// @brief  Returns a bit mask of delimiter and zero characters in `data`.
+///
+/// Each character is classified by looking up bit masks of high nibbles for its
+/// low nibble in `lo_table` and checking if the bit for its own high nibble is
+/// set. Characters with the high bit set are never delimiters.
+///
+TARGET_AVX2 static inline uint32_t avx2_delim_mask(__m256i lo_table, __m256i data)
+{
+   const __m256i hi_table = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+                                             1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+   const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+   __m256i lo_bits = _mm256_shuffle_epi8(lo_table, _mm256_and_si256(data, nibble));
+   __m256i hi_bits = _mm256_shuffle_epi8(hi_table, _mm256_and_si256(_mm256_srli_epi16(data, 4), nibble));
+
+   return ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(lo_bits, hi_bits), _mm256_setzero_si256()));
+}
+
+///
+/// @brief  Returns a pointer to the first delimiter or zero character in the 32-byte
+///         blocks of `str` that end at or before `end`, or a pointer to the first
+///         character following the last of these blocks if there is none.
+///
+TARGET_AVX2 static const char *avx2_find(const char *str, const char *end, const u_char *lo_nibbles)
+{
+   __m256i lo_table = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*) lo_nibbles));
+   const char *block;
+   uint32_t mask;
+
+   if(end - str < 32)
+      return str;
+
+   // the first block is unaligned, so characters preceding the string are not evaluated
+   if((mask = avx2_delim_mask(lo_table, _mm256_loadu_si256((const __m256i*) str))) != 0)
+      return str + bit_scan_forward(mask);
+
+   for(block = (const char*) (((uintptr_t) str + 32) & ~(uintptr_t) 31); end - block >= 32; block += 32) {
+      if((mask = avx2_delim_mask(lo_table, _mm256_load_si256((const __m256i*) block))) != 0)
+         return block + bit_scan_forward(mask);
+   }
+
+   return block;
+}
+
+#endif // DELIM_SCANNER_X86
+
+delim_scanner_t::delim_scanner_t(const char *delims)
+{
+   size_t count = strlen(delims);
+
+   if(count > MAX_DELIMS)
+      throw std::logic_error("Too many delimiters for a delimiter scanner");
+
+   memset(this->delims, 0, sizeof(this->delims));
+   memset(lo_nibbles, 0, sizeof(lo_nibbles));
+   memset(table, 0, sizeof(table));
+
+   memcpy(this->delims, delims, count);
+
+   // the terminating zero character is always a delimiter
+   table[0] = true;
+   lo_nibbles[0] = 1;
+
+   for(size_t index = 0; index < count; index++) {
+      u_char chr = (u_char) delims[index];
+
+      if(chr >= 0x80)
+         throw std::logic_error("Delimiter scanners only support ASCII delimiters");
+
+      table[chr] = true;
+      lo_nibbles[chr & 0x0F] |= (u_char) (1 << (chr >> 4));
+   }
+}
+
+const char *delim_scanner_t::find_scalar(const char *str) const
+{
+   while(!table[(u_char) *str])
+      str++;
+
+   return str;
+}
+
+///
+/// Only whole blocks preceding `end` are read with SIMD instructions and the rest
+/// of the string is evaluated one character at a time, so memory following `end`
+/// is never read. A delimiter found in a block is returned by the scalar scan as
+/// is.
+///
+const char *delim_scanner_t::find_sse42(const char *str, const char *end) const
+{
+#ifdef DELIM_SCANNER_X86
+   return find_scalar(sse42_find(str, end, delims));
+#else
+   return find_scalar(str);
+#endif
+}
+
+const char *delim_scanner_t::find_avx2(const char *str, const char *end) const
+{
+#ifdef DELIM_SCANNER_X86
+   return find_scalar(avx2_find(str, end, lo_nibbles));
+#else
+   return find_scalar(str);
+#endif
+}
+
+///
+/// @brief  Returns the best instruction set supported by the CPU.
+///
+delim_scanner_t::isa_t delim_scanner_t::get_cpu_isa(void)
+{
+#if defined(DELIM_SCANNER_X86) && defined(__GNUC__)
+   __builtin_cpu_init();
+
+   if(__builtin_cpu_supports("avx2"))
+      return ISA_AVX2;
+
+   if(__builtin_cpu_supports("sse4.2"))
+      return ISA_SSE42;
+#elif defined(DELIM_SCANNER_X86) && defined(_MSC_VER)
+   int info[4];
+   int max_leaf;
+   bool avx;
+
+   __cpuid(info, 0);
+   max_leaf = info[0];
+
+   __cpuid(info, 1);
+
+   // AVX state must be enabled by the OS (OSXSAVE and XCR0 bits 1 and 2)
+   avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+
+   if(avx && max_leaf >= 7) {
+      int info7[4];
+
+      __cpuidex(info7, 7, 0);
+
+      if(info7[1] & (1 << 5))
+         return ISA_AVX2;
+   }
+
+   if(info[2] & (1 << 20))
+      return ISA_SSE42;
+#endif
+
+   return ISA_SCALAR;
+}
+
+///
+/// @brief  Changes the instruction set used by all scanners and returns the one
+///         used before.
+///
+/// Instruction sets not supported by the CPU are replaced with the best one that
+/// is supported. This method is intended for testing and must not be called while
+/// any strings are being scanned.
+///
+delim_scanner_t::isa_t delim_scanner_t::set_isa(isa_t isa)
+{
+   isa_t prev_isa = delim_scanner_t::isa;
+   isa_t cpu_isa = get_cpu_isa();
+
+   delim_scanner_t::isa = isa > cpu_isa ? cpu_isa : isa;
+
+   return prev_isa;
+}
@@ -0,0 +1,84 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   delim_scanner.h
+*/
+#ifndef DELIM_SCANNER_H
+#define DELIM_SCANNER_H
+
+#include "types.h"
+
+#include <cstddef>
+
+///
+/// @brief  Finds the first character from a small set of ASCII delimiters in
+///         a zero-terminated string
+///
+/// The terminating zero character is always treated as a delimiter. SIMD scans
+/// only read whole blocks of characters preceding the end of the string passed
+/// into `find`, and the remainder of the string is scanned one character at a
+/// time, so `find` never reads past the end of the string.
+///
+/// Strings are scanned 32 characters at a time with AVX2 instructions, or 16
+/// characters at a time with SSE4.2 instructions, depending on what the CPU
+/// supports. The instruction set is selected once for all scanners and may be
+/// changed for testing.
+///
+class delim_scanner_t {
+   public:
+      /// Instruction sets used to scan strings.
+      enum isa_t {ISA_SCALAR, ISA_SSE42, ISA_AVX2};
+
+      static constexpr size_t MAX_DELIMS = 15;     ///< Maximum number of delimiters, excluding the zero character.
+
+   private:
+      static isa_t   isa;                 ///< Instruction set used by all scanners.
+
+      alignas(16) char delims[MAX_DELIMS+1];    ///< Zero-terminated delimiters (SSE4.2).
+
+      alignas(16) u_char lo_nibbles[16];  ///< Bit masks of high nibbles for each low nibble of a delimiter (AVX2).
+
+      bool           table[256];          ///< Delimiter flags indexed by character (scalar).
+
+   private:
+      const char *find_scalar(const char *str) const;
+
+      const char *find_sse42(const char *str, const char *end) const;
+
+      const char *find_avx2(const char *str, const char *end) const;
+
+   public:
+      delim_scanner_t(const char *delims);
+
+      ///
+      /// @brief  Returns a pointer to the first delimiter or the terminating zero
+      ///         character in `str`.
+      ///
+      /// `end` must point to the terminating zero character or to any character
+      /// in front of it, which limits how far ahead blocks of characters may be
+      /// read.
+      ///
+      const char *find(const char *str, const char *end) const
+      {
+         switch(isa) {
+            case ISA_AVX2:
+               return find_avx2(str, end);
+            case ISA_SSE42:
+               return find_sse42(str, end);
+            default:
+               return find_scalar(str);
+         }
+      }
+
+      static isa_t get_cpu_isa(void);
+
+      static isa_t get_isa(void) {return isa;}
+
+      static isa_t set_isa(isa_t isa);
+};
+
+#endif // DELIM_SCANNER_H
@@ -13,6 +13,7 @@
 #include "hnode.h"
 #include "serialize.h"
 #include "exception.h"
+#include "util_math.h"
 
 #include <typeinfo>
 
@@ -122,6 +123,26 @@ uint64_t dlnode_t::get_hash(void) const
    return hash_ex(hash_ex(0, hnode ? hnode->string : string_t()), name);
 }
 
+///
+/// Adds counters of `dlnode`, which must have the same name and the same host IP
+/// address, to this node. Average transfer amounts and processing times are combined
+/// using download counts of both nodes as weights.
+///
+/// Active downloads are not merged.
+///
+void dlnode_t::merge(const dlnode_t& dlnode)
+{
+   if(dlnode.count) {
+      avgxfer = AVG2(avgxfer, count, dlnode.avgxfer, dlnode.count);
+      avgtime = AVG2(avgtime, count, dlnode.avgtime, dlnode.count);
+   }
+
+   count += dlnode.count;
+   sumhits += dlnode.sumhits;
+   sumxfer += dlnode.sumxfer;
+   sumtime += dlnode.sumtime;
+}
+
 //
 // serialization
 //
@@ -82,6 +82,8 @@ struct dlnode_t : public htab_obj_t<const string_t&, const string_t&>, public ke
 
          void reset(uint64_t nodeid = 0);
 
+         void merge(const dlnode_t& dlnode);
+
          bool match_key(const string_t& ipaddr, const string_t& dlname) const override;
 
          static uint64_t hash_key(const string_t& ipaddr, const string_t& dlname) 
@@ -443,7 +443,7 @@ dns_db_record_t dns_resolver_t::dnode_t::get_db_record(const tstamp_t& ts_runtim
 }
 
 ///
-/// Converts the IP address string from the host node into a sockaddr of 
+/// Copies the binary IP address of the host node into a sockaddr of 
 /// the appropriate type. 
 /// 
 /// Note that while we could do this in the constructor, having a separate 
@@ -458,14 +458,13 @@ bool dns_resolver_t::dnode_t::fill_sockaddr(void)
    if(!hnode)
       return false;
 
-   if(s_addr_ip.sa_family == AF_INET) {
-      if(inet_pton(AF_INET, hnode->string, &s_addr_ipv4.sin_addr) != 1)
-         return false;
-   }
-   else if(s_addr_ip.sa_family == AF_INET6) {
-      if(inet_pton(AF_INET6, hnode->string, &s_addr_ipv6.sin6_addr) != 1)
-         return false;
-   }
+   // host nodes carry the binary address parsed with the log record or read from the database
+   if(s_addr_ip.sa_family == AF_INET && hnode->hostaddr.get_family() == ipaddr_t::IPV4)
+      memcpy(&s_addr_ipv4.sin_addr, hnode->hostaddr.get_ipv4_bytes(), sizeof(s_addr_ipv4.sin_addr));
+   else if(s_addr_ip.sa_family == AF_INET6 && hnode->hostaddr.get_family() == ipaddr_t::IPV6)
+      memcpy(&s_addr_ipv6.sin6_addr, hnode->hostaddr.get_bytes(), sizeof(s_addr_ipv6.sin6_addr));
+   else
+      return false;
 
    return true;
 }
@@ -550,9 +549,9 @@ bool dns_resolver_t::put_hnode(hnode_t *hnode)
    if(!hnode || hnode->string.isempty() || hnode->string[0] == ' ') 
       return false;
    
-   if(is_ipv4_address(hnode->string))
+   if(hnode->hostaddr.get_family() == ipaddr_t::IPV4)
       sa_family = AF_INET;
-   else if(is_ipv6_address(hnode->string))
+   else if(hnode->hostaddr.get_family() == ipaddr_t::IPV6)
       sa_family = AF_INET6;
    else
       sa_family = AF_UNSPEC;
@@ -14,14 +14,18 @@
 #include "tstring.h"
 #include "types.h"
 #include "storable.h"
+#include "slab_allocator.h"
 
-#include <list>
 #include <stdexcept>
+#include <tuple>
+#include <type_traits>
 
 const unsigned long LMAXHASH = 1048576ul;
 const unsigned long MAXHASH = 16384ul;
 const unsigned long SMAXHASH = 1024ul;
 
+const double HTAB_DEF_LOAD_FACTOR = 1.;   ///< Default maximum number of nodes per bucket before a hash table is resized.
+
 ///
 /// Hash tables may contain primary objects, such as user agents or URLs, and 
 /// object groups, such all versions of a particular browser or all URLs in a 
@@ -32,6 +36,15 @@ enum nodetype_t {
    OBJ_GRP = 2                      /* Grouped object               */
 };
 
+///
+/// Hash table nodes may be stored in bucket chains, which is the default, or in
+/// compact open-addressing slot arrays. See `hash_table` for details.
+///
+enum htab_storage_t {
+   HTAB_CHAINED,                    ///< Nodes are linked in bucket chains
+   HTAB_PROBED                      ///< Nodes are stored in linearly-probed slot arrays
+};
+
 ///
 /// @name   Hash functions
 ///
@@ -65,9 +78,6 @@ struct hash_string {
    }
 };
 
-template <typename node_t> struct htab_node_t;
-template <typename node_t> using node_list_t = std::list<htab_node_t<node_t>*>;
-
 ///
 /// @brief  A generic hash table object interface.
 ///
@@ -111,8 +121,14 @@ struct htab_obj_t {
 /// @brief  A hash table node that contains a single object of `node_t` type and
 ///         is linked to other `htab_node_t` nodes with the same key hash value.
 ///
-/// Hash table `node_t` ojects must be dynamically allocated and will be deleted
-/// by calling the `delete` operator.
+/// Hash table `node_t` ojects are not owned by this node and are destroyed by the
+/// hash table, which knows whether they were allocated from its own slabs or from
+/// the heap.
+///
+/// Each node is also linked into either the time-ordered list of regular nodes or
+/// the group node list via `lsnext` and `lsprev`, so moving a node within its list
+/// does not allocate any memory. Hash table nodes are allocated from the slab allocator
+/// of the hash table that owns them.
 ///
 template <typename node_t> 
 struct htab_node_t {
@@ -122,18 +138,86 @@ struct htab_node_t {
       uint64_t       hashval;              ///< Hash value of the node object.
       int64_t        tstamp;               ///< Relative time stamp associated with this node.
 
-      typename node_list_t<node_t>::iterator    lsnode;
+      htab_node_t    *lsnext;              ///< Next node in the time stamp or group list
+      htab_node_t    *lsprev;              ///< Previous node in the time stamp or group list
 
       public:
-         htab_node_t(node_t *node, uint64_t hashval, typename node_list_t<node_t>::iterator lsnode, int64_t tstamp) :
-               node(node), next(nullptr), prev(nullptr), tstamp(tstamp), lsnode(lsnode), hashval(hashval)
+         htab_node_t(node_t *node, uint64_t hashval, int64_t tstamp) :
+               node(node), next(nullptr), prev(nullptr), hashval(hashval), tstamp(tstamp), lsnext(nullptr), lsprev(nullptr)
          {
          }
+};
 
-         ~htab_node_t(void) 
-         {
-            delete node;
+///
+/// @brief  Evaluates to `true` if `node_t` has a `string_t` key named `string`, as
+///         all nodes derived from `base_node` do.
+///
+template <typename node_t, typename = void>
+struct has_string_key : std::false_type {};
+
+template <typename node_t>
+struct has_string_key<node_t, std::void_t<decltype(&node_t::string)>> : std::is_same<decltype(node_t::string), string_t> {};
+
+///
+/// @brief  An intrusive doubly-linked list of hash table nodes
+///
+/// The list does not own its nodes and uses `htab_node_t::lsnext` and `lsprev`
+/// for linking, so a node may be in only one list at a time.
+///
+template <typename node_t>
+struct node_list_t {
+   htab_node_t<node_t>  *head;      ///< First node in the list
+   htab_node_t<node_t>  *tail;      ///< Last node in the list
+
+   public:
+      node_list_t(void) : head(nullptr), tail(nullptr)
+      {
+      }
+
+      bool empty(void) const {return head == nullptr;}
+
+      htab_node_t<node_t> *front(void) const {return head;}
+
+      htab_node_t<node_t> *back(void) const {return tail;}
+
+      /// Appends a node that is not in any list to the end of this list.
+      void push_back(htab_node_t<node_t> *nptr)
+      {
+         nptr->lsprev = tail;
+         nptr->lsnext = nullptr;
+
+         if(tail)
+            tail->lsnext = nptr;
+         else
+            head = nptr;
+
+         tail = nptr;
+      }
+
+      /// Removes a node from this list.
+      void remove(htab_node_t<node_t> *nptr)
+      {
+         if(nptr->lsprev)
+            nptr->lsprev->lsnext = nptr->lsnext;
+         else
+            head = nptr->lsnext;
+
+         if(nptr->lsnext)
+            nptr->lsnext->lsprev = nptr->lsprev;
+         else
+            tail = nptr->lsprev;
+
+         nptr->lsnext = nptr->lsprev = nullptr;
+      }
+
+      /// Moves a node in this list to the end of the list.
+      void move_to_back(htab_node_t<node_t> *nptr)
+      {
+         if(nptr != tail) {
+            remove(nptr);
+            push_back(nptr);
          }
+      }
 };
 
 ///
@@ -169,10 +253,37 @@ class hash_table_base {
          }
       };
 
+      ///
+      /// @brief  Hash table bucket and chain statistics.
+      ///
+      /// While the hash table is being resized, bucket counts include buckets of
+      /// both, the old and the new bucket arrays, that may contain nodes. For slot
+      /// arrays, buckets are slots and chains are probe sequences of stored nodes.
+      ///
+      struct htab_stats_t {
+         size_t   count;               ///< Number of nodes in the hash table.
+         size_t   buckets;             ///< Number of buckets.
+         size_t   empty_buckets;       ///< Number of empty buckets.
+         size_t   max_chain;           ///< Number of nodes in the longest bucket chain.
+         double   avg_chain;           ///< Average number of nodes in non-empty buckets.
+         double   load_factor;         ///< Average number of nodes per bucket.
+         size_t   resize_count;        ///< Number of times the hash table was resized.
+         bool     resizing;            ///< Is the hash table being resized?
+      };
+
    public:
       /// Returns estimated memory size for this hash table.
       virtual size_t get_memsize(void) const = 0;
 
+      /// Returns bucket and chain statistics for this hash table.
+      virtual htab_stats_t get_stats(void) const = 0;
+
+      /// Sets the maximum load factor that triggers resizing (zero disables resizing).
+      virtual void set_max_load_factor(double load_factor) = 0;
+
+      /// Selects how nodes are stored, which is only allowed while the hash table is empty.
+      virtual void set_storage(htab_storage_t storage) = 0;
+
       /// Swaps out oldest nodes with time stamps less than or equal `tstamp` to some external storage.
       virtual void swap_out(int64_t tstamp, size_t maxsize = 0) = 0;
 };
@@ -207,6 +318,30 @@ class hash_table_base {
 /// into the time stamp list (`tmlist`). Consequently, only regular object nodes may
 /// be swapped out to the external storage while log processing is in progress.
 ///
+/// When the number of nodes exceeds the maximum load factor times the number of
+/// buckets, the hash table allocates a bucket array twice as large and moves a few
+/// buckets at a time into the new array on each insert and look-up, rather than
+/// moving all nodes at once. While nodes are being moved, buckets below `rhindex`
+/// in the old array are empty and their nodes are found in the new array.
+///
+/// Alternatively, nodes may be stored in open-addressing slot arrays (`HTAB_PROBED`),
+/// which keep a control byte with a few hash value bits for each slot and a separate
+/// array of full hash values and node pointers. A look-up scans control bytes of
+/// adjacent slots and accesses a hash table node only after its full hash value is
+/// matched, which avoids following bucket chain pointers through memory that is not
+/// cached. Slot arrays are resized all at once, because moving hash values and node
+/// pointers does not require accessing hash table nodes. Maximum load factor applies
+/// only to bucket chains.
+///
+/// Hash table nodes are allocated from a slab allocator owned by the hash table, which
+/// is not shared with other threads and does not need to be locked. Object nodes created
+/// with `new_node` are allocated from another slab allocator sized for `node_t` and the
+/// characters of `string` keys of inserted nodes are moved into slabs of a few size
+/// classes, so nodes and their keys are packed together instead of being interleaved
+/// with other heap allocations. Object nodes allocated with `new` are still accepted
+/// and are deleted with `delete`. `clear` runs destructors of object nodes one by one,
+/// because they may own other containers, but then releases all slab memory at once.
+///
 template <typename node_t>
 class hash_table : public hash_table_base {
    private:
@@ -223,6 +358,67 @@ class hash_table : public hash_table_base {
             }
       };
 
+      ///
+      /// @brief  Linearly-probed open-addressing slot arrays
+      ///
+      /// A control byte is zero for an empty slot and holds the lower 7 bits of the
+      /// hash value with the high bit set for an occupied slot. The home slot index
+      /// is taken from the upper bits of the hash value multiplied by a 64-bit odd
+      /// constant, so it does not depend on the same bits as the control byte.
+      ///
+      /// Removed nodes do not leave any tombstones behind. Instead, subsequent nodes
+      /// in the same probe sequence are shifted back into the vacated slot.
+      ///
+      struct probe_table_t {
+         ///
+         /// @brief  A hash value and a hash table node in an occupied slot
+         ///
+         struct slot_t {
+            uint64_t             hashval;    ///< Hash value of the node object.
+            htab_node_t<node_t>  *nptr;      ///< Hash table node.
+         };
+
+         static const size_t MIN_SLOTS = 16;  ///< Minimum number of slots.
+
+         u_char      *ctrl;         ///< Control bytes, one per slot.
+         slot_t      *slots;        ///< Hash values and nodes in occupied slots.
+         size_t      capacity;      ///< Number of slots, which is always a power of two.
+         u_int       shift;         ///< Shift that yields a home slot index from a mixed hash value.
+
+         public:
+            probe_table_t(size_t minslots);
+
+            ~probe_table_t(void);
+
+            probe_table_t(const probe_table_t&) = delete;
+            probe_table_t& operator = (const probe_table_t&) = delete;
+
+            /// Returns the first slot to probe for the specified hash value.
+            size_t home_slot(uint64_t hashval) const {return (size_t) ((hashval * UINT64_C(0x9E3779B97F4A7C15)) >> shift);}
+
+            /// Returns the slot following `index`, wrapping around at the end of the slot arrays.
+            size_t next_slot(size_t index) const {return (index + 1) & (capacity - 1);}
+
+            /// Returns the control byte of an occupied slot for the specified hash value.
+            static u_char ctrl_byte(uint64_t hashval) {return (u_char) (hashval | 0x80);}
+
+            /// Stores a node in the first empty slot of its probe sequence.
+            void insert(uint64_t hashval, htab_node_t<node_t> *nptr);
+
+            /// Returns the first node with the specified hash value for which `match` returns `true`.
+            template <typename match_t>
+            htab_node_t<node_t> *find(uint64_t hashval, match_t&& match) const;
+
+            /// Removes a node and shifts back subsequent nodes in its probe sequence.
+            void remove(const htab_node_t<node_t> *nptr);
+
+            /// Doubles the number of slots and moves all nodes into new slots.
+            void grow(void);
+
+            /// Marks all slots as empty.
+            void clear(void);
+      };
+
    public:
       ///
       /// @brief  A primary class template to define a type of hash table nodes 
@@ -258,7 +454,7 @@ class hash_table : public hash_table_base {
 
    public:
       ///
-      /// @tparam list_iter_t    Either `std::list::iterator` or `std::list::const_iterator`.
+      /// @tparam lsnode_t    Either `htab_node_t` or `const htab_node_t`.
       ///
       /// @brief  A hash table iterator template for `const` and non-`const` iterator types.
       ///
@@ -272,22 +468,20 @@ class hash_table : public hash_table_base {
       /// Neither of the underlying lists can change while there are any active iterators
       /// referencing any of those lists.
       ///
-      template <typename list_iter_t>
+      template <typename lsnode_t>
       class iterator_base {
          friend class hash_table<node_t>;
 
          private:
             bool pre;                     ///< A pre-first node position indicator.
 
-            list_iter_t    grpnode;       ///< The iterator pointing to the current group node.
-            list_iter_t    grpend;        ///< The end iterator of the group node list.
+            lsnode_t       *grpnode;      ///< The current group node, or `nullptr` at the end of the group node list.
 
-            list_iter_t    tmnode;        ///< The iterator pointing to the current regular node.
-            list_iter_t    tmend;         ///< The end iterator of the time-ordered list of regular nodes.
+            lsnode_t       *tmnode;       ///< The current regular node, or `nullptr` at the end of the time-ordered list.
 
          protected:
-            iterator_base(list_iter_t grpbegin, list_iter_t grpend, list_iter_t tmbegin, list_iter_t tmend) : 
-               pre(true), grpnode(grpbegin), grpend(grpend), tmnode(tmbegin), tmend(tmend)
+            iterator_base(lsnode_t *grpbegin, lsnode_t *tmbegin) : 
+               pre(true), grpnode(grpbegin), tmnode(tmbegin)
             {
             }
 
@@ -300,12 +494,12 @@ class hash_table : public hash_table_base {
                   return nullptr;
 
                // if there are nodes in the group list, return a group node
-               if(grpnode != grpend)
-                  return (*grpnode)->node;
+               if(grpnode)
+                  return grpnode->node;
 
                // if there are nodes in the time-ordered list, return a regular node
-               if(tmnode != tmend)
-                  return (*tmnode)->node;
+               if(tmnode)
+                  return tmnode->node;
 
                // otherwise there are no nodes in either of the lists
                return nullptr;
@@ -323,12 +517,12 @@ class hash_table : public hash_table_base {
                   pre = false;
 
                   // if the group list has any nodes, return the first one
-                  if(grpnode != grpend)
-                     return (*grpnode)->node;
+                  if(grpnode)
+                     return grpnode->node;
 
                   // if there are no group nodes, return the first regular node
-                  if(tmnode != tmend)
-                     return (*tmnode)->node;
+                  if(tmnode)
+                     return tmnode->node;
 
                   // both lists are empty, return nullptr
                   return nullptr;
@@ -338,14 +532,14 @@ class hash_table : public hash_table_base {
                // Once we returned the first node, walk the group list until we run out 
                // of group nodes.
                //
-               if(grpnode != grpend) {
-                  grpnode++;
+               if(grpnode) {
+                  grpnode = grpnode->lsnext;
 
-                  if(grpnode != grpend)
-                     return (*grpnode)->node;
+                  if(grpnode)
+                     return grpnode->node;
 
-                  if(tmnode != tmend)
-                     return (*tmnode)->node;
+                  if(tmnode)
+                     return tmnode->node;
 
                   return nullptr;
                }
@@ -354,11 +548,11 @@ class hash_table : public hash_table_base {
                // Finally, walk the time-ordered regular node list until we run out of 
                // regular nodes too.
                //
-               if(tmnode != tmend)
-                  tmnode++;
+               if(tmnode)
+                  tmnode = tmnode->lsnext;
 
-               if(tmnode != tmend)
-                  return (*tmnode)->node;
+               if(tmnode)
+                  return tmnode->node;
 
                return nullptr;
             }
@@ -367,15 +561,15 @@ class hash_table : public hash_table_base {
       ///
       /// @brief  A hash table iterator.
       ///
-      class iterator : public iterator_base<typename node_list_t<node_t>::iterator> {
+      class iterator : public iterator_base<htab_node_t<node_t>> {
          friend class hash_table<node_t>;
 
          private:
-            typedef typename node_list_t<node_t>::iterator list_iter_t;
+            typedef htab_node_t<node_t> lsnode_t;
 
          public:
-            iterator(list_iter_t grpbegin, list_iter_t grpend, list_iter_t tmbegin, list_iter_t tmend) :
-               iterator_base<list_iter_t>(grpbegin, grpend, tmbegin, tmend)
+            iterator(lsnode_t *grpbegin, lsnode_t *tmbegin) :
+               iterator_base<lsnode_t>(grpbegin, tmbegin)
             {
             }
       };
@@ -387,24 +581,45 @@ class hash_table : public hash_table_base {
       /// and overrides them with versions that call the base and return pointers to
       /// `const` nodes of the same type.
       ///
-      class const_iterator : private iterator_base<typename node_list_t<node_t>::const_iterator> {
+      class const_iterator : private iterator_base<const htab_node_t<node_t>> {
          friend class hash_table<node_t>;
 
          private:
-            typedef typename node_list_t<node_t>::const_iterator list_iter_t;
+            typedef const htab_node_t<node_t> lsnode_t;
 
          private:
-            const_iterator(list_iter_t grpbegin, list_iter_t grpend, list_iter_t tmbegin, list_iter_t tmend) :
-               iterator_base<list_iter_t>(grpbegin, grpend, tmbegin, tmend)
+            const_iterator(lsnode_t *grpbegin, lsnode_t *tmbegin) :
+               iterator_base<lsnode_t>(grpbegin, tmbegin)
             {
             }
 
          public:
-            const node_t *item(void) {return iterator_base<list_iter_t>::item();}
+            const node_t *item(void) {return iterator_base<lsnode_t>::item();}
 
-            const node_t *next(void) {return iterator_base<list_iter_t>::next();}
+            const node_t *next(void) {return iterator_base<lsnode_t>::next();}
       };
 
+   private:
+      /// A slab allocator for hash table nodes of this hash table.
+      typedef slab_allocator_t<sizeof(htab_node_t<node_t>), alignof(htab_node_t<node_t>)> node_slab_t;
+
+      /// A slab allocator for object nodes of this hash table.
+      typedef slab_allocator_t<sizeof(node_t), alignof(node_t)> obj_slab_t;
+
+      /// A slab allocator for key characters of one size class.
+      template <size_t KEYSIZE>
+      using key_slab_t = slab_allocator_t<KEYSIZE, alignof(void*)>;
+
+      /// Key slabs for keys up to 16, 32, 64, 128 and 256 bytes, including the null character.
+      typedef std::tuple<key_slab_t<16>, key_slab_t<32>, key_slab_t<64>, key_slab_t<128>, key_slab_t<256>> key_slabs_t;
+
+   private:
+      static const size_t REHASH_STEP = 8;   ///< Number of buckets moved into the new bucket array per insert.
+
+      static constexpr double PROBE_MAX_LOAD = .75;   ///< Maximum ratio of occupied slots before slot arrays are resized.
+
+      static const size_t MIN_KEY_SIZE = 16;          ///< Block size of the smallest key slab.
+
    private:
       size_t      count;      ///< Number of hash table entries
       size_t      maxhash;    ///< Number of buckets in the hash table
@@ -412,22 +627,70 @@ class hash_table : public hash_table_base {
       size_t      memsize;    ///< Estimated serialized size in bytes of all nodes.
       bucket_t    *htab;      ///< Buckets
 
+      bucket_t    *rhtab;     ///< New buckets while the hash table is being resized
+      size_t      rhmaxhash;  ///< Number of buckets in `rhtab`
+      size_t      rhindex;    ///< Next bucket in `htab` to be moved into `rhtab`
+      size_t      rhcount;    ///< Number of times the hash table was resized
+      double      max_load;   ///< Maximum load factor (zero disables resizing)
+
+      probe_table_t *ptab;    ///< Slot arrays, if nodes are stored in open-addressing slots
+
       node_list_t<node_t>  tmlist;  ///< Time-ordered list of regular nodes.
       node_list_t<node_t>  grplist; ///< Unordered list of group nodes.
 
+      node_slab_t node_slab;  ///< Memory for hash table nodes, released all at once by `clear`.
+      obj_slab_t  obj_slab;   ///< Memory for object nodes created by `new_node`, released all at once by `clear`.
+      key_slabs_t key_slabs;  ///< Memory for `string` keys of object nodes, released all at once by `clear`.
+
       eval_cb_t   evalcb;     ///< Evaluation callback.
       swap_cb_t   swapcb;     ///< Swap out callback.
       void        *cbarg;     ///< Swap out and evaluation callbacks argument.
 
    private:
+      /// Creates a hash table node in `node_slab` that owns `node`.
+      htab_node_t<node_t> *new_htab_node(node_t *node, uint64_t hashval, int64_t tstamp);
+
+      /// Destroys the hash table node and its object node and returns its memory to `node_slab`.
+      void delete_htab_node(htab_node_t<node_t> *nptr);
+
+      /// Destroys the object node and returns its memory and memory of its key to the slabs it came from.
+      void delete_obj_node(node_t *node);
+
+      /// Moves the `string` key of `node` into a key slab, if the key fits into one of the size classes.
+      void move_key(node_t& node);
+
+      /// Returns the memory of the `string` key of `node` to its key slab, if it came from one.
+      void release_key(node_t& node);
+
+      /// Allocates a block from the key slab of the size class `keyclass`.
+      void *allocate_key(size_t keyclass);
+
+      /// Returns a block to the key slab of the size class `keyclass`, if it was allocated from it.
+      bool deallocate_key(size_t keyclass, void *block);
+
       /// Completely unlinks the specified node from the bucket list.
       void unlink_node(bucket_t& bucket, htab_node_t<node_t> *nptr) const;
 
       /// Moves the specified node to the beginning of the bucket list.
       void move_to_front(bucket_t& bucket, htab_node_t<node_t> *nptr) const;
 
+      /// Returns the bucket for the specified hash value, in either of the bucket arrays.
+      bucket_t& get_bucket(uint64_t hashval) const
+      {
+         return rhtab && hashval % maxhash < rhindex ? rhtab[hashval % rhmaxhash] : htab[hashval % maxhash];
+      }
+
+      /// Allocates a larger bucket array and starts moving nodes into it.
+      void start_rehash(void);
+
+      /// Moves nodes from up to `buckets` old buckets into the new bucket array.
+      void rehash_step(size_t buckets);
+
+      /// Replaces the old bucket array with the new one.
+      void finish_rehash(void);
+
    public:
-      /// Constructs a hash table with the specified number of buckets.
+      /// Constructs a hash table with the specified initial number of buckets.
       hash_table(size_t maxhash = MAXHASH, swap_cb_t swapcb = nullptr, void *cbarg = nullptr, eval_cb_t evalcb = nullptr);
 
       /// Destroys the hash table and its contents.
@@ -443,6 +706,45 @@ class hash_table : public hash_table_base {
 
       /// Returns estimated memory size for this hash table.
       size_t get_memsize(void) const override {return memsize;}
+
+      /// Returns the number of buckets or slots, including new buckets while the hash table is being resized.
+      size_t get_bucket_count(void) const {return ptab ? ptab->capacity : rhtab ? maxhash - rhindex + rhmaxhash : maxhash;}
+
+      /// Returns the number of empty buckets or slots.
+      size_t get_empty_buckets(void) const {return ptab ? ptab->capacity - count : emptycnt;}
+
+      /// Returns the average number of nodes per bucket.
+      double get_load_factor(void) const {return (double) count / get_bucket_count();}
+
+      /// Returns bucket and chain statistics, which requires visiting every bucket.
+      htab_stats_t get_stats(void) const override;
+
+      /// Returns the number of slabs allocated for hash table nodes.
+      size_t get_slab_count(void) const {return node_slab.get_slab_count();}
+
+      /// Returns the number of slabs allocated for object nodes.
+      size_t get_obj_slab_count(void) const {return obj_slab.get_slab_count();}
+
+      /// Returns the number of slabs allocated for keys of object nodes.
+      size_t get_key_slab_count(void) const;
+
+      /// Returns the number of object node and key blocks in use.
+      size_t get_arena_used(void) const;
+
+      /// Sets the maximum load factor that triggers resizing (zero disables resizing).
+      void set_max_load_factor(double load_factor) override {max_load = load_factor;}
+      /// @}
+
+      ///
+      /// @name   Node storage
+      ///
+      /// @{
+
+      /// Selects how nodes are stored, which is only allowed while the hash table is empty.
+      void set_storage(htab_storage_t storage) override;
+
+      /// Returns how nodes are stored in this hash table.
+      htab_storage_t get_storage(void) const {return ptab ? HTAB_PROBED : HTAB_CHAINED;}
       /// @}
 
       ///
@@ -462,9 +764,9 @@ class hash_table : public hash_table_base {
       ///
       /// @{
 
-      iterator begin(void) {return iterator(grplist.begin(), grplist.end(), tmlist.begin(), tmlist.end());}
+      iterator begin(void) {return iterator(grplist.front(), tmlist.front());}
 
-      const_iterator begin(void) const {return const_iterator(grplist.begin(), grplist.end(), tmlist.begin(), tmlist.end());}
+      const_iterator begin(void) const {return const_iterator(grplist.front(), tmlist.front());}
       /// @}
 
       ///
@@ -475,6 +777,10 @@ class hash_table : public hash_table_base {
       /// Deletes all hash table nodes.
       void clear(void);
 
+      /// Constructs a new object node in memory owned by this hash table, which must be inserted with `put_node`.
+      template <typename ... args_t>
+      node_t *new_node(args_t&& ... args);
+
       /// Looks for a node with a string key and does not move the node to the end of the time stamp list.
       template <typename ... K>
       const node_t *find_node(nodetype_t type, K&& ... kp) const;
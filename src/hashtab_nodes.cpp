@@ -38,7 +38,7 @@ template<> const u_short datanode_t<danode_t>::__version = 2;
 template<> const u_short datanode_t<scnode_t>::__version = 2;
 template<> const u_short datanode_t<daily_t> ::__version = 2;
 template<> const u_short datanode_t<hourly_t>::__version = 1;
-template<> const u_short datanode_t<sysnode_t>::__version = 6;
+template<> const u_short datanode_t<sysnode_t>::__version = 7;
 
 //
 // hash table base webalizer nodes
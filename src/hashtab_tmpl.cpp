@@ -10,12 +10,132 @@
 #include <cstdlib>
 #include <cstring>
 #include <climits>
+#include <memory>
 
 #include "hashtab.h"
 
+template <typename node_t>
+hash_table<node_t>::probe_table_t::probe_table_t(size_t minslots) :
+      ctrl(nullptr), slots(nullptr), capacity(MIN_SLOTS), shift(64)
+{
+   while(capacity < minslots)
+      capacity <<= 1;
+
+   for(size_t slotcnt = capacity; slotcnt > 1; slotcnt >>= 1)
+      shift--;
+
+   ctrl = new u_char[capacity]();
+   slots = new slot_t[capacity];
+}
+
+template <typename node_t>
+hash_table<node_t>::probe_table_t::~probe_table_t(void)
+{
+   delete [] ctrl;
+   delete [] slots;
+}
+
+///
+/// The caller must ensure that there is at least one empty slot after the node is
+/// inserted, so probe sequences always terminate.
+///
+template <typename node_t>
+void hash_table<node_t>::probe_table_t::insert(uint64_t hashval, htab_node_t<node_t> *nptr)
+{
+   size_t index = home_slot(hashval);
+
+   while(ctrl[index])
+      index = next_slot(index);
+
+   ctrl[index] = ctrl_byte(hashval);
+   slots[index].hashval = hashval;
+   slots[index].nptr = nptr;
+}
+
+///
+/// Once the node is removed, each subsequent node in the same probe sequence whose
+/// home slot does not fall between the vacated slot and its own slot is moved into
+/// the vacated slot, which leaves its former slot vacated. This keeps all probe
+/// sequences contiguous without marking removed slots.
+///
+template <typename node_t>
+void hash_table<node_t>::probe_table_t::remove(const htab_node_t<node_t> *nptr)
+{
+   size_t index = home_slot(nptr->hashval), home;
+
+   while(ctrl[index] && slots[index].nptr != nptr)
+      index = next_slot(index);
+
+   if(!ctrl[index])
+      throw std::logic_error("Cannot find a hash table node in its probe sequence");
+
+   for(size_t next = next_slot(index); ctrl[next]; next = next_slot(next)) {
+      home = home_slot(slots[next].hashval);
+
+      // move the node if its home slot is not within (index, next], wrapping around
+      if(index < next ? home <= index || home > next : home <= index && home > next) {
+         ctrl[index] = ctrl[next];
+         slots[index] = slots[next];
+         index = next;
+      }
+   }
+
+   ctrl[index] = 0;
+}
+
+template <typename node_t>
+void hash_table<node_t>::probe_table_t::grow(void)
+{
+   std::unique_ptr<u_char[]> newctrl(new u_char[capacity * 2]());
+   std::unique_ptr<slot_t[]> newslots(new slot_t[capacity * 2]);
+   u_char *oldctrl = ctrl;
+   slot_t *oldslots = slots;
+   size_t oldcapacity = capacity;
+
+   ctrl = newctrl.release();
+   slots = newslots.release();
+   capacity *= 2;
+   shift--;
+
+   for(size_t index = 0; index < oldcapacity; index++) {
+      if(oldctrl[index])
+         insert(oldslots[index].hashval, oldslots[index].nptr);
+   }
+
+   delete [] oldctrl;
+   delete [] oldslots;
+}
+
+template <typename node_t>
+void hash_table<node_t>::probe_table_t::clear(void)
+{
+   memset(ctrl, 0, capacity);
+}
+
+///
+/// Only full hash values are compared in the slot array, so the hash table node
+/// is accessed only for nodes with the same hash value, which are then evaluated
+/// by `match`.
+///
+template <typename node_t>
+template <typename match_t>
+htab_node_t<node_t> *hash_table<node_t>::probe_table_t::find(uint64_t hashval, match_t&& match) const
+{
+   u_char cbyte = ctrl_byte(hashval);
+
+   for(size_t index = home_slot(hashval); ctrl[index]; index = next_slot(index)) {
+      if(ctrl[index] == cbyte && slots[index].hashval == hashval && match(slots[index].nptr->node))
+         return slots[index].nptr;
+   }
+
+   return nullptr;
+}
+
 template <typename node_t>
 hash_table<node_t>::hash_table(size_t maxhash, swap_cb_t swapcb, void *cbarg, eval_cb_t evalcb) : 
-      maxhash(maxhash), swapcb(swapcb), cbarg(cbarg), evalcb(evalcb), memsize(0)
+      maxhash(maxhash), swapcb(swapcb), cbarg(cbarg), evalcb(evalcb), memsize(0),
+      rhtab(nullptr), rhmaxhash(0), rhindex(0), rhcount(0), max_load(HTAB_DEF_LOAD_FACTOR),
+      ptab(nullptr)
 {
    count = 0;
    emptycnt = maxhash;
@@ -27,6 +147,110 @@ hash_table<node_t>::~hash_table(void)
 {
    clear();
    delete [] htab;
+   delete ptab;
+}
+
+///
+/// Slot arrays are created with at least as many slots as there were buckets in
+/// the bucket array, and vice versa.
+///
+template <typename node_t>
+void hash_table<node_t>::set_storage(htab_storage_t storage)
+{
+   if(count)
+      throw std::logic_error("Hash table storage cannot be changed while there are nodes in the hash table");
+
+   if(storage == get_storage())
+      return;
+
+   if(storage == HTAB_PROBED) {
+      ptab = new probe_table_t(maxhash);
+
+      // there are no nodes to move if resizing was in progress
+      delete [] rhtab;
+      delete [] htab;
+
+      htab = rhtab = nullptr;
+      rhmaxhash = rhindex = 0;
+   }
+   else {
+      htab = new bucket_t[maxhash];
+      emptycnt = maxhash;
+
+      delete ptab;
+      ptab = nullptr;
+   }
+}
+
+///
+/// The new bucket array is twice as large as the current one. Nodes are moved into
+/// the new bucket array by `rehash_step`, a few buckets at a time, so the cost of
+/// resizing is spread over subsequent inserts and look-ups.
+///
+template <typename node_t>
+void hash_table<node_t>::start_rehash(void)
+{
+   rhmaxhash = maxhash * 2;
+   rhtab = new bucket_t[rhmaxhash];
+   rhindex = 0;
+
+   emptycnt += rhmaxhash;
+}
+
+///
+/// Each node is moved to the front of its new bucket. Empty old buckets are just
+/// skipped, so each step has a predictable cost, which is proportional to the 
+/// number of nodes in `buckets` old buckets.
+///
+template <typename node_t>
+void hash_table<node_t>::rehash_step(size_t buckets)
+{
+   htab_node_t<node_t> *nptr;
+
+   for(size_t index = 0; index < buckets && rhindex < maxhash; index++, rhindex++) {
+      bucket_t& bucket = htab[rhindex];
+
+      // old buckets are no longer counted once they are moved
+      if(!bucket.count) {
+         emptycnt--;
+         continue;
+      }
+
+      while((nptr = bucket.head) != nullptr) {
+         bucket_t& newbucket = rhtab[nptr->hashval % rhmaxhash];
+
+         bucket.head = nptr->next;
+
+         if(newbucket.head)
+            newbucket.head->prev = nptr;
+
+         nptr->next = newbucket.head;
+         nptr->prev = nullptr;
+         newbucket.head = nptr;
+
+         if(!newbucket.count++)
+            emptycnt--;
+      }
+
+      bucket.count = 0;
+   }
+
+   if(rhindex == maxhash)
+      finish_rehash();
+}
+
+template <typename node_t>
+void hash_table<node_t>::finish_rehash(void)
+{
+   delete [] htab;
+
+   htab = rhtab;
+   maxhash = rhmaxhash;
+
+   rhtab = nullptr;
+   rhmaxhash = rhindex = 0;
+
+   rhcount++;
 }
 
 template <typename node_t>
@@ -52,7 +276,7 @@ void hash_table<node_t>::swap_out(int64_t tstamp, size_t maxsize)
    if(!swapcb)
       throw std::logic_error("Cannot swap out nodes without a swap callback");
 
-   typename node_list_t<node_t>::iterator lsnode = tmlist.begin();
+   htab_node_t<node_t> *nptr = tmlist.front(), *lsnext;
 
    //
    // Swap out oldest nodes with time stamps less than or equal to tstamp until the
@@ -61,26 +285,31 @@ void hash_table<node_t>::swap_out(int64_t tstamp, size_t maxsize)
    // in the hash table, so once the hash table memory size is zero, ignore it and
    // finish evaluating time stamps.
    //
-   while(lsnode != tmlist.end() && (*lsnode)->tstamp <= tstamp && (!memsize || memsize > maxsize)) {
+   while(nptr && nptr->tstamp <= tstamp && (!memsize || memsize > maxsize)) {
       // only regular nodes can be in the time stamp list
-      if((*lsnode)->node->get_type() != OBJ_REG)
+      if(nptr->node->get_type() != OBJ_REG)
          throw std::logic_error("Only regular object nodes may be swapped out");
 
-      htab_node_t<node_t> *nptr = *lsnode;
-      bucket_t& bucket = htab[nptr->hashval % maxhash];
-
-      if(nptr->lsnode == tmlist.end())
-         throw std::logic_error("Bad time stamp list node reference");
+      lsnext = nptr->lsnext;
 
       // check if we can swap out this node
       if(evalcb && !evalcb(nptr->node, cbarg))
-         lsnode++;
+         nptr = lsnext;
       else {
-         // remove the node from the bucket
-         unlink_node(bucket, nptr);
+         // remove the node from its slot or from the bucket
+         if(ptab)
+            ptab->remove(nptr);
+         else {
+            bucket_t& bucket = get_bucket(nptr->hashval);
+
+            unlink_node(bucket, nptr);
 
-         // and from the time-ordered list and advance the node iterator
-         lsnode = tmlist.erase(nptr->lsnode);
+            if(--bucket.count == 0)
+               emptycnt++;
+         }
+
+         // and from the time-ordered list
+         tmlist.remove(nptr);
 
          // serialized node size may have changed since it was added (e.g. city was added later)
          size_t nsize = nptr->node->s_data_size() + sizeof(node_t);
@@ -89,16 +318,20 @@ void hash_table<node_t>::swap_out(int64_t tstamp, size_t maxsize)
          else
             memsize = 0;
 
-         // adjust counters
          count--;
-         if(--bucket.count == 0)
-            emptycnt++;
 
-         // wrap the node in a unique pointer in case swapcb throws an exception
-         std::unique_ptr<htab_node_t<node_t>> uptr(nptr);
+         // finally, save the node in some external storage and delete it, even if swapcb throws an exception
+         try {
+            swapcb(nptr->node, cbarg);
+         }
+         catch (...) {
+            delete_htab_node(nptr);
+            throw;
+         }
 
-         // finally, save the node in some external storage
-         swapcb(nptr->node, cbarg);
+         delete_htab_node(nptr);
+
+         nptr = lsnext;
       }
    }
 }
@@ -133,54 +366,73 @@ node_t *hash_table<node_t>::put_node(node_t *nptr, int64_t tstamp)
 template <typename node_t>
 node_t *hash_table<node_t>::put_node(uint64_t hashval, node_t *node, int64_t tstamp)
 {
-   uint64_t hashidx;
    htab_node_t<node_t> **hptr, *nptr;
-   std::unique_ptr<node_t> objptr(node);
 
    if(!node)
       throw std::logic_error("Cannot insert a nullptr node pointer");
 
-   if(node->get_type() != OBJ_REG) {
-      // ignore the time stamp because group nodes don't participate in time stamp ordering
-      nptr = new htab_node_t<node_t>(objptr.release(), hashval, grplist.insert(grplist.end(), nullptr), 0);
-      grplist.back() = nptr;
+   try {
+      // move a few buckets into the new bucket array before the new node is linked
+      if(rhtab)
+         rehash_step(REHASH_STEP);
+
+      // grow slot arrays before the new node is created, so there is always an empty slot
+      if(ptab && count + 1 > ptab->capacity * PROBE_MAX_LOAD) {
+         ptab->grow();
+         rhcount++;
+      }
+
+      // keys are never changed once nodes are inserted, so they can be packed into key slabs
+      move_key(*node);
+
+      if(node->get_type() != OBJ_REG) {
+         // ignore the time stamp because group nodes don't participate in time stamp ordering
+         nptr = new_htab_node(node, hashval, 0);
+         grplist.push_back(nptr);
+      }
+      else {
+         // enforce time stamp order for new regular nodes
+         if(!tmlist.empty() && tmlist.back()->tstamp > tstamp)
+            throw std::logic_error("Nodes must be linserted in the ascending time stamp order");
+
+         nptr = new_htab_node(node, hashval, tstamp);
+         tmlist.push_back(nptr);
+      }
    }
-   else {
-      // enforce time stamp order for new regular nodes
-      if(!tmlist.empty() && tmlist.back()->tstamp > tstamp)
-         throw std::logic_error("Nodes must be linserted in the ascending time stamp order");
-
-      //
-      // Insert a new list node with a nullptr value at the end of the list and allocate 
-      // a new hash table node with the object node and the list iterator pointing to 
-      // the list node we just inserted.
-      //
-      nptr = new htab_node_t<node_t>(objptr.release(), hashval, tmlist.insert(tmlist.end(), nullptr), tstamp);
-
-      // set the list node to point back to the hash table node
-      tmlist.back() = nptr;
+   catch (...) {
+      delete_obj_node(node);
+      throw;
    }
 
-   // insert the new hash table node into its bucket
-   hashidx = hashval % maxhash;
+   // insert the new hash table node into its slot or its bucket
+   if(ptab)
+      ptab->insert(hashval, nptr);
+   else {
+      bucket_t& bucket = get_bucket(hashval);
+
+      if(!bucket.count)
+         emptycnt--;
 
-   if(!htab[hashidx].count)
-      emptycnt--;
+      hptr = &bucket.head;
 
-   hptr = &htab[hashidx].head;
+      if(*hptr) {
+         nptr->next = *hptr;
+         (*hptr)->prev = nptr;
+      }
+      *hptr = nptr;
 
-   if(*hptr) {
-      nptr->next = *hptr;
-      (*hptr)->prev = nptr;
+      bucket.count++;
    }
-   *hptr = nptr;
 
    // update sizes and counts
    memsize += (nptr->node->s_data_size() + sizeof(node_t));
 
-   htab[hashidx].count++;
    count++;
 
+   // start resizing if there are too many nodes per bucket
+   if(!ptab && !rhtab && max_load > 0. && count > maxhash * max_load)
+      start_rehash();
+
    return nptr->node;
 }
 
@@ -193,7 +445,13 @@ const node_t *hash_table<node_t>::find_node(nodetype_t type, K&& ... kp) const
 
    hashval = node_t::hash_key(std::forward<K>(kp)...);
 
-   for(nptr = htab[hashval % maxhash].head; nptr; nptr = nptr->next) {
+   if(ptab) {
+      nptr = ptab->find(hashval, [type, &kp...](const node_t *node) {return node->get_type() == type && node->match_key(kp...);});
+
+      return nptr ? nptr->node : nullptr;
+   }
+
+   for(nptr = get_bucket(hashval).head; nptr; nptr = nptr->next) {
       if(nptr->node->get_type() == type) {
          if(nptr->node->match_key(std::forward<K>(kp)...))
             return nptr->node;
@@ -210,6 +468,153 @@ node_t *hash_table<node_t>::find_node(nodetype_t type, int64_t tstamp, K&& ... k
    return find_node(node_t::hash_key(std::forward<K>(kp)...), type, tstamp, std::forward<K>(kp)...);
 }
 
+template <typename node_t>
+htab_node_t<node_t> *hash_table<node_t>::new_htab_node(node_t *node, uint64_t hashval, int64_t tstamp)
+{
+   return new (node_slab.allocate()) htab_node_t<node_t>(node, hashval, tstamp);
+}
+
+template <typename node_t>
+void hash_table<node_t>::delete_htab_node(htab_node_t<node_t> *nptr)
+{
+   delete_obj_node(nptr->node);
+
+   nptr->~htab_node_t();
+   node_slab.deallocate(nptr);
+}
+
+template <typename node_t>
+void hash_table<node_t>::delete_obj_node(node_t *node)
+{
+   release_key(*node);
+
+   if(obj_slab.owns(node)) {
+      node->~node_t();
+      obj_slab.deallocate(node);
+   }
+   else
+      delete node;
+}
+
+template <typename node_t>
+template <typename ... args_t>
+node_t *hash_table<node_t>::new_node(args_t&& ... args)
+{
+   void *block = obj_slab.allocate();
+
+   try {
+      return new (block) node_t(std::forward<args_t>(args) ...);
+   }
+   catch (...) {
+      obj_slab.deallocate(block);
+      throw;
+   }
+}
+
+///
+/// Keys that are empty, read-only or too long for the largest size class are left
+/// in their original memory. The key string holds the key slab block and will not
+/// attempt to free it, which is done by `release_key` or by `clear`.
+///
+template <typename node_t>
+void hash_table<node_t>::move_key(node_t& node)
+{
+   if constexpr (has_string_key<node_t>::value) {
+      size_t keysize = node.string.length() + 1;
+      size_t keyclass = 0;
+
+      if(keysize == 1 || !node.string.capacity())
+         return;
+
+      for(size_t blocksize = MIN_KEY_SIZE; blocksize < keysize; blocksize <<= 1)
+         keyclass++;
+
+      if(keyclass >= std::tuple_size<key_slabs_t>::value)
+         return;
+
+      char *block = (char*) allocate_key(keyclass);
+
+      memcpy(block, node.string.c_str(), keysize);
+
+      node.string.attach(string_t::char_buffer_t(block, MIN_KEY_SIZE << keyclass, true), keysize - 1);
+   }
+}
+
+template <typename node_t>
+void hash_table<node_t>::release_key(node_t& node)
+{
+   if constexpr (has_string_key<node_t>::value) {
+      size_t bufsize = node.string.capacity() + 1;
+      size_t keyclass = 0;
+
+      // read-only keys cannot be detached and never come from key slabs
+      if(bufsize == 1)
+         return;
+
+      for(size_t blocksize = MIN_KEY_SIZE; blocksize < bufsize; blocksize <<= 1)
+         keyclass++;
+
+      if(keyclass >= std::tuple_size<key_slabs_t>::value || bufsize != MIN_KEY_SIZE << keyclass)
+         return;
+
+      // a key that is not a holder is freed along with the detached buffer
+      string_t::char_buffer_t keybuf = node.string.detach();
+
+      if(keybuf.isholder())
+         deallocate_key(keyclass, keybuf.detach());
+   }
+}
+
+template <typename node_t>
+void *hash_table<node_t>::allocate_key(size_t keyclass)
+{
+   switch(keyclass) {
+      case 0: return std::get<0>(key_slabs).allocate();
+      case 1: return std::get<1>(key_slabs).allocate();
+      case 2: return std::get<2>(key_slabs).allocate();
+      case 3: return std::get<3>(key_slabs).allocate();
+      case 4: return std::get<4>(key_slabs).allocate();
+   }
+
+   throw std::logic_error("Bad key size class");
+}
+
+template <typename node_t>
+bool hash_table<node_t>::deallocate_key(size_t keyclass, void *block)
+{
+   auto release = [block](auto& key_slab) -> bool
+   {
+      if(!key_slab.owns(block))
+         return false;
+
+      key_slab.deallocate(block);
+
+      return true;
+   };
+
+   switch(keyclass) {
+      case 0: return release(std::get<0>(key_slabs));
+      case 1: return release(std::get<1>(key_slabs));
+      case 2: return release(std::get<2>(key_slabs));
+      case 3: return release(std::get<3>(key_slabs));
+      case 4: return release(std::get<4>(key_slabs));
+   }
+
+   return false;
+}
+
+template <typename node_t>
+size_t hash_table<node_t>::get_key_slab_count(void) const
+{
+   return std::apply([](const auto& ... key_slab) {return (key_slab.get_slab_count() + ...);}, key_slabs);
+}
+
+template <typename node_t>
+size_t hash_table<node_t>::get_arena_used(void) const
+{
+   return obj_slab.get_used() + std::apply([](const auto& ... key_slab) {return (key_slab.get_used() + ...);}, key_slabs);
+}
+
 ///
 /// @warning   `unlink_node` may be used to move nodes within the bucket and
 ///            it does not adjust bucket and hash table counts. The caller
@@ -246,51 +651,95 @@ template <typename node_t>
 template <typename ... K>
 node_t *hash_table<node_t>::find_node(uint64_t hashval, nodetype_t type, int64_t tstamp, K&& ... kp)
 {
-   bucket_t& bucket = htab[hashval % maxhash];
-   
+   htab_node_t<node_t> *nptr = nullptr;
+
+   // look-ups move one bucket, so resizing completes even if there are few inserts
+   if(rhtab)
+      rehash_step(1);
+
    // enforce time stamp order for pre-insert look-ups 
    if(type == OBJ_REG && !tmlist.empty() && tmlist.back()->tstamp > tstamp)
       throw std::logic_error("Nodes must be looked up in the ascending time stamp order when inserting");
 
-   u_int nodeidx = 0;
+   if(ptab)
+      nptr = ptab->find(hashval, [type, &kp...](const node_t *node) {return node->get_type() == type && node->match_key(kp...);});
+   else {
+      bucket_t& bucket = get_bucket(hashval);
+      u_int nodeidx = 0;
 
-   for(htab_node_t<node_t> *nptr = bucket.head; nptr != nullptr; nptr = nptr->next, nodeidx++) {
-      if(nptr->node->get_type() == type) {
-         if(nptr->node->match_key(std::forward<K>(kp) ...)) {
-            // if the node is further than 4 nodes from the head, move it to the front
-            if(nodeidx > 4)
-               move_to_front(bucket, nptr);
-
-            // if it's a regular object, move the node to the end of the time stamp list
-            if(type == OBJ_REG) {
-               tmlist.erase(nptr->lsnode);
-               nptr->tstamp = tstamp;
-               nptr->lsnode = tmlist.insert(tmlist.end(), nptr);
-            }
+      for(nptr = bucket.head; nptr != nullptr; nptr = nptr->next, nodeidx++) {
+         if(nptr->node->get_type() == type) {
+            if(nptr->node->match_key(std::forward<K>(kp) ...)) {
+               // if the node is further than 4 nodes from the head, move it to the front
+               if(nodeidx > 4)
+                  move_to_front(bucket, nptr);
 
-            return nptr->node;
+               break;
+            }
          }
       }
    }
 
-   return nullptr;
+   if(!nptr)
+      return nullptr;
+
+   // if it's a regular object, move the node to the end of the time stamp list
+   if(type == OBJ_REG) {
+      tmlist.move_to_back(nptr);
+      nptr->tstamp = tstamp;
+   }
+
+   return nptr->node;
 }
 
 template <typename node_t>
 void hash_table<node_t>::clear(void)
 {
+   htab_node_t<node_t> *nptr;
+
+   // key slab blocks held by key strings are not freed by their destructors
+   auto destroy_node = [this](htab_node_t<node_t> *nptr)
+   {
+      if(obj_slab.owns(nptr->node))
+         nptr->node->~node_t();
+      else
+         delete nptr->node;
+
+      nptr->~htab_node_t();
+   };
+
    // clear group nodes and ignore all counts
-   while(!grplist.empty()) {
-      unlink_node(htab[grplist.front()->hashval % maxhash], grplist.front());
-      delete grplist.front();
-      grplist.erase(grplist.begin());
+   while((nptr = grplist.front()) != nullptr) {
+      if(!ptab)
+         unlink_node(get_bucket(nptr->hashval), nptr);
+      grplist.remove(nptr);
+      destroy_node(nptr);
    }
 
    // clear regular nodes and ignore all counts
-   while(!tmlist.empty()) {
-      unlink_node(htab[tmlist.front()->hashval % maxhash], tmlist.front());
-      delete tmlist.front();
-      tmlist.erase(tmlist.begin());
+   while((nptr = tmlist.front()) != nullptr) {
+      if(!ptab)
+         unlink_node(get_bucket(nptr->hashval), nptr);
+      tmlist.remove(nptr);
+      destroy_node(nptr);
+   }
+
+   // release memory of all destroyed hash table nodes, object nodes and keys at once
+   node_slab.clear();
+   obj_slab.clear();
+   std::apply([](auto& ... key_slab) {(key_slab.clear(), ...);}, key_slabs);
+
+   if(ptab)
+      ptab->clear();
+
+   // all buckets are empty, so there is nothing left to move
+   if(rhtab)
+      finish_rehash();
+
+   // nodes were unlinked without adjusting bucket counts
+   if(htab) {
+      for(size_t index = 0; index < maxhash; index++)
+         htab[index].count = 0;
    }
 
    // now adjust all counts
@@ -299,6 +748,63 @@ void hash_table<node_t>::clear(void)
    memsize = 0;
 }
 
+template <typename node_t>
+typename hash_table<node_t>::htab_stats_t hash_table<node_t>::get_stats(void) const
+{
+   htab_stats_t stats = {};
+   size_t used = 0;
+
+   // report probe sequence lengths of stored nodes as chain lengths
+   if(ptab) {
+      size_t probes = 0, distance;
+
+      for(size_t index = 0; index < ptab->capacity; index++) {
+         if(ptab->ctrl[index]) {
+            distance = ((index - ptab->home_slot(ptab->slots[index].hashval)) & (ptab->capacity - 1)) + 1;
+            probes += distance;
+
+            if(distance > stats.max_chain)
+               stats.max_chain = distance;
+         }
+      }
+
+      stats.count = count;
+      stats.buckets = ptab->capacity;
+      stats.empty_buckets = ptab->capacity - count;
+      stats.avg_chain = count ? (double) probes / count : 0.;
+      stats.load_factor = get_load_factor();
+      stats.resize_count = rhcount;
+      stats.resizing = false;
+
+      return stats;
+   }
+
+   auto add_bucket = [&stats, &used](const bucket_t& bucket) {
+      if(bucket.count) {
+         used++;
+         if(bucket.count > stats.max_chain)
+            stats.max_chain = bucket.count;
+      }
+   };
+
+   // old buckets below rhindex have been moved into the new bucket array
+   for(size_t index = rhtab ? rhindex : 0; index < maxhash; index++)
+      add_bucket(htab[index]);
+
+   for(size_t index = 0; rhtab && index < rhmaxhash; index++)
+      add_bucket(rhtab[index]);
+
+   stats.count = count;
+   stats.buckets = get_bucket_count();
+   stats.empty_buckets = stats.buckets - used;
+   stats.avg_chain = used ? (double) count / used : 0.;
+   stats.load_factor = get_load_factor();
+   stats.resize_count = rhcount;
+   stats.resizing = rhtab != nullptr;
+
+   return stats;
+}
+
 template <typename node_t>
 typename hash_table<node_t>::tm_range_t hash_table<node_t>::tm_range(void) const
 {
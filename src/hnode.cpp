@@ -11,6 +11,9 @@
 
 #include "hnode.h"
 #include "serialize.h"
+#include "util_math.h"
+
+#include <algorithm>
 
 // -----------------------------------------------------------------------
 //
@@ -43,7 +46,8 @@ hnode_t::hnode_t(hnode_t&& hnode) noexcept : base_node<hnode_t>(std::move(hnode)
       city(std::move(hnode.city)),
       geoname_id(hnode.geoname_id),
       as_num(hnode.as_num),
-      as_org(std::move(hnode.as_org))
+      as_org(std::move(hnode.as_org)),
+      hostaddr(hnode.hostaddr)
 {
    spammer = hnode.spammer;
    robot = hnode.robot;
@@ -84,9 +88,23 @@ hnode_t::hnode_t(hnode_t&& hnode) noexcept : base_node<hnode_t>(std::move(hnode)
    hnode.visit = nullptr;
 }
 
-hnode_t::hnode_t(const string_t& ipaddr) : base_node<hnode_t>(ipaddr),
+///
+/// @brief  Constructs a host node for `ipaddr`, which may be a host name or an IP
+///         address.
+///
+hnode_t::hnode_t(const string_t& ipaddr) : hnode_t(ipaddr, ipaddr_t())
+{
+   hostaddr.parse(string.c_str(), string.length());
+}
+
+///
+/// @brief  Constructs a host node for the IP address in `ipaddr`, which must be
+///         the text form of `hostaddr` parsed by the caller.
+///
+hnode_t::hnode_t(const string_t& ipaddr, const ipaddr_t& hostaddr) : base_node<hnode_t>(ipaddr),
       geoname_id(0),
-      as_num(0)
+      as_num(0),
+      hostaddr(hostaddr)
 {
    spammer = false;
    robot = false;
@@ -156,6 +174,8 @@ void hnode_t::reset(uint64_t nodeid)
 {
    base_node<hnode_t>::reset(nodeid);
 
+   hostaddr.reset();
+
    spammer = false;
    count = 0;
    files = pages = visits = visits_conv = 0;
@@ -171,6 +191,13 @@ void hnode_t::reset(uint64_t nodeid)
    set_visit(nullptr);
 }
 
+uint64_t hnode_t::hash_key(const string_t& key)
+{
+   ipaddr_t addr;
+
+   return addr.parse(key.c_str(), key.length()) ? hash_key(addr) : hash_ex(0, key);
+}
+
 void hnode_t::set_ccode(const char _ccode[2])
 {
    ccode[0] = _ccode[0];
@@ -183,6 +210,59 @@ void hnode_t::reset_ccode(void)
    ccode[0] = ccode[1] = ccode[2] = 0;
 }
 
+///
+/// Adds counters of `hnode`, which must have the same IP address, to this node. 
+/// Average visit lengths are combined using visit counts of both nodes as weights
+/// and per-visit maximums are set to the larger of the two values.
+///
+/// The host name and location data are taken from `hnode` only if this node has
+/// none.
+///
+void hnode_t::merge(const hnode_t& hnode)
+{
+   if(hnode.visits)
+      visit_avg = AVG2(visit_avg, visits, hnode.visit_avg, hnode.visits);
+
+   visit_max = std::max(visit_max, hnode.visit_max);
+
+   max_v_hits = std::max(max_v_hits, hnode.max_v_hits);
+   max_v_files = std::max(max_v_files, hnode.max_v_files);
+   max_v_pages = std::max(max_v_pages, hnode.max_v_pages);
+   max_v_xfer = std::max(max_v_xfer, hnode.max_v_xfer);
+
+   count += hnode.count;
+   files += hnode.files;
+   pages += hnode.pages;
+   visits += hnode.visits;
+   visits_conv += hnode.visits_conv;
+   xfer += hnode.xfer;
+
+   if(!hnode.tstamp.null && (tstamp.null || hnode.tstamp > tstamp))
+      tstamp = hnode.tstamp;
+
+   if(hnode.spammer)
+      spammer = true;
+
+   if(hnode.robot)
+      robot = true;
+
+   if(name.isempty())
+      name = hnode.name;
+
+   if(!*ccode && *hnode.ccode) {
+      set_ccode(hnode.ccode);
+      city = hnode.city;
+      latitude = hnode.latitude;
+      longitude = hnode.longitude;
+      geoname_id = hnode.geoname_id;
+   }
+
+   if(!as_num && hnode.as_num) {
+      as_num = hnode.as_num;
+      as_org = hnode.as_org;
+   }
+}
+
 //
 // serialization
 //
@@ -261,6 +341,8 @@ size_t hnode_t::s_unpack_data(const void *buffer, size_t bufsize, s_unpack_cb_t<
 
    u_short version = s_node_ver(buffer);
 
+   hostaddr.parse(string.c_str(), string.length());
+
    ptr = sr.deserialize(ptr, tmp); spammer = tmp;
    ptr = sr.deserialize(ptr, count);
    ptr = sr.deserialize(ptr, files);
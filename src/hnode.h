@@ -18,6 +18,7 @@
 #include "tstamp.h"
 #include "types.h"
 #include "storable.h"
+#include "util_ipaddr.h"
 
 ///
 /// @brief  Host node
@@ -51,6 +52,12 @@
 /// sync regardless whether there is a visit active or not. See `vnode_t` for
 /// details.
 ///
+/// 7. Host nodes for IP addresses are hashed and matched in the hash table by their
+/// binary address in `hostaddr`, so textual variants of the same IPv6 address refer
+/// to the same host node. `hostaddr` is empty for host names and groups, which are
+/// hashed and matched by their strings. `hostaddr` is not saved in the state database
+/// and is parsed from the node string whenever the string is set.
+///
 struct hnode_t : public base_node<hnode_t> {
       static const size_t ccode_size = 2;   ///< In characters, not counting the zero terminator
 
@@ -96,6 +103,8 @@ struct hnode_t : public base_node<hnode_t> {
       uint32_t as_num;              ///< Autonomous system number.
       string_t as_org;              ///< Autonomous system organization.
 
+      ipaddr_t hostaddr;            ///< Binary IP address (not saved in the state database)
+
       public:
          template <typename ... param_t>
          using s_unpack_cb_t = void (*)(hnode_t& hnode, bool active, param_t ... param);
@@ -104,6 +113,7 @@ struct hnode_t : public base_node<hnode_t> {
          hnode_t(void);
          hnode_t(hnode_t&& tmp) noexcept;
          hnode_t(const string_t& ipaddr);
+         hnode_t(const string_t& ipaddr, const ipaddr_t& hostaddr);
 
          ~hnode_t(void);
 
@@ -111,6 +121,8 @@ struct hnode_t : public base_node<hnode_t> {
 
          void reset(uint64_t nodeid = 0);
 
+         void merge(const hnode_t& hnode);
+
          bool entry_url_set(void) const {return visit && visit->entry_url;}
 
          void set_entry_url(void) {if(visit) visit->entry_url = true;}
@@ -125,6 +137,20 @@ struct hnode_t : public base_node<hnode_t> {
 
          const string_t& hostname(void) const {return name.isempty() ? string : name;}
 
+         // make the single-string match_key visible for host groups
+         using base_node<hnode_t>::match_key;
+
+         /// Alternative key matching method that compares binary IP addresses.
+         bool match_key(const ipaddr_t& addr) const {return !hostaddr.isempty() && hostaddr == addr;}
+
+         /// Returns a hash value of the binary IP address in `key` or of `key` itself if it's not an IP address.
+         static uint64_t hash_key(const string_t& key);
+
+         /// Alternative key hashing method that hashes a binary IP address.
+         static uint64_t hash_key(const ipaddr_t& addr) {return hash_bin(0, addr.get_bytes(), ipaddr_t::size);}
+
+         uint64_t get_hash(void) const override {return hostaddr.isempty() ? hash_ex(0, string) : hash_key(hostaddr);}
+
          void add_grp_visit(storable_t<vnode_t> *vnode);
 
          vnode_t *get_grp_visit(void);
@@ -27,6 +27,14 @@ void hourly_t::reset(u_int hour)
    th_xfer = 0;
 }
 
+void hourly_t::merge(const hourly_t& hourly)
+{
+   th_hits += hourly.th_hits;
+   th_files += hourly.th_files;
+   th_pages += hourly.th_pages;
+   th_xfer += hourly.th_xfer;
+}
+
 //
 // serialization
 //
@@ -32,6 +32,8 @@ struct hourly_t : public keynode_t<uint32_t>, public datanode_t<hourly_t> {
 
          void reset(u_int hour);
 
+         void merge(const hourly_t& hourly);
+
          //
          // serialization
          //
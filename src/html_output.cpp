@@ -35,6 +35,35 @@
 #include <cctype>
 #include <algorithm>
 
+///
+/// @brief  Looks up the node at `index` in the selection of top nodes `top_nodes`
+///         and returns `true` if it was found.
+///
+template <typename node_t>
+bool get_top_node(const database_t& database, const top_nodes_t& top_nodes, size_t index, storable_t<node_t>& node, bool (database_t::*get_node_by_id)(storable_t<node_t>& node, typename node_t::template s_unpack_cb_t<> upcb) const)
+{
+   if(index >= top_nodes.size())
+      return false;
+
+   node.nodeid = top_nodes.get_nodeid(index);
+
+   return (database.*get_node_by_id)(node, nullptr);
+}
+
+///
+/// @brief  Looks up up to `count` top nodes from `top_nodes` into `nodes`, in the
+///         order of ranks, and returns the number of nodes found.
+///
+template <typename node_t>
+u_int get_top_nodes(const database_t& database, const top_nodes_t& top_nodes, storable_t<node_t> *nodes, u_int count, bool (database_t::*get_node_by_id)(storable_t<node_t>& node, typename node_t::template s_unpack_cb_t<> upcb) const)
+{
+   u_int i;
+
+   for(i = 0; i < count && get_top_node(database, top_nodes, i, nodes[i], get_node_by_id); i++);
+
+   return i;
+}
+
 //
 //
 //
@@ -567,6 +596,345 @@ void html_output_t::write_asn_report(void)
       top_asn_table();
 }
 
+///
+/// @brief  Selects top URLs for all URL tables in a single scan of the URL table.
+///
+/// Selected URLs are filtered in the same way URL tables used to filter URLs read
+/// from secondary indexes, so each table can be filled with selected URLs without
+/// skipping any of them.
+///
+void html_output_t::select_top_urls(void)
+{
+   storable_t<unode_t> unode;
+
+   top_urls_hits.reset(config.ntop_urls);
+   top_urls_xfer.reset(config.ntop_urlsK);
+   top_url_groups_hits.reset(config.bundle_groups ? config.ntop_urls : 0);
+   top_url_groups_xfer.reset(config.bundle_groups ? config.ntop_urlsK : 0);
+   top_urls_entry.reset(config.ntop_entry);
+   top_urls_exit.reset(config.ntop_exit);
+
+   if(!state.totals.t_url || !config.ntop_urls && !config.ntop_urlsK && !config.ntop_entry && !config.ntop_exit)
+      return;
+
+   database_t::iterator<unode_t> iter = state.database.begin_urls(nullptr);
+
+   while(iter.next(unode)) {
+      if(unode.flag == OBJ_GRP) {
+         if(config.bundle_groups) {
+            top_url_groups_hits.add(unode.count, unode.nodeid);
+            top_url_groups_xfer.add(unode.xfer, unode.nodeid);
+         }
+         else {
+            top_urls_hits.add(unode.count, unode.nodeid);
+            top_urls_xfer.add(unode.xfer, unode.nodeid);
+         }
+      }
+      else if(!config.hidden_urls.isinlistex(unode.string, unode.pathlen, true)) {
+         top_urls_hits.add(unode.count, unode.nodeid);
+         top_urls_xfer.add(unode.xfer, unode.nodeid);
+
+         // do not show entries with zero entry/exit values
+         if(unode.entry)
+            top_urls_entry.add(unode.entry, unode.nodeid);
+
+         if(unode.exit)
+            top_urls_exit.add(unode.exit, unode.nodeid);
+      }
+
+      unode.reset();
+   }
+
+   iter.close();
+}
+
+void html_output_t::select_top_hosts(void)
+{
+   storable_t<hnode_t> hnode;
+
+   top_hosts_hits.reset(config.ntop_hosts);
+   top_hosts_xfer.reset(config.ntop_hostsK);
+
+   // groups are only bundled in the hits table
+   top_host_groups_hits.reset(config.bundle_groups ? config.ntop_hosts : 0);
+
+   if(!state.totals.t_hosts || !config.ntop_hosts && !config.ntop_hostsK)
+      return;
+
+   database_t::iterator<hnode_t> iter = state.database.begin_hosts(nullptr);
+
+   while(iter.next(hnode)) {
+      if(hnode.flag == OBJ_GRP) {
+         if(config.bundle_groups)
+            top_host_groups_hits.add(hnode.count, hnode.nodeid);
+         else {
+            top_hosts_hits.add(hnode.count, hnode.nodeid);
+            top_hosts_xfer.add(hnode.xfer, hnode.nodeid);
+         }
+      }
+      else if(!(config.hide_hosts || hnode.robot && config.hide_robots || config.hidden_hosts.isinlist(hnode.string) || config.hidden_hosts.isinlist(hnode.name))) {
+         top_hosts_hits.add(hnode.count, hnode.nodeid);
+         top_hosts_xfer.add(hnode.xfer, hnode.nodeid);
+      }
+
+      hnode.reset();
+   }
+
+   iter.close();
+}
+
+void html_output_t::select_top_downloads(void)
+{
+   storable_t<dlnode_t> dlnode;
+
+   top_downloads_xfer.reset(config.ntop_downloads);
+
+   if(!state.totals.t_downloads || !config.ntop_downloads)
+      return;
+
+   database_t::iterator<dlnode_t> iter = state.database.begin_downloads(nullptr);
+
+   while(iter.next(dlnode)) {
+      top_downloads_xfer.add(dlnode.sumxfer, dlnode.nodeid);
+      dlnode.reset();
+   }
+
+   iter.close();
+}
+
+void html_output_t::select_top_errors(void)
+{
+   storable_t<rcnode_t> rcnode;
+
+   top_errors_hits.reset(config.ntop_errors);
+
+   if(!state.totals.t_err || !config.ntop_errors)
+      return;
+
+   database_t::iterator<rcnode_t> iter = state.database.begin_errors(nullptr);
+
+   while(iter.next(rcnode)) {
+      top_errors_hits.add(rcnode.count, rcnode.nodeid);
+      rcnode.reset();
+   }
+
+   iter.close();
+}
+
+void html_output_t::select_top_refs(void)
+{
+   storable_t<rnode_t> rnode;
+
+   top_refs_hits.reset(config.ntop_refs);
+   top_ref_groups_hits.reset(config.bundle_groups ? config.ntop_refs : 0);
+
+   if(!state.totals.t_ref || !config.ntop_refs)
+      return;
+
+   database_t::iterator<rnode_t> iter = state.database.begin_referrers(nullptr);
+
+   while(iter.next(rnode)) {
+      if(rnode.flag == OBJ_GRP) {
+         if(config.bundle_groups)
+            top_ref_groups_hits.add(rnode.count, rnode.nodeid);
+         else
+            top_refs_hits.add(rnode.count, rnode.nodeid);
+      }
+      else if(!config.hidden_refs.isinlist(rnode.string))
+         top_refs_hits.add(rnode.count, rnode.nodeid);
+
+      rnode.reset();
+   }
+
+   iter.close();
+}
+
+void html_output_t::select_top_search(void)
+{
+   storable_t<snode_t> snode;
+
+   top_search_hits.reset(config.ntop_search);
+
+   if(!state.totals.t_srchits || !state.totals.t_search || !config.ntop_search)
+      return;
+
+   database_t::iterator<snode_t> iter = state.database.begin_search(nullptr);
+
+   while(iter.next(snode)) {
+      top_search_hits.add(snode.count, snode.nodeid);
+      snode.reset();
+   }
+
+   iter.close();
+}
+
+void html_output_t::select_top_users(void)
+{
+   storable_t<inode_t> inode;
+
+   top_users_hits.reset(config.ntop_users);
+   top_user_groups_hits.reset(config.bundle_groups ? config.ntop_users : 0);
+
+   if(!state.totals.t_user || !config.ntop_users)
+      return;
+
+   database_t::iterator<inode_t> iter = state.database.begin_users(nullptr);
+
+   while(iter.next(inode)) {
+      if(inode.flag == OBJ_GRP) {
+         if(config.bundle_groups)
+            top_user_groups_hits.add(inode.count, inode.nodeid);
+         else
+            top_users_hits.add(inode.count, inode.nodeid);
+      }
+      else if(!config.hidden_users.isinlist(inode.string))
+         top_users_hits.add(inode.count, inode.nodeid);
+
+      inode.reset();
+   }
+
+   iter.close();
+}
+
+void html_output_t::select_top_agents(void)
+{
+   storable_t<anode_t> anode;
+
+   top_agents_visits.reset(config.ntop_agents);
+   top_agent_groups_visits.reset(config.bundle_groups ? config.ntop_agents : 0);
+
+   if(!state.totals.t_agent || !config.ntop_agents)
+      return;
+
+   database_t::iterator<anode_t> iter = state.database.begin_agents(nullptr);
+
+   while(iter.next(anode)) {
+      if(anode.flag == OBJ_GRP) {
+         if(config.bundle_groups)
+            top_agent_groups_visits.add(anode.visits, anode.nodeid);
+         else
+            top_agents_visits.add(anode.visits, anode.nodeid);
+      }
+      else if(!(config.hide_robots && anode.robot || config.hidden_agents.isinlist(anode.string)))
+         top_agents_visits.add(anode.visits, anode.nodeid);
+
+      anode.reset();
+   }
+
+   iter.close();
+}
+
+///
+/// Country, city and ASN indexes sort nodes with the same number of visits in the
+/// reverse order of node IDs, so the selections for these tables rank such nodes by
+/// ascending node IDs.
+///
+void html_output_t::select_top_ctrys(void)
+{
+   storable_t<ccnode_t> ccnode;
+
+   // the pie chart always shows top 10 countries
+   top_ctrys_visits.reset(std::max(config.ntop_ctrys, config.ntop_ctrys && config.ctry_graph ? 10u : 0u), true);
+
+   if(!state.cc_htab.size() || !config.ntop_ctrys)
+      return;
+
+   database_t::iterator<ccnode_t> iter = state.database.begin_countries(nullptr);
+
+   while(iter.next(ccnode))
+      top_ctrys_visits.add(ccnode.visits, ccnode.nodeid);
+
+   iter.close();
+}
+
+void html_output_t::select_top_cities(void)
+{
+   storable_t<ctnode_t> ctnode;
+
+   top_cities_visits.reset(config.geoip_city ? config.ntop_cities : 0, true);
+
+   if(!config.geoip_city || !config.ntop_cities)
+      return;
+
+   database_t::iterator<ctnode_t> iter = state.database.begin_cities(nullptr);
+
+   while(iter.next(ctnode))
+      top_cities_visits.add(ctnode.visits, ctnode.nodeid);
+
+   iter.close();
+}
+
+void html_output_t::select_top_asn(void)
+{
+   storable_t<asnode_t> asnode;
+
+   top_asn_visits.reset(!config.asn_db_path.isempty() ? config.ntop_asn : 0, true);
+
+   if(config.asn_db_path.isempty() || !config.ntop_asn)
+      return;
+
+   database_t::iterator<asnode_t> iter = state.database.begin_asn(nullptr);
+
+   while(iter.next(asnode))
+      top_asn_visits.add(asnode.visits, asnode.nodeid);
+
+   iter.close();
+}
+
+///
+/// @brief  Selects top nodes for all report tables.
+///
+/// Report tables only show a few top nodes, which are selected in a single scan
+/// of each primary table instead of traversing secondary indexes, which would have
+/// to be built over all nodes, so secondary indexes are only needed for All Items
+/// pages and dump files.
+///
+void html_output_t::select_top_nodes(void)
+{
+   select_top_urls();
+   select_top_hosts();
+   select_top_downloads();
+   select_top_errors();
+   select_top_refs();
+   select_top_search();
+   select_top_users();
+   select_top_agents();
+   select_top_ctrys();
+   select_top_cities();
+   select_top_asn();
+
+   top_nodes_t *top_nodes[] = {
+      &top_urls_hits, &top_urls_xfer, &top_url_groups_hits, &top_url_groups_xfer, &top_urls_entry, &top_urls_exit,
+      &top_hosts_hits, &top_hosts_xfer, &top_host_groups_hits,
+      &top_downloads_xfer, &top_errors_hits,
+      &top_refs_hits, &top_ref_groups_hits,
+      &top_search_hits,
+      &top_users_hits, &top_user_groups_hits,
+      &top_agents_visits, &top_agent_groups_visits,
+      &top_ctrys_visits, &top_cities_visits, &top_asn_visits
+   };
+
+   for(size_t i = 0; i < sizeof(top_nodes)/sizeof(top_nodes[0]); i++)
+      top_nodes[i]->sort();
+}
+
+void html_output_t::clear_top_nodes(void)
+{
+   top_nodes_t *top_nodes[] = {
+      &top_urls_hits, &top_urls_xfer, &top_url_groups_hits, &top_url_groups_xfer, &top_urls_entry, &top_urls_exit,
+      &top_hosts_hits, &top_hosts_xfer, &top_host_groups_hits,
+      &top_downloads_xfer, &top_errors_hits,
+      &top_refs_hits, &top_ref_groups_hits,
+      &top_search_hits,
+      &top_users_hits, &top_user_groups_hits,
+      &top_agents_visits, &top_agent_groups_visits,
+      &top_ctrys_visits, &top_cities_visits, &top_asn_visits
+   };
+
+   for(size_t i = 0; i < sizeof(top_nodes)/sizeof(top_nodes[0]); i++)
+      top_nodes[i]->clear();
+}
+
 /*********************************************/
 /* WRITE_MONTH_HTML - does what it says...   */
 /*********************************************/
@@ -665,6 +1033,9 @@ int html_output_t::write_monthly_report()
       fputs("</div>\n", out_fp);
    }
 
+   // select top nodes for all report tables in one scan per table
+   select_top_nodes();
+
    write_url_report();
 
    if(config.log_type == LOG_SQUID)
@@ -684,6 +1055,8 @@ int html_output_t::write_monthly_report()
    write_country_report();
    write_city_report();
 
+   clear_top_nodes();
+
    write_html_tail(out_fp);               /* finish up the HTML document    */
    fclose(out_fp);                        /* close the file                 */
 
@@ -1171,36 +1544,11 @@ void html_output_t::top_hosts_table(int flag)
    i = 0;
 
    // for the hits report, if groups are bundled, put them first
-   if(!flag && config.bundle_groups) {
-      database_t::reverse_iterator<hnode_t> iter = state.database.rbegin_hosts(flag ? "hosts.groups.xfer" : "hosts.groups.hits");
-
-      while(i < tot_num && iter.prev(h_array[i]))
-         i++;
-
-      iter.close();
-   }
-
-   // populate the remainder of the array
-   if(i < tot_num) {
-      database_t::reverse_iterator<hnode_t> iter = state.database.rbegin_hosts(flag ? "hosts.xfer" : "hosts.hits");
-
-      while(i < tot_num && iter.prev(h_array[i])) {
-         if(h_array[i].flag == OBJ_REG) {
-            // ignore hosts matching any of the hiding patterns
-            if(config.hide_hosts || h_array[i].robot && config.hide_robots || config.hidden_hosts.isinlist(h_array[i].string) || config.hidden_hosts.isinlist(h_array[i].name))
-               continue;
-         }
-         else if(h_array[i].flag == OBJ_GRP) {
-            // ignore groups if we did them before
-            if(config.bundle_groups)
-               continue;
-         }
-
-         i++;
-      }
+   if(!flag && config.bundle_groups)
+      i = get_top_nodes(state.database, top_host_groups_hits, h_array, tot_num, &database_t::get_hnode_by_id<>);
 
-      iter.close();
-   }
+   // populate the remainder of the array with hosts that were not hidden
+   i += get_top_nodes(state.database, flag ? top_hosts_xfer : top_hosts_hits, &h_array[i], tot_num - i, &database_t::get_hnode_by_id<>);
 
    // check if all items are hidden
    if(i == 0) {
@@ -1511,36 +1859,11 @@ void html_output_t::top_urls_table(int flag)
    i = 0;
 
    // if groups are bundled, put them first
-   if(config.bundle_groups) {
-      database_t::reverse_iterator<unode_t> iter = state.database.rbegin_urls(flag ? "urls.groups.xfer" : "urls.groups.hits");
-
-      while(i < tot_num && iter.prev(u_array[i]))
-         i++;
+   if(config.bundle_groups)
+      i = get_top_nodes(state.database, flag ? top_url_groups_xfer : top_url_groups_hits, u_array, tot_num, &database_t::get_unode_by_id);
 
-      iter.close();
-   }
-
-   // populate the remainder of the array
-   if(i < tot_num) {
-      database_t::reverse_iterator<unode_t> iter = state.database.rbegin_urls(flag ? "urls.xfer" : "urls.hits");
-
-      while(i < tot_num && iter.prev(u_array[i])) {
-         if(u_array[i].flag == OBJ_REG) {
-            // ignore URLs matching any of the hiding patterns
-            if(config.hidden_urls.isinlistex(u_array[i].string, u_array[i].pathlen, true))
-               continue;
-         }
-         else if(u_array[i].flag == OBJ_GRP) {
-            // ignore groups if we did them before
-            if(config.bundle_groups)
-               continue;
-         }
-
-         i++;
-      }
-
-      iter.close();
-   }
+   // populate the remainder of the array with URLs that were not hidden
+   i += get_top_nodes(state.database, flag ? top_urls_xfer : top_urls_hits, &u_array[i], tot_num - i, &database_t::get_unode_by_id);
 
    // check if all items are hidden
    if(i == 0) {
@@ -1791,18 +2114,8 @@ void html_output_t::top_entry_table(int flag)
 
    i = 0;
 
-   // traverse the entry/exit tables and populate the array
-   database_t::reverse_iterator<unode_t> iter = state.database.rbegin_urls(flag ? "urls.exit" : "urls.entry");
-
-   while(i < tot_num && iter.prev(u_array[i])) {
-      if(u_array[i].flag == OBJ_REG && !config.hidden_urls.isinlistex(u_array[i].string, u_array[i].pathlen, true)) {
-         // do not show entries with zero entry/exit values
-         if(!flag && u_array[i].entry || flag && u_array[i].exit)
-            i++;
-      }
-   }
-
-   iter.close();
+   // populate the array with URLs that were not hidden and have non-zero entry/exit counts
+   i = get_top_nodes(state.database, flag ? top_urls_exit : top_urls_entry, u_array, tot_num, &database_t::get_unode_by_id);
 
    // check if all items are hidden or have zero entry/exit counts
    if(i == 0) {
@@ -1929,36 +2242,11 @@ void html_output_t::top_refs_table()
    i = 0;
 
    // if groups are bundled, put them first
-   if(config.bundle_groups) {
-      database_t::reverse_iterator<rnode_t> iter = state.database.rbegin_referrers("referrers.groups.hits");
-
-      while(i < tot_num && iter.prev(r_array[i]))
-         i++;
-
-      iter.close();
-   }
-
-   // populate the remainder of the array
-   if(i < tot_num) {
-      database_t::reverse_iterator<rnode_t> iter = state.database.rbegin_referrers("referrers.hits");
-
-      while(i < tot_num && iter.prev(r_array[i])) {
-         if(r_array[i].flag == OBJ_REG) {
-            // ignore referrers matching any of the hiding patterns
-            if(config.hidden_refs.isinlist(r_array[i].string))
-               continue;
-         }
-         else if(r_array[i].flag == OBJ_GRP) {
-            // ignore groups if we did them before
-            if(config.bundle_groups)
-               continue;
-         }
-
-         i++;
-      }
+   if(config.bundle_groups)
+      i = get_top_nodes(state.database, top_ref_groups_hits, r_array, tot_num, &database_t::get_rnode_by_id);
 
-      iter.close();
-   }
+   // populate the remainder of the array with referrers that were not hidden
+   i += get_top_nodes(state.database, top_refs_hits, &r_array[i], tot_num - i, &database_t::get_rnode_by_id);
 
    // check if all items are hidden
    if(i == 0) {
@@ -2089,17 +2377,15 @@ void html_output_t::top_dl_table(void)
    dl_array = new storable_t<dlnode_t>[tot_num];
    h_array = new storable_t<hnode_t>[tot_num];
 
-   database_t::reverse_iterator<dlnode_t> iter = state.database.rbegin_downloads("downloads.xfer");
+   for(i = 0; i < tot_num && i < top_downloads_xfer.size(); i++) {
+      dl_array[i].nodeid = top_downloads_xfer.get_nodeid(i);
 
-   for(i = 0; i < tot_num; i++) {
-      if(!iter.prev<void *, storable_t<hnode_t>&>(dl_array[i], state_t::unpack_dlnode_and_host_cb, const_cast<state_t*>(&state), h_array[i]))
+      if(!state.database.get_dlnode_by_id<void *, storable_t<hnode_t>&>(dl_array[i], state_t::unpack_dlnode_and_host_cb, const_cast<state_t*>(&state), h_array[i]))
          break;
    }
 
    if(i < tot_num)
-      fprintf(stderr, "Failed to retrieve download records (%d)", iter.get_error());
-
-   iter.close();
+      fprintf(stderr, "Failed to retrieve download records (%" PRIu64 ")", i < top_downloads_xfer.size() ? top_downloads_xfer.get_nodeid(i) : 0);
 
    // generate the report
    fputs("\n<!-- Top Downloads Table -->\n", out_fp);
@@ -2323,9 +2609,6 @@ void html_output_t::top_err_table(void)
    /* get max to do... */
    tot_num = (a_ctr > config.ntop_errors) ? config.ntop_errors : (uint32_t) a_ctr;
 
-   // get top tot_num hit-ordered nodes from the state.database
-   database_t::reverse_iterator<rcnode_t> iter = state.database.rbegin_errors("errors.hits");
-
    fputs("\n<!-- Top HTTP Errors Table -->\n", out_fp);
    fputs("<a name=\"errors\"></a>\n", out_fp);
 
@@ -2341,7 +2624,7 @@ void html_output_t::top_err_table(void)
 
    fputs("<tbody class=\"stats_data_tbody\">\n", out_fp);
 
-   for(i=0; i < tot_num && iter.prev(rcnode); i++) {
+   for(i=0; i < tot_num && get_top_node(state.database, top_errors_hits, i, rcnode, &database_t::get_rcnode_by_id); i++) {
       rptr = &rcnode;
 
       fprintf(out_fp,
@@ -2362,8 +2645,6 @@ void html_output_t::top_err_table(void)
    }
    fputs("</tbody>\n", out_fp);
 
-   iter.close();
-
    if (config.all_errors && tot_num == config.ntop_errors && a_ctr > config.ntop_errors)
    {
       if (all_errors_page())
@@ -2535,36 +2816,11 @@ void html_output_t::top_agents_table()
    i = 0;
 
    // if groups are bundled, put them first
-   if(config.bundle_groups) {
-      database_t::reverse_iterator<anode_t> iter = state.database.rbegin_agents("agents.groups.visits");
-
-      while(i < tot_num && iter.prev(a_array[i]))
-         i++;
-
-      iter.close();
-   }
+   if(config.bundle_groups)
+      i = get_top_nodes(state.database, top_agent_groups_visits, a_array, tot_num, &database_t::get_anode_by_id);
 
-   // populate the remainder of the array
-   if(i < tot_num) {
-      database_t::reverse_iterator<anode_t> iter = state.database.rbegin_agents("agents.visits");
-
-      while(i < tot_num && iter.prev(a_array[i])) {
-         if(a_array[i].flag == OBJ_REG) {
-            // ignore agents matching any of the hiding patterns
-            if(config.hide_robots  && a_array[i].robot || config.hidden_agents.isinlist(a_array[i].string))
-               continue;
-         }
-         else if(a_array[i].flag == OBJ_GRP) {
-            // ignore groups if we did them before
-            if(config.bundle_groups)
-               continue;
-         }
-
-         i++;
-      }
-
-      iter.close();
-   }
+   // populate the remainder of the array with agents that were not hidden
+   i += get_top_nodes(state.database, top_agents_visits, &a_array[i], tot_num - i, &database_t::get_anode_by_id);
 
    // check if all items are hidden
    if(i == 0) {
@@ -2765,11 +3021,9 @@ void html_output_t::top_search_table(void)
    fprintf(out_fp,"<th class=\"item_th\">%s</th></tr>\n", config.lang.msg_h_search);
    fputs("</thead>\n", out_fp);
 
-   database_t::reverse_iterator<snode_t> iter = state.database.rbegin_search("search.hits");
-
    fputs("<tbody class=\"stats_data_tbody\">\n", out_fp);
 
-   for(i = 0; i < tot_num && iter.prev(snode); i++) {
+   for(i = 0; i < tot_num && get_top_node(state.database, top_search_hits, i, snode, &database_t::get_snode_by_id); i++) {
       sptr = &snode;
       fprintf(out_fp,
          "<tr>\n"
@@ -2809,8 +3063,6 @@ void html_output_t::top_search_table(void)
    }
    fputs("</tbody>\n", out_fp);
 
-   iter.close();
-
    if ( (config.all_search) && tot_num == config.ntop_search && a_ctr > config.ntop_search)
    {
       if (all_search_page())
@@ -2925,36 +3177,11 @@ void html_output_t::top_users_table()
    i = 0;
 
    // if groups are bundled, put them first
-   if(config.bundle_groups) {
-      database_t::reverse_iterator<inode_t> iter = state.database.rbegin_users("users.groups.hits");
-
-      while(i < tot_num && iter.prev(i_array[i]))
-         i++;
-
-      iter.close();
-   }
-
-   // populate the remainder of the array
-   if(i < tot_num) {
-      database_t::reverse_iterator<inode_t> iter = state.database.rbegin_users("users.hits");
+   if(config.bundle_groups)
+      i = get_top_nodes(state.database, top_user_groups_hits, i_array, tot_num, &database_t::get_inode_by_id);
 
-      while(i < tot_num && iter.prev(i_array[i])) {
-         if(i_array[i].flag == OBJ_REG) {
-            // ignore referrers matching any of the hiding patterns
-            if(config.hidden_users.isinlist(i_array[i].string))
-               continue;
-         }
-         else if(i_array[i].flag == OBJ_GRP) {
-            // ignore groups if we did them before
-            if(config.bundle_groups)
-               continue;
-         }
-
-         i++;
-      }
-
-      iter.close();
-   }
+   // populate the remainder of the array with users that were not hidden
+   i += get_top_nodes(state.database, top_users_hits, &i_array[i], tot_num - i, &database_t::get_inode_by_id);
 
    // check if all items are hidden
    if(i == 0) {
@@ -3173,14 +3400,11 @@ void html_output_t::top_ctry_table()
             uint64_t pie_data[10] = {};
             const char *pie_legend[10] = {};
 
-            database_t::reverse_iterator<ccnode_t> iter = state.database.rbegin_countries("countries.visits");
-
             // we only store country nodes with some activity, so no need to check for zero counts
-            for(u_int i = 0; i < 10u && iter.prev(ccnode); i++) {
+            for(u_int i = 0; i < 10u && get_top_node(state.database, top_ctrys_visits, i, ccnode, &database_t::get_ccnode_by_id); i++) {
                pie_data[i] = ccnode.visits;
                pie_legend[i] = state.cc_htab.get_ccnode(ccnode.ccode).cdesc.c_str();
             }
-            iter.close();
 
             graph.pie_chart(pie_fname_lang, pie_title, t_visits, pie_data, pie_legend);
          }
@@ -3210,9 +3434,7 @@ void html_output_t::top_ctry_table()
 
    fputs("<tbody class=\"stats_data_tbody\">\n", out_fp);
 
-   database_t::reverse_iterator<ccnode_t> iter = state.database.rbegin_countries("countries.visits");
-
-   for(u_int i = 0; i < tot_num && iter.prev(ccnode); i++) {
+   for(u_int i = 0; i < tot_num && get_top_node(state.database, top_ctrys_visits, i, ccnode, &database_t::get_ccnode_by_id); i++) {
       buffer_formatter.set_scope_mode(buffer_formatter_t::append),
       fprintf(out_fp,"<tr>"
             "<th>%u</th>\n"
@@ -3240,7 +3462,6 @@ void html_output_t::top_ctry_table()
             ccnode.ccode.c_str(),
             html_encode(state.cc_htab.get_ccnode(ccnode.ccode).cdesc.c_str()));
    }
-   iter.close();
 
    fputs("</tbody>\n", out_fp);
    fputs("</table>\n", out_fp);
@@ -3276,9 +3497,8 @@ void html_output_t::top_city_table()
    fputs("<tbody class=\"stats_data_tbody\">\n", out_fp);
 
    storable_t<ctnode_t> ctnode;
-   database_t::reverse_iterator<ctnode_t> iter = state.database.rbegin_cities("cities.visits");
 
-   for(u_int i = 0; i < tot_num && iter.prev(ctnode); i++) {
+   for(u_int i = 0; i < tot_num && get_top_node(state.database, top_cities_visits, i, ctnode, &database_t::get_ctnode_by_id); i++) {
       
       if(ctnode.hits != 0) {
          buffer_formatter.set_scope_mode(buffer_formatter_t::append),
@@ -3312,7 +3532,6 @@ void html_output_t::top_city_table()
               html_encode(ctnode.unknown_city() ? "" : ctnode.city.c_str()));
       }
    }
-   iter.close();
 
    fputs("</tbody>\n", out_fp);
    fputs("</table>\n", out_fp);
@@ -3348,9 +3567,8 @@ void html_output_t::top_asn_table()
    fputs("<tbody class=\"stats_data_tbody\">\n", out_fp);
 
    storable_t<asnode_t> asnode;
-   database_t::reverse_iterator<asnode_t> iter = state.database.rbegin_asn("asn.visits");
 
-   for(u_int i = 0; i < tot_num && iter.prev(asnode); i++) {
+   for(u_int i = 0; i < tot_num && get_top_node(state.database, top_asn_visits, i, asnode, &database_t::get_asnode_by_id); i++) {
       
       if(asnode.hits != 0) {
          buffer_formatter.set_scope_mode(buffer_formatter_t::append),
@@ -3387,7 +3605,6 @@ void html_output_t::top_asn_table()
                html_encode(asnode.as_org.c_str()));
       }
    }
-   iter.close();
 
    fputs("</tbody>\n", out_fp);
    fputs("</table>\n", out_fp);
@@ -15,6 +15,7 @@
 #include "graphs.h"
 #include "encoder.h"
 #include "formatter.h"
+#include "top_nodes.h"
 
 //
 //
@@ -40,6 +41,42 @@ class html_output_t : public output_t {
 
       buffer_formatter_t buffer_formatter;
 
+      //
+      // Top nodes for report tables, selected by `select_top_nodes` in a single scan
+      // of each primary table. Group lists are only filled if groups are bundled.
+      //
+      top_nodes_t top_urls_hits;
+      top_nodes_t top_urls_xfer;
+      top_nodes_t top_url_groups_hits;
+      top_nodes_t top_url_groups_xfer;
+      top_nodes_t top_urls_entry;
+      top_nodes_t top_urls_exit;
+
+      top_nodes_t top_hosts_hits;
+      top_nodes_t top_hosts_xfer;
+      top_nodes_t top_host_groups_hits;
+
+      top_nodes_t top_downloads_xfer;
+
+      top_nodes_t top_errors_hits;
+
+      top_nodes_t top_refs_hits;
+      top_nodes_t top_ref_groups_hits;
+
+      top_nodes_t top_search_hits;
+
+      top_nodes_t top_users_hits;
+      top_nodes_t top_user_groups_hits;
+
+      top_nodes_t top_agents_visits;
+      top_nodes_t top_agent_groups_visits;
+
+      top_nodes_t top_ctrys_visits;
+
+      top_nodes_t top_cities_visits;
+
+      top_nodes_t top_asn_visits;
+
    private:
       const char *fmt_printf(const char *fmt, ...);
       const char *fmt_xfer(uint64_t xfer, bool pre = false);
@@ -66,6 +103,21 @@ class html_output_t : public output_t {
       void write_city_report(void);
       void write_asn_report(void);
 
+      void select_top_urls(void);
+      void select_top_hosts(void);
+      void select_top_downloads(void);
+      void select_top_errors(void);
+      void select_top_refs(void);
+      void select_top_search(void);
+      void select_top_users(void);
+      void select_top_agents(void);
+      void select_top_ctrys(void);
+      void select_top_cities(void);
+      void select_top_asn(void);
+
+      void select_top_nodes(void);
+      void clear_top_nodes(void);
+
       void month_links(void);
       void month_total_table(void);
       void daily_total_table(void);
@@ -11,6 +11,9 @@
 
 #include "inode.h"
 #include "serialize.h"
+#include "util_math.h"
+
+#include <algorithm>
 
 inode_t::inode_t(void) : base_node<inode_t>() 
 {
@@ -28,6 +31,27 @@ inode_t::inode_t(const string_t& ident) : base_node<inode_t>(ident)
    avgtime = maxtime = .0;
 }
 
+///
+/// Adds counters of `inode`, which must have the same user name, to this node.
+/// Average processing times are combined using request counts of both nodes as
+/// weights.
+///
+void inode_t::merge(const inode_t& inode)
+{
+   if(inode.count)
+      avgtime = AVG2(avgtime, count, inode.avgtime, inode.count);
+
+   maxtime = std::max(maxtime, inode.maxtime);
+
+   count += inode.count;
+   files += inode.files;
+   visit += inode.visit;
+   xfer += inode.xfer;
+
+   if(!inode.tstamp.null && (tstamp.null || inode.tstamp > tstamp))
+      tstamp = inode.tstamp;
+}
+
 //
 // serialization
 //
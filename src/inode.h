@@ -36,6 +36,8 @@ struct inode_t : public base_node<inode_t> {
          inode_t(void);
          inode_t(const string_t& ident);
 
+         void merge(const inode_t& inode);
+
          //
          // serialization
          //
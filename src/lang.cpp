@@ -86,6 +86,7 @@
          "--end-month         end active visits and close the database", \
          "--compact-db        compact the database", \
          "--db-info           print database information", \
+         "--merge-db          merge state databases into the first one", \
          "--pipe-log-names    read log file names from standard input"
 
 /* short month names MUST BE 3 CHARS in size... pad if needed*/
@@ -721,6 +722,8 @@ lang_t::lang_t(void) :
    msg_dns_rslv= "DNS workers";
    msg_dns_init= "Error: Cannot initialize DNS resolver";
    msg_dns_htrt= "DNS cache hit ratio";
+   msg_ua_htrt = "User agent cache hit ratio";
+   msg_db_fskip = "Database look-ups skipped (false positives)";
    msg_dns_geoe= "Cannot open GeoIP database";
    msg_dns_asne= "Cannot open ASN database";
    msg_dns_useg= "Using GeoIP database";
@@ -838,6 +841,8 @@ void lang_t::init_lang_htab(void)
    ln_htab.emplace(string_t("msg_dns_rslv"), &msg_dns_rslv);
    ln_htab.emplace(string_t("msg_dns_init"), &msg_dns_init);
    ln_htab.emplace(string_t("msg_dns_htrt"), &msg_dns_htrt);
+   ln_htab.emplace(string_t("msg_ua_htrt"), &msg_ua_htrt);
+   ln_htab.emplace(string_t("msg_db_fskip"), &msg_db_fskip);
    ln_htab.emplace(string_t("msg_dns_geoe"), &msg_dns_geoe);
    ln_htab.emplace(string_t("msg_dns_asne"), &msg_dns_asne);
    ln_htab.emplace(string_t("msg_dns_useg"), &msg_dns_useg);
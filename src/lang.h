@@ -138,6 +138,8 @@ class lang_t {
       const char *msg_dns_rslv;
       const char *msg_dns_init;
       const char *msg_dns_htrt;
+      const char *msg_ua_htrt;
+      const char *msg_db_fskip;
       const char *msg_dns_geoe;
       const char *msg_dns_asne;
       const char *msg_dns_useg;
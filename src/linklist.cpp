@@ -12,14 +12,383 @@
 
 #include <cstring>
 #include <cctype>
+#include <algorithm>
+#include <deque>
 
 #include "lang.h"
 #include "linklist.h"
 
+//
+// list_matcher_t::pattern_trie_t
+//
+
+list_matcher_t::pattern_trie_t::pattern_trie_t(void)
+{
+   min_index = NO_MATCH;
+
+   std::fill_n(root_edges, 256, 0);
+}
+
+///
+/// @brief  Returns the state reached from `state` with `chr` or zero if there is
+///         no such transition.
+///
+/// Zero is the root state, which cannot be reached via any transition.
+///
+uint32_t list_matcher_t::pattern_trie_t::find_edge(uint32_t state, u_char chr) const
+{
+   const state_t& sref = states[state];
+   const edge_t *first = &edges[sref.first_edge], *last = first + sref.edge_count;
+
+   // most states have one or two edges, so a linear search is faster than a binary one
+   for(const edge_t *edge = first; edge != last && edge->chr <= chr; edge++) {
+      if(edge->chr == chr)
+         return edge->state;
+   }
+
+   return 0;
+}
+
+///
+/// @brief  Builds a trie from `keys`, each of which is paired with a pattern index.
+///
+/// Keys must be sorted by their pattern index. If `automaton` is `true`, failure
+/// states are computed for Aho-Corasick searches.
+///
+void list_matcher_t::pattern_trie_t::build(const std::vector<std::pair<string_t, uint32_t>>& keys, bool automaton)
+{
+   std::vector<std::vector<edge_t>> state_edges(1);
+   std::vector<std::vector<uint32_t>> state_patterns(1);
+   std::deque<uint32_t> queue;
+
+   // insert all keys into a temporary trie
+   for(size_t index = 0; index < keys.size(); index++) {
+      const string_t& key = keys[index].first;
+      uint32_t state = 0;
+
+      for(size_t pos = 0; pos < key.length(); pos++) {
+         std::vector<edge_t>& sedges = state_edges[state];
+         std::vector<edge_t>::iterator edge = std::find_if(sedges.begin(), sedges.end(), [&key, pos](const edge_t& edge) {return edge.chr == (u_char) key[pos];});
+
+         if(edge != sedges.end())
+            state = edge->state;
+         else {
+            sedges.push_back({(u_char) key[pos], (uint32_t) state_edges.size()});
+            state = (uint32_t) state_edges.size();
+            state_edges.emplace_back();
+            state_patterns.emplace_back();
+         }
+      }
+
+      state_patterns[state].push_back(keys[index].second);
+   }
+
+   states.resize(state_edges.size());
+
+   min_index = keys.empty() ? NO_MATCH : keys.front().second;
+
+   // copy states, edges and patterns into flat arrays
+   for(size_t state = 0; state < states.size(); state++) {
+      std::sort(state_edges[state].begin(), state_edges[state].end(), [](const edge_t& e1, const edge_t& e2) {return e1.chr < e2.chr;});
+
+      states[state].first_edge = (uint32_t) edges.size();
+      states[state].edge_count = (uint32_t) state_edges[state].size();
+      edges.insert(edges.end(), state_edges[state].begin(), state_edges[state].end());
+
+      states[state].first_pattern = (uint32_t) patterns.size();
+      states[state].pattern_count = (uint32_t) state_patterns[state].size();
+      patterns.insert(patterns.end(), state_patterns[state].begin(), state_patterns[state].end());
+
+      states[state].fail = 0;
+      states[state].match = state_patterns[state].empty() ? NO_MATCH : state_patterns[state].front();
+   }
+
+   if(!automaton)
+      return;
+
+   //
+   // Compute failure states breadth-first, so failure states of shorter prefixes
+   // are known by the time longer ones are processed. Each state inherits the
+   // lowest pattern index of its failure state, which is the longest suffix of
+   // this state's prefix that is also a prefix of some pattern.
+   //
+   for(uint32_t eindex = 0; eindex < states[0].edge_count; eindex++) {
+      const edge_t& edge = edges[states[0].first_edge + eindex];
+      root_edges[edge.chr] = edge.state;
+      queue.push_back(edge.state);
+   }
+
+   while(!queue.empty()) {
+      uint32_t state = queue.front();
+
+      queue.pop_front();
+
+      for(uint32_t eindex = 0; eindex < states[state].edge_count; eindex++) {
+         const edge_t& edge = edges[states[state].first_edge + eindex];
+         uint32_t fail = states[state].fail;
+
+         while(fail && !find_edge(fail, edge.chr))
+            fail = states[fail].fail;
+
+         states[edge.state].fail = fail ? find_edge(fail, edge.chr) : root_edges[edge.chr];
+         states[edge.state].match = std::min(states[edge.state].match, states[states[edge.state].fail].match);
+
+         queue.push_back(edge.state);
+      }
+   }
+}
+
+///
+/// @brief  Returns the lowest index of all patterns found in `str` that is lower
+///         than `limit` or `NO_MATCH` if none was found.
+///
+uint32_t list_matcher_t::pattern_trie_t::find_first(const char *str, size_t slen, uint32_t limit) const
+{
+   uint32_t state = 0, next, first = NO_MATCH;
+
+   for(size_t pos = 0; pos < slen; pos++) {
+      u_char chr = (u_char) str[pos];
+
+      while(state && (next = find_edge(state, chr)) == 0)
+         state = states[state].fail;
+
+      state = state ? next : root_edges[chr];
+
+      if(states[state].match < first) {
+         first = states[state].match;
+
+         // no pattern in this trie can have a lower index than the one we just found
+         if(first == min_index)
+            break;
+      }
+   }
+
+   return first < limit ? first : NO_MATCH;
+}
+
+///
+/// @brief  Walks the trie from the first character of `str` and returns the lowest
+///         index of patterns in visited states that is lower than `limit` and is
+///         confirmed by `check`, or `NO_MATCH` if there is no such pattern.
+///
+template <typename check_t>
+uint32_t list_matcher_t::pattern_trie_t::walk_forward(const char *str, size_t slen, bool nocase, uint32_t limit, check_t check) const
+{
+   uint32_t state = 0, first = NO_MATCH;
+
+   for(size_t pos = 0; pos < slen; pos++) {
+      if((state = find_edge(state, (u_char) (nocase ? string_t::tolower(str[pos]) : str[pos]))) == 0)
+         break;
+
+      // patterns are sorted by their index, so the first confirmed one is the lowest
+      for(uint32_t pindex = 0; pindex < states[state].pattern_count; pindex++) {
+         uint32_t index = patterns[states[state].first_pattern + pindex];
+
+         if(index >= std::min(limit, first))
+            break;
+
+         if(check(index)) {
+            first = index;
+            break;
+         }
+      }
+   }
+
+   return first;
+}
+
+///
+/// @brief  Walks the trie from the last character of `str` and returns the lowest
+///         index of patterns in visited states that is lower than `limit` and is
+///         confirmed by `check`, or `NO_MATCH` if there is no such pattern.
+///
+/// `isinstrex` does not compare the first character of the input if it is as long
+/// as the pattern without its leading asterisk, so patterns in all states following
+/// the one reached with the second input character are evaluated as candidates.
+///
+template <typename check_t>
+uint32_t list_matcher_t::pattern_trie_t::walk_backward(const char *str, size_t slen, bool nocase, uint32_t limit, check_t check) const
+{
+   uint32_t state = 0, first = NO_MATCH;
+   size_t pos = slen;
+
+   auto check_state = [this, &first, limit, &check](uint32_t state)
+   {
+      for(uint32_t pindex = 0; pindex < states[state].pattern_count; pindex++) {
+         uint32_t index = patterns[states[state].first_pattern + pindex];
+
+         if(index >= std::min(limit, first))
+            break;
+
+         if(check(index)) {
+            first = index;
+            break;
+         }
+      }
+   };
+
+   // patterns ending with an asterisk have empty keys
+   check_state(0);
+
+   while(--pos) {
+      if((state = find_edge(state, (u_char) (nocase ? string_t::tolower(str[pos]) : str[pos]))) == 0)
+         return first;
+
+      check_state(state);
+   }
+
+   for(uint32_t eindex = 0; eindex < states[state].edge_count; eindex++)
+      check_state(edges[states[state].first_edge + eindex].state);
+
+   return first;
+}
+
+//
+// list_matcher_t
+//
+
+list_matcher_t::list_matcher_t(std::vector<const base_list_node_t*>&& nodes, bool substr, bool nocase) :
+      nodes(std::move(nodes)),
+      substr(substr),
+      nocase(nocase)
+{
+   std::vector<std::pair<string_t, uint32_t>> substr_keys, prefix_keys, suffix_keys;
+   const char *star;
+
+   for(uint32_t index = 0; index < (uint32_t) this->nodes.size(); index++) {
+      const string_t& pattern = this->nodes[index]->string;
+
+      // empty patterns never match
+      if(pattern.isempty())
+         continue;
+
+      if(pattern[0] == '*') {
+         string_t key;
+
+         // characters following the last asterisk, in the reverse order
+         for(const char *cp = pattern.c_str() + pattern.length(); *--cp != '*'; )
+            key.append(nocase ? string_t::tolower(*cp) : *cp);
+
+         suffix_keys.emplace_back(key, index);
+      }
+      else if(substr && pattern[pattern.length()-1] != '*') {
+         if(nocase)
+            seq_patterns.push_back(index);
+         else
+            substr_keys.emplace_back(pattern, index);
+      }
+      else {
+         // characters preceding the first asterisk
+         string_t key(pattern.c_str(), (star = strchr(pattern, '*')) != nullptr ? star - pattern.c_str() : pattern.length());
+
+         prefix_keys.emplace_back(nocase ? key.tolower() : key, index);
+      }
+   }
+
+   substr_trie.build(substr_keys, true);
+   prefix_trie.build(prefix_keys, false);
+   suffix_trie.build(suffix_keys, false);
+}
+
+bool list_matcher_t::check_pattern(const char *str, size_t slen, uint32_t index) const
+{
+   const base_list_node_t *node = nodes[index];
+   return isinstrex(str, node->string, slen, node->string.length(), substr, &node->delta_table, nocase);
+}
+
+///
+/// @brief  Returns the first list node with a pattern matching `str` or `nullptr`
+///         if there is no such node.
+///
+/// Each trie search is limited to patterns preceding the first one found so far.
+///
+const base_list_node_t *list_matcher_t::find_node(const char *str, size_t slen) const
+{
+   uint32_t first = NO_MATCH, index;
+   auto check = [this, str, slen](uint32_t index) {return check_pattern(str, slen, index);};
+
+   if(!substr_trie.isempty())
+      first = substr_trie.find_first(str, slen, first);
+
+   for(size_t pindex = 0; pindex < seq_patterns.size() && seq_patterns[pindex] < first; pindex++) {
+      if(check(seq_patterns[pindex])) {
+         first = seq_patterns[pindex];
+         break;
+      }
+   }
+
+   if(!prefix_trie.isempty() && (index = prefix_trie.walk_forward(str, slen, nocase, first, check)) != NO_MATCH)
+      first = index;
+
+   if(!suffix_trie.isempty() && (index = suffix_trie.walk_backward(str, slen, nocase, first, check)) != NO_MATCH)
+      first = index;
+
+   return first != NO_MATCH ? nodes[first] : nullptr;
+}
+
 //
 // base_list
 //
 
+template <typename node_t>
+base_list<node_t>::base_list(void)
+{
+   for(size_t index = 0; index < sizeof(matchers)/sizeof(matchers[0]); index++)
+      matchers[index] = nullptr;
+}
+
+template <typename node_t>
+base_list<node_t>::~base_list(void)
+{
+   reset_matchers();
+}
+
+///
+/// @brief  Discards all compiled matchers after the list has been changed.
+///
+/// This method may not be called while the list is being searched on other threads.
+///
+template <typename node_t>
+void base_list<node_t>::reset_matchers(void)
+{
+   for(size_t index = 0; index < sizeof(matchers)/sizeof(matchers[0]); index++)
+      delete matchers[index].exchange(nullptr);
+}
+
+///
+/// @brief  Returns a matcher compiled for `substr` and `nocase`, compiling it if
+///         the list has been changed since the last search.
+///
+/// Lists may be searched on multiple threads, so a matcher is compiled under a lock
+/// and is published only after it has been fully constructed.
+///
+template <typename node_t>
+const list_matcher_t& base_list<node_t>::get_matcher(bool substr, bool nocase) const
+{
+   std::atomic<list_matcher_t*>& matcher = matchers[(substr ? 2 : 0) + (nocase ? 1 : 0)];
+   list_matcher_t *mptr;
+
+   if((mptr = matcher.load(std::memory_order_acquire)) != nullptr)
+      return *mptr;
+
+   std::lock_guard<std::mutex> lock(matcher_mtx);
+
+   if((mptr = matcher.load(std::memory_order_acquire)) == nullptr) {
+      std::vector<const base_list_node_t*> nodes;
+
+      nodes.reserve(list.size());
+
+      for(typename std::list<node_t>::const_iterator lptr = list.begin(); lptr != list.end(); lptr++)
+         nodes.push_back(&*lptr);
+
+      mptr = new list_matcher_t(std::move(nodes), substr, nocase);
+
+      matcher.store(mptr, std::memory_order_release);
+   }
+
+   return *mptr;
+}
+
 template <typename node_t>
 const string_t *base_list<node_t>::isinlist(const string_t& str, bool nocase) const
 {
@@ -40,15 +409,7 @@ const node_t *base_list<node_t>::find_node_ex(const char *str, size_t slen, bool
    if(str == nullptr || *str == 0 || slen == 0 || list.empty())
       return nullptr;
 
-   for(typename std::list<node_t>::const_iterator lptr = list.begin(); lptr != list.end(); lptr++) {
-      if(lptr->string.isempty())
-         continue; 
-
-      if(isinstrex(str, lptr->string, slen, lptr->string.length(), substr, &lptr->delta_table, nocase)) 
-         return &(*lptr);
-   }
-
-   return nullptr;
+   return static_cast<const node_t*>(get_matcher(substr, nocase).find_node(str, slen));
 }
 
 template <typename node_t>
@@ -79,6 +440,8 @@ bool nlist::add_nlist(const char *str)
    if(!str || !*str)
       return false;
 
+   reset_matchers();
+
    // insert a single asterisk at the head (wildcard)
    if(str[0] == '*' && str[1] == 0) 
       list.emplace_front(str);
@@ -154,6 +517,8 @@ bool glist::add_glist(const char *str, bool srcheng)
       qlen = 0;
    }
 
+   reset_matchers();
+
    if(!has_names && nlen)
       has_names = true;
 
@@ -169,8 +534,7 @@ bool glist::add_glist(const char *str, bool srcheng)
 const string_t *glist::isinglist(const string_t& str) const
 {
    const gnode_t *lptr;
-   glist::const_iterator iter = list.begin();
-   return ((lptr = find_node(str, iter, false)) != nullptr) ? &lptr->name : nullptr;
+   return ((lptr = find_node_ex(str.c_str(), str.length(), true)) != nullptr) ? &lptr->name : nullptr;
 }
 
 const string_t *glist::isinglist(const char *str, size_t slen, bool substr) const
@@ -185,6 +549,9 @@ void glist::for_each(const char *str, void (*cb)(const char *, void*), void *ptr
 
    slen = (str && *str) ? strlen(str) : 0;
 
+   if(delmatch)
+      reset_matchers();
+
    std::list<gnode_t>::iterator nptr = list.begin();
    while(nptr != list.end()) {
       if(nptr->noname || (slen && isinstrex(str, nptr->name, slen, nptr->name.length(), false, nullptr, nocase))) {
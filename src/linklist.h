@@ -17,6 +17,9 @@
 #include "types.h"
 
 #include <list>
+#include <vector>
+#include <atomic>
+#include <mutex>
 
 ///
 /// @brief  A list node with a string pattern for matching beginning or ending of a
@@ -54,6 +57,105 @@ struct base_list_node_t {
       void set_key(const char *str, size_t slen) {string.assign(str, slen); init_delta_table();}
 };
 
+///
+/// @brief  A compiled form of list patterns that finds the first pattern matching
+///         the input in a single pass over each end of the input
+///
+/// Patterns are compiled into three tries, based on how `isinstrex` evaluates them
+/// for the specified `substr` and `nocase` values:
+///
+///   1. Substring patterns, such as `abc`, are compiled into an Aho-Corasick automaton
+///      that finds all of them in one pass over the input.
+///   2. Patterns matched at the beginning of the input, such as `abc*`, or exact
+///      patterns if `substr` is `false`, are compiled into a trie of characters
+///      preceding the first asterisk that is walked from the first input character.
+///   3. Patterns matched at the end of the input, such as `*abc`, are compiled into
+///      a trie of reversed characters following the last asterisk that is walked from
+///      the last input character.
+///
+/// Anchored patterns found in the tries are only candidates and are confirmed with
+/// `isinstrex`, so all wildcard quirks of `isinstrex`, such as `*abc*` matching any
+/// input at least four characters long, are preserved. Among all matching patterns,
+/// the one with the lowest list index is returned, same as if the list was scanned
+/// sequentially.
+///
+/// Case-insensitive substring patterns are evaluated sequentially because they are
+/// compared by `strstr_ex` as UTF-8 characters.
+///
+class list_matcher_t {
+   public:
+      static constexpr uint32_t NO_MATCH = UINT32_MAX;
+
+   private:
+      ///
+      /// @brief  A trie of pattern characters, which is also used as an Aho-Corasick
+      ///         automaton for substring patterns
+      ///
+      class pattern_trie_t {
+         private:
+            struct edge_t {
+               u_char      chr;              ///< Pattern character.
+               uint32_t    state;            ///< Next state for this character.
+            };
+
+            struct state_t {
+               uint32_t    first_edge;       ///< Index of the first edge in `edges`.
+               uint32_t    edge_count;       ///< Number of edges, sorted by character.
+               uint32_t    first_pattern;    ///< Index of the first pattern in `patterns`.
+               uint32_t    pattern_count;    ///< Number of patterns ending in this state, sorted by their list index.
+               uint32_t    fail;             ///< Aho-Corasick failure state.
+               uint32_t    match;            ///< Lowest index of patterns ending in this state or in any of its failure states.
+            };
+
+         private:
+            std::vector<state_t>    states;
+            std::vector<edge_t>     edges;
+            std::vector<uint32_t>   patterns;
+
+            uint32_t    min_index;           ///< Lowest pattern index in this trie.
+
+            uint32_t    root_edges[256];     ///< Root transitions, indexed by character (Aho-Corasick only).
+
+         private:
+            uint32_t find_edge(uint32_t state, u_char chr) const;
+
+         public:
+            pattern_trie_t(void);
+
+            bool isempty(void) const {return patterns.empty();}
+
+            void build(const std::vector<std::pair<string_t, uint32_t>>& keys, bool automaton);
+
+            uint32_t find_first(const char *str, size_t slen, uint32_t limit) const;
+
+            template <typename check_t>
+            uint32_t walk_forward(const char *str, size_t slen, bool nocase, uint32_t limit, check_t check) const;
+
+            template <typename check_t>
+            uint32_t walk_backward(const char *str, size_t slen, bool nocase, uint32_t limit, check_t check) const;
+      };
+
+   private:
+      std::vector<const base_list_node_t*> nodes;   ///< All list nodes, in the list order.
+
+      bool              substr;
+      bool              nocase;
+
+      pattern_trie_t    substr_trie;         ///< Substring patterns (Aho-Corasick).
+      pattern_trie_t    prefix_trie;         ///< Patterns anchored at the beginning of the input.
+      pattern_trie_t    suffix_trie;         ///< Patterns anchored at the end of the input.
+
+      std::vector<uint32_t> seq_patterns;    ///< Patterns evaluated sequentially.
+
+   private:
+      bool check_pattern(const char *str, size_t slen, uint32_t index) const;
+
+   public:
+      list_matcher_t(std::vector<const base_list_node_t*>&& nodes, bool substr, bool nocase);
+
+      const base_list_node_t *find_node(const char *str, size_t slen) const;
+};
+
 ///
 /// @brief  An ordered linked list of nodes containing string patterns
 ///
@@ -61,6 +163,11 @@ struct base_list_node_t {
 /// the pattern `xyz` will match input `abcxyz123`. If `substr` is `false`, `abc` will only
 /// match input `abc`.
 ///
+/// The list is compiled into a `list_matcher_t` instance for each combination of
+/// `substr` and `nocase` when it is searched for the first time. A compiled matcher
+/// is discarded when the list is changed, which includes obtaining a non-constant
+/// iterator that may be used to change list patterns.
+///
 template <typename node_t>
 class base_list {
    public: 
@@ -70,12 +177,26 @@ class base_list {
    protected:
       std::list<node_t> list;
 
+   private:
+      mutable std::mutex matcher_mtx;
+      mutable std::atomic<list_matcher_t*> matchers[4];   ///< Compiled matchers, indexed by `substr` and `nocase`.
+
+   private:
+      const list_matcher_t& get_matcher(bool substr, bool nocase) const;
+
+   protected:
+      void reset_matchers(void);
+
    public:
-      base_list(void) {}
+      base_list(void);
+
+      base_list(const base_list&) = delete;
       
-      ~base_list(void) {}
+      ~base_list(void);
+
+      base_list& operator = (const base_list&) = delete;
 
-      typename std::list<node_t>::iterator begin(void) {return list.begin();}
+      typename std::list<node_t>::iterator begin(void) {reset_matchers(); return list.begin();}
       typename std::list<node_t>::const_iterator begin(void) const {return list.begin();}
 
       typename std::list<node_t>::iterator end(void) {return list.end();}
@@ -86,7 +207,7 @@ class base_list {
       bool isempty(void) const {return list.empty();}
 
       /// Removes all elements from the list.
-      void clear(void) {list.clear();}
+      void clear(void) {reset_matchers(); list.clear();}
 
       /// scan list values for str as substring and return the matching one, if found, or nullptr otherwise
       const string_t *isinlist(const string_t& str, bool nocase = false) const;
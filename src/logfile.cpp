@@ -10,44 +10,99 @@
 #include "pch.h"
 #include "logfile.h"
 #include "util_path.h"
+#include "exception.h"
 #include <errno.h>
 
+#include <algorithm>
+
 #ifdef _WIN32
 #include <io.h>
+#else
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #endif
 
-logfile_t::logfile_t(const string_t& fname) : log_fname(fname), id(0)
+logfile_t::logfile_t(const string_t& fname, log_read_mode_t mode, size_t bufsize, size_t read_ahead, size_t inflate_threads) :
+      log_fname(fname), id(0),
+      read_mode(mode), active_mode(mode),
+      blk_size(std::max(bufsize, LOG_MIN_BUF_SIZE)),
+      blk_ptr(nullptr), blk_pos(nullptr), blk_end(nullptr), blk_offset(0), skip_line(false),
+      map_base(nullptr), map_size(0), file_size(0),
+      ra_depth(std::min(read_ahead, LOG_MAX_READ_AHEAD)), ra_head(0), ra_count(0), ra_eof(false), ra_error(0), ra_stop(false),
+      inflate_threads(std::min(inflate_threads, LOG_MAX_INFLATE_THREADS)), bgzf_log(false)
 {
    log_fp = nullptr;
    gzlog_fp = nullptr;
-   
+
    reopen_offset = 0;
 
    gz_log = log_fname.length() > 3 && !string_t::compare_ci((log_fname.c_str()+log_fname.length()-3), ".gz");
+
+   // compressed files and stdin cannot be mapped into memory
+#ifdef _WIN32
+   if(read_mode == LOG_READ_MMAP)
+      read_mode = LOG_READ_BLOCK;
+#else
+   if(read_mode == LOG_READ_MMAP && (gz_log || log_fname.isempty()))
+      read_mode = LOG_READ_BLOCK;
+#endif
+
+   // compressed log files are inflated on their own thread if inflate threads are requested
+   if(gz_log && this->inflate_threads && ra_depth < 2)
+      ra_depth = 2;
+
+   // log files are read ahead in blocks, so line-by-line reads cannot be read ahead
+   if(read_mode == LOG_READ_STDIO && ra_depth)
+      read_mode = LOG_READ_BLOCK;
+
+   active_mode = read_mode;
 }
 
 logfile_t::~logfile_t(void)
 {
+   stop_read_ahead();
+   close_mmap();
 }
 
 int logfile_t::open(void)
 {
+   int errnum;
+
+   // start with an empty block region at the current read position
+   active_mode = read_mode;
+   blk_ptr = blk_pos = blk_end = nullptr;
+   blk_offset = reopen_offset > 0 ? (uint64_t) reopen_offset : 0;
+   skip_line = false;
+
+   if(active_mode == LOG_READ_BLOCK && !blk_buf)
+      blk_buf.reset(new char[blk_size]);
+
    if(log_fname.isempty()) {
       log_fp = stdin;
       return 0;
    }
 
    if(gz_log) {
-      if(!gzlog_fp && (gzlog_fp = gzopen(log_fname,"rb")) == Z_NULL)
+      // BGZF files are read as regular files and inflated by the BGZF reader
+      if(inflate_threads && active_mode == LOG_READ_BLOCK && !log_fp && !gzlog_fp && (errnum = open_bgzf()) != 0)
+         return errnum;
+
+      if(!bgzf_log && !gzlog_fp && (gzlog_fp = gzopen(log_fname,"rb")) == Z_NULL)
          return errno;
    }
    else {
-      if(!log_fp && (log_fp = fopen(log_fname,"r")) == nullptr)
+      if(!log_fp && (log_fp = fopen(log_fname, active_mode == LOG_READ_STDIO ? "r" : "rb")) == nullptr)
          return errno;
    }
-   
-   // check if we need to return to the previous read position
-   if(reopen_offset > 0) {
+
+   // memory-mapped files do not use the file pointer
+   if(active_mode == LOG_READ_MMAP) {
+      if((errnum = open_mmap()) != 0)
+         return errnum;
+   }
+   // check if we need to return to the previous read position (the BGZF reader seeks on its own)
+   else if(reopen_offset > 0 && !bgzf_log) {
       if(gz_log) {
          if(gzseek(gzlog_fp, reopen_offset, SEEK_SET) == -1L)
             return errno;
@@ -57,6 +112,10 @@ int logfile_t::open(void)
             return errno;
       }
    }
+
+   // open_mmap may fall back to block reads
+   if(active_mode == LOG_READ_BLOCK && ra_depth)
+      start_read_ahead();
    
    return 0;
 }
@@ -69,6 +128,19 @@ int logfile_t::close(void)
    if(log_fp == stdin)
       return 0;
    
+   // the read-ahead thread must not use the file after it is closed
+   stop_read_ahead();
+
+   if(bgzf_log) {
+      bgzf->close();
+      bgzf_log = false;
+   }
+
+   close_mmap();
+
+   // block region pointers are no longer valid
+   blk_ptr = blk_pos = blk_end = nullptr;
+
    if(gz_log && gzlog_fp) {
       errnum = gzclose(gzlog_fp);
       gzlog_fp = nullptr;
@@ -83,7 +155,15 @@ int logfile_t::close(void)
 
 long logfile_t::set_reopen_offset(void)
 {
-   if(gz_log && gzlog_fp)
+   //
+   // In block-oriented modes the file pointer is ahead of the lines handed out
+   // to the caller, so use the offset of the next unread line instead.
+   //
+   if(active_mode != LOG_READ_STDIO) {
+      if(is_open())
+         reopen_offset = (long) (blk_offset + (blk_pos - blk_ptr));
+   }
+   else if(gz_log && gzlog_fp)
       reopen_offset = gztell(gzlog_fp);
    else if(log_fp) 
       reopen_offset = ftell(log_fp);
@@ -123,6 +203,453 @@ int logfile_t::get_line(char *buffer, u_int bufsize, int *errnum) const
    return (int) strlen(buffer);
 }
 
+///
+/// @brief  Returns the next log line as a view into the block region.
+///
+/// The returned line includes the line terminator, if there is one, and remains
+/// valid until the next call to `get_line` or `close`. A line longer than the
+/// block region is returned once, truncated to the region size, and the rest of
+/// this line is skipped. The caller may detect truncated lines by comparing the
+/// returned length against its own maximum record size.
+///
+/// Returns the length of the line, zero if there is no more data or -1 if an
+/// error occurred, in which case `errnum` is populated with the error code. This
+/// method may only be used in block-oriented read modes.
+///
+int logfile_t::get_line(const char *& line, size_t& linelen, int *errnum)
+{
+   const char *eol;
+   size_t bytes;
+   int error;
+
+   line = nullptr;
+   linelen = 0;
+
+   if(errnum)
+      *errnum = 0;
+
+   if(active_mode == LOG_READ_STDIO || !is_open()) {
+      if(errnum)
+         *errnum = EINVAL;
+      return -1;
+   }
+
+   while(true) {
+      // look for the end of the line in the data we already have
+      if(blk_pos < blk_end && (eol = (const char*) memchr(blk_pos, '\n', blk_end - blk_pos)) != nullptr) {
+         // if we are skipping the tail of a truncated line, move past it
+         if(skip_line) {
+            blk_pos = eol + 1;
+            skip_line = false;
+            continue;
+         }
+
+         line = blk_pos;
+         linelen = eol + 1 - blk_pos;
+         blk_pos = eol + 1;
+
+         return (int) linelen;
+      }
+
+      if(skip_line)
+         blk_pos = blk_end;
+      else if((size_t) (blk_end - blk_pos) >= max_line_size()) {
+         // hand out the truncated line and skip the rest of it on the next call
+         line = blk_pos;
+         linelen = blk_end - blk_pos;
+         blk_pos = blk_end;
+         skip_line = true;
+
+         return (int) linelen;
+      }
+
+      // move the unread data to the start of the region and read more
+      if((error = (active_mode == LOG_READ_MMAP) ? fill_mmap(bytes) : fill_block(bytes)) != 0) {
+         if(errnum)
+            *errnum = error;
+         return -1;
+      }
+
+      // if there is no more data, return the last line without a line terminator
+      if(!bytes) {
+         if(blk_pos == blk_end || skip_line) {
+            blk_pos = blk_end;
+            skip_line = false;
+            return 0;
+         }
+
+         line = blk_pos;
+         linelen = blk_end - blk_pos;
+         blk_pos = blk_end;
+
+         return (int) linelen;
+      }
+   }
+}
+
+///
+/// @brief  Returns the maximum line length that fits into the block region.
+///
+size_t logfile_t::max_line_size(void) const
+{
+   //
+   // A memory-mapped window always starts at a page boundary, so the region
+   // may be up to one page shorter than the window. 
+   //
+   return active_mode == LOG_READ_MMAP ? MMAP_WINDOW_SIZE - 65536 : blk_size;
+}
+
+///
+/// @brief  Moves unread data to the start of the block buffer and reads more 
+///         data from the file after it.
+///
+/// Returns zero on success or an error code if the file could not be read. The
+/// number of bytes read is returned in `bytes` and will be zero at the end of
+/// the file.
+///
+int logfile_t::fill_block(size_t& bytes)
+{
+   size_t remain = blk_end - blk_pos;
+   int error;
+
+   bytes = 0;
+
+   // the file offset of the unread data becomes the new region offset
+   blk_offset += blk_pos - blk_ptr;
+
+   if(remain && blk_pos != blk_buf.get())
+      memmove(blk_buf.get(), blk_pos, remain);
+
+   blk_ptr = blk_pos = blk_buf.get();
+   blk_end = blk_ptr + remain;
+
+   if(remain == blk_size)
+      return 0;
+
+   if((error = ra_thread.joinable() ? get_read_ahead(blk_buf.get() + remain, blk_size - remain, bytes) : read_file(blk_buf.get() + remain, blk_size - remain, bytes)) != 0)
+      return error;
+
+   blk_end += bytes;
+
+   return 0;
+}
+
+///
+/// @brief  Reads up to `bufsize` bytes from the log file into `buffer`.
+///
+/// Returns zero on success or an error code if the file could not be read. The
+/// number of bytes read is returned in `bytes` and will be zero at the end of
+/// the file.
+///
+int logfile_t::read_file(char *buffer, size_t bufsize, size_t& bytes)
+{
+   bytes = 0;
+
+   if(bgzf_log)
+      return bgzf->read(buffer, bufsize, bytes);
+
+   if(gz_log) {
+      int count = gzread(gzlog_fp, buffer, (unsigned) bufsize);
+
+      if(count < 0) {
+         int zerror;
+         gzerror(gzlog_fp, &zerror);
+         return zerror == Z_ERRNO ? errno : EIO;
+      }
+
+      bytes = (size_t) count;
+   }
+   else {
+      bytes = fread(buffer, 1, bufsize, log_fp);
+
+      if(!bytes && ferror(log_fp))
+         return errno ? errno : EIO;
+   }
+
+   return 0;
+}
+
+///
+/// @brief  Opens a compressed log file as a regular file if it is BGZF-compressed
+///         and starts inflating it on multiple threads.
+///
+/// If the log file is not a BGZF file, it is closed and `bgzf_log` remains `false`,
+/// so it is opened via zlib as any other compressed log file.
+///
+int logfile_t::open_bgzf(void)
+{
+   int errnum;
+
+   if((log_fp = fopen(log_fname, "rb")) == nullptr)
+      return errno;
+
+   if(!bgzf_reader_t::is_bgzf(log_fp)) {
+      fclose(log_fp);
+      log_fp = nullptr;
+      return 0;
+   }
+
+   if(!bgzf)
+      bgzf.reset(new bgzf_reader_t(inflate_threads));
+
+   if((errnum = bgzf->open(log_fp, reopen_offset > 0 ? (uint64_t) reopen_offset : 0)) != 0) {
+      bgzf->close();
+      fclose(log_fp);
+      log_fp = nullptr;
+      return errnum;
+   }
+
+   bgzf_log = true;
+
+   return 0;
+}
+
+///
+/// @brief  Starts a thread that reads the log file ahead into the ring of 
+///         read-ahead blocks.
+///
+/// Standard input is always read on the calling thread.
+///
+void logfile_t::start_read_ahead(void)
+{
+   if(ra_thread.joinable() || log_fp == stdin)
+      return;
+
+   while(ra_blocks.size() < ra_depth)
+      ra_blocks.emplace_back(blk_size);
+
+   ra_head = ra_count = 0;
+   ra_eof = ra_stop = false;
+   ra_error = 0;
+
+   ra_thread = std::thread(&logfile_t::read_ahead_thread_proc, this);
+}
+
+///
+/// @brief  Stops the read-ahead thread and discards all blocks read ahead.
+///
+void logfile_t::stop_read_ahead(void)
+{
+   if(!ra_thread.joinable())
+      return;
+
+   {
+      std::lock_guard<std::mutex> lock(ra_mtx);
+      ra_stop = true;
+   }
+
+   ra_cv.notify_all();
+
+   ra_thread.join();
+
+   ra_head = ra_count = 0;
+}
+
+///
+/// @brief  Reads the log file into free read-ahead blocks until the end of the
+///         file or an error is reached, or until the thread is stopped.
+///
+void logfile_t::read_ahead_thread_proc(void)
+{
+   size_t bytes;
+   int error;
+
+   set_os_ex_translator();
+
+   std::unique_lock<std::mutex> lock(ra_mtx);
+
+   while(true) {
+      ra_cv.wait(lock, [this] {return ra_stop || ra_count < ra_depth;});
+
+      if(ra_stop)
+         break;
+
+      // the block after the last filled one is not used by the reading thread
+      ra_block_t& block = ra_blocks[(ra_head + ra_count) % ra_depth];
+
+      lock.unlock();
+
+      error = read_file(block.data.get(), blk_size, bytes);
+
+      lock.lock();
+
+      block.size = bytes;
+      block.pos = 0;
+
+      if(error || !bytes) {
+         ra_error = error;
+         ra_eof = true;
+         ra_cv.notify_all();
+         break;
+      }
+
+      ra_count++;
+
+      ra_cv.notify_all();
+   }
+}
+
+///
+/// @brief  Copies up to `bufsize` bytes from read-ahead blocks into `buffer`.
+///
+/// This method waits for the read-ahead thread only if no data is available and
+/// returns whatever data has been read ahead otherwise, even if it is less than
+/// `bufsize`. The return value and `bytes` have the same meaning as in `read_file`.
+///
+int logfile_t::get_read_ahead(char *buffer, size_t bufsize, size_t& bytes)
+{
+   size_t count;
+
+   std::unique_lock<std::mutex> lock(ra_mtx);
+
+   bytes = 0;
+
+   while(bytes < bufsize) {
+      if(!ra_count && bytes)
+         break;
+
+      ra_cv.wait(lock, [this] {return ra_count || ra_eof;});
+
+      // report a read error only after all data read before it was consumed
+      if(!ra_count)
+         return bytes ? 0 : ra_error;
+
+      ra_block_t& block = ra_blocks[ra_head];
+
+      count = std::min(bufsize - bytes, block.size - block.pos);
+
+      // filled blocks are not changed by the read-ahead thread
+      lock.unlock();
+
+      memcpy(buffer + bytes, block.data.get() + block.pos, count);
+
+      lock.lock();
+
+      block.pos += count;
+      bytes += count;
+
+      if(block.pos == block.size) {
+         ra_head = (ra_head + 1) % ra_depth;
+         ra_count--;
+         ra_cv.notify_all();
+      }
+   }
+
+   return 0;
+}
+
+#ifdef _WIN32
+int logfile_t::open_mmap(void)
+{
+   return EINVAL;
+}
+
+void logfile_t::close_mmap(void)
+{
+}
+
+int logfile_t::fill_mmap(size_t& bytes)
+{
+   bytes = 0;
+   return EINVAL;
+}
+#else
+///
+/// @brief  Prepares an opened uncompressed log file for being mapped into memory.
+///
+/// If the file cannot be mapped into memory (e.g. it is a pipe), the block read
+/// mode is used instead.
+///
+int logfile_t::open_mmap(void)
+{
+   struct stat fstats;
+
+   if(fstat(fileno(log_fp), &fstats) == -1)
+      return errno;
+
+   if(!S_ISREG(fstats.st_mode)) {
+      active_mode = LOG_READ_BLOCK;
+
+      if(!blk_buf)
+         blk_buf.reset(new char[blk_size]);
+
+      if(reopen_offset > 0 && fseek(log_fp, reopen_offset, SEEK_SET) == -1)
+         return errno;
+
+      return 0;
+   }
+
+   file_size = (uint64_t) fstats.st_size;
+
+   return 0;
+}
+
+///
+/// @brief  Unmaps the current memory-mapped window, if there is one.
+///
+void logfile_t::close_mmap(void)
+{
+   if(map_base) {
+      munmap(map_base, map_size);
+      map_base = nullptr;
+      map_size = 0;
+   }
+}
+
+///
+/// @brief  Maps the next window of the file into memory, starting at the page 
+///         containing the first unread byte.
+///
+/// Returns zero on success or an error code if the file could not be mapped.
+/// The number of bytes added to the region is returned in `bytes` and will be
+/// zero at the end of the file.
+///
+int logfile_t::fill_mmap(size_t& bytes)
+{
+   static const uint64_t page_size = (uint64_t) sysconf(_SC_PAGESIZE);
+
+   struct stat fstats;
+   uint64_t start = blk_offset + (blk_pos - blk_ptr);
+   uint64_t prev_end = blk_offset + (blk_end - blk_ptr);
+   uint64_t base;
+
+   bytes = 0;
+
+   // pick up any data appended to the log file since it was opened
+   if(prev_end >= file_size) {
+      if(fstat(fileno(log_fp), &fstats) == -1)
+         return errno;
+
+      file_size = (uint64_t) fstats.st_size;
+   }
+
+   if(start >= file_size)
+      return 0;
+
+   close_mmap();
+
+   base = start - start % page_size;
+   map_size = (size_t) std::min(file_size - base, (uint64_t) MMAP_WINDOW_SIZE);
+
+   if((map_base = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fileno(log_fp), (off_t) base)) == MAP_FAILED) {
+      map_base = nullptr;
+      map_size = 0;
+      return errno;
+   }
+
+   madvise(map_base, map_size, MADV_SEQUENTIAL);
+
+   blk_offset = start;
+   blk_ptr = blk_pos = (const char*) map_base + (start - base);
+   blk_end = (const char*) map_base + map_size;
+
+   if(base + map_size > prev_end)
+      bytes = (size_t) (base + map_size - prev_end);
+
+   return 0;
+}
+#endif
+
 bool logfile_t::is_readable(void) const 
 {
    // stdin (empty file name) is always readable
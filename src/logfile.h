@@ -12,14 +12,72 @@
 
 #include <zlib.h>
 #include <cstdio>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "tstring.h"
 #include "types.h"
+#include "bgzf_reader.h"
+
+///
+/// @brief  Log file read modes
+///
+/// `LOG_READ_STDIO` reads log files line by line via `fgets`/`gzgets`.
+///
+/// `LOG_READ_BLOCK` reads log files in large blocks via `fread`/`gzread` and
+/// hands out line views pointing into the block buffer.
+///
+/// `LOG_READ_MMAP` maps uncompressed log files into memory and hands out line
+/// views pointing into the mapped region. Compressed log files, standard input
+/// and platforms without memory-mapped files fall back to `LOG_READ_BLOCK`.
+///
+enum log_read_mode_t {
+   LOG_READ_STDIO    = 0,
+   LOG_READ_BLOCK    = 1,
+   LOG_READ_MMAP     = 2
+};
 
 ///
 /// @brief  A class that opens and reads a log file line by line
 ///
+/// In block-oriented read modes log lines are returned as views into an internal
+/// buffer, along with their lengths, which remain valid until the next call to
+/// `get_line` or `close`. Lines that do not fit into the buffer are returned once,
+/// truncated to the buffer size, and the rest of the line is skipped.
+///
+/// In the `LOG_READ_BLOCK` mode, the log file may be read ahead on a separate thread
+/// into a ring of blocks, so slow reads, such as those of compressed log files, are
+/// performed while previously read log lines are being processed. If read-ahead is
+/// requested in the `LOG_READ_STDIO` mode, log files are read in the block mode.
+///
+/// If inflate threads are requested, compressed log files are always read ahead and
+/// BGZF-compressed log files are also inflated on multiple threads.
+///
 class logfile_t {
+   public:
+      static constexpr size_t LOG_DEF_BUF_SIZE = 1024 * 1024;      ///< Default block buffer size, in bytes.
+      static constexpr size_t LOG_MIN_BUF_SIZE = 64 * 1024;        ///< Minimum block buffer size, in bytes.
+      static constexpr size_t LOG_MAX_READ_AHEAD = 16;             ///< Maximum number of blocks read ahead.
+      static constexpr size_t LOG_MAX_INFLATE_THREADS = 32;        ///< Maximum number of threads inflating a BGZF log file.
+
+   private:
+      static constexpr size_t MMAP_WINDOW_SIZE = 64 * 1024 * 1024; ///< Size of a memory-mapped file window, in bytes.
+
+   private:
+      ///
+      /// @brief  A block of log file data read ahead on the read-ahead thread
+      ///
+      struct ra_block_t {
+         std::unique_ptr<char[]> data;       ///< Block data.
+         size_t      size;                   ///< Number of bytes in `data`.
+         size_t      pos;                    ///< Number of bytes consumed.
+
+         ra_block_t(size_t bufsize) : data(new char[bufsize]), size(0), pos(0) {}
+      };
+
    private:
       string_t    log_fname;              ///< A log file name and path (relative or absolute).
       
@@ -32,9 +90,63 @@ class logfile_t {
                                           ///< file is opened.
                                              
       u_int       id;                     ///< A file identifier used for reporting purposes.
-   
+
+      log_read_mode_t read_mode;          ///< Requested read mode.
+      log_read_mode_t active_mode;        ///< Read mode used for the currently opened file.
+
+      size_t      blk_size;               ///< Block buffer size, in bytes.
+      std::unique_ptr<char[]> blk_buf;    ///< Block buffer for `LOG_READ_BLOCK`.
+
+      const char  *blk_ptr;               ///< Start of the current block region.
+      const char  *blk_pos;               ///< Start of the next unread line in the block region.
+      const char  *blk_end;               ///< End of the current block region.
+      uint64_t    blk_offset;             ///< Uncompressed file offset of `blk_ptr`.
+      bool        skip_line;              ///< Skip the rest of a truncated line?
+
+      void        *map_base;              ///< Memory-mapped window base address.
+      size_t      map_size;               ///< Memory-mapped window size, in bytes.
+      uint64_t    file_size;              ///< Size of the memory-mapped file, in bytes.
+
+      size_t      ra_depth;               ///< Number of blocks to read ahead (zero disables read-ahead).
+      std::vector<ra_block_t> ra_blocks;  ///< A ring of read-ahead blocks.
+      size_t      ra_head;                ///< Index of the next block to consume.
+      size_t      ra_count;               ///< Number of filled blocks, starting at `ra_head`.
+      bool        ra_eof;                 ///< Has the read-ahead thread reached the end of the file?
+      int         ra_error;               ///< An error encountered by the read-ahead thread.
+      bool        ra_stop;                ///< Should the read-ahead thread stop?
+      std::thread ra_thread;              ///< Read-ahead thread.
+      std::mutex  ra_mtx;                 ///< Guards the ring state.
+      std::condition_variable ra_cv;      ///< Signalled when a block is filled or consumed.
+
+      size_t      inflate_threads;        ///< Number of threads inflating a BGZF log file (zero disables).
+      std::unique_ptr<bgzf_reader_t> bgzf;   ///< BGZF reader, created for the first BGZF file opened.
+      bool        bgzf_log;               ///< Is the opened log file read via `bgzf`?
+
+   private:
+      int open_bgzf(void);
+
+      int read_file(char *buffer, size_t bufsize, size_t& bytes);
+
+      void start_read_ahead(void);
+
+      void stop_read_ahead(void);
+
+      void read_ahead_thread_proc(void);
+
+      int get_read_ahead(char *buffer, size_t bufsize, size_t& bytes);
+
+      int open_mmap(void);
+
+      void close_mmap(void);
+
+      int fill_block(size_t& bytes);
+
+      int fill_mmap(size_t& bytes);
+
+      size_t max_line_size(void) const;
+
    public:
-      logfile_t(const string_t& fname);
+      logfile_t(const string_t& fname, log_read_mode_t mode = LOG_READ_STDIO, size_t bufsize = LOG_DEF_BUF_SIZE, size_t read_ahead = 0, size_t inflate_threads = 0);
       
       ~logfile_t(void);
       
@@ -53,11 +165,22 @@ class logfile_t {
       bool is_gzip(void) const {return gz_log;}
       
       int get_line(char *buffer, u_int bufsize, int *errnum = nullptr) const;
-      
+
+      int get_line(const char *& line, size_t& linelen, int *errnum = nullptr);
+
       bool is_readable(void) const;
-      
+
       bool is_open(void) const {return gz_log && gzlog_fp || log_fp;}
 
+      /// Returns the read mode used for the opened log file.
+      log_read_mode_t get_read_mode(void) const {return active_mode;}
+
+      /// Returns `true` if the opened log file is read ahead on a separate thread.
+      bool is_read_ahead(void) const {return ra_thread.joinable();}
+
+      /// Returns `true` if the opened log file is inflated as a BGZF file on multiple threads.
+      bool is_bgzf(void) const {return bgzf_log;}
+
       void set_id(u_int fileid) {id = fileid;}
 
       u_int get_id(void) const {return id;}
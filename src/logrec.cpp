@@ -11,25 +11,91 @@
 
 #include "logrec.h"
 
-log_struct::log_struct(void) : resp_code(0), xfer_size(0), proc_time(0), port(0)
+#include <stdexcept>
+
+log_struct::log_struct(void) : resp_code(0), xfer_size(0), proc_time(0), port(0), field_view_count(0)
 {
 }
 
 void log_struct::reset(void)
 {
-   hostname.reset();
-   method.reset();
-   url.reset();
-   refer.reset();
-   agent.reset();
-   srchargs.reset();
-   ident.reset();
-   xsrchstr.reset();
+   release_field(hostname);
+   release_field(method);
+   release_field(url);
+   release_field(refer);
+   release_field(agent);
+   release_field(srchargs);
+   release_field(ident);
+   release_field(xsrchstr);
+
+   field_view_count = 0;
 
    tstamp.reset();
 
+   hostaddr.reset();
+
    resp_code = 0;
    xfer_size = 0;
    proc_time = 0;
    port = 0;
 }
+
+///
+/// @brief  Records a field value in the log line buffer, which will be held by 
+///         `field` after `hold_fields` is called.
+///
+/// `value` must point into the modifiable log line buffer being parsed. Values 
+/// are not null-terminated until `hold_fields` is called because the parser may
+/// still need to scan characters following each value. If the same field is set 
+/// more than once, the last value is used.
+///
+void log_struct::set_field(string_t log_struct::*field, const char *value, size_t length)
+{
+   size_t index;
+
+   for(index = 0; index < field_view_count && field_views[index].field != field; index++);
+
+   if(index == MAX_FIELD_VIEWS)
+      throw std::logic_error("Too many log record field views");
+
+   if(index == field_view_count)
+      field_view_count++;
+
+   field_views[index].field = field;
+   field_views[index].value = const_cast<char*>(value);
+   field_views[index].length = length;
+}
+
+///
+/// @brief  Makes field strings hold values recorded by `set_field`.
+///
+/// Each value is null-terminated in the log line buffer, replacing the delimiter
+/// character that follows the value.
+///
+void log_struct::hold_fields(void)
+{
+   for(size_t index = 0; index < field_view_count; index++) {
+      const field_view_t& view = field_views[index];
+
+      release_field(this->*view.field);
+
+      if(view.length)
+         (this->*view.field).attach(string_t::char_buffer_t(view.value, view.length + 1, true), view.length);
+   }
+
+   field_view_count = 0;
+}
+
+///
+/// @brief  Empties `field` without writing into the memory it holds.
+///
+/// Memory allocated by the field string is kept for the next log record, while
+/// a view into a log line buffer is just dropped.
+///
+void log_struct::release_field(string_t& field)
+{
+   string_t::char_buffer_t buffer = field.detach();
+
+   if(!buffer.isnull() && !buffer.isholder())
+      field.attach(std::move(buffer), 0);
+}
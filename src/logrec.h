@@ -13,6 +13,7 @@
 
 #include "tstring.h"
 #include "tstamp.h"
+#include "util_ipaddr.h"
 
 #define MAXURL   4096                  // Max HTTP request/URL field size
 #define MAXMETHOD 16                   // HTTP method
@@ -46,8 +47,18 @@ enum log_type_t {
 ///
 /// 3. It is not clear what character set is used for user identification.
 ///
+/// 4. String fields may hold modifiable views into the log line buffer the record
+/// was parsed from, which must not be reused until the log record is reset or
+/// destroyed. Parsers call `set_field` to record field values while the log line
+/// is being parsed and `hold_fields` once the log line is no longer scanned, which
+/// null-terminates each value in place. A field value is copied only when it needs
+/// to grow (e.g. when URL normalization expands it) or when it is used to create
+/// a new hash table node. Releasing a view, which is done in `reset`, never writes
+/// into the log line buffer, which may be reused by then.
+///
 struct  log_struct  {
       string_t   hostname;             ///< client IP address (may be host name)
+      ipaddr_t   hostaddr;             ///< binary client IP address (empty if `hostname` is not an IP address)
       string_t   method;               ///< HTTP method
       string_t   url;                  ///< requested URL path, without the query
       string_t   refer;                ///< referrer URL, without the query
@@ -64,10 +75,33 @@ struct  log_struct  {
       u_short    port;                 ///< HTTP port
       u_short    resp_code;            ///< HTTP response code
 
+      string_t::char_buffer_t linebuf; ///< log line buffer for records parsed without parser threads
+
+   private:
+      static constexpr size_t MAX_FIELD_VIEWS = 8;
+
+      ///
+      /// @brief  A field value in the log line buffer that is not held yet
+      ///
+      struct field_view_t {
+         string_t log_struct::*field;  ///< field string that will hold the value
+         char       *value;            ///< field value in the log line buffer
+         size_t     length;            ///< field value length, in characters
+      };
+
+      field_view_t field_views[MAX_FIELD_VIEWS];   ///< field values recorded by `set_field`
+      size_t     field_view_count;                 ///< number of recorded field values
+
    public:
       log_struct(void);
 
       void reset(void);
+
+      void set_field(string_t log_struct::*field, const char *value, size_t length);
+
+      void hold_fields(void);
+
+      static void release_field(string_t& field);
 };
 
 #endif // LOGREC_H
@@ -0,0 +1,246 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   parse_pipeline.cpp
+*/
+#include "pch.h"
+
+#include "parse_pipeline.h"
+#include "exception.h"
+
+parse_pipeline_t::batch_t::batch_t(void) :
+      text(new char[BATCH_TEXT_SIZE]),
+      text_size(0),
+      logrecs(BATCH_MAX_LINES),
+      next(0),
+      done(false)
+{
+   lines.reserve(BATCH_MAX_LINES);
+}
+
+///
+/// @brief  Prepares a batch for being filled with new log lines.
+///
+/// Log records are not reset because the parser resets each log record before
+/// parsing a log line, which allows us to reuse string memory across batches.
+///
+void parse_pipeline_t::batch_t::clear(void)
+{
+   text_size = 0;
+   lines.clear();
+   orig_lines.clear();
+   parser.reset();
+   next = 0;
+   done = false;
+   error = nullptr;
+}
+
+///
+/// @brief  Returns a pointer to the unused part of the batch text and its size
+///         in `bufsize`.
+///
+/// Returns `nullptr` if the batch cannot accept any more log lines.
+///
+char *parse_pipeline_t::batch_t::get_free_space(size_t& bufsize)
+{
+   if(lines.size() == BATCH_MAX_LINES || text_size >= BATCH_TEXT_SIZE) {
+      bufsize = 0;
+      return nullptr;
+   }
+
+   bufsize = BATCH_TEXT_SIZE - text_size;
+
+   return text.get() + text_size;
+}
+
+///
+/// @brief  Adds a log line of `length` characters, which was read into the space
+///         returned by `get_free_space`, to the batch.
+///
+void parse_pipeline_t::batch_t::add_line(size_t length, uint64_t recnum)
+{
+   lines.push_back({text_size, length, recnum, PARSE_CODE_ERROR});
+
+   // skip the line and its null character
+   text_size += length + 1;
+}
+
+parse_pipeline_t::parse_pipeline_t(const config_t& config) :
+      config(config),
+      stop_workers(false)
+{
+}
+
+parse_pipeline_t::~parse_pipeline_t(void)
+{
+   stop();
+}
+
+///
+/// @brief  Starts `threads` worker threads and prepares batch queues for the
+///         specified number of log files.
+///
+void parse_pipeline_t::start(size_t threads, size_t logfiles)
+{
+   stop_workers = false;
+
+   file_queues.resize(logfiles);
+
+   for(size_t index = 0; index < threads; index++)
+      workers.emplace_back(&parse_pipeline_t::worker_thread_proc, this);
+}
+
+///
+/// @brief  Stops all worker threads and releases all batches, including those
+///         that were not consumed yet.
+///
+void parse_pipeline_t::stop(void)
+{
+   if(workers.empty())
+      return;
+
+   {
+      std::lock_guard<std::mutex> lock(batch_mtx);
+      stop_workers = true;
+   }
+
+   work_cv.notify_all();
+
+   for(size_t index = 0; index < workers.size(); index++)
+      workers[index].join();
+
+   workers.clear();
+
+   pending.clear();
+   file_queues.clear();
+   free_batches.clear();
+   batches.clear();
+}
+
+///
+/// @brief  Returns an empty batch, reusing a released one, if there is any.
+///
+parse_pipeline_t::batch_t *parse_pipeline_t::get_batch(void)
+{
+   batch_t *batch;
+
+   if(free_batches.empty()) {
+      batches.emplace_back(new batch_t());
+      return batches.back().get();
+   }
+
+   batch = free_batches.back();
+   free_batches.pop_back();
+
+   batch->clear();
+
+   return batch;
+}
+
+///
+/// @brief  Returns a batch that is no longer in use to the pool.
+///
+void parse_pipeline_t::release_batch(batch_t *batch)
+{
+   free_batches.push_back(batch);
+}
+
+///
+/// @brief  Queues a filled batch for parsing.
+///
+void parse_pipeline_t::submit(batch_t *batch)
+{
+   {
+      std::lock_guard<std::mutex> lock(batch_mtx);
+      pending.push_back(batch);
+   }
+
+   work_cv.notify_one();
+}
+
+///
+/// @brief  Waits until all log lines in the batch are parsed.
+///
+/// If parsing failed with an exception in the worker thread, this exception is
+/// rethrown in the context of the calling thread.
+///
+void parse_pipeline_t::wait(batch_t& batch)
+{
+   std::unique_lock<std::mutex> lock(batch_mtx);
+
+   done_cv.wait(lock, [&batch] {return batch.done;});
+
+   if(batch.error)
+      std::rethrow_exception(batch.error);
+}
+
+///
+/// @brief  Parses all log lines in the batch with a worker parser that has the
+///         same state as the parser snapshot in the batch.
+///
+void parse_pipeline_t::parse_batch(batch_t& batch, parser_t& parser) const
+{
+   // the parser modifies log lines, so keep original lines for reporting bad records
+   if(config.debug_mode)
+      batch.orig_lines.resize(batch.lines.size());
+
+   for(size_t index = 0; index < batch.lines.size(); index++) {
+      batch_t::line_t& line = batch.lines[index];
+      char *text = batch.text.get() + line.offset;
+
+      if(config.debug_mode)
+         batch.orig_lines[index].assign(text, line.length);
+
+      line.parse_code = parser.parse_record(text, line.length, batch.logrecs[index]);
+
+      // release original lines of good records right away
+      if(config.debug_mode && line.parse_code != PARSE_CODE_ERROR)
+         batch.orig_lines[index].reset();
+   }
+}
+
+void parse_pipeline_t::worker_thread_proc(void)
+{
+   std::unique_ptr<parser_t> parser;
+   std::shared_ptr<const parser_t> parser_snapshot;    // keeps the snapshot address unique
+   batch_t *batch;
+
+   set_os_ex_translator();
+
+   std::unique_lock<std::mutex> lock(batch_mtx);
+
+   while(true) {
+      work_cv.wait(lock, [this] {return stop_workers || !pending.empty();});
+
+      if(stop_workers)
+         break;
+
+      batch = pending.front();
+      pending.pop_front();
+
+      lock.unlock();
+
+      try {
+         // get a private copy of the parser whenever a directive changes the parser state
+         if(parser_snapshot != batch->parser) {
+            parser.reset(new parser_t(*batch->parser));
+            parser_snapshot = batch->parser;
+         }
+
+         parse_batch(*batch, *parser);
+      }
+      catch (...) {
+         batch->error = std::current_exception();
+      }
+
+      lock.lock();
+
+      batch->done = true;
+
+      done_cv.notify_all();
+   }
+}
@@ -0,0 +1,139 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   parse_pipeline.h
+*/
+#ifndef PARSE_PIPELINE_H
+#define PARSE_PIPELINE_H
+
+#include "config.h"
+#include "logrec.h"
+#include "parser.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <vector>
+#include <deque>
+
+///
+/// @brief  A pool of worker threads that parse batches of log lines into log
+///         records ahead of the main log processing loop
+///
+/// The main thread reads log lines of a single log file into a batch and submits
+/// this batch to the pipeline, which parses all lines in the batch on one of the
+/// worker threads. The main thread waits for batches of each log file in the order
+/// they were submitted and consumes parsed log records in the original log line
+/// order, so log records are processed exactly as if they were parsed on the main
+/// thread.
+///
+/// Each batch carries a snapshot of the parser that was current when the batch was
+/// filled. Log file directives that change the parser state (e.g. W3C `#Fields`) are
+/// parsed on the main thread between batches, so log lines following a directive
+/// are always parsed with the updated parser state.
+///
+class parse_pipeline_t {
+   public:
+      static constexpr size_t BATCH_TEXT_SIZE = 256 * 1024;  ///< Size of the log line storage in a batch, in bytes.
+      static constexpr size_t BATCH_MAX_LINES = 1024;        ///< Maximum number of log lines in a batch.
+      static constexpr size_t FILE_QUEUE_DEPTH = 4;          ///< Maximum number of batches in flight per log file.
+
+      ///
+      /// @brief  A batch of log lines from a single log file and their parsed
+      ///         log records
+      ///
+      struct batch_t {
+         ///
+         /// @brief  A log line descriptor
+         ///
+         struct line_t {
+            size_t   offset;           ///< Offset of the log line in the batch text.
+            size_t   length;           ///< Log line length, not including the null character.
+            uint64_t recnum;           ///< Log record number, for reporting bad records.
+            int      parse_code;       ///< Parse code returned by the parser.
+         };
+
+         std::unique_ptr<char[]> text;                ///< Null-terminated log lines.
+         size_t                  text_size;           ///< Number of bytes used in `text`.
+
+         std::vector<line_t>     lines;               ///< Log line descriptors.
+         std::vector<log_struct> logrecs;             ///< Parsed log records, one per log line.
+         std::vector<string_t>   orig_lines;          ///< Original log lines of bad records (debug mode).
+
+         std::shared_ptr<const parser_t> parser;      ///< Parser state for this batch.
+
+         size_t                  next;                ///< Next log line to be consumed.
+         bool                    done;                ///< Have all lines been parsed?
+         std::exception_ptr      error;               ///< An exception thrown in the worker thread.
+
+         public:
+            batch_t(void);
+
+            void clear(void);
+
+            bool is_empty(void) const {return lines.empty();}
+
+            char *get_free_space(size_t& bufsize);
+
+            void add_line(size_t length, uint64_t recnum);
+      };
+
+      ///
+      /// @brief  Batches in flight for a single log file
+      ///
+      struct file_queue_t {
+         std::deque<batch_t*> batches;                ///< Batches in the submission order.
+         bool                 eof = false;            ///< Have all lines been read from the log file?
+      };
+
+   private:
+      const config_t&         config;
+
+      std::vector<std::thread> workers;               ///< Worker threads.
+
+      std::mutex              batch_mtx;              ///< Guards `pending`, `stop_workers` and `batch_t::done`.
+      std::condition_variable work_cv;                ///< Signalled when a batch is submitted or workers are stopped.
+      std::condition_variable done_cv;                ///< Signalled when a batch is parsed.
+
+      std::deque<batch_t*>    pending;                ///< Batches waiting for a worker.
+      bool                    stop_workers;
+
+      std::vector<std::unique_ptr<batch_t>> batches;  ///< Owns all batches.
+      std::vector<batch_t*>   free_batches;           ///< Batches available for reuse.
+
+      std::vector<file_queue_t> file_queues;          ///< Batches in flight, indexed by zero-based log file ID.
+
+   private:
+      void worker_thread_proc(void);
+
+      void parse_batch(batch_t& batch, parser_t& parser) const;
+
+   public:
+      parse_pipeline_t(const config_t& config);
+
+      ~parse_pipeline_t(void);
+
+      void start(size_t threads, size_t logfiles);
+
+      void stop(void);
+
+      bool is_active(void) const {return !workers.empty();}
+
+      file_queue_t& get_file_queue(u_int fileid) {return file_queues[fileid-1];}
+
+      batch_t *get_batch(void);
+
+      void release_batch(batch_t *batch);
+
+      void submit(batch_t *batch);
+
+      void wait(batch_t& batch);
+};
+
+#endif // PARSE_PIPELINE_H
@@ -20,8 +20,10 @@
 #include "unicode.h"
 #include "util_url.h"
 #include "util_time.h"
+#include "delim_scanner.h"
 
 #include <vector>
+#include <algorithm>
 
 #include <ctime>
 #include <cstdio>
@@ -34,6 +36,18 @@
 //
 #define SQUID_FIELD_COUNT     ((u_int) 10)
 
+//
+// Field layouts of the standard Apache log formats, which are parsed without
+// looking up field types at run time:
+//
+//    common           %h %l %u %t "%r" %>s %b
+//    combined         %h %l %u %t "%r" %>s %b "%{Referer}i" "%{User-Agent}i"
+//    vhost_combined   %v:%p %h %l %u %t "%r" %>s %O "%{Referer}i" "%{User-Agent}i"
+//
+#define APACHE_COMMON_FIELDS           eClientIpAddress, eRemoteLoginName, eUserName, eDateTime, eHttpRequestLine, eHttpStatus, eBytesSent
+#define APACHE_COMBINED_FIELDS         APACHE_COMMON_FIELDS, eReferrer, eUserAgent
+#define APACHE_VHOST_COMBINED_FIELDS   eWebsiteNamePort, APACHE_COMBINED_FIELDS
+
 //
 //
 //
@@ -63,10 +77,75 @@ const char *parser_t::log_month[12] = { "jan", "feb", "mar", "apr", "may", "jun"
 parser_t::parser_t(const config_t& _config) : config(_config)
 {
    fields = nullptr;
+   apache_parser = nullptr;
+   field_demand = get_field_demand(config);
+   memset(clf_tstamp_text, 0, sizeof(clf_tstamp_text));
+}
+
+///
+/// @brief  Creates a copy of the log file format state of another parser.
+///
+/// The copy has its own field descriptor storage and may be used to parse log
+/// records on a different thread, while the original parser keeps processing
+/// log file directives that may change the log file format (e.g. `#Fields`).
+///
+parser_t::parser_t(const parser_t& other) : 
+      config(other.config),
+      log_rec_fields(other.log_rec_fields),
+      fields(nullptr),
+      apache_parser(other.apache_parser),
+      field_demand(other.field_demand),
+      iis_tstamp(other.iis_tstamp)
+{
+   memset(clf_tstamp_text, 0, sizeof(clf_tstamp_text));
+
+   // Squid log records have a fixed number of fields
+   if(other.fields)
+      fields = new field_desc[std::max(log_rec_fields.size(), (size_t) SQUID_FIELD_COUNT)];
 }
 
 parser_t::~parser_t(void)
 {
+   cleanup_parser();
+}
+
+///
+/// @brief  Returns `true` if the log line is a log file directive that changes
+///         the state of the parser, such as W3C `#Fields` or `#Date`.
+///
+/// Directives must be parsed in the same order they appear in the log file, so
+/// all log lines that follow a directive are parsed with the updated state.
+///
+bool parser_t::is_directive(const char *buffer) const
+{
+   return (config.log_type == LOG_W3C || config.log_type == LOG_IIS) && buffer && *buffer == '#';
+}
+
+///
+/// @brief  Returns a mask of optional log record fields that are used by reports,
+///         filters or groups in the configuration.
+///
+/// Fields that are not in the mask are left empty in parsed log records, which
+/// saves copying and URL-decoding them for every log record. User names are not
+/// optional because they are counted in the monthly summary.
+///
+u_int parser_t::get_field_demand(const config_t& config)
+{
+   u_int demand = 0;
+
+   if(config.ntop_refs || !config.spam_refs.isempty() || !config.group_refs.isempty() ||
+         !config.include_refs.isempty() || !config.ignored_refs.isempty() || !config.search_list.isempty())
+      demand |= LOG_FIELD_REFER;
+
+   // referrer query strings are only used to find search terms
+   if(!config.search_list.isempty())
+      demand |= LOG_FIELD_XSRCHSTR;
+
+   if(config.ntop_agents || !config.robots.isempty() || !config.group_agents.isempty() ||
+         !config.include_agents.isempty() || !config.ignored_agents.isempty())
+      demand |= LOG_FIELD_AGENT;
+
+   return demand;
 }
 
 ///
@@ -77,6 +156,9 @@ parser_t::~parser_t(void)
 ///
 bool parser_t::init_parser(int logtype)
 {
+   // the configuration is complete at this point
+   field_demand = get_field_demand(config);
+
    switch(logtype) {
       case LOG_SQUID:
          fields = new field_desc[SQUID_FIELD_COUNT];
@@ -104,6 +186,8 @@ void parser_t::cleanup_parser(void)
    if(fields)
       delete [] fields;
    fields = nullptr;
+
+   apache_parser = nullptr;
 }
 
 //
@@ -130,6 +214,45 @@ inline char *parser_t::proc_apache_escape_seq(char *cp1)
    return --cp1;
 }
 
+//
+// get_fmt_scanners
+//
+// Returns three delimiter scanners for fmt_logrec for the specified combination
+// of noparen, noquotes and bsesc. Scanners are ordered for characters outside of
+// any quotes, brackets and parenthesis, for characters inside of brackets or
+// parenthesis and for characters inside of quotes. Delimiters in each scanner 
+// are those characters that are evaluated in the fmt_logrec switch statement in
+// the corresponding state.
+//
+const delim_scanner_t *parser_t::get_fmt_scanners(bool noparen, bool noquotes, bool bsesc)
+{
+   static const std::vector<delim_scanner_t> scanners = [] () {
+      std::vector<delim_scanner_t> scanners;
+
+      for(int flags = 0; flags < 8; flags++) {
+         string_t quoted, bracketed;
+
+         quoted = (flags & 1) ? "\\\r\n" : "\r\n";
+
+         if(!(flags & 2))
+            quoted += '"';
+
+         bracketed = quoted;
+
+         if(!(flags & 4))
+            bracketed += "[]()";
+
+         scanners.emplace_back(bracketed + " \t");
+         scanners.emplace_back(bracketed);
+         scanners.emplace_back(quoted);
+      }
+
+      return scanners;
+   }();
+
+   return &scanners[((noparen ? 4 : 0) + (noquotes ? 2 : 0) + (bsesc ? 1 : 0)) * 3];
+}
+
 //
 // fmt_logrec
 //
@@ -148,19 +271,43 @@ inline char *parser_t::proc_apache_escape_seq(char *cp1)
 // replaced by an underscore.
 //
 // buffer      - pointer to a log line
+// reclen      - log line length, which limits how far ahead delimiter scanners read
 // noparen     - ignore parenthesis
 // noquotes    - ignore quotes
 // bsesc       - process backslash escape sequences
 // fieldcnt    - number of fields; if zero, fields are not processed
 //
-bool parser_t::fmt_logrec(char *buffer, bool noparen, bool noquotes, bool bsesc, size_t fieldcnt)
+// Characters that are not delimiters in the current state, which is tracked by 
+// q, b and p, are skipped in bulk using one of the delimiter scanners returned
+// by get_fmt_scanners.
+//
+bool parser_t::fmt_logrec(char *buffer, size_t reclen, bool noparen, bool noquotes, bool bsesc, size_t fieldcnt)
 {
+   const delim_scanner_t *scanners = get_fmt_scanners(noparen, noquotes, bsesc);
+   const char *eob = buffer + reclen;
    char *cp1 = buffer, *cp2;
    int q = 0, b = 0, p = 0;
    u_int slen = 0, index = 0;
+   size_t run;
 
    cp2 = cp1;
    while(*cp1 && (!fieldcnt || index < fieldcnt)) {
+      // skip characters that do not change the state or the record
+      if((run = scanners[q ? 2 : b || p ? 1 : 0].find(cp1, eob) - cp1) != 0) {
+         if(fieldcnt) {
+            if(slen == 0)
+               fields[index].field = cp2;
+            slen += (u_int) run;
+         }
+
+         // move characters if one or more escape sequences were shortened
+         if(bsesc && cp1 != cp2)
+            memmove(cp2, cp1, run);
+
+         cp1 += run, cp2 += run;
+         continue;
+      }
+
       /* break record up, terminate fields with '\0' */
       switch (*cp1) {
          case '\\': if(bsesc) cp1 = proc_apache_escape_seq(cp1); break;
@@ -219,6 +366,27 @@ bool parser_t::parse_clf_tstamp(const char *dt, tstamp_t& ts)
    if(dt[0] != '[' || dt[27] != ']' || dt[28] != 0)
       return false;
 
+   //
+   // Consecutive log records almost always have the same date, hour and UTC offset,
+   // so only minutes and seconds are parsed if everything else matches the time stamp
+   // that started the current hour.
+   //
+   if(!memcmp(dt, clf_tstamp_text, 15) && !memcmp(&dt[21], &clf_tstamp_text[21], 7) && 
+         dt[15] == ':' && dt[18] == ':' && 
+         isdigit((u_char) dt[16]) && isdigit((u_char) dt[17]) && isdigit((u_char) dt[19]) && isdigit((u_char) dt[20])) {
+      u_int min = (dt[16] - '0') * 10 + dt[17] - '0';
+      u_int sec = (dt[19] - '0') * 10 + dt[20] - '0';
+
+      if(min > 59 || sec > 59)
+         return false;
+
+      ts = clf_tstamp_hour;
+      ts.min = min;
+      ts.sec = sec;
+
+      return true;
+   }
+
    month = 0;
 
    for(int index = 0; index < 12; index++) {
@@ -238,6 +406,13 @@ bool parser_t::parse_clf_tstamp(const char *dt, tstamp_t& ts)
 
    if(ts.year < 1900 || ts.month > 12 || ts.hour > 23 || ts.min > 59 || ts.sec > 59)
       return false;
+
+   // remember the date, hour and UTC offset if they are not followed by extra digits
+   if(dt[15] == ':' && dt[21] == ' ') {
+      memcpy(clf_tstamp_text, dt, sizeof(clf_tstamp_text));
+      clf_tstamp_hour = ts;
+      clf_tstamp_hour.min = clf_tstamp_hour.sec = 0;
+   }
    
    return true;
 }
@@ -266,7 +441,7 @@ const char *parser_t::parse_http_req_line(const char *cp1, log_struct& log_rec)
       return nullptr;
    
    // copy the method   
-   log_rec.method.assign(cptr, cp1-cptr);
+   log_rec.set_field(&log_struct::method, cptr, cp1-cptr);
 
    // check if there is no first space
    if(*cp1 != ' ')
@@ -284,7 +459,7 @@ const char *parser_t::parse_http_req_line(const char *cp1, log_struct& log_rec)
    }
    if(cp1 <= cptr)
       return nullptr;
-   log_rec.url.assign(cptr, cp1-cptr);
+   log_rec.set_field(&log_struct::url, cptr, cp1-cptr);
 
    // check for query strings
    if(*cp1 == '?') {
@@ -292,7 +467,7 @@ const char *parser_t::parse_http_req_line(const char *cp1, log_struct& log_rec)
       cptr = cp1;
       while(*cp1 && *cp1 != ' ') cp1++;
       if(cp1 > cptr)
-         log_rec.srchargs.assign(cptr, cp1-cptr);
+         log_rec.set_field(&log_struct::srchargs, cptr, cp1-cptr);
    }
 
    // check if there is no second space
@@ -329,7 +504,10 @@ int parser_t::parse_record(char *buffer, size_t reclen, log_struct& log_rec)
          retval = parse_record_clf(buffer, reclen, log_rec);
          break;
       case LOG_APACHE:
-         retval = parse_record_apache(buffer, reclen, log_rec);
+         if(apache_parser)
+            retval = (this->*apache_parser)(buffer, reclen, log_rec);
+         else
+            retval = parse_record_apache(buffer, reclen, log_rec);
          break;
       case LOG_SQUID: 
          retval = parse_record_squid(buffer, reclen, log_rec);
@@ -338,6 +516,9 @@ int parser_t::parse_record(char *buffer, size_t reclen, log_struct& log_rec)
 
    // if the record is good, convert all domain names to lower case
    if(retval == PARSE_CODE_OK) {
+      // the log line is not scanned anymore, so field values may be null-terminated
+      log_rec.hold_fields();
+
       //
       // Normalize all strings that may have URL encoding
       //
@@ -370,6 +551,21 @@ int parser_t::parse_record(char *buffer, size_t reclen, log_struct& log_rec)
 
       // convert possible host names and IPv6 addresses to lower case
       log_rec.hostname.tolower();
+
+      // parse IP addresses once, so they can be hashed and resolved in their binary form
+      if(log_rec.hostaddr.parse(log_rec.hostname.c_str(), log_rec.hostname.length()) && log_rec.hostaddr.get_family() == ipaddr_t::IPV6) {
+         char addrstr[ipaddr_t::max_text_size];
+         size_t addrlen = log_rec.hostaddr.to_string(addrstr, sizeof(addrstr));
+
+         // replace IPv6 spelling variants with one text form, so host look-ups by value match those by address
+         if(addrlen != log_rec.hostname.length() || memcmp(addrstr, log_rec.hostname.c_str(), addrlen)) {
+            // a log line view cannot grow (e.g. 1::2:3:4:5:6:7 is written as 1:0:2:3:4:5:6:7)
+            if(addrlen > log_rec.hostname.capacity())
+               log_struct::release_field(log_rec.hostname);
+
+            log_rec.hostname.assign(addrstr, addrlen);
+         }
+      }
    }
 
    return retval;
@@ -402,13 +598,15 @@ int parser_t::parse_record_clf(char *buffer, size_t reclen, log_struct& log_rec)
       return PARSE_CODE_IGNORE;
 
    eob = buffer + reclen;                      /* calculate end of buffer     */
-   fmt_logrec(buffer, false, false, false, 0); /* separate fields with 0's    */
+   fmt_logrec(buffer, reclen, false, false, false, 0); /* separate fields with 0's    */
 
    //
    // IP address
    //
    cp1 = buffer; 
-   cp1 += log_rec.hostname.assign(cp1).length();
+   cpx = cp1 + strlen(cp1);
+   log_rec.set_field(&log_struct::hostname, cp1, cpx - cp1);
+   cp1 = cpx;
    if(++cp1 >= eob) return PARSE_CODE_ERROR;
 
    //
@@ -440,7 +638,7 @@ int parser_t::parse_record_clf(char *buffer, size_t reclen, log_struct& log_rec)
 
    // assign only if it's not an empty field
    if(cp2-cp1 && (*cp1 != '-' || *(cp1+1)))
-      log_rec.ident.assign(cp1, cp2-cp1);
+      log_rec.set_field(&log_struct::ident, cp1, cp2-cp1);
 
    cp1 = cpx;
 
@@ -479,6 +677,10 @@ int parser_t::parse_record_clf(char *buffer, size_t reclen, log_struct& log_rec)
    /* done with CLF record */
    if(cp1++ >= eob) return PARSE_CODE_OK;
 
+   // skip the rest of the record if referrers and user agents aren't used
+   if(!is_demanded(LOG_FIELD_REFER) && !is_demanded(LOG_FIELD_AGENT))
+      return PARSE_CODE_OK;
+
    //
    // get the referrer, if present
    //
@@ -489,14 +691,15 @@ int parser_t::parse_record_clf(char *buffer, size_t reclen, log_struct& log_rec)
    if(*cp1 == '"') {cp1++; if(*cp2 != '?') cp2--;}
 
    // assign only if it's not an empty field
-   if(cp2-cp1 && (*cp1 != '-' || *(cp1+1)))
-      log_rec.refer.assign(cp1, cp2-cp1);
+   if(cp2-cp1 && (*cp1 != '-' || *(cp1+1)) && is_demanded(LOG_FIELD_REFER))
+      log_rec.set_field(&log_struct::refer, cp1, cp2-cp1);
 
    if(*cp2 == '?') {
       cp1 = ++cp2;
       while(*cp2 && cp2 < eob && *cp2 != '\n') cp2++;
       if(*--cp2 != '"') cp2++;
-      log_rec.xsrchstr.assign(cp1, cp2-cp1);
+      if(is_demanded(LOG_FIELD_XSRCHSTR))
+         log_rec.set_field(&log_struct::xsrchstr, cp1, cp2-cp1);
    }
    while(*cp2 && cp2 < eob) cp2++;
    if(++cp2 >= eob) return PARSE_CODE_OK;
@@ -510,8 +713,8 @@ int parser_t::parse_record_clf(char *buffer, size_t reclen, log_struct& log_rec)
    if(*cp1 == '"') {cp1++; cp2--;}
 
    // assign only if it's not an empty field
-   if(cp2-cp1 && (*cp1 != '-' || *(cp1+1)))
-      log_rec.agent.assign(cp1, cp2-cp1);
+   if(cp2-cp1 && (*cp1 != '-' || *(cp1+1)) && is_demanded(LOG_FIELD_AGENT))
+      log_rec.set_field(&log_struct::agent, cp1, cp2-cp1);
 
    return PARSE_CODE_OK;     /* maybe a valid record, return with TRUE */
 }
@@ -527,6 +730,7 @@ bool parser_t::parse_apache_log_format(const char *format)
    fields = nullptr;
 
    log_rec_fields.clear();
+   apache_parser = nullptr;
 
    if(format == nullptr || *format == 0)
       return false;
@@ -632,7 +836,13 @@ bool parser_t::parse_apache_log_format(const char *format)
 
          case 'v':
          case 'V':
-            log_rec_fields.push_back(eWebsiteName);
+            // %v:%p is logged as a single field (e.g. vhost_combined)
+            if(!strncmp(cptr + 1, ":%p", 3)) {
+               log_rec_fields.push_back(eWebsiteNamePort);
+               cptr += 3;
+            }
+            else
+               log_rec_fields.push_back(eWebsiteName);
             break;
 
          case 'i':
@@ -658,6 +868,11 @@ bool parser_t::parse_apache_log_format(const char *format)
 
    fields = new field_desc[log_rec_fields.size()];
 
+   // use a parser generated for the field layout of a standard format, if there is one
+   select_apache_parser<APACHE_COMMON_FIELDS>() ||
+         select_apache_parser<APACHE_COMBINED_FIELDS>() ||
+         select_apache_parser<APACHE_VHOST_COMBINED_FIELDS>();
+
    return (log_rec_fields.size()) ? true : false;
 
 errexit:
@@ -665,125 +880,198 @@ errexit:
    return false;
 }
 
-int parser_t::parse_record_apache(char *buffer, size_t reclen, log_struct& log_rec)
+///
+/// @brief  Parses a single Apache log record field identified by `fid`.
+///
+/// Each instance of this template handles one type of field without looking
+/// up the field type at run time, so parsers for standard Apache log formats,
+/// which are generated from lists of field identifiers, do not evaluate any
+/// field type switches for individual log records.
+///
+template <parser_t::TLogFieldId fid>
+bool parser_t::parse_apache_field(const field_desc& field, log_struct& log_rec)
 {
-   size_t slen;
-   size_t fldindex = 0, fieldcnt;
-   const char *cp1, *cp2;
-
-   if(buffer == nullptr || *buffer == 0)
-      return PARSE_CODE_ERROR;
+   size_t slen = field.length;
+   const char *cp1 = field.field, *cp2;
 
-   fieldcnt = log_rec_fields.size();
-
-   if(fields == nullptr || fieldcnt == 0)
-      return PARSE_CODE_ERROR;
-
-   if(!fmt_logrec(buffer, false, false, true, fieldcnt))
-      return PARSE_CODE_ERROR;
-
-   while(fldindex < fieldcnt) {
-      slen = fields[fldindex].length;
-      cp1 = fields[fldindex].field;
+   if(!cp1 || !slen)
+      return false;
 
-      if(!cp1 || !slen)
-         return PARSE_CODE_ERROR;
+   if(*cp1 == '"' && slen >= 2) {
+      cp1++; slen -= 2;
+   }
 
-      if(*cp1 == '"' && slen >= 2) {
-         cp1++; slen -= 2;
+   if constexpr (fid == eClientIpAddress)
+      log_rec.set_field(&log_struct::hostname, cp1, slen);
+   else if constexpr (fid == eUserName) {
+      if(slen && (slen > 1 || *cp1 != '-'))
+         log_rec.set_field(&log_struct::ident, cp1, slen);
+   }
+   else if constexpr (fid == eDateTime) {
+      if(!parse_clf_tstamp(cp1, log_rec.tstamp))
+         return false;
+   }
+   else if constexpr (fid == eHttpRequestLine) {
+      if(parse_http_req_line(cp1, log_rec) == nullptr)
+         return false;
+   }
+   else if constexpr (fid == eHttpStatus) {
+      /* response code */
+      log_rec.resp_code = (u_short) atoi(cp1);
+   }
+   else if constexpr (fid == eBytesReceived) {
+      if(config.upstream_traffic)
+         log_rec.xfer_size += strtoul(cp1,nullptr,10);
+   }
+   else if constexpr (fid == eBytesSent) {
+      /* xfer size */
+      log_rec.xfer_size += strtoul(cp1,nullptr,10);
+   }
+   else if constexpr (fid == eReferrer) {
+      if(slen && (slen > 1 || *cp1 != '-') && is_demanded(LOG_FIELD_REFER)) {
+         if((cp2 = strchr(cp1, '?')) != nullptr) {
+            log_rec.set_field(&log_struct::refer, cp1, cp2-cp1); cp2++;
+            if(is_demanded(LOG_FIELD_XSRCHSTR))
+               log_rec.set_field(&log_struct::xsrchstr, cp2, slen - (cp2-cp1));
+         }
+         else
+            log_rec.set_field(&log_struct::refer, cp1, slen);
+      }
+   }
+   else if constexpr (fid == eUserAgent) {
+      if(slen && (slen > 1 || *cp1 != '-') && is_demanded(LOG_FIELD_AGENT))
+         log_rec.set_field(&log_struct::agent, cp1, slen);
+   }
+   else if constexpr (fid == eUriStem)
+      log_rec.set_field(&log_struct::url, cp1, slen);
+   else if constexpr (fid == eUriQuery) {
+      if(*cp1 == '?') {
+         cp1++; slen--;
       }
-      switch (log_rec_fields[fldindex]) {
-         case eClientIpAddress:
-            log_rec.hostname.assign(cp1, slen);
-            break;
-
-         case eUserName:
-            if(slen && (slen > 1 || *cp1 != '-'))
-               log_rec.ident.assign(cp1, slen);
-            break;
 
-         case eDateTime:
-            if(!parse_clf_tstamp(cp1, log_rec.tstamp))
-               return PARSE_CODE_ERROR;
+      if(slen && (slen > 1 || *cp1 != '-'))
+         log_rec.set_field(&log_struct::srchargs, cp1, slen);
+   }
+   else if constexpr (fid == eHttpMethod)
+      log_rec.set_field(&log_struct::method, cp1, slen);
+   else if constexpr (fid == eWebsitePort)
+      log_rec.port = (u_short) atoi(cp1);
+   else if constexpr (fid == eWebsiteNamePort) {
+      // %v:%p - the port follows the last colon (host names may be IPv6 addresses)
+      for(cp2 = cp1 + slen; cp2 > cp1 && *(cp2-1) != ':'; cp2--);
+
+      if(cp2 > cp1)
+         log_rec.port = (u_short) atoi(cp2);
+   }
+   else if constexpr (fid == eProcTimeMcS)
+      log_rec.proc_time = usec2msec(strtoul(cp1, nullptr, 10));
+   else if constexpr (fid == eProcTimeS)
+      log_rec.proc_time = strtoul(cp1, nullptr, 10) * 1000;
 
-            break;
+   return true;
+}
 
-         case eHttpRequestLine:
-            if((cp1 = parse_http_req_line(cp1, log_rec)) == nullptr)
-               return PARSE_CODE_ERROR;
+///
+/// @brief  Parses a single Apache log record field of the type identified by 
+///         `fid` at run time.
+///
+bool parser_t::parse_apache_field(TLogFieldId fid, const field_desc& field, log_struct& log_rec)
+{
+   switch (fid) {
+      case eClientIpAddress: return parse_apache_field<eClientIpAddress>(field, log_rec);
+      case eUserName: return parse_apache_field<eUserName>(field, log_rec);
+      case eDateTime: return parse_apache_field<eDateTime>(field, log_rec);
+      case eHttpRequestLine: return parse_apache_field<eHttpRequestLine>(field, log_rec);
+      case eHttpStatus: return parse_apache_field<eHttpStatus>(field, log_rec);
+      case eBytesReceived: return parse_apache_field<eBytesReceived>(field, log_rec);
+      case eBytesSent: return parse_apache_field<eBytesSent>(field, log_rec);
+      case eReferrer: return parse_apache_field<eReferrer>(field, log_rec);
+      case eUserAgent: return parse_apache_field<eUserAgent>(field, log_rec);
+      case eUriStem: return parse_apache_field<eUriStem>(field, log_rec);
+      case eUriQuery: return parse_apache_field<eUriQuery>(field, log_rec);
+      case eHttpMethod: return parse_apache_field<eHttpMethod>(field, log_rec);
+      case eWebsitePort: return parse_apache_field<eWebsitePort>(field, log_rec);
+      case eWebsiteNamePort: return parse_apache_field<eWebsiteNamePort>(field, log_rec);
+      case eProcTimeMcS: return parse_apache_field<eProcTimeMcS>(field, log_rec);
+      case eProcTimeS: return parse_apache_field<eProcTimeS>(field, log_rec);
+      default: return parse_apache_field<eUnknown>(field, log_rec);
+   }
+}
 
-            break;
+///
+/// @brief  Parses Apache log records with any log format by looking up the type 
+///         of each field in `log_rec_fields`.
+///
+int parser_t::parse_record_apache(char *buffer, size_t reclen, log_struct& log_rec)
+{
+   size_t fldindex, fieldcnt;
 
-         case eHttpStatus:
-            /* response code */
-            log_rec.resp_code = (u_short) atoi(cp1);
-            break;
+   if(buffer == nullptr || *buffer == 0)
+      return PARSE_CODE_ERROR;
 
-         case eBytesReceived:
-            if(config.upstream_traffic)
-               log_rec.xfer_size += strtoul(cp1,nullptr,10);
-            break;
+   fieldcnt = log_rec_fields.size();
 
-         case eBytesSent:
-            /* xfer size */
-            log_rec.xfer_size += strtoul(cp1,nullptr,10);
-            break;
+   if(fields == nullptr || fieldcnt == 0)
+      return PARSE_CODE_ERROR;
 
-         case eReferrer:
-            if(slen && (slen > 1 || *cp1 != '-')) {
-               if((cp2 = strchr(cp1, '?')) != nullptr) {
-                  log_rec.refer.assign(cp1, cp2-cp1); cp2++;
-                  log_rec.xsrchstr.assign(cp2, slen - (cp2-cp1));
-               }
-               else
-                  log_rec.refer.assign(cp1, slen);
-            }
-            break;
+   if(!fmt_logrec(buffer, reclen, false, false, true, fieldcnt))
+      return PARSE_CODE_ERROR;
 
-         case eUserAgent:
-            if(slen && (slen > 1 || *cp1 != '-'))
-               log_rec.agent.assign(cp1, slen);
-            break;
+   for(fldindex = 0; fldindex < fieldcnt; fldindex++) {
+      if(!parse_apache_field(log_rec_fields[fldindex], fields[fldindex], log_rec))
+         return PARSE_CODE_ERROR;
+   }
 
-         case eUriStem:
-            log_rec.url.assign(cp1, slen);
+   return PARSE_CODE_OK;
+}
 
-            break;
+///
+/// @brief  Parses Apache log records with a log format that consists of the 
+///         fields in `fids`, in this order.
+///
+/// The list of fields is known at compile time, so each field is parsed by
+/// an instance of `parse_apache_field` for its type, which the compiler may 
+/// inline. Fields are parsed left to right until a bad field is found, same 
+/// as in `parse_record_apache`.
+///
+template <parser_t::TLogFieldId ... fids>
+int parser_t::parse_record_apache_std(char *buffer, size_t reclen, log_struct& log_rec)
+{
+   size_t fldindex = 0;
 
-         case eUriQuery:
-            if(*cp1 == '?') {
-               cp1++; slen--;
-            }
+   if(buffer == nullptr || *buffer == 0)
+      return PARSE_CODE_ERROR;
 
-            if(slen && (slen > 1 || *cp1 != '-'))
-               log_rec.srchargs.assign(cp1, slen);
+   if(fields == nullptr)
+      return PARSE_CODE_ERROR;
 
-            break;
+   if(!fmt_logrec(buffer, reclen, false, false, true, sizeof...(fids)))
+      return PARSE_CODE_ERROR;
 
-         case eHttpMethod:
-            log_rec.method.assign(cp1, slen);
-            break;
+   if(!(parse_apache_field<fids>(fields[fldindex++], log_rec) && ...))
+      return PARSE_CODE_ERROR;
 
-         case eWebsitePort:
-            log_rec.port = (u_short) atoi(cp1);
-            break;
+   return PARSE_CODE_OK;
+}
 
-         case eProcTimeMcS:
-            log_rec.proc_time = usec2msec(strtoul(cp1, nullptr, 10));
-            break;
+///
+/// @brief  Selects `parse_record_apache_std` for `fids` if `log_rec_fields` 
+///         contains the same fields, in the same order.
+///
+template <parser_t::TLogFieldId ... fids>
+bool parser_t::select_apache_parser(void)
+{
+   size_t fldindex = 0;
 
-         case eProcTimeS:
-            log_rec.proc_time = strtoul(cp1, nullptr, 10) * 1000;
-            break;
+   if(log_rec_fields.size() != sizeof...(fids))
+      return false;
 
-         default:
-            break;
-      }
+   if(!((log_rec_fields[fldindex++] == fids) && ...))
+      return false;
 
-      fldindex++;
-   }
+   apache_parser = &parser_t::parse_record_apache_std<fids...>;
 
-   return PARSE_CODE_OK;     
+   return true;
 }
 
 //
@@ -971,7 +1259,7 @@ int parser_t::parse_record_w3c(char *buffer, size_t reclen, log_struct& log_rec,
    if(fields == nullptr || fieldcnt == 0)
       return PARSE_CODE_ERROR;
 
-   if(!fmt_logrec(buffer, true, true, false, fieldcnt))
+   if(!fmt_logrec(buffer, reclen, true, true, false, fieldcnt))
       return PARSE_CODE_ERROR;
 
    while(fldindex < fieldcnt) {
@@ -1002,20 +1290,21 @@ int parser_t::parse_record_w3c(char *buffer, size_t reclen, log_struct& log_rec,
             break;
 
          case eClientIpAddress:
-            log_rec.hostname.assign(cp1, slen);
+            log_rec.set_field(&log_struct::hostname, cp1, slen);
             break;
 
          case eUserName:
             if(slen && (slen > 1 || *cp1 != '-'))
-               log_rec.ident.assign(cp1, slen);
+               log_rec.set_field(&log_struct::ident, cp1, slen);
             break;
 
          case eWebsiteName:
          case eWebsiteIpAddress:
+         case eWebsiteNamePort:
             break;
 
          case eHttpMethod:
-            log_rec.method.assign(cp1, slen);
+            log_rec.set_field(&log_struct::method, cp1, slen);
             break;
 
          case eWebsitePort:
@@ -1023,13 +1312,13 @@ int parser_t::parse_record_w3c(char *buffer, size_t reclen, log_struct& log_rec,
             break;
 
          case eUriStem:
-            log_rec.url.assign(cp1, slen);
+            log_rec.set_field(&log_struct::url, cp1, slen);
 
             break;
 
          case eUriQuery:
             if(slen && (slen > 1 || *cp1 != '-'))
-               log_rec.srchargs.assign(cp1, slen);
+               log_rec.set_field(&log_struct::srchargs, cp1, slen);
 
             break;
 
@@ -1052,20 +1341,22 @@ int parser_t::parse_record_w3c(char *buffer, size_t reclen, log_struct& log_rec,
             break;
 
          case eUserAgent:
-            if(slen && (slen > 1 || *cp1 != '-')) {
-               log_rec.agent.assign(cp1, slen);
-               log_rec.agent.replace('+', ' ');
+            if(slen && (slen > 1 || *cp1 != '-') && is_demanded(LOG_FIELD_AGENT)) {
+               // cp1 points into the buffer, which may be modified
+               std::replace(buffer + (cp1 - buffer), buffer + (cp1 - buffer) + slen, '+', ' ');
+               log_rec.set_field(&log_struct::agent, cp1, slen);
             }
             break;
 
          case eReferrer:
-            if(slen && (slen > 1 || *cp1 != '-')) {
+            if(slen && (slen > 1 || *cp1 != '-') && is_demanded(LOG_FIELD_REFER)) {
                if((cp2 = strchr(cp1, '?')) != nullptr) {
-                  log_rec.refer.assign(cp1, cp2-cp1); cp2++;
-                  log_rec.xsrchstr.assign(cp2, slen - (cp2-cp1));
+                  log_rec.set_field(&log_struct::refer, cp1, cp2-cp1); cp2++;
+                  if(is_demanded(LOG_FIELD_XSRCHSTR))
+                     log_rec.set_field(&log_struct::xsrchstr, cp2, slen - (cp2-cp1));
                }
                else
-                  log_rec.refer.assign(cp1, slen);
+                  log_rec.set_field(&log_struct::refer, cp1, slen);
             }
             break;
 
@@ -1109,7 +1400,7 @@ int parser_t::parse_record_squid(char *buffer, size_t reclen, log_struct& log_re
    eob = buffer + reclen;                         
 
    // seperate fields with \0's
-   if(!fmt_logrec(buffer, true, true, false, SQUID_FIELD_COUNT)) 
+   if(!fmt_logrec(buffer, reclen, true, true, false, SQUID_FIELD_COUNT)) 
       return PARSE_CODE_ERROR;
 
    /* date/time */
@@ -1125,7 +1416,7 @@ int parser_t::parse_record_squid(char *buffer, size_t reclen, log_struct& log_re
 
    /* HOSTNAME */
    fldindex++;
-   log_rec.hostname.assign(fields[fldindex].field, fields[fldindex].length);
+   log_rec.set_field(&log_struct::hostname, fields[fldindex].field, fields[fldindex].length);
 
    /* skip cache status */
    cp1 = fields[++fldindex].field;
@@ -1145,7 +1436,7 @@ int parser_t::parse_record_squid(char *buffer, size_t reclen, log_struct& log_re
    cpx = cp1;
    while(*cp1 && *cp1 != ' ' && *cp1 != '"')
       cp1++;
-   log_rec.method.assign(cpx, cp1-cpx);
+   log_rec.set_field(&log_struct::method, cpx, cp1-cpx);
 
    // URL path
    cp1 = fields[++fldindex].field;
@@ -1154,7 +1445,7 @@ int parser_t::parse_record_squid(char *buffer, size_t reclen, log_struct& log_re
          break;
       cp1++;
    }
-   log_rec.url.assign(fields[fldindex].field, cp1-fields[fldindex].field);
+   log_rec.set_field(&log_struct::url, fields[fldindex].field, cp1-fields[fldindex].field);
 
    // query strings (if any)
    if(*cp1 == '?') {
@@ -1163,7 +1454,7 @@ int parser_t::parse_record_squid(char *buffer, size_t reclen, log_struct& log_re
       while(*cp1 && *cp1 != ' ')
          cp1++;
       if(cp1 > cpx)
-         log_rec.srchargs.assign(cpx, cp1-cpx);
+         log_rec.set_field(&log_struct::srchargs, cpx, cp1-cpx);
    }
 
    /* IDENT (authuser) field */
@@ -1171,7 +1462,7 @@ int parser_t::parse_record_squid(char *buffer, size_t reclen, log_struct& log_re
 
    // assign only if it's not an empty field
    if(fields[fldindex].length && (fields[fldindex].length > 1 || *fields[fldindex].field != '-'))
-      log_rec.ident.assign(fields[fldindex].field, fields[fldindex].length);
+      log_rec.set_field(&log_struct::ident, fields[fldindex].field, fields[fldindex].length);
 
    /* we have no interest in the remaining fields */
    return PARSE_CODE_OK;
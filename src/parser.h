@@ -28,11 +28,19 @@
 //
 struct log_struct;
 struct field_desc;
+class delim_scanner_t;
+
+/// Unit test classes that need access to private members.
+namespace sswtest {
+   class ParserTest_StdApacheFormats_Test;
+}
 
 ///
 /// @brief  A log file parser class
 ///
 class parser_t {
+   friend class sswtest::ParserTest_StdApacheFormats_Test;
+
    private:
       enum TLogFieldId {
          eDateTime,
@@ -58,9 +66,19 @@ class parser_t {
          eCookie,
          eHttpRequestLine,         // GET / HTTP/1.1
          eRemoteLoginName,         // remote logname (from identd, if supplied). 
+         eWebsiteNamePort,         // www.example.com:443 (Apache %v:%p)
          eUnknown = -1            // must be last
       };
 
+      typedef int (parser_t::*apache_parser_t)(char *buffer, size_t reclen, log_struct& log_rec);
+
+      /// Optional log record fields, which are not stored if nothing in the configuration uses them.
+      enum log_field_t : u_int {
+         LOG_FIELD_REFER      = 0x01,     ///< Referrer
+         LOG_FIELD_XSRCHSTR   = 0x02,     ///< Referrer query string
+         LOG_FIELD_AGENT      = 0x04      ///< User agent
+      };
+
    private:
       const config_t& config;
 
@@ -68,24 +86,48 @@ class parser_t {
 
       field_desc *fields;
 
+      apache_parser_t apache_parser;      ///< A parser for a standard Apache log format, if the configured one matches.
+
+      u_int field_demand;                 ///< Optional log record fields used by the configuration (`log_field_t`).
+
       tstamp_t iis_tstamp;
 
+      char clf_tstamp_text[29];           ///< The last CLF time stamp text that started a new hour.
+      tstamp_t clf_tstamp_hour;           ///< The time stamp in `clf_tstamp_text` without minutes and seconds.
+
       static const char *log_month[12];
 
    private:
+      static u_int get_field_demand(const config_t& config);
+
+      bool is_demanded(log_field_t field) const {return (field_demand & field) != 0;}
+
       const char *parse_http_req_line(const char *cp1, log_struct& log_rec);
 
       char *proc_apache_escape_seq(char *cp1);
 
       bool parse_clf_tstamp(const char *dt, tstamp_t& ts);
 
-      bool fmt_logrec(char *buffer, bool noparen, bool noquotes, bool bsesc, size_t fieldcnt);
+      static const delim_scanner_t *get_fmt_scanners(bool noparen, bool noquotes, bool bsesc);
+
+      bool fmt_logrec(char *buffer, size_t reclen, bool noparen, bool noquotes, bool bsesc, size_t fieldcnt);
 
       int parse_record_clf(char *buffer, size_t reclen, log_struct& log_rec);
 
       bool parse_apache_log_format(const char *format);
       int parse_record_apache(char *buffer, size_t reclen, log_struct& log_rec);
 
+      template <TLogFieldId fid>
+      bool parse_apache_field(const field_desc& field, log_struct& log_rec);
+
+      bool parse_apache_field(TLogFieldId fid, const field_desc& field, log_struct& log_rec);
+
+      template <TLogFieldId ... fids>
+      int parse_record_apache_std(char *buffer, size_t reclen, log_struct& log_rec);
+
+      template <TLogFieldId ... fids>
+      bool select_apache_parser(void);
+
       int parse_w3c_log_directive(const char *buffer);
       int parse_record_w3c(char *buffer, size_t reclen, log_struct& log_rec, bool iis);
 
@@ -94,8 +136,14 @@ class parser_t {
    public:
       parser_t(const config_t& _config);
 
+      parser_t(const parser_t& other);
+
       ~parser_t(void);
 
+      parser_t& operator = (const parser_t& other) = delete;
+
+      bool is_directive(const char *buffer) const;
+
       bool init_parser(int logtype);
 
       void cleanup_parser(void);
@@ -40,10 +40,23 @@ state_t::state_t(const config_t& config, end_visit_cb_t end_visit_cb, end_downlo
    config(config), history(config), database(config),
    end_visit_cb(end_visit_cb), end_download_cb(end_download_cb), end_cb_arg(end_cb_arg)
 {
+   hash_table_base *hti[] = {&hm_htab, &um_htab, &rm_htab, &am_htab, &sr_htab, &im_htab, &rc_htab, &dl_htab, &cc_htab, &ct_htab, &as_htab};
+
+   // hash tables that may hold many nodes
+   hash_table_base *htl[] = {&hm_htab, &um_htab, &rm_htab, &am_htab, &sr_htab, &im_htab, &dl_htab};
+
    buffer = new char[BUFSIZE];
 
    v_ended.reserve(128);
    dl_ended.reserve(128); 
+
+   for(hash_table_base *h : hti)
+      h->set_max_load_factor(config.htab_load_factor);
+
+   if(config.htab_probing) {
+      for(hash_table_base *h : htl)
+         h->set_storage(HTAB_PROBED);
+   }
 }
 
 state_t::~state_t(void)
@@ -220,6 +233,9 @@ void state_t::save_state(void)
    if(!config.is_maintenance()) {
       sysnode.incremental = config.incremental;
       sysnode.batch = config.batch;
+
+      // log records were processed without secondary indexes
+      sysnode.report_indexes = 0;
    }
 
    if(!database.put_sysnode(sysnode, sysnode.storage_info)) {
@@ -405,6 +421,11 @@ void state_t::save_state(void)
    }
    rc_htab.clear();
 
+   // write nodes batched by tables and report any errors
+   database_t::status_t status;
+   if(!(status = database.wait_writes()).success())
+      throw exception_t(0, string_t::_format("%s (%s)", config.lang.msg_data_err, status.err_msg().c_str()));
+
    //
    // Update history for the current month. If the history file was missing, 
    // a new one will be created with this data. 
@@ -433,7 +454,7 @@ bool state_t::initialize(void)
    // initialize the database
    //
    
-   if(config.is_maintenance()) {
+   if(config.is_maintenance() && !config.merge_db) {
       // make sure database exists, so database_t::open doesn't create an empty one
       if(access(config.get_db_path(), F_OK)) {
          fprintf(stderr, "%s: %s\n", config.lang.msg_nofile, config.get_db_path().c_str());
@@ -501,6 +522,25 @@ bool state_t::initialize(void)
    if(!config.is_maintenance()) {
       // enable trickling for log processing
       database.set_trickle(true);
+
+      // write swapped-out nodes on a background thread, so parsing doesn't stall on database I/O
+      database.set_write_behind(config.db_write_behind);
+
+      // skip database look-ups for new items that were never swapped out
+      database.set_value_filters(config.db_value_filters);
+   }
+
+   //
+   // Rebuild indexes of different tables on separate threads, but only if this run
+   // will rebuild any, because parallel indexes require a free-threaded environment
+   // with a single writer. Log processing rebuilds report indexes for reports in the
+   // non-batch mode and other runs rebuild those not maintained by the last run.
+   //
+   if(!config.compact_db && !config.db_info) {
+      if(config.prep_report || config.end_month || config.merge_db)
+         database.set_parallel_indexes((get_report_indexes() & ~sysnode.report_indexes) != 0);
+      else
+         database.set_parallel_indexes(!config.batch && get_report_indexes() != 0);
    }
 
    // open the full state database (sysnode is already up to date)
@@ -520,9 +560,9 @@ bool state_t::initialize(void)
    // nothing to do if just compacting the database or printing information
    if(!config.compact_db && !config.db_info) {
       // attach indexes to generate a report or to end the current month
-      if(config.prep_report || config.end_month) {
-         // if the last run was in the batch mode, rebuild indexes
-         if(!(status = database.attach_indexes(sysnode.batch ? true : false)).success())
+      if(config.prep_report || config.end_month || config.merge_db) {
+         // rebuild indexes that were not maintained by the last run (e.g. in the batch mode)
+         if(!(status = attach_indexes(false)).success())
             throw exception_t(0, string_t::_format("Cannot activate secondary database indexes (%s)", status.err_msg().c_str()));
       }
       else {
@@ -578,6 +618,98 @@ bool state_t::initialize(void)
    return true;
 }
 
+///
+/// @brief  Secondary indexes traversed by reports in their entirety.
+///
+/// Top report tables are selected in a single scan of each primary table and only
+/// All Items pages and dump files traverse secondary indexes. The position of each
+/// index in this table is its bit in `sysnode_t::report_indexes`, so new indexes
+/// must be appended.
+///
+static const struct {
+   const char     *index_db;                 // index name
+   bool config_t::*all_items;                // All Items page option or `nullptr`
+   bool config_t::*dump;                     // dump file option or `nullptr`
+} report_indexes[] = {
+   {"urls.hits", &config_t::all_urls, &config_t::dump_urls},
+   {"urls.groups.hits", &config_t::all_urls, nullptr},
+   {"hosts.hits", &config_t::all_hosts, &config_t::dump_hosts},
+   {"hosts.groups.hits", &config_t::all_hosts, nullptr},
+   {"downloads.xfer", &config_t::all_downloads, &config_t::dump_downloads},
+   {"agents.hits", nullptr, &config_t::dump_agents},
+   {"agents.visits", &config_t::all_agents, nullptr},
+   {"agents.groups.visits", &config_t::all_agents, nullptr},
+   {"referrers.hits", &config_t::all_refs, &config_t::dump_refs},
+   {"referrers.groups.hits", &config_t::all_refs, nullptr},
+   {"search.hits", &config_t::all_search, &config_t::dump_search},
+   {"users.hits", &config_t::all_users, &config_t::dump_users},
+   {"users.groups.hits", &config_t::all_users, nullptr},
+   {"errors.hits", &config_t::all_errors, &config_t::dump_errors},
+   {"countries.visits", nullptr, &config_t::dump_countries},
+   {"cities.visits", nullptr, &config_t::dump_cities},
+   {"asn.visits", nullptr, &config_t::dump_asn}
+};
+
+///
+/// @brief  Returns `true` if the index `index_db` is in the bit mask of report indexes
+///         pointed to by `arg` and `false` otherwise.
+///
+bool state_t::use_report_index_cb(const char *index_db, void *arg)
+{
+   uint32_t indexes = *(const uint32_t*) arg;
+
+   for(size_t i = 0; i < sizeof(report_indexes)/sizeof(report_indexes[0]); i++) {
+      if(!strcmp(report_indexes[i].index_db, index_db))
+         return (indexes & (1u << i)) != 0;
+   }
+
+   return false;
+}
+
+///
+/// @brief  Returns a bit mask of report indexes used by All Items pages and dump
+///         files in the current configuration.
+///
+uint32_t state_t::get_report_indexes(void) const
+{
+   uint32_t indexes = 0;
+
+   for(size_t i = 0; i < sizeof(report_indexes)/sizeof(report_indexes[0]); i++) {
+      if(report_indexes[i].all_items && config.*report_indexes[i].all_items || report_indexes[i].dump && config.*report_indexes[i].dump)
+         indexes |= 1u << i;
+   }
+
+   return indexes;
+}
+
+///
+/// @brief  Attaches secondary indexes used by All Items pages and dump files.
+///
+/// Only attached indexes are maintained as their tables change, so the indexes
+/// attached in this run are recorded in the system node. If `rebuild` is `false`,
+/// only those indexes that were not maintained by the last run are rebuilt.
+///
+database_t::status_t state_t::attach_indexes(bool rebuild)
+{
+   database_t::status_t status;
+   uint32_t indexes = get_report_indexes();
+   uint32_t stale = rebuild ? indexes : indexes & ~sysnode.report_indexes;
+   uint32_t current = indexes & ~stale;
+
+   if(current && !(status = database.attach_indexes(false, use_report_index_cb, &current)).success())
+      return status;
+
+   if(stale && !(status = database.attach_indexes(true, use_report_index_cb, &stale)).success())
+      return status;
+
+   sysnode.report_indexes = indexes;
+
+   if(!database.put_sysnode(sysnode, sysnode.storage_info))
+      return string_t::_format("%s (system node)", config.lang.msg_data_err);
+
+   return status;
+}
+
 void state_t::cleanup(void)
 {
    if(!config.db_info)
@@ -713,7 +845,7 @@ void state_t::restore_state(void)
    {database_t::iterator<ctnode_t> iter = database.begin_cities(nullptr);
    storable_t<ctnode_t> ctnode;
    while(iter.next(ctnode)) {
-      ct_htab.put_node(new storable_t<ctnode_t>(std::move(ctnode)), 0);
+      ct_htab.put_node(ct_htab.new_node(std::move(ctnode)), 0);
    }
    iter.close();
    }
@@ -722,7 +854,7 @@ void state_t::restore_state(void)
    {database_t::iterator<asnode_t> iter = database.begin_asn(nullptr);
    storable_t<asnode_t> asnode;
    while(iter.next(asnode)) {
-      as_htab.put_node(new storable_t<asnode_t>(std::move(asnode)), 0);
+      as_htab.put_node(as_htab.new_node(std::move(asnode)), 0);
    }
    iter.close();
    }
@@ -756,7 +888,7 @@ void state_t::restore_state(void)
          if((uptr = um_htab.find_node(OBJ_REG, htab_tstamp, unode.string)) != nullptr)
             vnode.set_lasturl(uptr);
          else
-            vnode.set_lasturl(um_htab.put_node(new storable_t<unode_t>(std::move(unode)), htab_tstamp));
+            vnode.set_lasturl(um_htab.put_node(um_htab.new_node(std::move(unode)), htab_tstamp));
       }
 
       hnode.set_visit(new storable_t<vnode_t>(std::move(vnode)));
@@ -766,7 +898,7 @@ void state_t::restore_state(void)
          sp_htab.insert(hnode.string);
 
       // now we can move the host node into the new instance in the hash table
-      hptr = hm_htab.put_node(new storable_t<hnode_t>(std::move(hnode)), htab_tstamp);
+      hptr = hm_htab.put_node(hm_htab.new_node(std::move(hnode)), htab_tstamp);
 
       hnode.reset();
       unode.reset();
@@ -791,7 +923,7 @@ void state_t::restore_state(void)
       dlnode.set_host(hptr);
 
       // finish up and insert the download node into the hash table
-      dl_htab.put_node(new storable_t<dlnode_t>(std::move(dlnode)), htab_tstamp);
+      dl_htab.put_node(dl_htab.new_node(std::move(dlnode)), htab_tstamp);
 
       dlnode.reset();
       danode.reset();
@@ -799,6 +931,315 @@ void state_t::restore_state(void)
    }}
 }
 
+///
+/// @brief  Merges nodes of one type from another state database into this database.
+///
+/// Each source node is looked up by value in this database. If it is found, the source
+/// node is merged into the node from this database and unique item counters in totals
+/// are decremented, so the same item is not counted twice. Otherwise, the source node is
+/// stored under a new node ID from this database.
+///
+template <typename node_t,
+            bool (database_t::*get_node_by_id)(storable_t<node_t>& node, typename node_t::template s_unpack_cb_t<> upcb) const,
+            bool (database_t::*get_node_by_value)(storable_t<node_t>& node, typename node_t::template s_unpack_cb_t<> upcb) const,
+            uint64_t (database_t::*get_node_id)(void),
+            bool (database_t::*put_node)(const node_t& node, storage_info_t& strg_info)>
+void state_t::merge_nodes(const database_t& srcdb, database_t::iterator<node_t>& iter, const char *desc)
+{
+   storable_t<node_t> srcnode, node;
+
+   while(iter.next(srcnode)) {
+      // read a copy of the source node, so its key values can be looked up in this database
+      node.reset(srcnode.nodeid);
+
+      if(!(srcdb.*get_node_by_id)(node, nullptr))
+         throw exception_t(0, string_t::_format("%s (%s %" PRIu64 ")", config.lang.msg_bad_data, desc, srcnode.nodeid));
+
+      // a look-up miss leaves the source copy intact
+      if((database.*get_node_by_value)(node, nullptr)) {
+         uncount_merged_node(node, srcnode);
+         node.merge(srcnode);
+      }
+      else
+         node.nodeid = (database.*get_node_id)();
+
+      if(!(database.*put_node)(node, node.storage_info))
+         throw exception_t(0, string_t::_format("%s (%s)", config.lang.msg_data_err, desc));
+
+      srcnode.reset();
+      node.reset();
+   }
+}
+
+///
+/// @brief  Merges download jobs from another state database into this database.
+///
+/// Download jobs are identified by their name and their host, so hosts must be merged
+/// before this method is called to be able to find the host of each source download job
+/// in this database.
+///
+void state_t::merge_downloads(const database_t& srcdb)
+{
+   database_t::iterator<dlnode_t> iter = srcdb.begin_downloads(nullptr);
+   storable_t<dlnode_t> srcnode;
+   storable_t<hnode_t> hnode;
+
+   while(iter.next<void *, storable_t<hnode_t>&>(srcnode, unpack_merged_dlnode_cb, const_cast<database_t*>(&srcdb), hnode)) {
+      // find the source host in this database (a hit replaces the host ID)
+      if(!database.get_hnode_by_value(hnode))
+         throw exception_t(0, string_t::_format("%s (no host %s for download %" PRIu64 ")", config.lang.msg_bad_data, hnode.string.c_str(), srcnode.nodeid));
+
+      // the download job node must be destroyed before the host node it references
+      {storable_t<dlnode_t> dlnode(srcnode.name, hnode);
+
+      if(database.get_dlnode_by_value<void *, const storable_t<hnode_t>&>(dlnode, &state_t::unpack_dlnode_cached_host_cb, this, (const storable_t<hnode_t>&) hnode))
+         totals.t_downloads--;
+      else
+         dlnode.nodeid = database.get_dlnode_id();
+
+      dlnode.merge(srcnode);
+
+      if(!database.put_dlnode(dlnode, dlnode.storage_info))
+         throw exception_t(0, string_t::_format("%s (downloads)", config.lang.msg_data_err));
+      }
+
+      srcnode.reset();
+      hnode.reset();
+   }
+
+   iter.close();
+}
+
+void state_t::uncount_merged_node(const unode_t& unode, const unode_t& srcnode)
+{
+   if(unode.flag == OBJ_GRP)
+      totals.t_grp_urls--;
+   else {
+      totals.t_url--;
+
+      if(unode.entry && srcnode.entry)
+         totals.u_entry--;
+
+      if(unode.exit && srcnode.exit)
+         totals.u_exit--;
+   }
+}
+
+void state_t::uncount_merged_node(const hnode_t& hnode, const hnode_t& srcnode)
+{
+   if(hnode.flag == OBJ_GRP)
+      totals.t_grp_hosts--;
+   else {
+      totals.t_hosts--;
+
+      if(hnode.robot && srcnode.robot)
+         totals.t_rhosts--;
+
+      if(hnode.spammer && srcnode.spammer)
+         totals.t_shosts--;
+
+      if(hnode.visits_conv && srcnode.visits_conv)
+         totals.t_hosts_conv--;
+   }
+}
+
+void state_t::uncount_merged_node(const rnode_t& rnode, const rnode_t& srcnode)
+{
+   if(rnode.flag == OBJ_GRP)
+      totals.t_grp_refs--;
+   else
+      totals.t_ref--;
+}
+
+void state_t::uncount_merged_node(const anode_t& anode, const anode_t& srcnode)
+{
+   if(anode.flag == OBJ_GRP)
+      totals.t_grp_agents--;
+   else
+      totals.t_agent--;
+}
+
+void state_t::uncount_merged_node(const snode_t& snode, const snode_t& srcnode)
+{
+   // search strings are counted only if they are reported
+   if(config.ntop_search)
+      totals.t_search--;
+}
+
+void state_t::uncount_merged_node(const inode_t& inode, const inode_t& srcnode)
+{
+   if(inode.flag == OBJ_GRP)
+      totals.t_grp_users--;
+   else
+      totals.t_user--;
+}
+
+void state_t::uncount_merged_node(const rcnode_t& rcnode, const rcnode_t& srcnode)
+{
+   totals.t_err--;
+}
+
+///
+/// @brief  Merges another state database for the same month into the current state.
+///
+/// Totals, daily and hourly totals, status codes, countries, cities and autonomous
+/// systems are merged into the memory state and are stored in this database when
+/// `save_state` is called. All other nodes are merged directly into this database.
+///
+/// Averages are recombined using their counters as weights. Daily and hourly maximum
+/// values are combined as if both databases covered the same hours, and daily host
+/// counts are added up because individual hosts are not tracked per day.
+///
+/// The source database is not modified and must not have any active visits or active
+/// downloads, which are ended when a month is finished.
+///
+/// This method will throw an instance of `exception_t` in case of an error.
+///
+void state_t::merge_state(const string_t& db_fname)
+{
+   u_int i;
+   database_t::status_t status;
+   string_t db_path(config.get_db_path(db_fname));
+   storable_t<sysnode_t> srcsys;
+   storable_t<totals_t> srctotals;
+
+   // make sure database exists, so database_t::open doesn't create an empty one
+   if(access(db_path, F_OK))
+      throw exception_t(0, string_t::_format("%s: %s", config.lang.msg_nofile, db_path.c_str()));
+
+   database_t srcdb(config, db_fname);
+
+   if(!(status = srcdb.open()).success())
+      throw exception_t(0, string_t::_format("Cannot open the database %s (%s)", db_path.c_str(), status.err_msg().c_str()));
+
+   if(config.verbose > 1)
+      printf("%s %s\n", config.lang.msg_use_db, db_path.c_str());
+
+   //
+   // The source database must pass the same compatibility checks as the current one,
+   // except that it is never upgraded because it is not modified.
+   //
+   if(!srcdb.get_sysnode_by_id(srcsys))
+      throw exception_t(0, string_t::_format("%s (system node)", config.lang.msg_bad_data));
+
+   if(!srcsys.check_byte_order())
+      throw exception_t(0, "Incompatible database format (byte order)");
+
+   if(srcsys.appver_last < MIN_APP_DB_VERSION)
+      throw exception_t(0, string_t::_format("Cannot open a database with a version prior to v%s", state_t::get_version(MIN_APP_DB_VERSION).c_str()));
+
+   if(srcsys.appver_last > VERSION)
+      throw exception_t(0, string_t::_format("Cannot open a database with a greater version (%s)", state_t::get_version(srcsys.appver_last).c_str()));
+
+   if(!srcsys.check_size_of())
+      throw exception_t(0, "Incompatible database format (data type sizes)");
+
+   if(!srcsys.check_time_settings(config))
+      throw exception_t(0, "Incompatible database format (time settings)");
+
+   // active visits and downloads cannot be merged without ending them first
+   if(srcdb.get_vcount() || srcdb.get_dacount())
+      throw exception_t(0, string_t::_format("Cannot merge a database with active visits or downloads (%s)", db_path.c_str()));
+
+   if(!srcdb.get_tgnode_by_id(srctotals))
+      throw exception_t(0, string_t::_format("%s (totals)", config.lang.msg_bad_data));
+
+   // only databases for the same month can be merged
+   if(!totals.cur_tstamp.null && !srctotals.cur_tstamp.null) {
+      if(totals.cur_tstamp.year != srctotals.cur_tstamp.year || totals.cur_tstamp.month != srctotals.cur_tstamp.month)
+         throw exception_t(0, string_t::_format("Cannot merge a database for a different month (%04d/%02d)", srctotals.cur_tstamp.year, srctotals.cur_tstamp.month));
+   }
+
+   totals.merge(srctotals);
+
+   // daily totals
+   {storable_t<daily_t> daily;
+   for(i = 0; i < 31; i++) {
+      daily.reset(i+1);
+      if(!srcdb.get_tdnode_by_id(daily))
+         throw exception_t(0, string_t::_format("%s (daily totals)", config.lang.msg_bad_data));
+      t_daily[i].merge(daily);
+   }}
+
+   // hourly totals
+   {storable_t<hourly_t> hourly;
+   for(i = 0; i < 24; i++) {
+      hourly.reset(i);
+      if(!srcdb.get_thnode_by_id(hourly))
+         throw exception_t(0, string_t::_format("%s (hourly totals)", config.lang.msg_bad_data));
+      t_hourly[i].merge(hourly);
+   }}
+
+   // status codes missing in the source database have no requests
+   for(i = 0; i < response.size(); i++) {
+      storable_t<scnode_t> scnode(response[i].get_scode());
+      if(srcdb.get_scnode_by_id(scnode))
+         response[i].count += scnode.count;
+   }
+
+   {database_t::iterator<ccnode_t> iter = srcdb.begin_countries(nullptr);
+   storable_t<ccnode_t> ccnode;
+   while(iter.next(ccnode))
+      cc_htab.get_ccnode(ccnode.ccode, 0).merge(ccnode);
+   iter.close();
+   }
+
+   {database_t::iterator<ctnode_t> iter = srcdb.begin_cities(nullptr);
+   storable_t<ctnode_t> ctnode;
+   while(iter.next(ctnode))
+      ct_htab.get_ctnode(ctnode.geoname_id(), ctnode.city, ctnode.ccode, 0).merge(ctnode);
+   iter.close();
+   }
+
+   {database_t::iterator<asnode_t> iter = srcdb.begin_asn(nullptr);
+   storable_t<asnode_t> asnode;
+   while(iter.next(asnode))
+      as_htab.get_asnode((uint32_t) asnode.nodeid, asnode.as_org, 0).merge(asnode);
+   iter.close();
+   }
+
+   {database_t::iterator<unode_t> iter = srcdb.begin_urls(nullptr);
+   merge_nodes<unode_t, &database_t::get_unode_by_id, &database_t::get_unode_by_value, &database_t::get_unode_id, &database_t::put_unode>(srcdb, iter, "URLs");
+   iter.close();
+   }
+
+   {database_t::iterator<hnode_t> iter = srcdb.begin_hosts(nullptr);
+   merge_nodes<hnode_t, &database_t::get_hnode_by_id<>, &database_t::get_hnode_by_value<>, &database_t::get_hnode_id, &database_t::put_hnode>(srcdb, iter, "hosts");
+   iter.close();
+   }
+
+   // downloads reference hosts and must be merged after hosts
+   merge_downloads(srcdb);
+
+   {database_t::iterator<rnode_t> iter = srcdb.begin_referrers(nullptr);
+   merge_nodes<rnode_t, &database_t::get_rnode_by_id, &database_t::get_rnode_by_value, &database_t::get_rnode_id, &database_t::put_rnode>(srcdb, iter, "referrers");
+   iter.close();
+   }
+
+   {database_t::iterator<anode_t> iter = srcdb.begin_agents(nullptr);
+   merge_nodes<anode_t, &database_t::get_anode_by_id, &database_t::get_anode_by_value, &database_t::get_anode_id, &database_t::put_anode>(srcdb, iter, "user agents");
+   iter.close();
+   }
+
+   {database_t::iterator<snode_t> iter = srcdb.begin_search(nullptr);
+   merge_nodes<snode_t, &database_t::get_snode_by_id, &database_t::get_snode_by_value, &database_t::get_snode_id, &database_t::put_snode>(srcdb, iter, "search strings");
+   iter.close();
+   }
+
+   {database_t::iterator<inode_t> iter = srcdb.begin_users(nullptr);
+   merge_nodes<inode_t, &database_t::get_inode_by_id, &database_t::get_inode_by_value, &database_t::get_inode_id, &database_t::put_inode>(srcdb, iter, "users");
+   iter.close();
+   }
+
+   {database_t::iterator<rcnode_t> iter = srcdb.begin_errors(nullptr);
+   merge_nodes<rcnode_t, &database_t::get_rcnode_by_id, &database_t::get_rcnode_by_value, &database_t::get_rcnode_id, &database_t::put_rcnode>(srcdb, iter, "errors");
+   iter.close();
+   }
+
+   if(!(status = srcdb.close()).success())
+      throw exception_t(0, string_t::_format("Cannot close the database %s (%s)", db_path.c_str(), status.err_msg().c_str()));
+}
+
 ///
 /// @brief  Makes the state database schema compatible with the current application
 ///         version.
@@ -1039,6 +1480,31 @@ void state_t::swap_out(int64_t tstamp, size_t maxmem)
                h->swap_out(tstamp, htotmem - hcutmem);
          }
       }
+
+      // write swapped-out nodes batched by tables, but not those queued for write-behind
+      database_t::status_t status;
+      if(!(status = database.write_batches()).success())
+         throw exception_t(0, string_t::_format("Cannot store swapped-out nodes in the database (%s)", status.err_msg().c_str()));
+   }
+}
+
+///
+/// @brief  Prints node counts, bucket counts and chain lengths of the larger
+///         hash tables.
+///
+void state_t::print_htab_stats(void) const
+{
+   struct {const char *name; const hash_table_base *htab;} htabs[] = {
+      {"hosts", &hm_htab}, {"urls", &um_htab}, {"referrers", &rm_htab}, {"agents", &am_htab}, 
+      {"search", &sr_htab}, {"users", &im_htab}, {"downloads", &dl_htab}
+   };
+
+   for(size_t index = 0; index < sizeof(htabs)/sizeof(htabs[0]); index++) {
+      hash_table_base::htab_stats_t stats = htabs[index].htab->get_stats();
+
+      printf("Hash table %-9s: %zu nodes, %zu buckets (%zu empty), load %.2f, chain avg %.2f max %zu, resized %zu time(s)%s\n",
+            htabs[index].name, stats.count, stats.buckets, stats.empty_buckets, stats.load_factor, 
+            stats.avg_chain, stats.max_chain, stats.resize_count, stats.resizing ? ", resizing" : "");
    }
 }
 
@@ -1103,6 +1569,26 @@ void state_t::unpack_dlnode_and_host_cb(dlnode_t& dlnode, uint64_t hostid, bool
       throw std::runtime_error(string_t::_format("Cannot find the host node (ID: %" PRIu64 ") for the download (ID: %" PRIu64 ")", hostid, dlnode.nodeid));
 }
 
+///
+/// This method is intended for reading download nodes from a state database being
+/// merged into the current one and reads the associated host node from the same
+/// source database, which is passed in as `arg`.
+///
+/// Neither of the node arguments is linked to one another. See `unpack_dlnode_and_host_cb`.
+///
+void state_t::unpack_merged_dlnode_cb(dlnode_t& dlnode, uint64_t hostid, bool active, void *arg, storable_t<hnode_t>& hnode)
+{
+   const database_t *srcdb = (const database_t*) arg;
+
+   // a download node must have a valid host node ID
+   if(!hostid)
+      throw std::runtime_error(string_t::_format("Invalid host node for the download (ID: %" PRIu64 ")", dlnode.nodeid));
+
+   hnode.nodeid = hostid;
+   if(!srcdb->get_hnode_by_id(hnode))
+      throw std::runtime_error(string_t::_format("Cannot find the host node (ID: %" PRIu64 ") for the download (ID: %" PRIu64 ")", hostid, dlnode.nodeid));
+}
+
 ///
 /// This method is intended for loading downloads and their associated hosts during 
 /// `state_t` initialization using active downloads as input.
@@ -110,9 +110,38 @@ class state_t {
 
       static bool eval_unode_cb(const unode_t *unode, void *arg);
 
+      static bool use_report_index_cb(const char *index_db, void *arg);
+
+      uint32_t get_report_indexes(void) const;
+
       template <typename node_t, bool (database_t::*put_node)(const node_t& node, storage_info_t& strg_info)>
       static void swap_out_node_cb(storable_t<node_t> *node, void *arg);
 
+      ///
+      /// @name   Database merging
+      ///
+      /// @{
+
+      template <typename node_t,
+                  bool (database_t::*get_node_by_id)(storable_t<node_t>& node, typename node_t::template s_unpack_cb_t<> upcb) const,
+                  bool (database_t::*get_node_by_value)(storable_t<node_t>& node, typename node_t::template s_unpack_cb_t<> upcb) const,
+                  uint64_t (database_t::*get_node_id)(void),
+                  bool (database_t::*put_node)(const node_t& node, storage_info_t& strg_info)>
+      void merge_nodes(const database_t& srcdb, database_t::iterator<node_t>& iter, const char *desc);
+
+      void merge_downloads(const database_t& srcdb);
+
+      void uncount_merged_node(const unode_t& unode, const unode_t& srcnode);
+      void uncount_merged_node(const hnode_t& hnode, const hnode_t& srcnode);
+      void uncount_merged_node(const rnode_t& rnode, const rnode_t& srcnode);
+      void uncount_merged_node(const anode_t& anode, const anode_t& srcnode);
+      void uncount_merged_node(const snode_t& snode, const snode_t& srcnode);
+      void uncount_merged_node(const inode_t& inode, const inode_t& srcnode);
+      void uncount_merged_node(const rcnode_t& rcnode, const rcnode_t& srcnode);
+
+      static void unpack_merged_dlnode_cb(dlnode_t& dlnode, uint64_t hostid, bool active, void *srcdb, storable_t<hnode_t>& hnode);
+      /// @}
+
    public:
       state_t(const config_t& config, end_visit_cb_t end_visit_db, end_download_cb_t end_download_cb, void *and_cb_arg);
 
@@ -122,10 +151,14 @@ class state_t {
 
       void cleanup(void);
 
+      database_t::status_t attach_indexes(bool rebuild);
+
       void save_state(void);
 
       void restore_state(void);
 
+      void merge_state(const string_t& db_fname);
+
       static void upgrade_database(storable_t<sysnode_t>& sysnode, system_database_t& sysdb);
 
       void clear_month(void);
@@ -140,6 +173,8 @@ class state_t {
 
       void swap_out(int64_t tstamp, size_t maxmem);
 
+      void print_htab_stats(void) const;
+
       ///
       /// @name   Serialization callbacks
       ///
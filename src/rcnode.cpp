@@ -49,6 +49,22 @@ bool rcnode_t::match_key(u_short respcode, const string_t& method, const string_
    return this->url == url;
 }
 
+void rcnode_t::reset(uint64_t nodeid)
+{
+   keynode_t<uint64_t>::reset(nodeid);
+   datanode_t<rcnode_t>::reset();
+
+   url.reset();
+   method.reset();
+   respcode = 0;
+   count = 0;
+}
+
+void rcnode_t::merge(const rcnode_t& rcnode)
+{
+   count += rcnode.count;
+}
+
 //
 // serialization
 //
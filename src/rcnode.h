@@ -35,6 +35,10 @@ struct rcnode_t : public htab_obj_t<u_short, const string_t&, const string_t&>,
          rcnode_t(void);
          rcnode_t(const string_t& method, const string_t& url, u_short respcode);
 
+         void reset(uint64_t nodeid = 0);
+
+         void merge(const rcnode_t& rcnode);
+
          nodetype_t get_type(void) const override {return OBJ_REG;}
 
          bool match_key(u_short respcode, const string_t& method, const string_t& url) const override;
@@ -22,6 +22,12 @@ rnode_t::rnode_t(const string_t& ref) : base_node<rnode_t>(ref)
    visits = 0;
 }
 
+void rnode_t::merge(const rnode_t& rnode)
+{
+   count += rnode.count;
+   visits += rnode.visits;
+}
+
 //
 // serialization
 //
@@ -30,6 +30,8 @@ struct rnode_t : public base_node<rnode_t> {
          rnode_t(void) : count(0), visits(0) {}
          rnode_t(const string_t& ref);
 
+         void merge(const rnode_t& rnode);
+
          //
          // serialization
          //
@@ -0,0 +1,182 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   slab_allocator.h
+*/
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+#include "types.h"
+
+#include <cstdlib>
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <new>
+#include <vector>
+
+///
+/// @brief  A memory allocator that carves fixed-size memory blocks out of large
+///         slabs
+///
+/// @tparam BLOCKSIZE   Size of each memory block, in bytes
+///
+/// @tparam ALIGNMENT   Alignment of each memory block
+///
+/// Released memory blocks are kept in a free list within the released blocks and
+/// are reused for subsequent allocations, so objects of the same size are packed
+/// together instead of being interleaved with other heap allocations. Slabs are
+/// not returned to the heap while any of their blocks are in use, but once all
+/// blocks are released, either one by one or all at once via `clear`, all slabs
+/// except the first one are freed.
+///
+/// This class is not thread-safe. Each hash table owns an allocator for its nodes
+/// and uses it only on the thread that modifies the hash table.
+///
+template <size_t BLOCKSIZE, size_t ALIGNMENT>
+class slab_allocator_t {
+   static_assert(ALIGNMENT <= alignof(std::max_align_t), "Slab blocks cannot be aligned beyond the malloc alignment");
+
+   private:
+      ///
+      /// @brief  A released memory block
+      ///
+      struct free_block_t {
+         free_block_t   *next;         ///< Next released memory block.
+      };
+
+   public:
+      static constexpr size_t SLAB_SIZE = 256 * 1024;    ///< Preferred slab size, in bytes.
+
+      /// Block size, large enough to hold a free list pointer and rounded up to `ALIGNMENT`.
+      static constexpr size_t block_size = ((BLOCKSIZE < sizeof(free_block_t) ? sizeof(free_block_t) : BLOCKSIZE) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+      /// Number of blocks in each slab.
+      static constexpr size_t slab_blocks = SLAB_SIZE / block_size < 16 ? 16 : SLAB_SIZE / block_size;
+
+   private:
+      std::vector<u_char*> slabs;      ///< All slabs, with the current one at the end.
+      std::vector<u_char*> slab_index; ///< All slabs, sorted by address.
+      size_t         slab_used;        ///< Number of blocks carved from the current slab.
+
+      free_block_t   *free_list;       ///< Released memory blocks.
+      size_t         used;             ///< Number of blocks in use.
+
+   public:
+      slab_allocator_t(void) : slab_used(slab_blocks), free_list(nullptr), used(0)
+      {
+      }
+
+      slab_allocator_t(const slab_allocator_t&) = delete;
+
+      ~slab_allocator_t(void)
+      {
+         for(size_t index = 0; index < slabs.size(); index++)
+            std::free(slabs[index]);
+      }
+
+      slab_allocator_t& operator = (const slab_allocator_t&) = delete;
+
+      ///
+      /// @brief  Returns a released memory block or carves a new one from the current
+      ///         slab, allocating a new slab if the current one is full.
+      ///
+      void *allocate(void)
+      {
+         void *block;
+
+         if(free_list) {
+            block = free_list;
+            free_list = free_list->next;
+         }
+         else {
+            if(slab_used == slab_blocks) {
+               // reserve space before the slab is allocated, so push_back cannot throw
+               slabs.reserve(slabs.size() + 1);
+               slab_index.reserve(slab_index.size() + 1);
+
+               u_char *slab = (u_char*) std::malloc(slab_blocks * block_size);
+
+               if(!slab)
+                  throw std::bad_alloc();
+
+               slabs.push_back(slab);
+               slab_index.insert(std::upper_bound(slab_index.begin(), slab_index.end(), slab, std::less<u_char*>()), slab);
+
+               slab_used = 0;
+            }
+
+            block = slabs.back() + slab_used++ * block_size;
+         }
+
+         used++;
+
+         return block;
+      }
+
+      ///
+      /// @brief  Returns a memory block to the free list and frees all slabs except
+      ///         the first one once no blocks are in use.
+      ///
+      /// The first slab is kept to avoid freeing and allocating a slab repeatedly when
+      /// a single object is allocated and released in a loop.
+      ///
+      void deallocate(void *block)
+      {
+         if(--used) {
+            ((free_block_t*) block)->next = free_list;
+            free_list = (free_block_t*) block;
+            return;
+         }
+
+         clear();
+      }
+
+      ///
+      /// @brief  Releases all memory blocks at once and frees all slabs except the
+      ///         first one.
+      ///
+      /// Objects in released blocks are not destroyed, so the caller must destroy
+      /// them before calling this method, but may skip returning each block to the
+      /// free list.
+      ///
+      void clear(void)
+      {
+         while(slabs.size() > 1) {
+            std::free(slabs.back());
+            slabs.pop_back();
+         }
+
+         slab_index.assign(slabs.begin(), slabs.end());
+
+         free_list = nullptr;
+         slab_used = slabs.empty() ? slab_blocks : 0;
+         used = 0;
+      }
+
+      ///
+      /// @brief  Returns `true` if `block` was carved out of one of the slabs of this
+      ///         allocator, `false` otherwise.
+      ///
+      bool owns(const void *block) const
+      {
+         std::vector<u_char*>::const_iterator next = std::upper_bound(slab_index.begin(), slab_index.end(), (u_char*) block, std::less<u_char*>());
+
+         if(next == slab_index.begin())
+            return false;
+
+         return std::less<const u_char*>()((const u_char*) block, *(next - 1) + slab_blocks * block_size);
+      }
+
+      /// Returns the number of memory blocks in use.
+      size_t get_used(void) const {return used;}
+
+      /// Returns the number of allocated slabs.
+      size_t get_slab_count(void) const {return slabs.size();}
+};
+
+#endif // SLAB_ALLOCATOR_H
@@ -12,6 +12,12 @@
 #include "snode.h"
 #include "serialize.h"
 
+void snode_t::merge(const snode_t& snode)
+{
+   count += snode.count;
+   visits += snode.visits;
+}
+
 //
 // serialization
 //
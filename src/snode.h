@@ -40,6 +40,8 @@ struct snode_t : public base_node<snode_t> {
          snode_t(void) : base_node<snode_t>() {count = 0; termcnt = 0; visits = 0;}
          snode_t(const string_t& srch) : base_node<snode_t>(srch) {count = 0; termcnt = 0; visits = 0;}
 
+         void merge(const snode_t& snode);
+
          //
          // serialization
          //
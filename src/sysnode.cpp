@@ -34,6 +34,8 @@ sysnode_t::sysnode_t(void) : keynode_t<uint32_t>(1)
 
    utc_time = true;
    utc_offset = 0; 
+
+   report_indexes = 0;
 }
 
 void sysnode_t::reset(const config_t& config)
@@ -59,6 +61,8 @@ void sysnode_t::reset(const config_t& config)
 
    utc_time = !config.local_time;
    utc_offset = config.utc_offset; 
+
+   report_indexes = 0;
 }
 
 bool sysnode_t::check_size_of(void) const
@@ -109,7 +113,8 @@ size_t sysnode_t::s_data_size(void) const
             sizeof(u_char)       +     // utc_time
             sizeof(short)        +     // utc_offset
             sizeof(u_short)      +     // sizeof_longlong
-            sizeof(uint64_t)     ;     // byte_order_x64
+            sizeof(uint64_t)     +     // byte_order_x64
+            sizeof(uint32_t)     ;     // report_indexes
 }
 
 size_t sysnode_t::s_pack_data(void *buffer, size_t bufsize) const
@@ -142,6 +147,8 @@ size_t sysnode_t::s_pack_data(void *buffer, size_t bufsize) const
    ptr = sr.serialize(ptr, sizeof_longlong);
    ptr = sr.serialize(ptr, byte_order_x64);
 
+   ptr = sr.serialize(ptr, report_indexes);
+
    return sr.data_size(ptr);
 }
 
@@ -212,6 +219,12 @@ size_t sysnode_t::s_unpack_data(const void *buffer, size_t bufsize, s_unpack_cb_
       byte_order_x64 = 0x1234567890ABCDEFull;
    }
 
+   // prior versions maintained all indexes, unless in the batch mode
+   if(version >= 7)
+      ptr = sr.deserialize(ptr, report_indexes);
+   else
+      report_indexes = batch ? 0 : UINT32_MAX;
+
    if(upcb)
       upcb(*this, std::forward<param_t>(param) ...);
 
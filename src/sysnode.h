@@ -47,6 +47,8 @@ struct sysnode_t : public keynode_t<uint32_t>, datanode_t<sysnode_t> {
    bool        utc_time;            ///< UTC or local time?
    int         utc_offset;          ///< UTC offset in minutes if local time
 
+   uint32_t    report_indexes;      ///< Report indexes maintained by the last run (see `state_t::attach_indexes`)
+
    public:
       template <typename ... param_t>
       using s_unpack_cb_t = void (*)(sysnode_t& sysnode, param_t ... param);
@@ -0,0 +1,95 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   ut_agentcache.cpp
+*/
+#include "pch.h"
+
+#include "../agent_cache.h"
+
+namespace sswtest {
+
+///
+/// @brief  Tests that repeat user agents return the same entry with values
+///         evaluated for the first look-up.
+///
+TEST(AgentCacheTests, RepeatAgents)
+{
+   agent_cache_t cache(10);
+   string_t robot("Googlebot");
+
+   agent_cache_t::entry_t& entry1 = cache.get_entry(string_t("Mozilla/5.0 (compatible; Googlebot/2.1)"));
+
+   EXPECT_FALSE(entry1.mangled_set || entry1.robot_set || entry1.group_set) << "A new entry should not have any values";
+
+   entry1.robot = &robot;
+   entry1.robot_set = true;
+
+   agent_cache_t::entry_t& entry2 = cache.get_entry(string_t("Mozilla/5.0 (Windows NT 10.0)"));
+
+   EXPECT_NE(&entry1, &entry2);
+   EXPECT_FALSE(entry2.robot_set);
+
+   agent_cache_t::entry_t& entry3 = cache.get_entry(string_t("Mozilla/5.0 (compatible; Googlebot/2.1)"));
+
+   EXPECT_EQ(&entry1, &entry3) << "A repeat user agent should return the same entry";
+   EXPECT_TRUE(entry3.robot_set);
+   EXPECT_EQ(&robot, entry3.robot);
+
+   EXPECT_EQ(1, cache.get_hits());
+   EXPECT_EQ(2, cache.get_misses());
+   EXPECT_EQ(2, cache.size());
+}
+
+///
+/// @brief  Tests that the least recently used entry is replaced when the cache
+///         is full.
+///
+TEST(AgentCacheTests, ReplaceLeastRecentlyUsed)
+{
+   agent_cache_t cache(2);
+
+   cache.get_entry(string_t("Agent 1")).mangled_set = true;
+   cache.get_entry(string_t("Agent 2")).mangled_set = true;
+
+   // make Agent 1 the most recently used one
+   EXPECT_TRUE(cache.get_entry(string_t("Agent 1")).mangled_set);
+
+   // replaces Agent 2
+   agent_cache_t::entry_t& entry3 = cache.get_entry(string_t("Agent 3"));
+
+   EXPECT_STREQ("Agent 3", entry3.agent.c_str());
+   EXPECT_FALSE(entry3.mangled_set) << "A replaced entry should be reset";
+   EXPECT_EQ(2, cache.size());
+
+   EXPECT_TRUE(cache.get_entry(string_t("Agent 1")).mangled_set) << "Agent 1 should not be replaced";
+   EXPECT_FALSE(cache.get_entry(string_t("Agent 2")).mangled_set) << "Agent 2 should be replaced";
+
+   EXPECT_EQ(2, cache.get_hits());
+   EXPECT_EQ(4, cache.get_misses());
+}
+
+///
+/// @brief  Tests that nothing is cached if the maximum cache size is zero.
+///
+TEST(AgentCacheTests, NoCaching)
+{
+   agent_cache_t cache(0);
+
+   cache.get_entry(string_t("Agent 1")).mangled_set = true;
+
+   agent_cache_t::entry_t& entry = cache.get_entry(string_t("Agent 1"));
+
+   EXPECT_STREQ("Agent 1", entry.agent.c_str());
+   EXPECT_FALSE(entry.mangled_set) << "An entry should be reset for every look-up";
+
+   EXPECT_EQ(0, cache.get_hits());
+   EXPECT_EQ(2, cache.get_misses());
+   EXPECT_EQ(0, cache.size());
+}
+
+}
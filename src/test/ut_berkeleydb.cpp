@@ -88,6 +88,74 @@ class BerkeleyDBTest : public ::testing::Test {
          ASSERT_EQ(0, status.err_num()) << "A database should close without an error";
       }
 
+      /// Lets `table` queue records for the write-behind thread or, if `queue` is `false`, write them synchronously.
+      void SetWriteQueue(berkeleydb_t::table_t& table, bool queue)
+      {
+         table.set_write_queue(queue ? &bdb.write_queue : nullptr);
+      }
+
+      /// Starts the write-behind thread and waits until it writes all queued records.
+      berkeleydb_t::status_t WriteQueuedRecords(void)
+      {
+         bdb.write_queue.start();
+         return bdb.write_queue.stop();
+      }
+
+      /// Returns the number of records waiting to be written.
+      size_t QueuedRecordCount(void) const
+      {
+         return bdb.write_queue.records.size();
+      }
+
+      /// Returns the total size of queued records, in bytes.
+      size_t QueuedRecordSize(void) const
+      {
+         return bdb.write_queue.qsize;
+      }
+
+      /// Returns the size of queued records, in bytes, past which callers wait for the write-behind thread.
+      static size_t WriteQueueLimit(void)
+      {
+         return berkeleydb_t::WRITE_QUEUE_SIZE;
+      }
+
+      /// Discards all queued records and stops the write-behind thread.
+      void DiscardQueuedRecords(void)
+      {
+         bdb.write_queue.abort();
+      }
+
+      /// Returns the number of records indexed by node ID, including those being written.
+      size_t IndexedRecordCount(void) const
+      {
+         return bdb.write_queue.ids.size();
+      }
+
+      /// Makes the write queue report `message` as if the write-behind thread could not write records.
+      void SetWriteQueueError(const char *message)
+      {
+         bdb.write_queue.write_error = message;
+      }
+
+      /// Makes `table` report `error` as if its put batch could not be written.
+      static void SetBatchWriteError(berkeleydb_t::table_t& table, int error)
+      {
+         table.write_error = error;
+      }
+
+      /// Clears the write queue error and the write error latched by `table`.
+      void ClearWriteErrors(berkeleydb_t::table_t& table)
+      {
+         bdb.write_queue.write_error.reset();
+         table.write_error = 0;
+      }
+
+      /// Returns the number of records put into `table` that have not been written yet.
+      static size_t BatchedRecordCount(const berkeleydb_t::table_t& table)
+      {
+         return table.batch.size();
+      }
+
       /// Returns node hit count value as a node ID multiplied by ten.
       static uint64_t HitCountValueX10(uint64_t nodeid, uint64_t minid, uint64_t maxid) 
       {
@@ -175,6 +243,42 @@ TEST_F(BerkeleyDBTest, LookUpAgentNodes)
    }
 }
 
+///
+/// @brief  Puts agent nodes into a table without a write queue and checks that
+///         they are batched and written before they are looked up.
+///
+TEST_F(BerkeleyDBTest, LookUpBatchedAgentNodes)
+{
+   PopulateTable<anode_t>("agents", agents, "Agent ", 1, 10, HitCountValueX10, false);
+
+   ASSERT_EQ(10, BatchedRecordCount(agents)) << "Nodes should be batched until they are looked up";
+
+   storable_t<anode_t> anode(string_t("Agent 5"), false);
+
+   anode.nodeid = 5;
+   anode.count = 555;
+   ASSERT_TRUE(agents.put_node<anode_t>(anode, anode.storage_info)) << "An updated node should be batched";
+
+   anode.reset();
+   anode.nodeid = 5;
+   ASSERT_TRUE(agents.get_node_by_id(anode)) << "A batched node should be found by its ID";
+   EXPECT_EQ(555, anode.count) << "The most recent update should be found";
+
+   EXPECT_EQ(0, BatchedRecordCount(agents)) << "A look-up should write all batched records";
+
+   storable_t<anode_t> new_anode(string_t("Agent 11"), false);
+
+   new_anode.nodeid = 11;
+   new_anode.count = 1100;
+   ASSERT_TRUE(agents.put_node<anode_t>(new_anode, new_anode.storage_info)) << "A new node should be batched";
+
+   storable_t<anode_t> vnode(string_t("Agent 11"), false);
+
+   ASSERT_TRUE(agents.get_node_by_value(vnode)) << "A batched node should be found by its value";
+   EXPECT_EQ(11, vnode.nodeid);
+   EXPECT_EQ(1100, vnode.count);
+}
+
 ///
 /// @brief  Stores a few host nodes in a database and looks some of them up by
 ///         node ID and value.
@@ -201,6 +305,42 @@ TEST_F(BerkeleyDBTest, LookUpHostNodes)
    }
 }
 
+///
+/// @brief  Swaps out an IPv6 host node and looks it up by value using another
+///         spelling of the same address.
+///
+/// The parser replaces IPv6 addresses with their canonical text, which is what
+/// host nodes are stored and looked up by, so this test formats addresses the
+/// same way.
+///
+TEST_F(BerkeleyDBTest, LookUpIPv6HostVariants)
+{
+   berkeleydb_t::status_t status;
+   char addrstr[ipaddr_t::max_text_size];
+   ipaddr_t addr;
+
+   PopulateTable<hnode_t>("hosts", hosts, "Host ", 1, 10, HitCountValueX10);
+
+   // swap out a host node for an address in its compressed form
+   ASSERT_TRUE(addr.parse("2001:db8::1", 11));
+
+   storable_t<hnode_t> hnode(string_t(addrstr, addr.to_string(addrstr, sizeof(addrstr))), addr);
+
+   hnode.nodeid = 11;
+   hnode.count = 110;
+   ASSERT_TRUE(hosts.put_node<hnode_t>(hnode, hnode.storage_info)) << "An IPv6 host node should be stored without an error";
+
+   // look up the same address spelled in full
+   ASSERT_TRUE(addr.parse("2001:DB8:0:0:0:0:0:1", 20));
+
+   storable_t<hnode_t> vnode(string_t(addrstr, addr.to_string(addrstr, sizeof(addrstr))), addr);
+
+   ASSERT_TRUE(hosts.get_node_by_value(vnode)) << "An IPv6 host should be found by another spelling of its address";
+   EXPECT_EQ(11, vnode.nodeid);
+   EXPECT_EQ(110, vnode.count);
+   EXPECT_STREQ("2001:db8::1", vnode.string);
+}
+
 ///
 /// @brief  Populates a table and traverses its records by a secondary index
 ///         in ascending order.
@@ -233,6 +373,31 @@ TEST_F(BerkeleyDBTest, ForwardIndexTraversal)
    ASSERT_FALSE(iter.next(anode)) << "There should be no more than 100 secondary index entries";
 }
 
+///
+/// @brief  Populates a table with enough records to fill a few bulk buffers and
+///         traverses the primary database in the order of node IDs.
+///
+TEST_F(BerkeleyDBTest, PrimaryTraversal)
+{
+   PopulateTable<anode_t>("agents", agents, "Agent ", 1, 50000, HitCountValueX10, false);
+
+   storable_t<anode_t> anode;
+   uint64_t i = 1;
+
+   berkeleydb_t::iterator<anode_t> iter = agents.begin<anode_t>(nullptr);
+
+   for(; iter.next(anode); i++) {
+      ASSERT_EQ(i, anode.nodeid) << "Primary records should be returned in the order of node IDs";
+      ASSERT_EQ(i * 10, anode.count) << "Agent hit count should be node ID * 10";
+      ASSERT_STREQ(("Agent " + std::to_string(i)).c_str(), anode.string) << "Agent name should match the node ID";
+
+      anode.reset();
+   }
+
+   ASSERT_EQ(50001, i) << "All 50000 records should be returned";
+   ASSERT_FALSE(iter.is_error()) << "A complete traversal should not end in an error";
+}
+
 ///
 /// @brief  Populates a table and traverses its records by a secondary index
 ///         in descending order.
@@ -330,6 +495,183 @@ TEST_F(BerkeleyDBTest, AgentNodeReadCallback)
    }
 }
 
+///
+/// @brief  Checks that an error writing the put batch is reported by all subsequent
+///         writes and that no more nodes are batched after it.
+///
+TEST_F(BerkeleyDBTest, ReportBatchWriteError)
+{
+   PopulateTable<anode_t>("agents", agents, "Agent ", 1, 10, HitCountValueX10, false);
+
+   SetBatchWriteError(agents, EIO);
+
+   storable_t<anode_t> anode(string_t("Agent 11"), false);
+
+   anode.nodeid = 11;
+   anode.count = 1100;
+   EXPECT_FALSE(agents.put_node<anode_t>(anode, anode.storage_info)) << "A node should not be batched after a write error";
+   EXPECT_EQ(10, BatchedRecordCount(agents)) << "The put batch should not grow after a write error";
+
+   EXPECT_EQ(EIO, agents.write_batch()) << "Writing the batch should report the write error";
+   EXPECT_EQ(EIO, bdb.write_batches().err_num()) << "Writing all batches should report the write error";
+   EXPECT_EQ(EIO, bdb.wait_writes().err_num()) << "Waiting for writes should report the write error";
+
+   ClearWriteErrors(agents);
+
+   EXPECT_EQ(0, agents.write_batch()) << "The batch should be written once the write error is cleared";
+   EXPECT_EQ(0, BatchedRecordCount(agents));
+}
+
+///
+/// @brief  Queues agent node updates for the write-behind thread and looks them up
+///         by node ID and value before and after they are written.
+///
+/// The in-memory test database is not free-threaded, so the writer thread is only
+/// started after all look-ups from the queue are done.
+///
+TEST_F(BerkeleyDBTest, LookUpQueuedAgentNodes)
+{
+   berkeleydb_t::status_t status;
+
+   PopulateTable<anode_t>("agents", agents, "Agent ", 1, 10, HitCountValueX10, false);
+
+   SetWriteQueue(agents, true);
+
+   // queue two updates for an existing node and one new node
+   storable_t<anode_t> anode(string_t("Agent 5"), false);
+
+   anode.nodeid = 5;
+   anode.count = 500;
+   ASSERT_TRUE(agents.put_node<anode_t>(anode, anode.storage_info)) << "An updated node should be queued";
+
+   anode.count = 555;
+   ASSERT_TRUE(agents.put_node<anode_t>(anode, anode.storage_info)) << "A second update for the same node should be queued";
+
+   ASSERT_EQ(1, QueuedRecordCount()) << "The second update should replace the queued record";
+
+   storable_t<anode_t> new_anode(string_t("Agent 11"), false);
+
+   new_anode.nodeid = 11;
+   new_anode.count = 1100;
+   ASSERT_TRUE(agents.put_node<anode_t>(new_anode, new_anode.storage_info)) << "A new node should be queued";
+
+   // queued records are found ahead of the database
+   storable_t<anode_t> qnode;
+
+   qnode.nodeid = 5;
+   ASSERT_TRUE(agents.get_node_by_id(qnode)) << "A queued node should be found by its ID";
+   EXPECT_EQ(555, qnode.count) << "The most recent update should be found";
+
+   storable_t<anode_t> vnode(string_t("Agent 11"), false);
+
+   ASSERT_TRUE(agents.get_node_by_value(vnode)) << "A queued node should be found by its value";
+   EXPECT_EQ(11, vnode.nodeid);
+   EXPECT_EQ(1100, vnode.count);
+
+   // write all queued records and look them up in the database
+   ASSERT_TRUE(WriteQueuedRecords().success()) << "Queued records should be written without an error";
+
+   SetWriteQueue(agents, false);
+
+   ASSERT_EQ(0, IndexedRecordCount()) << "Written records should be removed from the queue";
+
+   qnode.reset();
+   qnode.nodeid = 5;
+   ASSERT_TRUE(agents.get_node_by_id(qnode)) << "A written node should be found by its ID";
+   EXPECT_EQ(555, qnode.count);
+
+   vnode.reset();
+   vnode.string = "Agent 11";
+   ASSERT_TRUE(agents.get_node_by_value(vnode)) << "A written node should be found by its value";
+   EXPECT_EQ(11, vnode.nodeid);
+   EXPECT_EQ(1100, vnode.count);
+}
+
+///
+/// @brief  Checks that iterators and counts report an error instead of records after
+///         queued records could not be written.
+///
+TEST_F(BerkeleyDBTest, ReportWriteQueueError)
+{
+   PopulateTable<anode_t>("agents", agents, "Agent ", 1, 10, HitCountValueX10, false);
+
+   SetWriteQueue(agents, true);
+
+   SetWriteQueueError("Failed to write queued records to the database");
+
+   storable_t<anode_t> anode;
+
+   berkeleydb_t::iterator<anode_t> iter = agents.begin<anode_t>(nullptr);
+
+   EXPECT_FALSE(iter.next(anode)) << "An iterator should not return records after a write error";
+   EXPECT_TRUE(iter.is_error()) << "An iterator should report a write error";
+
+   iter.close();
+
+   berkeleydb_t::reverse_iterator<anode_t> riter = agents.rbegin<anode_t>(nullptr);
+
+   EXPECT_FALSE(riter.prev(anode)) << "A reverse iterator should not return records after a write error";
+   EXPECT_TRUE(riter.is_error()) << "A reverse iterator should report a write error";
+
+   riter.close();
+
+   EXPECT_EQ(0, agents.count()) << "A table should not count records after a write error";
+
+   ClearWriteErrors(agents);
+
+   SetWriteQueue(agents, false);
+
+   EXPECT_EQ(10, agents.count()) << "A table should count records once write errors are cleared";
+}
+
+///
+/// @brief  Queues more agent nodes than fit into the write queue while a read cursor
+///         is open.
+///
+/// A thread holding an open cursor may block the writer thread, so it must not wait
+/// for the writer thread to catch up. The writer thread is never started, so if the
+/// queue blocked this thread, this test would never finish.
+///
+TEST_F(BerkeleyDBTest, FillWriteQueueWithOpenCursor)
+{
+   PopulateTable<anode_t>("agents", agents, "Agent ", 1, 10, HitCountValueX10, false);
+
+   storable_t<anode_t> anode;
+
+   berkeleydb_t::iterator<anode_t> iter = agents.begin<anode_t>(nullptr);
+
+   ASSERT_TRUE(iter.next(anode)) << "A read cursor should return the first agent node";
+
+   SetWriteQueue(agents, true);
+
+   // queue large agent nodes until the queue exceeds its size limit
+   std::string agent(16 * 1024, 'A');
+
+   for(uint64_t nodeid = 11; QueuedRecordSize() <= WriteQueueLimit(); nodeid++) {
+      std::string value = agent + std::to_string(nodeid);
+      storable_t<anode_t> new_anode(string_t::hold(value.c_str(), value.length()), false);
+
+      new_anode.nodeid = nodeid;
+      new_anode.count = nodeid * 10;
+      ASSERT_TRUE(agents.put_node<anode_t>(new_anode, new_anode.storage_info)) << "A new node should be queued while a read cursor is open";
+   }
+
+   ASSERT_GT(QueuedRecordSize(), WriteQueueLimit()) << "The write queue should grow past its limit while a read cursor is open";
+
+   anode.reset();
+   ASSERT_TRUE(iter.next(anode)) << "A read cursor should remain usable while records are queued";
+   EXPECT_EQ(2, anode.nodeid);
+
+   iter.close();
+
+   // the in-memory test database cannot hold all queued records
+   DiscardQueuedRecords();
+
+   SetWriteQueue(agents, false);
+
+   EXPECT_EQ(0, IndexedRecordCount()) << "Discarded records should be removed from the queue";
+}
+
 }
 
 #include "../database_tmpl.cpp"
@@ -0,0 +1,101 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   ut_bloomfilter.cpp
+*/
+#include "pch.h"
+
+#include "../bloom_filter.h"
+
+#include <vector>
+
+namespace sswtest {
+
+///
+/// @brief  Tests that added values are always found and that the false positive
+///         rate stays low for the number of values the filter was sized for.
+///
+TEST(BloomFilterTest, AddAndLookUp)
+{
+   bloom_filter_t filter;
+
+   EXPECT_FALSE(filter.is_ready()) << "A default filter should not be usable";
+
+   filter.reset(100000);
+
+   ASSERT_TRUE(filter.is_ready());
+   EXPECT_EQ(100000, filter.get_capacity());
+
+   // sequential hash values do not spread well over all bits
+   for(uint64_t i = 0; i < 100000; i++)
+      filter.add(i);
+
+   // values that were false positives when added are not counted
+   uint64_t count = filter.get_count();
+
+   EXPECT_LE(count, 100000);
+   EXPECT_GT(count, 99000);
+
+   EXPECT_FALSE(filter.add(1)) << "A value that was added before should not be added again";
+   EXPECT_EQ(count, filter.get_count()) << "A value that was added before should not be counted again";
+
+   for(uint64_t i = 0; i < 100000; i++)
+      ASSERT_TRUE(filter.maybe_contains(i)) << "An added value must always be found";
+
+   uint64_t positives = 0;
+
+   for(uint64_t i = 100000; i < 200000; i++) {
+      if(filter.maybe_contains(i))
+         positives++;
+   }
+
+   EXPECT_LT(positives, 1000) << "The false positive rate should be under 1%";
+
+   filter.clear();
+
+   EXPECT_EQ(0, filter.get_count());
+   EXPECT_TRUE(filter.is_ready()) << "A cleared filter should keep its size";
+   EXPECT_FALSE(filter.maybe_contains(1)) << "A cleared filter should not contain any values";
+}
+
+///
+/// @brief  Tests that a serialized filter is restored with all of its values and
+///         that filters with an unknown format are rejected.
+///
+TEST(BloomFilterTest, PackAndUnpack)
+{
+   bloom_filter_t filter, restored;
+
+   filter.reset(1000);
+
+   for(uint64_t i = 0; i < 1000; i++)
+      filter.add(i * 3);
+
+   std::vector<u_char> buffer(filter.s_data_size());
+
+   ASSERT_EQ(buffer.size(), filter.s_pack_data(buffer.data(), buffer.size()));
+   ASSERT_EQ(buffer.size(), restored.s_unpack_data(buffer.data(), buffer.size()));
+
+   EXPECT_EQ(filter.get_capacity(), restored.get_capacity());
+   EXPECT_EQ(filter.get_count(), restored.get_count());
+
+   for(uint64_t i = 0; i < 1000; i++)
+      ASSERT_TRUE(restored.maybe_contains(i * 3)) << "A restored filter must contain all values";
+
+   // a truncated bit array should be rejected
+   bloom_filter_t truncated;
+
+   EXPECT_EQ(0, truncated.s_unpack_data(buffer.data(), buffer.size() - sizeof(uint64_t)));
+   EXPECT_FALSE(truncated.is_ready()) << "A rejected filter should remain unusable";
+
+   // an unknown version should be rejected
+   buffer[0] = buffer[1] = 0xFF;
+
+   EXPECT_EQ(0, truncated.s_unpack_data(buffer.data(), buffer.size()));
+}
+
+}
@@ -17,7 +17,11 @@
 
 #include <string>
 #include <list>
+#include <vector>
 #include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
 
 namespace sswtest {
 
@@ -581,6 +585,542 @@ TEST(HashTableTest, URLMultiKey)
    ASSERT_EQ(unode_t::hash_key(url_p), unode_t::hash_key(urlpath, string_t()));
 }
 
+///
+/// @brief  Tests that `hnode_t` key methods produce expected results for IP
+///         addresses and host names and that textual variants of the same IPv6
+///         address are found in a hash table by their binary address.
+///
+TEST(HashTableTest, HostBinaryKey)
+{
+   h_hash_table htab;
+   string_t ipv6("2017:db8::1");
+   string_t ipv6_alt("2017:db8:0:0:0:0:0:1");
+   string_t ipv4("192.0.2.1");
+   string_t hostname("host.example.com");
+   ipaddr_t addr;
+
+   ASSERT_TRUE(addr.parse(ipv6.c_str(), ipv6.length()));
+
+   storable_t<hnode_t> *hnode = new storable_t<hnode_t>(ipv6, addr);
+   hnode->flag = OBJ_REG;
+
+   // the hash value must be the same for the binary and text keys and for textual variants
+   ASSERT_EQ(hnode->get_hash(), hnode_t::hash_key(addr));
+   ASSERT_EQ(hnode->get_hash(), hnode_t::hash_key(ipv6));
+   ASSERT_EQ(hnode->get_hash(), hnode_t::hash_key(ipv6_alt));
+
+   htab.put_node(hnode, 0);
+
+   ASSERT_TRUE(addr.parse(ipv6_alt.c_str(), ipv6_alt.length()));
+   EXPECT_EQ(hnode, htab.find_node(OBJ_REG, addr)) << "An IPv6 address variant should be found by its binary address";
+   EXPECT_EQ(hnode, htab.find_node(OBJ_REG, ipv6)) << "An IPv6 address should be found by its text";
+
+   // a node constructed from a string parses its IP address
+   hnode_t hnode4(ipv4);
+
+   ASSERT_TRUE(addr.parse(ipv4.c_str(), ipv4.length()));
+   EXPECT_TRUE(hnode4.match_key(addr));
+   EXPECT_EQ(hnode4.get_hash(), hnode_t::hash_key(addr));
+   EXPECT_EQ(hnode4.get_hash(), hnode_t::hash_key(ipv4));
+
+   // host names are hashed and matched as strings
+   hnode_t hnode_name(hostname);
+
+   EXPECT_TRUE(hnode_name.hostaddr.isempty());
+   EXPECT_FALSE(hnode_name.match_key(ipaddr_t()));
+   EXPECT_EQ(hnode_name.get_hash(), hnode_t::hash_key(hostname));
+   EXPECT_EQ(hnode_name.get_hash(), hash_ex(0, hostname));
+}
+
+
+///
+/// @brief  Tests that a hash table is resized incrementally once the load factor
+///         is exceeded and that all nodes can be found while nodes are being moved
+///         between bucket arrays.
+///
+TEST(HashTableTest, IncrementalResize)
+{
+   size_t swapcnt = 0;
+   bool resizing = false;
+
+   auto swap_cb = [] (storable_t<anode_t> *node, void *arg)
+   {
+      (*(size_t*) arg)++;
+   };
+
+   hash_table<storable_t<anode_t>> htab(16, swap_cb, &swapcnt);
+
+   htab.set_max_load_factor(2.);
+
+   for(int i = 0; i < 20000; i++) {
+      std::string agent = "Agent " + std::to_string(i);
+
+      ASSERT_NO_THROW(htab.put_node(new storable_t<anode_t>(string_t::hold(agent.c_str(), agent.length()), false), i));
+
+      // look up an older node, which may be in either of the bucket arrays
+      std::string old_agent = "Agent " + std::to_string(i / 2);
+      ASSERT_TRUE(htab.find_node(OBJ_REG, (int64_t) i, string_t::hold(old_agent.c_str(), old_agent.length())) != nullptr) << "An existing node should be found while resizing";
+
+      hash_table_base::htab_stats_t stats = htab.get_stats();
+
+      if(stats.resizing)
+         resizing = true;
+
+      // check bucket counts maintained by the hash table against the actual ones every now and then
+      if(i % 997 == 0 || stats.resizing && i % 7 == 0) {
+         ASSERT_EQ(htab.size(), stats.count);
+         ASSERT_EQ(htab.get_empty_buckets(), stats.empty_buckets) << "Empty bucket count should match the actual number of empty buckets";
+         ASSERT_EQ(htab.get_bucket_count(), stats.buckets);
+      }
+   }
+
+   hash_table_base::htab_stats_t stats = htab.get_stats();
+
+   EXPECT_TRUE(resizing) << "The hash table should have been resized at least once";
+   EXPECT_GE(stats.resize_count, 9) << "16 buckets must be doubled at least 9 times to keep 20000 nodes within the load factor of 2";
+   EXPECT_LE(stats.load_factor, 2.);
+   EXPECT_GE(stats.max_chain, (size_t) stats.avg_chain);
+
+   for(int i = 0; i < 20000; i++) {
+      std::string agent = "Agent " + std::to_string(i);
+
+      ASSERT_TRUE(htab.find_node(OBJ_REG, string_t::hold(agent.c_str(), agent.length())) != nullptr) << "Every node should be found after resizing";
+   }
+
+   //
+   // Nodes 0-9999 were last looked up with time stamps 2n and 2n+1, so only nodes
+   // 0-4999 have time stamps less than 10000. Swap them out, possibly while nodes
+   // are being moved between bucket arrays.
+   //
+   ASSERT_NO_THROW(htab.swap_out(9999));
+
+   EXPECT_EQ(5000, swapcnt);
+   EXPECT_EQ(15000, htab.size());
+   EXPECT_EQ(htab.get_empty_buckets(), htab.get_stats().empty_buckets);
+
+   ASSERT_NO_THROW(htab.clear());
+
+   EXPECT_EQ(htab.get_bucket_count(), htab.get_empty_buckets()) << "All buckets should be empty after the hash table is cleared";
+}
+
+///
+/// @brief  Tests that a hash table with resizing disabled keeps its original number
+///         of buckets and reports chain statistics.
+///
+TEST(HashTableTest, FixedSizeStats)
+{
+   hash_table<storable_t<anode_t>> htab(10);
+
+   htab.set_max_load_factor(0.);
+
+   for(int i = 0; i < 100; i++) {
+      std::string agent = "Agent " + std::to_string(i);
+
+      ASSERT_NO_THROW(htab.put_node(new storable_t<anode_t>(string_t::hold(agent.c_str(), agent.length()), false), i));
+   }
+
+   hash_table_base::htab_stats_t stats = htab.get_stats();
+
+   EXPECT_EQ(10, stats.buckets);
+   EXPECT_EQ(0, stats.resize_count);
+   EXPECT_FALSE(stats.resizing);
+   EXPECT_DOUBLE_EQ(10., stats.load_factor);
+   EXPECT_DOUBLE_EQ(100. / (stats.buckets - stats.empty_buckets), stats.avg_chain);
+   EXPECT_GE(stats.max_chain, 10);
+
+   // a cleared table must report all buckets as empty
+   ASSERT_NO_THROW(htab.clear());
+
+   hash_table_base::htab_stats_t cleared = htab.get_stats();
+
+   EXPECT_EQ(0, cleared.count);
+   EXPECT_EQ(cleared.buckets, cleared.empty_buckets);
+   EXPECT_EQ(htab.get_empty_buckets(), cleared.empty_buckets);
+   EXPECT_EQ(0, cleared.max_chain);
+
+   // the same nodes inserted after clearing the table must yield the same statistics
+   for(int i = 0; i < 100; i++) {
+      std::string agent = "Agent " + std::to_string(i);
+
+      ASSERT_NO_THROW(htab.put_node(new storable_t<anode_t>(string_t::hold(agent.c_str(), agent.length()), false), i));
+   }
+
+   hash_table_base::htab_stats_t refilled = htab.get_stats();
+
+   EXPECT_EQ(stats.empty_buckets, refilled.empty_buckets);
+   EXPECT_EQ(htab.get_empty_buckets(), refilled.empty_buckets);
+   EXPECT_EQ(stats.max_chain, refilled.max_chain);
+   EXPECT_DOUBLE_EQ(stats.avg_chain, refilled.avg_chain);
+}
+
+///
+/// @brief  Tests inserting, looking up and swapping out nodes stored in open-addressing
+///         slot arrays, which are resized as nodes are inserted.
+///
+TEST(HashTableTest, ProbedStorage)
+{
+   size_t swapcnt = 0;
+
+   auto swap_cb = [] (storable_t<anode_t> *node, void *arg)
+   {
+      (*(size_t*) arg)++;
+   };
+
+   hash_table<storable_t<anode_t>> htab(16, swap_cb, &swapcnt);
+
+   ASSERT_NO_THROW(htab.set_storage(HTAB_PROBED));
+   ASSERT_EQ(HTAB_PROBED, htab.get_storage());
+
+   for(int i = 0; i < 20000; i++) {
+      std::string agent = "Agent " + std::to_string(i);
+
+      ASSERT_NO_THROW(htab.put_node(new storable_t<anode_t>(string_t::hold(agent.c_str(), agent.length()), false), i));
+
+      std::string old_agent = "Agent " + std::to_string(i / 2);
+      ASSERT_TRUE(htab.find_node(OBJ_REG, (int64_t) i, string_t::hold(old_agent.c_str(), old_agent.length())) != nullptr) << "An existing node should be found in a slot";
+   }
+
+   EXPECT_THROW(htab.set_storage(HTAB_CHAINED), std::logic_error) << "Storage cannot be changed while there are nodes in the hash table";
+
+   hash_table_base::htab_stats_t stats = htab.get_stats();
+
+   EXPECT_EQ(20000, stats.count);
+   EXPECT_EQ(32768, stats.buckets) << "16 slots should be doubled until 20000 nodes occupy no more than 3/4 of all slots";
+   EXPECT_EQ(11, stats.resize_count);
+   EXPECT_EQ(stats.buckets - 20000, stats.empty_buckets);
+   EXPECT_GE(stats.max_chain, (size_t) stats.avg_chain);
+
+   // nodes 0-4999 have time stamps less than 10000 (see IncrementalResize)
+   ASSERT_NO_THROW(htab.swap_out(9999));
+
+   EXPECT_EQ(5000, swapcnt);
+   EXPECT_EQ(15000, htab.size());
+
+   // removed slots must not break probe sequences of remaining nodes
+   for(int i = 0; i < 20000; i++) {
+      std::string agent = "Agent " + std::to_string(i);
+
+      if(i < 5000)
+         ASSERT_EQ(nullptr, htab.find_node(OBJ_REG, string_t::hold(agent.c_str(), agent.length()))) << "A swapped out node should not be found";
+      else
+         ASSERT_TRUE(htab.find_node(OBJ_REG, string_t::hold(agent.c_str(), agent.length())) != nullptr) << "A remaining node should be found";
+   }
+
+   ASSERT_NO_THROW(htab.clear());
+
+   EXPECT_EQ(htab.get_bucket_count(), htab.get_empty_buckets()) << "All slots should be empty after the hash table is cleared";
+   EXPECT_NO_THROW(htab.set_storage(HTAB_CHAINED)) << "Storage may be changed once the hash table is empty";
+}
+
+///
+/// @brief  Tests nodes that share the same hash value and node types in the same
+///         probe sequence of open-addressing slots.
+///
+TEST(HashTableTest, ProbedStorageSameHash)
+{
+   size_t swapcnt = 0;
+
+   auto swap_cb = [] (storable_t<anode_t> *node, void *arg)
+   {
+      (*(size_t*) arg)++;
+   };
+
+   hash_table<storable_t<anode_t>> htab(16, swap_cb, &swapcnt);
+
+   htab.set_storage(HTAB_PROBED);
+
+   // the caller is trusted to supply correct hash values, so use the same one for all nodes
+   for(int i = 0; i < 50; i++) {
+      std::string agent = "Agent " + std::to_string(i);
+      string_t agent_key(string_t::hold(agent.c_str(), agent.length()));
+
+      ASSERT_NO_THROW(htab.put_node(42, new storable_t<anode_t>(agent_key, false), i));
+
+      // a group node with the same key
+      if(i % 10 == 0) {
+         storable_t<anode_t> *agent_grp = new storable_t<anode_t>(agent_key, false);
+         agent_grp->flag = OBJ_GRP;
+
+         ASSERT_NO_THROW(htab.put_node(42, agent_grp, 0));
+      }
+   }
+
+   for(int i = 0; i < 50; i++) {
+      std::string agent = "Agent " + std::to_string(i);
+      string_t agent_key(string_t::hold(agent.c_str(), agent.length()));
+
+      storable_t<anode_t> *anode = htab.find_node(42, OBJ_REG, (int64_t) 50 + i, agent_key);
+
+      ASSERT_TRUE(anode != nullptr) << "Every node with the same hash value should be found by its key";
+      EXPECT_EQ(OBJ_REG, anode->flag);
+      EXPECT_STREQ(agent_key.c_str(), anode->string.c_str());
+
+      anode = htab.find_node(42, OBJ_GRP, 0, agent_key);
+
+      if(i % 10 == 0) {
+         ASSERT_TRUE(anode != nullptr) << "A group node should be found by its type and key";
+         EXPECT_EQ(OBJ_GRP, anode->flag);
+      }
+      else
+         EXPECT_EQ(nullptr, anode) << "A regular node should not be found as a group node";
+   }
+
+   EXPECT_EQ(55, htab.get_stats().max_chain) << "All nodes should be in a single probe sequence";
+
+   // swap out nodes from the middle of the probe sequence
+   ASSERT_NO_THROW(htab.swap_out(50 + 24));
+
+   EXPECT_EQ(25, swapcnt);
+
+   for(int i = 0; i < 50; i++) {
+      std::string agent = "Agent " + std::to_string(i);
+
+      EXPECT_EQ(i >= 25, htab.find_node(42, OBJ_REG, (int64_t) 100, string_t::hold(agent.c_str(), agent.length())) != nullptr) << "Only nodes that were not swapped out should be found";
+      EXPECT_EQ(i % 10 == 0, htab.find_node(42, OBJ_GRP, 0, string_t::hold(agent.c_str(), agent.length())) != nullptr) << "Group nodes are never swapped out";
+   }
+}
+
+///
+/// @brief  Tests that look-ups move found nodes to the end of the time stamp list,
+///         so nodes are swapped out in the order they were last used, for both
+///         types of node storage.
+///
+TEST(HashTableTest, LookupTimeStampOrder)
+{
+   const size_t node_count = 2000, lookup_count = 10000;
+   std::vector<std::string> agents;
+   std::vector<int64_t> tstamps(node_count, 1);
+   std::vector<size_t> swapped;
+   uint32_t seed = 1;
+
+   auto swap_cb = [] (storable_t<anode_t> *node, void *arg)
+   {
+      // agent strings end with the index of the agent
+      ((std::vector<size_t>*) arg)->push_back((size_t) std::stoul(std::string(strrchr(node->string.c_str(), '/') + 1)));
+   };
+
+   for(size_t i = 0; i < node_count; i++)
+      agents.push_back("Mozilla/5.0 (compatible) Agent/" + std::to_string(i));
+
+   for(htab_storage_t storage : {HTAB_CHAINED, HTAB_PROBED}) {
+      hash_table<storable_t<anode_t>> htab(MAXHASH, swap_cb, &swapped);
+
+      htab.set_storage(storage);
+
+      swapped.clear();
+      std::fill(tstamps.begin(), tstamps.end(), 1);
+
+      for(size_t i = 0; i < node_count; i++)
+         htab.put_node(new storable_t<anode_t>(string_t::hold(agents[i].c_str(), agents[i].length()), false), 1);
+
+      // look up nodes in a fixed pseudo-random order, each with a new time stamp
+      for(size_t i = 0; i < lookup_count; i++) {
+         seed = seed * 1103515245u + 12345u;
+
+         size_t index = (seed >> 8) % node_count;
+
+         ASSERT_TRUE(htab.find_node(OBJ_REG, (int64_t) i + 2, string_t::hold(agents[index].c_str(), agents[index].length())) != nullptr);
+
+         tstamps[index] = (int64_t) i + 2;
+      }
+
+      // swap out nodes that were not used in the second half of look-ups
+      int64_t swap_tstamp = (int64_t) lookup_count / 2;
+
+      htab.swap_out(swap_tstamp);
+
+      size_t expected = std::count_if(tstamps.begin(), tstamps.end(), [swap_tstamp] (int64_t tstamp) {return tstamp <= swap_tstamp;});
+
+      ASSERT_EQ(expected, swapped.size()) << "Only nodes last used at or before the swap-out time stamp should be swapped out";
+      EXPECT_EQ(node_count - expected, htab.size());
+
+      for(size_t i = 0; i < swapped.size(); i++) {
+         EXPECT_LE(tstamps[swapped[i]], swap_tstamp);
+
+         if(i)
+            EXPECT_LE(tstamps[swapped[i-1]], tstamps[swapped[i]]) << "Nodes should be swapped out in the order they were last used";
+      }
+   }
+}
+
+///
+/// @brief  Reports times of inserts, of look-ups that move found nodes to the end
+///         of the time stamp list and of swapping out all nodes for both types of
+///         node storage.
+///
+/// This test reports elapsed times and does not fail if one storage type is slower
+/// than the other, because timings depend on the hardware and on the system load.
+/// It is disabled and may be run with `--gtest_also_run_disabled_tests` and
+/// `--gtest_filter=HashTableTest.DISABLED_LookupTiming`.
+///
+TEST(HashTableTest, DISABLED_LookupTiming)
+{
+   const size_t node_count = 100000, lookup_count = 500000;
+   std::vector<std::string> agents;
+   std::vector<size_t> lookups;
+   uint32_t seed = 1;
+
+   auto swap_cb = [] (storable_t<anode_t> *node, void *arg)
+   {
+      (*(size_t*) arg)++;
+   };
+
+   for(size_t i = 0; i < node_count; i++)
+      agents.push_back("Mozilla/5.0 (compatible; Agent/" + std::to_string(i) + ")");
+
+   // use a fixed pseudo-random sequence, so timings are comparable between runs
+   for(size_t i = 0; i < lookup_count; i++) {
+      seed = seed * 1103515245u + 12345u;
+      lookups.push_back((seed >> 8) % node_count);
+   }
+
+   for(htab_storage_t storage : {HTAB_CHAINED, HTAB_PROBED}) {
+      size_t swapcnt = 0, found = 0;
+      hash_table<storable_t<anode_t>> htab(MAXHASH, swap_cb, &swapcnt);
+
+      htab.set_storage(storage);
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+      for(size_t i = 0; i < node_count; i++)
+         htab.put_node(new storable_t<anode_t>(string_t::hold(agents[i].c_str(), agents[i].length()), false), 0);
+
+      std::chrono::steady_clock::time_point lookup_start = std::chrono::steady_clock::now();
+
+      for(size_t i = 0; i < lookup_count; i++) {
+         const std::string& agent = agents[lookups[i]];
+
+         if(htab.find_node(OBJ_REG, (int64_t) i + 1, string_t::hold(agent.c_str(), agent.length())))
+            found++;
+      }
+
+      std::chrono::steady_clock::time_point swap_start = std::chrono::steady_clock::now();
+
+      htab.swap_out(lookup_count);
+
+      std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+      EXPECT_EQ(lookup_count, found);
+      EXPECT_EQ(node_count, swapcnt);
+
+      printf("[          ] %-7s: insert %.3f ms, look-up %.1f ns, swap-out %.3f ms\n",
+            storage == HTAB_CHAINED ? "chained" : "probed",
+            std::chrono::duration<double, std::milli>(lookup_start - start).count(),
+            std::chrono::duration<double, std::nano>(swap_start - lookup_start).count() / lookup_count,
+            std::chrono::duration<double, std::milli>(end - swap_start).count());
+   }
+}
+
+///
+/// @brief  Tests that hash table nodes are allocated from slabs owned by the hash
+///         table, which are released when the hash table is cleared or when all
+///         nodes are swapped out.
+///
+TEST(HashTableTest, NodeSlabs)
+{
+   const size_t node_count = 20000;
+   size_t swapcnt = 0;
+
+   auto swap_cb = [] (storable_t<anode_t> *node, void *arg)
+   {
+      (*(size_t*) arg)++;
+   };
+
+   hash_table<storable_t<anode_t>> htab(MAXHASH, swap_cb, &swapcnt);
+
+   EXPECT_EQ(0, htab.get_slab_count()) << "An empty hash table should not allocate any slabs";
+
+   for(int pass = 0; pass < 2; pass++) {
+      for(size_t i = 0; i < node_count; i++) {
+         std::string agent = "Agent " + std::to_string(i);
+
+         htab.put_node(new storable_t<anode_t>(string_t::hold(agent.c_str(), agent.length()), false), 1);
+      }
+
+      EXPECT_LT(1, htab.get_slab_count()) << "Hash table nodes should be allocated from multiple slabs";
+
+      // release all nodes at once on the first pass and one by one on the second
+      if(!pass)
+         htab.clear();
+      else {
+         htab.swap_out(1);
+         EXPECT_EQ(node_count, swapcnt);
+      }
+
+      EXPECT_EQ(0, htab.size());
+      EXPECT_EQ(1, htab.get_slab_count()) << "Only the first slab should remain once all nodes are released";
+
+      std::string agent = "Agent 1";
+      EXPECT_EQ(nullptr, htab.find_node(OBJ_REG, string_t::hold(agent.c_str(), agent.length())));
+   }
+}
+
+///
+/// @brief  Tests that object nodes created by the hash table and their keys are
+///         allocated from hash table slabs, which are released when the hash table
+///         is cleared or when all nodes are swapped out.
+///
+TEST(HashTableTest, NodeArenas)
+{
+   const size_t node_count = 20000;
+   size_t swapcnt = 0;
+
+   auto swap_cb = [] (storable_t<anode_t> *node, void *arg)
+   {
+      (*(size_t*) arg)++;
+   };
+
+   hash_table<storable_t<anode_t>> htab(MAXHASH, swap_cb, &swapcnt);
+
+   EXPECT_EQ(0, htab.get_obj_slab_count()) << "An empty hash table should not allocate any object node slabs";
+   EXPECT_EQ(0, htab.get_key_slab_count()) << "An empty hash table should not allocate any key slabs";
+
+   for(int pass = 0; pass < 2; pass++) {
+      size_t slab_keys = 0;
+
+      for(size_t i = 0; i < node_count; i++) {
+         // short keys, keys longer than 16 characters and keys too long for any key slab
+         std::string agent = i % 3 == 0 ? "A" + std::to_string(i) : i % 3 == 1 ? "Mozilla/5.0 (Agent " + std::to_string(i) + ")" : std::string(300, 'x') + std::to_string(i);
+
+         if(agent.length() < 256)
+            slab_keys++;
+
+         htab.put_node(htab.new_node(string_t::hold(agent.c_str(), agent.length()), false), 1);
+      }
+
+      // a node allocated by the caller should be accepted and deleted with its key in a key slab
+      htab.put_node(new storable_t<anode_t>(string_t::hold("Heap Agent"), false), 1);
+
+      EXPECT_LT(1, htab.get_obj_slab_count()) << "Object nodes should be allocated from multiple slabs";
+      EXPECT_EQ(2, htab.get_key_slab_count()) << "Keys should be allocated from slabs of two size classes";
+      EXPECT_EQ(node_count + slab_keys + 1, htab.get_arena_used()) << "Long keys should not be allocated from key slabs";
+
+      std::string agent = "Mozilla/5.0 (Agent 1)";
+      const storable_t<anode_t> *anode = htab.find_node(OBJ_REG, string_t::hold(agent.c_str(), agent.length()));
+      ASSERT_NE(nullptr, anode);
+      EXPECT_STREQ(agent.c_str(), anode->string.c_str());
+
+      agent = std::string(300, 'x') + "2";
+      EXPECT_NE(nullptr, htab.find_node(OBJ_REG, string_t::hold(agent.c_str(), agent.length())));
+
+      // release all nodes at once on the first pass and one by one on the second
+      if(!pass)
+         htab.clear();
+      else {
+         htab.swap_out(1);
+         EXPECT_EQ(node_count + 1, swapcnt);
+      }
+
+      EXPECT_EQ(0, htab.size());
+      EXPECT_EQ(0, htab.get_arena_used()) << "No object nodes or keys should be in use once all nodes are released";
+      EXPECT_EQ(1, htab.get_obj_slab_count()) << "Only the first object node slab should remain once all nodes are released";
+      EXPECT_EQ(2, htab.get_key_slab_count()) << "Only the first slab of each key size class should remain once all nodes are released";
+
+      agent = "A0";
+      EXPECT_EQ(nullptr, htab.find_node(OBJ_REG, string_t::hold(agent.c_str(), agent.length())));
+   }
+}
+
 }
 
 #include "../hashtab_tmpl.cpp"
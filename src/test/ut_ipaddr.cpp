@@ -61,6 +61,47 @@ TEST(IPAddressTest, GoodIPv6Addresses)
    EXPECT_TRUE(is_ipv6_address("::192.0.2.128")) << "::192.0.2.128";
 }
 
+///
+/// @brief  Format IPv4 and IPv6 addresses in their canonical text form
+///
+TEST(IPAddressTest, CanonicalText)
+{
+   static const char *addrs[][2] = {
+      {"0.0.0.0", "0.0.0.0"},
+      {"192.0.2.128", "192.0.2.128"},
+      {"255.255.255.255", "255.255.255.255"},
+      {"::", "::"},
+      {"::1", "::1"},
+      {"1::", "1::"},
+      {"2017:0DB8:85A3:0000:0000:8A2E:0370:7334", "2017:db8:85a3::8a2e:370:7334"},
+      {"2017:db8:0:0:0:0:0:1", "2017:db8::1"},
+      {"2017:db8::0:1", "2017:db8::1"},
+      {"2017:db8:0:1:1:1:1:1", "2017:db8:0:1:1:1:1:1"},
+      {"2017:db8::1:1:1:1:1", "2017:db8:0:1:1:1:1:1"},
+      {"2017:0:0:1:0:0:0:1", "2017:0:0:1::1"},
+      {"2017:db8:0:0:1:0:0:1", "2017:db8::1:0:0:1"},
+      {"ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff", "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff"},
+      {"::ffff:c000:0280", "::ffff:192.0.2.128"},
+      {"::ffff:192.0.2.128", "::ffff:192.0.2.128"},
+      {"::ffff:0.0.0.0", "::ffff:0.0.0.0"},
+      {"::192.0.2.128", "::c000:280"},
+      {"64:ff9b::192.0.2.128", "64:ff9b::c000:280"}
+   };
+
+   ipaddr_t addr;
+   char addrstr[ipaddr_t::max_text_size];
+
+   for(size_t index = 0; index < sizeof(addrs) / sizeof(addrs[0]); index++) {
+      ASSERT_TRUE(addr.parse(addrs[index][0], strlen(addrs[index][0]))) << addrs[index][0];
+      EXPECT_EQ(strlen(addrs[index][1]), addr.to_string(addrstr, sizeof(addrstr))) << addrs[index][0];
+      EXPECT_STREQ(addrs[index][1], addrstr) << addrs[index][0];
+   }
+
+   // an empty address and a short buffer yield no text
+   EXPECT_EQ(0, ipaddr_t().to_string(addrstr, sizeof(addrstr)));
+   EXPECT_EQ(0, addr.to_string(addrstr, sizeof(addrstr) - 1));
+}
+
 ///
 /// @brief  Parse malformed IPv6 addresses
 ///
@@ -77,4 +118,78 @@ TEST(IPAddressTest, BadIPv6Addresses)
    EXPECT_FALSE(is_ipv6_address("::ffff:1234.0.2.128")) << "Four digits in a group in the IPv4 part of the address (1st group)";
    EXPECT_FALSE(is_ipv6_address("::ffff:192.0.1234.128")) << "Four digits in a group in the IPv4 part of the address (3rd group)";
 }
-}
\ No newline at end of file
+
+///
+/// @brief  Parses `str` and checks that it has the family and the bytes in `expected`.
+///
+static void check_ipaddr(const char *str, ipaddr_t::family_t family, const std::vector<u_char>& expected)
+{
+   ipaddr_t ipaddr;
+
+   ASSERT_TRUE(ipaddr.parse(str, strlen(str))) << str;
+   EXPECT_EQ(family, ipaddr.get_family()) << str;
+   ASSERT_EQ(ipaddr_t::size, expected.size()) << str;
+   EXPECT_EQ(0, memcmp(expected.data(), ipaddr.get_bytes(), ipaddr_t::size)) << str;
+}
+
+///
+/// @brief  Parse IPv4 and IPv6 addresses into their binary form
+///
+TEST(IPAddressTest, BinaryAddresses)
+{
+   check_ipaddr("0.0.0.0", ipaddr_t::IPV4, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 0, 0, 0, 0});
+   check_ipaddr("127.0.0.1", ipaddr_t::IPV4, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 127, 0, 0, 1});
+   check_ipaddr("255.254.10.0", ipaddr_t::IPV4, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 255, 254, 10, 0});
+
+   check_ipaddr("2017:0db8:85a3:0000:0000:8a2e:0370:7334", ipaddr_t::IPV6, {0x20, 0x17, 0x0d, 0xb8, 0x85, 0xa3, 0, 0, 0, 0, 0x8a, 0x2e, 0x03, 0x70, 0x73, 0x34});
+   check_ipaddr("2017:DB8:85A3::8A2E:370:7334", ipaddr_t::IPV6, {0x20, 0x17, 0x0d, 0xb8, 0x85, 0xa3, 0, 0, 0, 0, 0x8a, 0x2e, 0x03, 0x70, 0x73, 0x34});
+   check_ipaddr("::", ipaddr_t::IPV6, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0});
+   check_ipaddr("::1", ipaddr_t::IPV6, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1});
+   check_ipaddr("2017::", ipaddr_t::IPV6, {0x20, 0x17, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0});
+   check_ipaddr("1::2:3", ipaddr_t::IPV6, {0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 3});
+   check_ipaddr("1:2:3:4:5:6::8", ipaddr_t::IPV6, {0, 1, 0, 2, 0, 3, 0, 4, 0, 5, 0, 6, 0, 0, 0, 8});
+   check_ipaddr("::ffff:192.0.2.128", ipaddr_t::IPV6, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 192, 0, 2, 128});
+   check_ipaddr("1:2:3:4:5:6:192.0.2.128", ipaddr_t::IPV6, {0, 1, 0, 2, 0, 3, 0, 4, 0, 5, 0, 6, 192, 0, 2, 128});
+}
+
+///
+/// @brief  Parse malformed addresses into their binary form
+///
+TEST(IPAddressTest, BadBinaryAddresses)
+{
+   const char *bad_addrs[] = {
+      "", "abc", "1.2.3", "1.2.3.4.", ".1.2.3.4", "1.2.3.256", "1.2.3.04", "1.2.3.4 ",
+      ":", ":::", ":1::2", "1::2:", "1:2", "1::2::3", "12345::", "1:2:3:4:5:6:7:8:9",
+      "1:2:3:4:5:6:7::8", "1:2:3:4:5:6:7:8::", "::1.2.3.4:5", "::ffff:1.2.3.256",
+      "1:2:3:4:5:6:7:1.2.3.4", "fe80::1%eth0", "g::1"
+   };
+
+   for(const char *str : bad_addrs) {
+      ipaddr_t ipaddr;
+
+      EXPECT_FALSE(ipaddr.parse(str, strlen(str))) << str;
+      EXPECT_TRUE(ipaddr.isempty()) << str;
+   }
+}
+
+///
+/// @brief  Compare binary addresses
+///
+TEST(IPAddressTest, CompareBinaryAddresses)
+{
+   ipaddr_t addr1, addr2;
+
+   EXPECT_TRUE(addr1 == addr2) << "Empty addresses are equal";
+
+   ASSERT_TRUE(addr1.parse("2017:db8::1", 11));
+   ASSERT_TRUE(addr2.parse("2017:0DB8:0:0:0:0:0:0001", 24));
+   EXPECT_TRUE(addr1 == addr2) << "Text variants of the same IPv6 address are equal";
+
+   ASSERT_TRUE(addr1.parse("1.2.3.4", 7));
+   ASSERT_TRUE(addr2.parse("::ffff:1.2.3.4", 14));
+   EXPECT_TRUE(addr1 != addr2) << "IPv4 and IPv4-mapped IPv6 addresses are different";
+
+   ASSERT_TRUE(addr2.parse("1.2.3.4", 7));
+   EXPECT_TRUE(addr1 == addr2) << "Same IPv4 addresses are equal";
+}
+}
@@ -11,9 +11,27 @@
 
 #include "../linklist.h"
 
+#include <vector>
+#include <string>
+#include <random>
+
 namespace sswtest {
 class NListTest : public testing::Test {
    protected:
+      ///
+      /// @brief  Returns the first node matching `str` by evaluating each pattern
+      ///         sequentially, the way lists were searched before they were compiled.
+      ///
+      static const nnode_t *FindNodeSeq(const nlist& list, const char *str, size_t slen, bool substr, bool nocase)
+      {
+         for(nlist::const_iterator lptr = list.begin(); lptr != list.end(); lptr++) {
+            if(!lptr->string.isempty() && isinstrex(str, lptr->string, slen, lptr->string.length(), substr, &lptr->delta_table, nocase))
+               return &*lptr;
+         }
+
+         return nullptr;
+      }
+
       void FillNList(nlist& list)
       {
          list.add_nlist("one");
@@ -130,6 +148,117 @@ TEST_F(NListTest, NListSuffixSearch)
 ///
 /// @brief  glist Config Include
 ///
+///
+/// @brief  Verifies that compiled lists find the same patterns as sequential scans
+///         for random inputs, including wildcard quirks of `isinstrex`.
+///
+TEST_F(NListTest, NListMatchesSequentialScan)
+{
+   const char *patterns[] = {
+      "bc", "abca", "*ab", "ca*", "cab", "*a*b", "a*c", "b", "*bca", "ab*c*",
+      "*cc*", "aab", "*", "cbcb*", "*c", "Ab", "ABC*", "*BA", "bb", "**a"
+   };
+   std::mt19937 rng(12345);
+   std::string input;
+   nlist list;
+
+   for(size_t index = 0; index < sizeof(patterns)/sizeof(patterns[0]); index++) {
+      // a single asterisk would be moved to the front and match everything
+      if(strcmp(patterns[index], "*"))
+         list.add_nlist(patterns[index]);
+   }
+
+   const nlist& clist = list;
+
+   for(size_t count = 0; count < 20000; count++) {
+      input.clear();
+
+      for(size_t length = rng() % 8 + 1; length; length--)
+         input += "abcAB"[rng() % 5];
+
+      for(int mode = 0; mode < 4; mode++) {
+         bool substr = (mode & 2) != 0, nocase = (mode & 1) != 0;
+         const string_t *result = clist.isinlistex(input.c_str(), input.length(), substr, nocase);
+         const nnode_t *expected = FindNodeSeq(clist, input.c_str(), input.length(), substr, nocase);
+
+         ASSERT_EQ(expected ? expected->string.c_str() : "(null)", result ? result->c_str() : "(null)") << "input: " << input << ", substr: " << substr << ", nocase: " << nocase;
+      }
+   }
+
+   // a single asterisk at the front must match any input
+   list.add_nlist("*");
+
+   EXPECT_STREQ("*", list.isinlist(string_t("xyz"))->c_str());
+}
+
+///
+/// @brief  Verifies that a compiled list is discarded when the list is changed.
+///
+TEST_F(NListTest, NListChangeResetsMatcher)
+{
+   nlist list;
+
+   FillNList(list);
+
+   EXPECT_EQ(nullptr, list.isinlist(string_t("three")));
+
+   list.add_nlist("hre");
+
+   EXPECT_STREQ("hre", list.isinlist(string_t("three"))->c_str()) << "A new pattern should be found after the list was searched";
+
+   // change patterns via a non-constant iterator
+   for(nlist::iterator iter = list.begin(); iter != list.end(); iter++)
+      iter->string.toupper();
+
+   EXPECT_EQ(nullptr, list.isinlistex("end", 3, false)) << "'*end' was changed to '*END'";
+   EXPECT_STREQ("*END", list.isinlistex("THE END", 7, false)->c_str()) << "'THE END' should match the changed '*END' pattern";
+
+   list.clear();
+
+   EXPECT_EQ(nullptr, list.isinlist(string_t("THE END"))) << "A cleared list should not match any input";
+}
+
+///
+/// @brief  Verifies that a compiled list with many robot-like patterns finds the
+///         same pattern as a sequential scan for each user agent.
+///
+TEST_F(NListTest, NListLargeListMatchesSequentialScan)
+{
+   std::vector<std::string> agents;
+   std::mt19937 rng(12345);
+   size_t matches = 0;
+   nlist list;
+
+   // robot-like substring patterns, with some prefix and suffix patterns mixed in
+   for(size_t index = 0; index < 800; index++) {
+      std::string pattern = "bot" + std::to_string(index * 7919 % 100000);
+
+      if(index % 10 == 1)
+         pattern += "*";
+      else if(index % 10 == 2)
+         pattern = "*" + pattern;
+
+      list.add_nlist(pattern.c_str());
+   }
+
+   for(size_t index = 0; index < 2000; index++)
+      agents.push_back("Mozilla/5.0 (compatible; bot" + std::to_string(rng() % 1000000) + "; +http://www.example.com/bot.html)");
+
+   const nlist& clist = list;
+
+   for(size_t index = 0; index < agents.size(); index++) {
+      const string_t *result = clist.isinlist(string_t::hold(agents[index].c_str(), agents[index].length()));
+      const nnode_t *expected = FindNodeSeq(clist, agents[index].c_str(), agents[index].length(), true, false);
+
+      ASSERT_STREQ(expected ? expected->string.c_str() : "(null)", result ? result->c_str() : "(null)") << "agent: " << agents[index];
+
+      if(result)
+         matches++;
+   }
+
+   EXPECT_LT(0, matches) << "Some user agents should match robot patterns";
+}
+
 TEST(GListTest, GListConfigHostInclude)
 {
    int included = 0;
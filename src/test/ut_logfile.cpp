@@ -0,0 +1,478 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   ut_logfile.cpp
+*/
+#include "pch.h"
+
+#include "../logfile.h"
+
+#include <zlib.h>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace sswtest {
+
+///
+/// @brief  A test fixture that creates temporary log files and reads them back
+///         in all read modes.
+///
+class LogFileTest : public testing::Test {
+   protected:
+      std::vector<std::string> tmp_files;
+
+   protected:
+      ~LogFileTest(void)
+      {
+         for(const std::string& fname : tmp_files)
+            std::remove(fname.c_str());
+      }
+
+      ///
+      /// @brief  Returns a unique temporary file path with the specified suffix.
+      ///
+      std::string make_tmp_path(const char *suffix)
+      {
+         std::string fname = (std::filesystem::temp_directory_path() / ("ut_logfile_" + std::to_string(tmp_files.size()) + "_" + testing::UnitTest::GetInstance()->current_test_info()->name() + suffix)).string();
+
+         tmp_files.push_back(fname);
+
+         return fname;
+      }
+
+      ///
+      /// @brief  Writes `content` into a temporary file, compressed if `gzip` is
+      ///         `true`, and returns the file path.
+      ///
+      std::string write_log(const std::string& content, bool gzip = false)
+      {
+         std::string fname = make_tmp_path(gzip ? ".log.gz" : ".log");
+
+         if(gzip) {
+            gzFile gzfp = gzopen(fname.c_str(), "wb");
+            EXPECT_NE(gzfp, nullptr);
+            EXPECT_EQ(gzwrite(gzfp, content.data(), (unsigned) content.length()), (int) content.length());
+            gzclose(gzfp);
+         }
+         else {
+            FILE *fp = fopen(fname.c_str(), "wb");
+            EXPECT_NE(fp, nullptr);
+            EXPECT_EQ(fwrite(content.data(), 1, content.length(), fp), content.length());
+            fclose(fp);
+         }
+
+         return fname;
+      }
+
+      ///
+      /// @brief  Writes `content` into a temporary BGZF file, compressing at most
+      ///         `blksize` bytes per block, and returns the file path.
+      ///
+      std::string write_bgzf(const std::string& content, size_t blksize)
+      {
+         std::string fname = make_tmp_path(".log.gz");
+         std::vector<unsigned char> block(bgzf_reader_t::BGZF_MAX_BLOCK_SIZE);
+         FILE *fp = fopen(fname.c_str(), "wb");
+
+         EXPECT_NE(fp, nullptr);
+
+         // the last block is empty and serves as an end-of-file marker
+         for(size_t offset = 0; offset <= content.length(); offset += blksize) {
+            size_t usize = std::min(blksize, content.length() - offset);
+            uLong crc = crc32(crc32(0, nullptr, 0), (const Bytef*) content.data() + offset, (uInt) usize);
+            z_stream zs = {};
+            size_t bsize;
+
+            // gzip header with the BC subfield, followed by raw deflate data
+            static const unsigned char header[] = {0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0};
+
+            memcpy(block.data(), header, sizeof(header));
+
+            EXPECT_EQ(deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY), Z_OK);
+            zs.next_in = (Bytef*) content.data() + offset;
+            zs.avail_in = (uInt) usize;
+            zs.next_out = block.data() + sizeof(header);
+            zs.avail_out = (uInt) (block.size() - sizeof(header) - 8);
+            EXPECT_EQ(deflate(&zs, Z_FINISH), Z_STREAM_END);
+
+            bsize = sizeof(header) + zs.total_out + 8;
+            deflateEnd(&zs);
+
+            block[16] = (unsigned char) ((bsize - 1) & 0xff);
+            block[17] = (unsigned char) ((bsize - 1) >> 8);
+
+            for(size_t i = 0; i < 4; i++) {
+               block[bsize - 8 + i] = (unsigned char) (crc >> (i * 8));
+               block[bsize - 4 + i] = (unsigned char) (usize >> (i * 8));
+            }
+
+            EXPECT_EQ(fwrite(block.data(), 1, bsize, fp), bsize);
+         }
+
+         fclose(fp);
+
+         return fname;
+      }
+
+      ///
+      /// @brief  Reads all lines from the log file using line views.
+      ///
+      static std::vector<std::string> read_views(logfile_t& logfile, size_t maxlines = SIZE_MAX)
+      {
+         std::vector<std::string> lines;
+         const char *line;
+         size_t linelen;
+         int errnum = 0;
+
+         while(lines.size() < maxlines && logfile.get_line(line, linelen, &errnum) > 0)
+            lines.emplace_back(line, linelen);
+
+         EXPECT_EQ(errnum, 0);
+
+         return lines;
+      }
+
+      ///
+      /// @brief  Reads all lines from the log file in the stream read mode.
+      ///
+      static std::vector<std::string> read_stdio(logfile_t& logfile, size_t maxlines = SIZE_MAX)
+      {
+         std::vector<std::string> lines;
+         char buffer[1024];
+         int errnum = 0;
+
+         while(lines.size() < maxlines && logfile.get_line(buffer, sizeof(buffer), &errnum) > 0)
+            lines.emplace_back(buffer);
+
+         EXPECT_EQ(errnum, 0);
+
+         return lines;
+      }
+
+      ///
+      /// @brief  Generates `count` log lines of varying length.
+      ///
+      static std::string make_log(size_t count)
+      {
+         std::string content;
+
+         for(size_t i = 0; i < count; i++) {
+            content += "127.0.0.1 - - [01/Jan/2021:00:00:00 +0000] \"GET /page-" + std::to_string(i) + std::string(i % 97, 'x') + ".html HTTP/1.1\" 200 " + std::to_string(i * 31 % 10000) + "\n";
+         }
+
+         return content;
+      }
+};
+
+///
+/// @brief  Verifies that all read modes return identical lines for a small
+///         block buffer, which forces lines to straddle block boundaries.
+///
+TEST_F(LogFileTest, ReadModesMatch)
+{
+   std::string fname = write_log(make_log(5000));
+
+   logfile_t stdio_log(string_t(fname.c_str()), LOG_READ_STDIO);
+   logfile_t block_log(string_t(fname.c_str()), LOG_READ_BLOCK, logfile_t::LOG_MIN_BUF_SIZE);
+   logfile_t mmap_log(string_t(fname.c_str()), LOG_READ_MMAP);
+
+   ASSERT_EQ(stdio_log.open(), 0);
+   ASSERT_EQ(block_log.open(), 0);
+   ASSERT_EQ(mmap_log.open(), 0);
+
+   EXPECT_EQ(block_log.get_read_mode(), LOG_READ_BLOCK);
+
+#ifndef _WIN32
+   EXPECT_EQ(mmap_log.get_read_mode(), LOG_READ_MMAP);
+#endif
+
+   std::vector<std::string> stdio_lines = read_stdio(stdio_log);
+
+   EXPECT_EQ(stdio_lines.size(), 5000);
+   EXPECT_EQ(read_views(block_log), stdio_lines);
+   EXPECT_EQ(read_views(mmap_log), stdio_lines);
+
+   stdio_log.close();
+   block_log.close();
+   mmap_log.close();
+}
+
+///
+/// @brief  Verifies that the last line is returned even if it has no line
+///         terminator.
+///
+TEST_F(LogFileTest, NoTrailingNewLine)
+{
+   std::string fname = write_log("line 1\nline 2\nline 3");
+
+   for(log_read_mode_t mode : {LOG_READ_BLOCK, LOG_READ_MMAP}) {
+      logfile_t logfile(string_t(fname.c_str()), mode);
+
+      ASSERT_EQ(logfile.open(), 0);
+
+      std::vector<std::string> lines = read_views(logfile);
+
+      ASSERT_EQ(lines.size(), 3);
+      EXPECT_EQ(lines[0], "line 1\n");
+      EXPECT_EQ(lines[2], "line 3");
+
+      logfile.close();
+   }
+}
+
+///
+/// @brief  Verifies that lines longer than the block buffer are returned once,
+///         truncated, and that the rest of the line is skipped.
+///
+TEST_F(LogFileTest, LongLineTruncated)
+{
+   std::string longline(logfile_t::LOG_MIN_BUF_SIZE * 3, 'a');
+   std::string fname = write_log("line 1\n" + longline + "\nline 3\n");
+
+   logfile_t logfile(string_t(fname.c_str()), LOG_READ_BLOCK, logfile_t::LOG_MIN_BUF_SIZE);
+
+   ASSERT_EQ(logfile.open(), 0);
+
+   std::vector<std::string> lines = read_views(logfile);
+
+   ASSERT_EQ(lines.size(), 3);
+   EXPECT_EQ(lines[0], "line 1\n");
+   EXPECT_EQ(lines[1].length(), logfile_t::LOG_MIN_BUF_SIZE);
+   EXPECT_EQ(lines[2], "line 3\n");
+
+   logfile.close();
+}
+
+///
+/// @brief  Verifies that compressed log files are read in the block mode, even
+///         if memory-mapped files are requested.
+///
+TEST_F(LogFileTest, GzipBlockRead)
+{
+   std::string content = make_log(3000);
+   std::string fname = write_log(content);
+   std::string gzname = write_log(content, true);
+
+   logfile_t stdio_log(string_t(fname.c_str()), LOG_READ_STDIO);
+   logfile_t gzip_log(string_t(gzname.c_str()), LOG_READ_MMAP, logfile_t::LOG_MIN_BUF_SIZE);
+
+   ASSERT_EQ(stdio_log.open(), 0);
+   ASSERT_EQ(gzip_log.open(), 0);
+
+   EXPECT_TRUE(gzip_log.is_gzip());
+   EXPECT_EQ(gzip_log.get_read_mode(), LOG_READ_BLOCK);
+
+   EXPECT_EQ(read_views(gzip_log), read_stdio(stdio_log));
+
+   stdio_log.close();
+   gzip_log.close();
+}
+
+///
+/// @brief  Verifies that a log file closed in the middle resumes reading at the
+///         next unread line when it is reopened.
+///
+TEST_F(LogFileTest, ReopenOffset)
+{
+   std::string content = make_log(2000);
+   std::string fnames[] = {write_log(content), write_log(content, true)};
+
+   for(const std::string& fname : fnames) {
+      for(log_read_mode_t mode : {LOG_READ_STDIO, LOG_READ_BLOCK, LOG_READ_MMAP}) {
+         logfile_t logfile(string_t(fname.c_str()), mode, logfile_t::LOG_MIN_BUF_SIZE);
+         std::vector<std::string> lines;
+
+         ASSERT_EQ(logfile.open(), 0);
+         lines = mode == LOG_READ_STDIO ? read_stdio(logfile, 700) : read_views(logfile, 700);
+         logfile.set_reopen_offset();
+         logfile.close();
+
+         ASSERT_EQ(logfile.open(), 0);
+         std::vector<std::string> rest = mode == LOG_READ_STDIO ? read_stdio(logfile) : read_views(logfile);
+         logfile.close();
+
+         lines.insert(lines.end(), rest.begin(), rest.end());
+
+         ASSERT_EQ(lines.size(), 2000);
+         EXPECT_EQ(lines[700], "127.0.0.1 - - [01/Jan/2021:00:00:00 +0000] \"GET /page-700" + std::string(700 % 97, 'x') + ".html HTTP/1.1\" 200 " + std::to_string(700 * 31 % 10000) + "\n");
+      }
+   }
+}
+
+///
+/// @brief  Verifies that log files read ahead on a separate thread return the
+///         same lines, including after the log file is closed and reopened.
+///
+TEST_F(LogFileTest, ReadAhead)
+{
+   std::string content = make_log(5000);
+   std::string fnames[] = {write_log(content), write_log(content, true)};
+
+   for(const std::string& fname : fnames) {
+      logfile_t stdio_log(string_t(fname.c_str()), LOG_READ_STDIO);
+      logfile_t ra_log(string_t(fname.c_str()), LOG_READ_BLOCK, logfile_t::LOG_MIN_BUF_SIZE, 3);
+
+      ASSERT_EQ(stdio_log.open(), 0);
+      ASSERT_EQ(ra_log.open(), 0);
+
+      EXPECT_TRUE(ra_log.is_read_ahead());
+
+      std::vector<std::string> stdio_lines = read_stdio(stdio_log);
+      std::vector<std::string> lines = read_views(ra_log, 1200);
+
+      ASSERT_NE(ra_log.set_reopen_offset(), -1L);
+      ra_log.close();
+
+      EXPECT_FALSE(ra_log.is_read_ahead());
+
+      ASSERT_EQ(ra_log.open(), 0);
+      std::vector<std::string> rest = read_views(ra_log);
+      ra_log.close();
+
+      lines.insert(lines.end(), rest.begin(), rest.end());
+
+      EXPECT_EQ(lines, stdio_lines);
+
+      stdio_log.close();
+   }
+}
+
+///
+/// @brief  Verifies that log files are read ahead in the block mode if read-ahead
+///         is requested in the stdio read mode.
+///
+TEST_F(LogFileTest, ReadAheadStdio)
+{
+   std::string content = make_log(3000);
+   std::string fname = write_log(content);
+
+   logfile_t stdio_log(string_t(fname.c_str()), LOG_READ_STDIO);
+   logfile_t ra_log(string_t(fname.c_str()), LOG_READ_STDIO, logfile_t::LOG_MIN_BUF_SIZE, 2);
+
+   ASSERT_EQ(stdio_log.open(), 0);
+   ASSERT_EQ(ra_log.open(), 0);
+
+   EXPECT_EQ(ra_log.get_read_mode(), LOG_READ_BLOCK);
+   EXPECT_TRUE(ra_log.is_read_ahead());
+
+   EXPECT_EQ(read_views(ra_log), read_stdio(stdio_log));
+
+   ra_log.close();
+   stdio_log.close();
+}
+
+///
+/// @brief  Verifies that BGZF log files inflated on multiple threads return the
+///         same lines as zlib, including after the log file is reopened in the
+///         middle of a block.
+///
+TEST_F(LogFileTest, BgzfParallelInflate)
+{
+   std::string content = make_log(5000);
+   std::string fname = write_bgzf(content, 10000);
+
+   logfile_t stdio_log(string_t(fname.c_str()), LOG_READ_STDIO);
+   logfile_t bgzf_log(string_t(fname.c_str()), LOG_READ_BLOCK, logfile_t::LOG_MIN_BUF_SIZE, 0, 4);
+
+   ASSERT_EQ(stdio_log.open(), 0);
+   ASSERT_EQ(bgzf_log.open(), 0);
+
+   EXPECT_TRUE(bgzf_log.is_bgzf());
+   EXPECT_TRUE(bgzf_log.is_read_ahead());
+
+   std::vector<std::string> stdio_lines = read_stdio(stdio_log);
+   std::vector<std::string> lines = read_views(bgzf_log, 1234);
+
+   ASSERT_NE(bgzf_log.set_reopen_offset(), -1L);
+   bgzf_log.close();
+
+   ASSERT_EQ(bgzf_log.open(), 0);
+   std::vector<std::string> rest = read_views(bgzf_log);
+   bgzf_log.close();
+
+   lines.insert(lines.end(), rest.begin(), rest.end());
+
+   ASSERT_EQ(stdio_lines.size(), 5000);
+   EXPECT_EQ(lines, stdio_lines);
+
+   stdio_log.close();
+}
+
+///
+/// @brief  Verifies that regular gzip files are not treated as BGZF files when
+///         inflate threads are requested.
+///
+TEST_F(LogFileTest, GzipNotBgzf)
+{
+   std::string content = make_log(1000);
+   std::string gzname = write_log(content, true);
+
+   logfile_t gzip_log(string_t(gzname.c_str()), LOG_READ_BLOCK, logfile_t::LOG_MIN_BUF_SIZE, 0, 4);
+
+   ASSERT_EQ(gzip_log.open(), 0);
+
+   EXPECT_FALSE(gzip_log.is_bgzf());
+   EXPECT_TRUE(gzip_log.is_read_ahead());
+
+   EXPECT_EQ(read_views(gzip_log).size(), 1000);
+
+   gzip_log.close();
+}
+
+///
+/// @brief  Compares read times of all read modes for a larger log file.
+///
+/// This test reports elapsed times and does not fail if one mode is slower
+/// than another, because timings depend on the file system and on caching.
+/// It is disabled and may be run with `--gtest_also_run_disabled_tests` and
+/// `--gtest_filter=LogFileTest.DISABLED_ReadModeTiming`.
+///
+TEST_F(LogFileTest, DISABLED_ReadModeTiming)
+{
+   std::string fname = write_log(make_log(200000));
+   size_t stdio_count = 0;
+
+   for(log_read_mode_t mode : {LOG_READ_STDIO, LOG_READ_BLOCK, LOG_READ_MMAP}) {
+      logfile_t logfile(string_t(fname.c_str()), mode);
+      char buffer[1024];
+      const char *line;
+      size_t linelen;
+      size_t count = 0, bytes = 0;
+      int reclen;
+
+      ASSERT_EQ(logfile.open(), 0);
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+      if(mode == LOG_READ_STDIO) {
+         while((reclen = logfile.get_line(buffer, sizeof(buffer))) > 0)
+            count++, bytes += reclen;
+         stdio_count = count;
+      }
+      else {
+         while((reclen = logfile.get_line(line, linelen)) > 0)
+            count++, bytes += reclen;
+      }
+
+      std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+
+      logfile.close();
+
+      EXPECT_EQ(count, stdio_count);
+
+      printf("[          ] %-5s: %zu lines, %zu bytes, %.3f ms\n",
+            mode == LOG_READ_STDIO ? "stdio" : mode == LOG_READ_BLOCK ? "block" : "mmap",
+            count, bytes, std::chrono::duration<double, std::milli>(elapsed).count());
+   }
+}
+
+}
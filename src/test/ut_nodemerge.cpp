@@ -0,0 +1,114 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information 
+   
+   ut_nodemerge.cpp
+*/
+#include "pch.h"
+
+#include "../unode.h"
+#include "../hnode.h"
+#include "../rcnode.h"
+#include "../tstring.h"
+
+namespace sswtest {
+
+///
+/// @brief  Tests that URL counters are added up and that the average processing
+///         time is weighted by request counts.
+///
+TEST(NodeMerge, UrlCountersAndAverages)
+{
+   unode_t unode(string_t::hold("/index.html"), string_t()), srcnode(string_t::hold("/index.html"), string_t());
+
+   unode.count = 1;
+   unode.xfer = 100;
+   unode.entry = 1;
+   unode.avgtime = 4.;
+   unode.maxtime = 4.;
+
+   srcnode.count = 3;
+   srcnode.xfer = 300;
+   srcnode.exit = 2;
+   srcnode.avgtime = 8.;
+   srcnode.maxtime = 10.;
+
+   unode.merge(srcnode);
+
+   EXPECT_EQ(4, unode.count);
+   EXPECT_EQ(400, unode.xfer);
+   EXPECT_EQ(1, unode.entry);
+   EXPECT_EQ(2, unode.exit);
+   EXPECT_DOUBLE_EQ(7., unode.avgtime) << "The average must be weighted by request counts";
+   EXPECT_DOUBLE_EQ(10., unode.maxtime);
+
+   // merging a node without requests must not change the average
+   unode_t empty(string_t::hold("/index.html"), string_t());
+
+   unode.merge(empty);
+
+   EXPECT_EQ(4, unode.count);
+   EXPECT_DOUBLE_EQ(7., unode.avgtime);
+}
+
+///
+/// @brief  Tests that host visit averages are weighted by visit counts and that
+///         the host keeps its own DNS and GeoIP information.
+///
+TEST(NodeMerge, HostVisitsAndLocation)
+{
+   hnode_t hnode(string_t::hold("192.0.2.1")), srcnode(string_t::hold("192.0.2.1"));
+
+   hnode.count = 10;
+   hnode.visits = 3;
+   hnode.visit_avg = 60.;
+   hnode.visit_max = 120;
+   hnode.name = "host.example.com";
+
+   srcnode.count = 5;
+   srcnode.visits = 1;
+   srcnode.visits_conv = 1;
+   srcnode.visit_avg = 20.;
+   srcnode.visit_max = 20;
+   srcnode.robot = true;
+   srcnode.name = "other.example.com";
+   srcnode.set_ccode("ca");
+
+   hnode.merge(srcnode);
+
+   EXPECT_EQ(15, hnode.count);
+   EXPECT_EQ(4, hnode.visits);
+   EXPECT_EQ(1, hnode.visits_conv);
+   EXPECT_DOUBLE_EQ(50., hnode.visit_avg) << "The average must be weighted by visit counts";
+   EXPECT_EQ(120, hnode.visit_max);
+   EXPECT_TRUE(hnode.robot);
+   EXPECT_STREQ("host.example.com", hnode.name.c_str()) << "An existing host name must not be replaced";
+   EXPECT_STREQ("ca", hnode.ccode) << "A missing country code must be taken from the merged node";
+}
+
+///
+/// @brief  Tests that resetting an HTTP error node clears its key and data.
+///
+TEST(NodeMerge, ErrorNodeReset)
+{
+   rcnode_t rcnode(string_t::hold("GET"), string_t::hold("/missing"), 404), srcnode(string_t::hold("GET"), string_t::hold("/missing"), 404);
+
+   rcnode.count = 2;
+   srcnode.count = 3;
+
+   rcnode.merge(srcnode);
+
+   EXPECT_EQ(5, rcnode.count);
+
+   rcnode.reset(12);
+
+   EXPECT_EQ(12, rcnode.nodeid);
+   EXPECT_EQ(0, rcnode.count);
+   EXPECT_EQ(0, rcnode.respcode);
+   EXPECT_TRUE(rcnode.url.isempty() && rcnode.method.isempty());
+}
+
+}
@@ -10,9 +10,110 @@
 #include "pch.h"
 
 #include "../util_url.h"
+#include "../unicode.h"
+#include "../cp1252.h"
+
+#include <string>
+#include <random>
+#include <cstring>
 
 namespace sswtest {
 
+///
+/// @brief  A straightforward implementation of `norm_url_str` that evaluates one
+///         character at a time, which is used to check the results of the actual
+///         implementation.
+///
+static std::string norm_url_str_ref(const std::string& str)
+{
+   std::string decoded, out;
+   const char *cp1, *cp2;
+   size_t chsz;
+   char chr[2] = {0};
+
+   // find the first character that may need to be normalized
+   for(cp1 = str.c_str(); *cp1; cp1 += chsz) {
+      if((unsigned char) *cp1 < '\x20' || (unsigned char) *cp1 == '\x7F' || *cp1 == '%')
+         break;
+
+      if((chsz = utf8size(cp1)) == 0)
+         break;
+   }
+
+   if(!*cp1)
+      return str;
+
+   out.assign(str.c_str(), cp1 - str.c_str());
+
+   // decode URL-encoded sequences and fix misplaced % characters
+   for(cp2 = cp1; *cp2; ) {
+      if(*cp2 != '%') {
+         if((unsigned char) *cp2 < '\x20' || (unsigned char) *cp2 == '\x7F')
+            decoded += string_t::_format("%%%02X", (unsigned char) *cp2++).c_str();
+         else
+            decoded += *cp2++;
+      }
+      else {
+         cp2++;
+         if(string_t::isxdigit(*cp2) && string_t::isxdigit(*(cp2+1))) {
+            from_hex(cp2, chr);
+
+            if((unsigned char) *chr < '\x20' || (unsigned char) *chr == '\x7F' || strchr(":/?#[]@!$&'()*+,;=%", (unsigned char) *chr))
+               decoded += '%', decoded += string_t::toupper(*cp2++), decoded += string_t::toupper(*cp2++);
+            else
+               decoded += *chr, cp2 += 2;
+         }
+         else
+            decoded += "%25";
+      }
+   }
+
+   // convert all non-UTF-8 characters as if they are in CP1252
+   for(cp2 = decoded.c_str(); *cp2; ) {
+      if((chsz = utf8size(cp2)) == 0) {
+         char buffer[2];
+
+         cp1252utf8(cp2++, 1, buffer, sizeof(buffer), &chsz);
+         out.append(buffer, chsz);
+      }
+      else {
+         out.append(cp2, chsz);
+         cp2 += chsz;
+      }
+   }
+
+   return out;
+}
+
+///
+/// @brief  Returns a random string made of plain ASCII runs of different lengths,
+///         URL-encoded sequences, UTF-8, CP1252 and control characters.
+///
+static std::string random_url_str(std::mt19937& rng)
+{
+   static const char *parts[] = {
+      "%", "%4", "%41", "%2F", "%2f", "%25", "%00", "%7F", "%20", "%C3%A9", "%c3%a9", "%E9", "%E8%A8%98", "%F0%9F%98%80",
+      "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xA3", "\x80", "\xC0\xAF", "\xE0\x80\x80", "\xED\xA0\x80",
+      "\xF4\x90\x80\x80", "\xF5", "\xFF", "\xC3", "\xE2\x82", "\x01", "\x1F", "\x7F", "\t", "+", "?"
+   };
+   static const char plain[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-._~/?=&:;+ ";
+
+   std::string str;
+   size_t count = rng() % 8;
+
+   for(size_t index = 0; index < count; index++) {
+      // plain runs of up to 40 characters cross 16-byte blocks at different offsets
+      for(size_t length = rng() % 41; length; length--)
+         str += plain[rng() % (sizeof(plain) - 1)];
+
+      if(rng() % 4)
+         str += parts[rng() % (sizeof(parts) / sizeof(parts[0]))];
+   }
+
+   return str;
+}
+
+
 ///
 /// @brief  Normalize ASCII strings without URL-encoded characters
 ///
@@ -261,4 +362,27 @@ TEST(URLNormalizerTest, URLEncodeBufEndSpecialCharacter)
       EXPECT_STREQ(string_t::_format("12%%%02X", (unsigned char) *cp).c_str(), out.c_str());
    }
 }
+
+///
+/// @brief  Tests that random strings are normalized the same way as they are by
+///         the reference implementation, which evaluates one character at a time.
+///
+TEST(URLNormalizerTest, MatchesReference)
+{
+   std::mt19937 rng(12345);
+   string_t::char_buffer_t strbuf;
+
+   for(size_t index = 0; index < 100000; index++) {
+      std::string input = random_url_str(rng);
+      string_t str(input.c_str(), input.length());
+
+      norm_url_str(str, strbuf);
+
+      std::string expected = norm_url_str_ref(input);
+
+      ASSERT_EQ(expected.length(), str.length()) << "Input: " << input;
+      ASSERT_EQ(0, memcmp(expected.c_str(), str.c_str(), expected.length())) << "Input: " << input;
+   }
+}
+
 }
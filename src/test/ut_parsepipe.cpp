@@ -0,0 +1,190 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   ut_parsepipe.cpp
+*/
+#include "pch.h"
+
+#include "../parse_pipeline.h"
+#include "../parser.h"
+#include "../config.h"
+#include "../logrec.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace sswtest {
+
+///
+/// @brief  A test fixture that parses log lines on parser threads and compares
+///         the results against log records parsed on the calling thread.
+///
+class ParsePipelineTest : public testing::Test {
+   protected:
+      config_t    config;
+
+   protected:
+      ///
+      /// @brief  Copies log lines into a new batch with the specified parser
+      ///         snapshot and submits the batch to the pipeline.
+      ///
+      static parse_pipeline_t::batch_t *submit_lines(parse_pipeline_t& pipeline, const std::vector<std::string>& lines, size_t start, size_t count, const std::shared_ptr<const parser_t>& parser)
+      {
+         parse_pipeline_t::batch_t *batch = pipeline.get_batch();
+         size_t bufsize;
+         char *bufptr;
+
+         batch->parser = parser;
+
+         for(size_t index = start; index < start + count && index < lines.size(); index++) {
+            if((bufptr = batch->get_free_space(bufsize)) == nullptr || bufsize <= lines[index].length())
+               break;
+
+            memcpy(bufptr, lines[index].c_str(), lines[index].length() + 1);
+            batch->add_line(lines[index].length(), index);
+         }
+
+         pipeline.submit(batch);
+
+         return batch;
+      }
+
+      ///
+      /// @brief  Parses a log line on the calling thread.
+      ///
+      /// Log record fields may point into `buffer`, which must not be changed while
+      /// `logrec` is being used.
+      ///
+      static int parse_line(parser_t& parser, const std::string& line, std::vector<char>& buffer, log_struct& logrec)
+      {
+         buffer.assign(line.begin(), line.end());
+         buffer.push_back(0);
+
+         return parser.parse_record(buffer.data(), line.length(), logrec);
+      }
+
+      static void expect_logrec_eq(const log_struct& logrec1, const log_struct& logrec2, size_t index)
+      {
+         EXPECT_STREQ(logrec1.hostname.c_str(), logrec2.hostname.c_str()) << "log line " << index;
+         EXPECT_STREQ(logrec1.method.c_str(), logrec2.method.c_str()) << "log line " << index;
+         EXPECT_STREQ(logrec1.url.c_str(), logrec2.url.c_str()) << "log line " << index;
+         EXPECT_STREQ(logrec1.srchargs.c_str(), logrec2.srchargs.c_str()) << "log line " << index;
+         EXPECT_STREQ(logrec1.agent.c_str(), logrec2.agent.c_str()) << "log line " << index;
+         EXPECT_EQ(logrec1.resp_code, logrec2.resp_code) << "log line " << index;
+         EXPECT_EQ(logrec1.xfer_size, logrec2.xfer_size) << "log line " << index;
+         EXPECT_TRUE(logrec1.tstamp == logrec2.tstamp) << "log line " << index;
+      }
+};
+
+///
+/// @brief  Verifies that CLF log lines parsed on parser threads match those
+///         parsed on the calling thread, in the original order.
+///
+TEST_F(ParsePipelineTest, ParseCLFInOrder)
+{
+   std::vector<std::string> lines;
+   std::vector<parse_pipeline_t::batch_t*> batches;
+   parse_pipeline_t pipeline(config);
+   parser_t parser(config);
+   std::vector<char> buffer;
+   log_struct logrec;
+
+   config.log_type = LOG_CLF;
+
+   ASSERT_TRUE(parser.init_parser(config.log_type));
+
+   for(size_t index = 0; index < 5000; index++) {
+      // every 100th line is malformed
+      if(index % 100 == 99)
+         lines.push_back("bad log line " + std::to_string(index));
+      else
+         lines.push_back("192.168.1." + std::to_string(index % 250) + " - - [01/Jan/2021:10:" + std::to_string(10 + index % 50) + ":00 -0500] \"GET /page-" + std::to_string(index) + ".html?q=" + std::to_string(index) + " HTTP/1.1\" 200 " + std::to_string(index * 7));
+   }
+
+   std::shared_ptr<const parser_t> snapshot = std::make_shared<const parser_t>(parser);
+
+   pipeline.start(4, 1);
+
+   for(size_t start = 0; start < lines.size(); start += 300)
+      batches.push_back(submit_lines(pipeline, lines, start, 300, snapshot));
+
+   for(size_t bindex = 0; bindex < batches.size(); bindex++) {
+      parse_pipeline_t::batch_t& batch = *batches[bindex];
+
+      pipeline.wait(batch);
+
+      for(size_t index = 0; index < batch.lines.size(); index++) {
+         const parse_pipeline_t::batch_t::line_t& line = batch.lines[index];
+
+         ASSERT_EQ(line.recnum, bindex * 300 + index);
+
+         EXPECT_EQ(line.parse_code, parse_line(parser, lines[line.recnum], buffer, logrec)) << "log line " << line.recnum;
+
+         if(line.parse_code == PARSE_CODE_OK)
+            expect_logrec_eq(batch.logrecs[index], logrec, line.recnum);
+      }
+
+      pipeline.release_batch(&batch);
+   }
+
+   pipeline.stop();
+}
+
+///
+/// @brief  Verifies that batches submitted before a W3C `#Fields` directive are
+///         parsed with the field list that was in effect when they were filled.
+///
+TEST_F(ParsePipelineTest, W3CDirectiveSnapshot)
+{
+   // W3C log lines must keep their line terminators, as if read from a log file
+   std::vector<std::string> lines1 = {"2021-01-01 10:00:00 192.168.1.1 GET /a.html 200 1000\n"};
+   std::vector<std::string> lines2 = {"2021-01-01 10:00:01 GET /b.html 192.168.1.2 404 2000\n"};
+   parse_pipeline_t pipeline(config);
+   parser_t parser(config);
+   log_struct logrec;
+   char directive1[] = "#Fields: date time c-ip cs-method cs-uri-stem sc-status sc-bytes";
+   char directive2[] = "#Fields: date time cs-method cs-uri-stem c-ip sc-status sc-bytes";
+
+   config.log_type = LOG_W3C;
+
+   ASSERT_TRUE(parser.init_parser(config.log_type));
+
+   pipeline.start(2, 1);
+
+   EXPECT_TRUE(parser.is_directive(directive1));
+   EXPECT_EQ(parser.parse_record(directive1, strlen(directive1), logrec), PARSE_CODE_IGNORE);
+   std::shared_ptr<const parser_t> snapshot1 = std::make_shared<const parser_t>(parser);
+
+   parse_pipeline_t::batch_t *batch1 = submit_lines(pipeline, lines1, 0, 1, snapshot1);
+
+   // change the field order before the first batch is consumed
+   EXPECT_EQ(parser.parse_record(directive2, strlen(directive2), logrec), PARSE_CODE_IGNORE);
+   std::shared_ptr<const parser_t> snapshot2 = std::make_shared<const parser_t>(parser);
+
+   parse_pipeline_t::batch_t *batch2 = submit_lines(pipeline, lines2, 0, 1, snapshot2);
+
+   pipeline.wait(*batch1);
+   pipeline.wait(*batch2);
+
+   ASSERT_EQ(batch1->lines[0].parse_code, PARSE_CODE_OK);
+   EXPECT_STREQ(batch1->logrecs[0].hostname.c_str(), "192.168.1.1");
+   EXPECT_STREQ(batch1->logrecs[0].url.c_str(), "/a.html");
+
+   ASSERT_EQ(batch2->lines[0].parse_code, PARSE_CODE_OK);
+   EXPECT_STREQ(batch2->logrecs[0].hostname.c_str(), "192.168.1.2");
+   EXPECT_STREQ(batch2->logrecs[0].url.c_str(), "/b.html");
+   EXPECT_EQ(batch2->logrecs[0].resp_code, 404);
+
+   pipeline.release_batch(batch1);
+   pipeline.release_batch(batch2);
+
+   pipeline.stop();
+}
+
+}
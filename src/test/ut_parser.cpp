@@ -0,0 +1,663 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   ut_parser.cpp
+*/
+#include "pch.h"
+
+#include "../parser.h"
+#include "../delim_scanner.h"
+#include "../config.h"
+#include "../logrec.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <stdexcept>
+
+namespace sswtest {
+
+static const char *isa_names[] = {"scalar", "SSE4.2", "AVX2"};
+
+///
+/// @brief  Restores the instruction set used by delimiter scanners when a test
+///         goes out of scope.
+///
+class isa_guard_t {
+   private:
+      delim_scanner_t::isa_t isa;
+
+   public:
+      isa_guard_t(void) : isa(delim_scanner_t::get_isa()) {}
+
+      ~isa_guard_t(void) {delim_scanner_t::set_isa(isa);}
+};
+
+///
+/// @brief  Tests that delimiters and the terminating zero character are found
+///         at the same position with all supported instruction sets, including
+///         strings starting at any block offset and ending at a page boundary.
+///
+/// Each string is also scanned in a copy that fits it exactly, so AddressSanitizer
+/// builds report any characters read past the end of the string.
+///
+TEST(DelimScannerTests, MatchesScalarScan)
+{
+   isa_guard_t isa_guard;
+   std::mt19937 rng(12345);
+   const char chars[] = "abcdefgh \t\"[]()\\\r\n?\x80\xff";
+   const char *delim_sets[] = {" \t[]\"", "\\\r\n", "\"[]()\\\r\n", "", "0123456789ABCDE"};
+
+   // two pages, so strings may end right before the page boundary
+   std::vector<char> storage(4096 * 3);
+   char *page = storage.data() + (4096 - (uintptr_t) storage.data() % 4096);
+
+   for(const char *delims : delim_sets) {
+      delim_scanner_t scanner(delims);
+
+      for(size_t count = 0; count < 3000; count++) {
+         size_t length = rng() % 100;
+         size_t offset = (count % 2) ? rng() % 64 : 4096 - length - 1 - rng() % 40;
+
+         // fill memory before the string with delimiters, which must be ignored
+         memset(page, *delims ? *delims : 0, offset);
+
+         char *str = page + offset;
+
+         for(size_t index = 0; index < length; index++)
+            str[index] = (rng() % 4) ? chars[rng() % (sizeof(chars) - 1)] : (*delims ? delims[rng() % strlen(delims)] : 'x');
+
+         str[length] = 0;
+
+         delim_scanner_t::set_isa(delim_scanner_t::ISA_SCALAR);
+
+         const char *expected = str;
+
+         while(*expected && !strchr(delims, *expected))
+            expected++;
+
+         for(int isa = delim_scanner_t::ISA_SCALAR; isa <= delim_scanner_t::get_cpu_isa(); isa++) {
+            delim_scanner_t::set_isa((delim_scanner_t::isa_t) isa);
+
+            ASSERT_EQ(expected - str, scanner.find(str, str + length) - str) << isa_names[isa] << " scanner, delimiters \"" << delims << "\", string \"" << str << "\"";
+
+            std::unique_ptr<char[]> copy(new char[length + 1]);
+
+            memcpy(copy.get(), str, length + 1);
+
+            ASSERT_EQ(expected - str, scanner.find(copy.get(), copy.get() + length) - copy.get()) << isa_names[isa] << " scanner, delimiters \"" << delims << "\", copied string \"" << str << "\"";
+         }
+      }
+   }
+}
+
+///
+/// @brief  Tests that invalid delimiter sets are rejected.
+///
+TEST(DelimScannerTests, InvalidDelimiters)
+{
+   EXPECT_THROW(delim_scanner_t("0123456789ABCDEF"), std::logic_error) << "More than 15 delimiters should be rejected";
+   EXPECT_THROW(delim_scanner_t("a\x80"), std::logic_error) << "Non-ASCII delimiters should be rejected";
+   EXPECT_NO_THROW(delim_scanner_t("0123456789ABCDE"));
+}
+
+///
+/// @brief  A test fixture that parses the same log lines with all supported
+///         instruction sets and compares the results against the scalar parser.
+///
+class ParserTest : public testing::Test {
+   protected:
+      config_t    config;
+
+      std::mt19937 rng;
+
+      isa_guard_t isa_guard;
+
+   protected:
+      ParserTest(void) : rng(54321) {}
+
+      ///
+      /// @brief  Returns a random field value that may contain quotes, brackets,
+      ///         parentheses and escape sequences and, unless `nospace` is `true`,
+      ///         spaces and tabs.
+      ///
+      std::string random_text(size_t maxlen, bool nospace = false)
+      {
+         static const char *parts[] = {"Mozilla/5.0", "(X11;Linux)", "\\\"", "\\x41", "[", "]", "\"", "Gecko/20100101", "\\\\", "%20", "search?q=1&r=2", "-", " ", "\t"};
+         std::string text;
+         size_t count = rng() % maxlen;
+         size_t parts_size = sizeof(parts) / sizeof(parts[0]) - (nospace ? 2 : 0);
+
+         for(size_t index = 0; index < count; index++)
+            text += parts[rng() % parts_size];
+
+         return text;
+      }
+
+      static void expect_logrec_eq(const log_struct& logrec1, const log_struct& logrec2, const char *desc, size_t index)
+      {
+         EXPECT_STREQ(logrec1.hostname.c_str(), logrec2.hostname.c_str()) << desc << ", log line " << index;
+         EXPECT_STREQ(logrec1.ident.c_str(), logrec2.ident.c_str()) << desc << ", log line " << index;
+         EXPECT_STREQ(logrec1.method.c_str(), logrec2.method.c_str()) << desc << ", log line " << index;
+         EXPECT_STREQ(logrec1.url.c_str(), logrec2.url.c_str()) << desc << ", log line " << index;
+         EXPECT_STREQ(logrec1.srchargs.c_str(), logrec2.srchargs.c_str()) << desc << ", log line " << index;
+         EXPECT_STREQ(logrec1.refer.c_str(), logrec2.refer.c_str()) << desc << ", log line " << index;
+         EXPECT_STREQ(logrec1.xsrchstr.c_str(), logrec2.xsrchstr.c_str()) << desc << ", log line " << index;
+         EXPECT_STREQ(logrec1.agent.c_str(), logrec2.agent.c_str()) << desc << ", log line " << index;
+         EXPECT_EQ(logrec1.resp_code, logrec2.resp_code) << desc << ", log line " << index;
+         EXPECT_EQ(logrec1.xfer_size, logrec2.xfer_size) << desc << ", log line " << index;
+         EXPECT_EQ(logrec1.port, logrec2.port) << desc << ", log line " << index;
+         EXPECT_TRUE(logrec1.tstamp == logrec2.tstamp) << desc << ", log line " << index;
+      }
+
+      ///
+      /// @brief  Parses each log line with all supported instruction sets and
+      ///         compares log records to those produced by the scalar parser.
+      ///
+      void expect_isa_match(parser_t& parser, const std::vector<std::string>& lines)
+      {
+         log_struct logrec1, logrec2;
+         std::vector<char> buffer1, buffer2;
+         size_t parsed = 0;
+
+         for(size_t index = 0; index < lines.size(); index++) {
+            buffer1.assign(lines[index].begin(), lines[index].end());
+            buffer1.push_back(0);
+
+            delim_scanner_t::set_isa(delim_scanner_t::ISA_SCALAR);
+
+            int rc1 = parser.parse_record(buffer1.data(), lines[index].length(), logrec1);
+
+            if(rc1 == PARSE_CODE_OK)
+               parsed++;
+
+            for(int isa = delim_scanner_t::ISA_SSE42; isa <= delim_scanner_t::get_cpu_isa(); isa++) {
+               delim_scanner_t::set_isa((delim_scanner_t::isa_t) isa);
+
+               buffer2.assign(lines[index].begin(), lines[index].end());
+               buffer2.push_back(0);
+
+               int rc2 = parser.parse_record(buffer2.data(), lines[index].length(), logrec2);
+
+               ASSERT_EQ(rc1, rc2) << isa_names[isa] << ", log line " << index << ": " << lines[index];
+
+               if(rc1 != PARSE_CODE_OK)
+                  continue;
+
+               expect_logrec_eq(logrec1, logrec2, isa_names[isa], index);
+            }
+         }
+
+         // make sure that most log lines were parsed and not just rejected
+         EXPECT_GT(parsed, lines.size() / 2);
+      }
+
+      std::string clf_line(size_t index)
+      {
+         return "192.168.1." + std::to_string(index % 250) + " - user" + std::to_string(index % 7) + " [01/Jan/2021:10:" + std::to_string(10 + index % 50) + ":00 -0500] \"GET /page-" + std::to_string(index) + ".html?q=" + random_text(4, true) + " HTTP/1.1\" 200 " + std::to_string(index * 7);
+      }
+};
+
+TEST_F(ParserTest, CLFMatchesScalar)
+{
+   std::vector<std::string> lines;
+   parser_t parser(config);
+
+   config.log_type = LOG_CLF;
+
+   ASSERT_TRUE(parser.init_parser(config.log_type));
+
+   for(size_t index = 0; index < 3000; index++)
+      lines.push_back(clf_line(index) + "\n");
+
+   expect_isa_match(parser, lines);
+}
+
+TEST_F(ParserTest, ApacheMatchesScalar)
+{
+   std::vector<std::string> lines;
+
+   config.log_type = LOG_APACHE;
+   config.apache_log_format = "%h %l %u %t \"%r\" %>s %b \"%{Referer}i\" \"%{User-Agent}i\"";
+
+   parser_t parser(config);
+
+   ASSERT_TRUE(parser.init_parser(config.log_type));
+
+   for(size_t index = 0; index < 3000; index++)
+      lines.push_back(clf_line(index) + " \"http://example.com/" + random_text(4) + "\" \"" + random_text(8) + "\"\n");
+
+   expect_isa_match(parser, lines);
+}
+
+TEST_F(ParserTest, W3CMatchesScalar)
+{
+   std::vector<std::string> lines;
+   parser_t parser(config);
+
+   config.log_type = LOG_W3C;
+
+   ASSERT_TRUE(parser.init_parser(config.log_type));
+
+   lines.push_back("#Fields: date time c-ip cs-method cs-uri-stem cs-uri-query sc-status sc-bytes cs(User-Agent) cs(Referer)");
+
+   for(size_t index = 0; index < 3000; index++)
+      lines.push_back("2021-01-01 10:" + std::to_string(10 + index % 50) + ":00 10.0.0." + std::to_string(index % 250) + " GET /page-" + std::to_string(index) + ".html q=" + std::to_string(index) + " 200 " + std::to_string(index * 3) + " Mozilla/5.0+(" + random_text(3, true) + ") http://example.com/" + random_text(3, true) + "\n");
+
+   expect_isa_match(parser, lines);
+}
+
+TEST_F(ParserTest, SquidMatchesScalar)
+{
+   std::vector<std::string> lines;
+   parser_t parser(config);
+
+   config.log_type = LOG_SQUID;
+
+   ASSERT_TRUE(parser.init_parser(config.log_type));
+
+   for(size_t index = 0; index < 3000; index++)
+      lines.push_back("1609513200." + std::to_string(100 + index % 900) + " " + std::to_string(index % 500) + " 172.16.0." + std::to_string(index % 250) + " TCP_MISS/200 " + std::to_string(index * 11) + " GET http://example.com/" + random_text(3, true) + " - DIRECT/1.2.3.4 text/html\n");
+
+   expect_isa_match(parser, lines);
+}
+
+///
+/// @brief  Tests that log record fields point into the log line buffer, unless
+///         they grow during normalization, and that resetting a log record does
+///         not write into the buffer.
+///
+TEST_F(ParserTest, FieldsAreLineViews)
+{
+   std::string line = "192.168.1.1 - - [01/Jan/2021:10:00:00 -0500] \"GET /a%41b.html?x=%zz HTTP/1.1\" 200 123 \"http://example.com/\" \"Mozilla/5.0\"\n";
+   std::vector<char> buffer(line.begin(), line.end());
+   parser_t parser(config);
+   log_struct logrec;
+
+   buffer.push_back(0);
+
+   config.log_type = LOG_CLF;
+
+   ASSERT_TRUE(parser.init_parser(config.log_type));
+
+   ASSERT_EQ(PARSE_CODE_OK, parser.parse_record(buffer.data(), line.length(), logrec));
+
+   auto in_buffer = [&buffer](const string_t& field) -> bool
+   {
+      return field.c_str() >= buffer.data() && field.c_str() < buffer.data() + buffer.size();
+   };
+
+   EXPECT_STREQ("192.168.1.1", logrec.hostname.c_str());
+   EXPECT_TRUE(in_buffer(logrec.hostname));
+   EXPECT_EQ(ipaddr_t::IPV4, logrec.hostaddr.get_family());
+
+   EXPECT_STREQ("GET", logrec.method.c_str());
+   EXPECT_TRUE(in_buffer(logrec.method));
+
+   // URL-decoded in place
+   EXPECT_STREQ("/aAb.html", logrec.url.c_str());
+   EXPECT_TRUE(in_buffer(logrec.url));
+
+   // the misplaced percent character is URL-encoded and doesn't fit into the line
+   EXPECT_STREQ("x=%25zz", logrec.srchargs.c_str());
+   EXPECT_FALSE(in_buffer(logrec.srchargs));
+
+   EXPECT_STREQ("http://example.com/", logrec.refer.c_str());
+   EXPECT_TRUE(in_buffer(logrec.refer));
+
+   EXPECT_STREQ("Mozilla/5.0", logrec.agent.c_str());
+   EXPECT_TRUE(in_buffer(logrec.agent));
+
+   std::vector<char> parsed(buffer);
+
+   logrec.reset();
+
+   EXPECT_TRUE(parsed == buffer) << "Resetting a log record should not change the log line buffer";
+
+   EXPECT_TRUE(logrec.hostname.isempty() && logrec.url.isempty() && logrec.srchargs.isempty() && logrec.agent.isempty());
+   EXPECT_TRUE(logrec.hostaddr.isempty());
+}
+
+///
+/// @brief  Tests that IPv6 host addresses are replaced with their canonical text,
+///         so all spellings of an address are stored and looked up as one host.
+///
+TEST_F(ParserTest, CanonicalIPv6Hosts)
+{
+   static const char *hosts[][2] = {
+      {"2001:db8::1", "2001:db8::1"},
+      {"2001:DB8:0:0:0:0:0:1", "2001:db8::1"},
+      {"2001:0db8:0000::0001", "2001:db8::1"},
+      {"::ffff:c000:280", "::ffff:192.0.2.128"},
+      {"1::2:3:4:5:6:7", "1:0:2:3:4:5:6:7"},
+      {"192.0.2.1", "192.0.2.1"},
+      {"Host.Example.COM", "host.example.com"}
+   };
+
+   parser_t parser(config);
+   log_struct logrec;
+
+   config.log_type = LOG_CLF;
+
+   ASSERT_TRUE(parser.init_parser(config.log_type));
+
+   for(size_t index = 0; index < sizeof(hosts) / sizeof(hosts[0]); index++) {
+      std::string line = std::string(hosts[index][0]) + " - - [01/Jan/2021:10:00:00 -0500] \"GET /index.html HTTP/1.1\" 200 123\n";
+      std::vector<char> buffer(line.begin(), line.end());
+
+      buffer.push_back(0);
+
+      ASSERT_EQ(PARSE_CODE_OK, parser.parse_record(buffer.data(), line.length(), logrec)) << hosts[index][0];
+      EXPECT_STREQ(hosts[index][1], logrec.hostname.c_str()) << hosts[index][0];
+
+      logrec.reset();
+   }
+}
+
+///
+/// @brief  Tests that referrers, referrer query strings and user agents are
+///         only stored if the configuration uses them.
+///
+TEST_F(ParserTest, FieldDemand)
+{
+   std::string line = "192.168.1.1 - - [01/Jan/2021:10:00:00 -0500] \"GET /a.html HTTP/1.1\" 200 123 \"http://www.google.com/search?q=test\" \"Mozilla/5.0\"\n";
+   std::vector<char> buffer;
+   log_struct logrec;
+
+   auto parse_line = [&](log_type_t log_type) -> void
+   {
+      parser_t parser(config);
+
+      buffer.assign(line.begin(), line.end());
+      buffer.push_back(0);
+
+      config.log_type = log_type;
+      config.apache_log_format = "%h %l %u %t \"%r\" %>s %b \"%{Referer}i\" \"%{User-Agent}i\"";
+
+      logrec.reset();
+
+      ASSERT_TRUE(parser.init_parser(config.log_type));
+      ASSERT_EQ(PARSE_CODE_OK, parser.parse_record(buffer.data(), line.length(), logrec));
+
+      EXPECT_STREQ("/a.html", logrec.url.c_str());
+      EXPECT_EQ(123, logrec.xfer_size);
+   };
+
+   for(log_type_t log_type : {LOG_CLF, LOG_APACHE}) {
+      // top referrers and user agents are reported by default
+      parse_line(log_type);
+
+      EXPECT_STREQ("http://www.google.com/search", logrec.refer.c_str());
+      EXPECT_STREQ("Mozilla/5.0", logrec.agent.c_str());
+      EXPECT_TRUE(logrec.xsrchstr.isempty()) << "Referrer query strings are only used to find search terms";
+
+      config.ntop_refs = 0;
+      config.ntop_agents = 0;
+
+      parse_line(log_type);
+
+      EXPECT_TRUE(logrec.refer.isempty() && logrec.xsrchstr.isempty() && logrec.agent.isempty());
+
+      // search terms require referrers and their query strings
+      config.search_list.add_glist("www.google.\t   q=");
+
+      parse_line(log_type);
+
+      EXPECT_STREQ("http://www.google.com/search", logrec.refer.c_str());
+      EXPECT_STREQ("q=test", logrec.xsrchstr.c_str());
+      EXPECT_TRUE(logrec.agent.isempty());
+
+      config.search_list.clear();
+
+      // robot patterns are matched against user agents
+      config.robots.add_glist("Googlebot*\tGooglebot");
+
+      parse_line(log_type);
+
+      EXPECT_TRUE(logrec.refer.isempty());
+      EXPECT_STREQ("Mozilla/5.0", logrec.agent.c_str());
+
+      config.robots.clear();
+      config.ntop_refs = 30;
+      config.ntop_agents = 15;
+   }
+}
+
+///
+/// @brief  Tests that CLF time stamps that reuse the date and hour of the previous
+///         time stamp are parsed the same way as those parsed from scratch.
+///
+TEST_F(ParserTest, CachedCLFTimeStamps)
+{
+   const char *tstamps[] = {
+      "[01/Jan/2021:10:00:00 -0500]",
+      "[01/Jan/2021:10:00:01 -0500]",
+      "[01/Jan/2021:10:59:59 -0500]",
+      "[01/Jan/2021:10:60:00 -0500]",     // invalid minutes
+      "[01/Jan/2021:10:05:6x -0500]",     // parsed as 6 seconds
+      "[01/Jan/2021:10:5x:00 -0500]",     // parsed as 5 minutes
+      "[01/Jan/2021:10:07:00 +0200]",     // different UTC offset
+      "[01/Jan/2021:11:07:00 +0200]",
+      "[01/jan/2021:11:08:00 +0200]",     // case-insensitive month
+      "[02/Jan/2021:11:09:00 +0200]",
+      "[02/Jan/2021:11:10:00 +0200]",
+      "[02/Feb/2021:11:10:00 +0200]",
+      "[02/Feb/2022:11:10:00 +0200]",
+      "[02/Feb/2022:11:10:59 +0200]",
+      "[02/Xyz/2022:11:10:59 +0200]",     // invalid month
+   };
+
+   parser_t cached_parser(config);
+
+   config.log_type = LOG_CLF;
+
+   ASSERT_TRUE(cached_parser.init_parser(config.log_type));
+
+   for(const char *tstamp : tstamps) {
+      std::string line = std::string("192.168.1.1 - - ") + tstamp + " \"GET / HTTP/1.1\" 200 123\n";
+      std::vector<char> buffer1(line.begin(), line.end()), buffer2(line.begin(), line.end());
+      log_struct logrec1, logrec2;
+      parser_t parser(config);
+
+      buffer1.push_back(0);
+      buffer2.push_back(0);
+
+      ASSERT_TRUE(parser.init_parser(config.log_type));
+
+      int retval = parser.parse_record(buffer1.data(), line.length(), logrec1);
+
+      ASSERT_EQ(retval, cached_parser.parse_record(buffer2.data(), line.length(), logrec2)) << tstamp;
+
+      if(retval == PARSE_CODE_OK) {
+         EXPECT_TRUE(logrec1.tstamp.year == logrec2.tstamp.year && logrec1.tstamp.month == logrec2.tstamp.month &&
+               logrec1.tstamp.day == logrec2.tstamp.day && logrec1.tstamp.hour == logrec2.tstamp.hour &&
+               logrec1.tstamp.min == logrec2.tstamp.min && logrec1.tstamp.sec == logrec2.tstamp.sec &&
+               logrec1.tstamp.offset == logrec2.tstamp.offset && logrec1.tstamp.utc == logrec2.tstamp.utc) << tstamp;
+      }
+   }
+}
+
+///
+/// @brief  Tests that standard Apache log formats are parsed by generated parsers
+///         with the same results as those produced by the interpreted parser.
+///
+TEST_F(ParserTest, StdApacheFormats)
+{
+   struct format_t {
+      const char *format;
+      const char *prefix;
+      const char *suffix;
+   } formats[] = {
+      {"%h %l %u %t \"%r\" %>s %b", "", ""},
+      {"%a %l %u %t \"%r\" %s %B", "", ""},
+      {"%h %l %u %t \"%r\" %>s %b \"%{Referer}i\" \"%{User-agent}i\"", "", "combined"},
+      {"%v:%p %h %l %u %t \"%r\" %>s %O \"%{Referer}i\" \"%{User-Agent}i\"", "www.example.com:8080 ", "combined"}
+   };
+
+   log_struct logrec1, logrec2;
+   std::vector<char> buffer1, buffer2;
+
+   config.log_type = LOG_APACHE;
+
+   for(const format_t& format : formats) {
+      std::vector<std::string> lines;
+      parser_t parser(config);
+      size_t parsed = 0;
+
+      config.apache_log_format = format.format;
+
+      ASSERT_TRUE(parser.init_parser(config.log_type));
+
+      parser_t::apache_parser_t apache_parser = parser.apache_parser;
+
+      ASSERT_TRUE(apache_parser != nullptr) << "A generated parser should be selected for " << format.format;
+
+      for(size_t index = 0; index < 2000; index++) {
+         std::string line = format.prefix + clf_line(index);
+
+         if(*format.suffix)
+            line += " \"http://example.com/" + random_text(4) + "\" \"" + random_text(8) + "\"";
+
+         // a few log lines have too few or too many fields
+         if(index % 50 == 7)
+            line += " extra";
+         else if(index % 50 == 9)
+            line.erase(line.rfind(' '));
+
+         lines.push_back(line + "\n");
+      }
+
+      for(size_t index = 0; index < lines.size(); index++) {
+         buffer1.assign(lines[index].begin(), lines[index].end());
+         buffer1.push_back(0);
+
+         parser.apache_parser = apache_parser;
+
+         int rc1 = parser.parse_record(buffer1.data(), lines[index].length(), logrec1);
+
+         buffer2.assign(lines[index].begin(), lines[index].end());
+         buffer2.push_back(0);
+
+         parser.apache_parser = nullptr;
+
+         int rc2 = parser.parse_record(buffer2.data(), lines[index].length(), logrec2);
+
+         ASSERT_EQ(rc2, rc1) << format.format << ", log line " << index << ": " << lines[index];
+
+         if(rc1 == PARSE_CODE_OK) {
+            expect_logrec_eq(logrec2, logrec1, format.format, index);
+
+            if(*format.prefix)
+               EXPECT_EQ(8080, logrec1.port) << "log line " << index;
+
+            parsed++;
+         }
+      }
+
+      EXPECT_GT(parsed, lines.size() / 2) << format.format;
+   }
+
+   // other formats are interpreted
+   parser_t parser(config);
+
+   config.apache_log_format = "%h %l %u %t \"%r\" %>s %b %D";
+
+   ASSERT_TRUE(parser.init_parser(config.log_type));
+
+   EXPECT_TRUE(parser.apache_parser == nullptr);
+}
+
+///
+/// @brief  Tests that Apache combined log lines with long fields, which span many
+///         SIMD blocks, are split into the same fields with each supported
+///         instruction set.
+///
+TEST_F(ParserTest, LongFieldsMatchScalar)
+{
+   static const char *agent = "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/90.0.4430.93 Safari/537.36";
+   std::vector<std::string> lines;
+   std::vector<char> buffer;
+   log_struct logrec;
+
+   config.log_type = LOG_APACHE;
+   config.apache_log_format = "%h %l %u %t \"%r\" %>s %b \"%{Referer}i\" \"%{User-Agent}i\"";
+
+   parser_t parser(config);
+
+   ASSERT_TRUE(parser.init_parser(config.log_type));
+
+   for(size_t index = 0; index < 1000; index++)
+      lines.push_back("192.168.1." + std::to_string(index % 250) + " - - [01/Jan/2021:10:" + std::to_string(10 + index % 50) + ":00 -0500] \"GET /images/products/page-" + std::to_string(index) + ".png?v=" + std::to_string(index) + " HTTP/1.1\" 200 " + std::to_string(index * 7) + " \"https://www.example.com/catalog/category-" + std::to_string(index % 20) + "/index.html\" \"" + agent + "\"\n");
+
+   expect_isa_match(parser, lines);
+
+   // all fields must be found, not just be equally wrong for all instruction sets
+   for(int isa = delim_scanner_t::ISA_SCALAR; isa <= delim_scanner_t::get_cpu_isa(); isa++) {
+      delim_scanner_t::set_isa((delim_scanner_t::isa_t) isa);
+
+      for(size_t index = 0; index < lines.size(); index += 97) {
+         buffer.assign(lines[index].begin(), lines[index].end());
+         buffer.push_back(0);
+
+         ASSERT_EQ(PARSE_CODE_OK, parser.parse_record(buffer.data(), lines[index].length(), logrec)) << isa_names[isa] << ", log line " << index;
+
+         EXPECT_STREQ(("/images/products/page-" + std::to_string(index) + ".png").c_str(), logrec.url.c_str()) << isa_names[isa] << ", log line " << index;
+         EXPECT_STREQ(("https://www.example.com/catalog/category-" + std::to_string(index % 20) + "/index.html").c_str(), logrec.refer.c_str()) << isa_names[isa] << ", log line " << index;
+         EXPECT_STREQ(agent, logrec.agent.c_str()) << isa_names[isa] << ", log line " << index;
+         EXPECT_EQ(index * 7, logrec.xfer_size) << isa_names[isa] << ", log line " << index;
+      }
+   }
+}
+
+///
+/// @brief  Reports the time it takes to parse Apache combined log lines with
+///         each supported instruction set.
+///
+/// This test reports elapsed times and does not fail if one instruction set is
+/// slower than another. It is disabled and may be run with
+/// `--gtest_also_run_disabled_tests` and `--gtest_filter=ParserTest.DISABLED_ParseTiming`.
+///
+TEST_F(ParserTest, DISABLED_ParseTiming)
+{
+   std::vector<std::string> lines;
+   std::vector<char> buffer;
+   log_struct logrec;
+
+   config.log_type = LOG_APACHE;
+   config.apache_log_format = "%h %l %u %t \"%r\" %>s %b \"%{Referer}i\" \"%{User-Agent}i\"";
+
+   parser_t parser(config);
+
+   ASSERT_TRUE(parser.init_parser(config.log_type));
+
+   for(size_t index = 0; index < 1000; index++)
+      lines.push_back("192.168.1." + std::to_string(index % 250) + " - - [01/Jan/2021:10:" + std::to_string(10 + index % 50) + ":00 -0500] \"GET /images/products/page-" + std::to_string(index) + ".png?v=" + std::to_string(index) + " HTTP/1.1\" 200 " + std::to_string(index * 7) + " \"https://www.example.com/catalog/category-" + std::to_string(index % 20) + "/index.html\" \"Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/90.0.4430.93 Safari/537.36\"\n");
+
+   for(int isa = delim_scanner_t::ISA_SCALAR; isa <= delim_scanner_t::get_cpu_isa(); isa++) {
+      delim_scanner_t::set_isa((delim_scanner_t::isa_t) isa);
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+      for(size_t pass = 0; pass < 100; pass++) {
+         for(size_t index = 0; index < lines.size(); index++) {
+            buffer.assign(lines[index].begin(), lines[index].end());
+            buffer.push_back(0);
+
+            ASSERT_EQ(PARSE_CODE_OK, parser.parse_record(buffer.data(), lines[index].length(), logrec));
+         }
+      }
+
+      double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+      printf("[          ] %s: %.3f us per log line\n", isa_names[isa], elapsed / (100 * lines.size()));
+   }
+}
+
+}
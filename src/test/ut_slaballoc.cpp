@@ -0,0 +1,107 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   ut_slaballoc.cpp
+*/
+#include "pch.h"
+
+#include "../slab_allocator.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace sswtest {
+
+///
+/// @brief  Tests that released blocks are reused before new blocks are carved out
+///         of a slab.
+///
+TEST(SlabAllocatorTests, ReuseReleasedBlocks)
+{
+   slab_allocator_t<24, 8> slab;
+
+   void *block1 = slab.allocate();
+   void *block2 = slab.allocate();
+
+   EXPECT_EQ((uintptr_t) block1 + slab.block_size, (uintptr_t) block2) << "Blocks should be carved out of a slab sequentially";
+   EXPECT_EQ(0, (uintptr_t) block2 % 8) << "Blocks should be aligned";
+
+   slab.deallocate(block1);
+
+   EXPECT_EQ(block1, slab.allocate()) << "A released block should be allocated first";
+   EXPECT_EQ(2, slab.get_used());
+
+   slab.deallocate(block1);
+   slab.deallocate(block2);
+
+   EXPECT_EQ(0, slab.get_used());
+}
+
+///
+/// @brief  Tests that all slabs except the first one are freed once all blocks
+///         are released.
+///
+TEST(SlabAllocatorTests, ReleaseSlabs)
+{
+   slab_allocator_t<36, 8> slab;
+   std::vector<void*> blocks;
+
+   EXPECT_EQ(40, slab.block_size) << "Block size should be rounded up to the alignment";
+
+   for(size_t i = 0; i < slab.slab_blocks * 3; i++)
+      blocks.push_back(slab.allocate());
+
+   EXPECT_EQ(3, slab.get_slab_count());
+   EXPECT_EQ(slab.slab_blocks * 3, slab.get_used());
+
+   for(size_t i = 0; i < blocks.size() - 1; i++)
+      slab.deallocate(blocks[i]);
+
+   EXPECT_EQ(3, slab.get_slab_count()) << "Slabs should not be freed while any blocks are in use";
+
+   slab.deallocate(blocks.back());
+
+   EXPECT_EQ(1, slab.get_slab_count()) << "Only the first slab should remain once all blocks are released";
+   EXPECT_EQ(blocks.front(), slab.allocate()) << "Blocks should be carved out from the start of the first slab";
+}
+
+///
+/// @brief  Tests that all blocks can be released at once without returning each
+///         one to the free list.
+///
+TEST(SlabAllocatorTests, ClearAllBlocks)
+{
+   slab_allocator_t<24, 8> slab;
+   void *first = nullptr;
+
+   for(size_t i = 0; i < slab.slab_blocks * 2 + 1; i++) {
+      void *block = slab.allocate();
+
+      if(!first)
+         first = block;
+   }
+
+   EXPECT_EQ(3, slab.get_slab_count());
+
+   slab.clear();
+
+   EXPECT_EQ(0, slab.get_used());
+   EXPECT_EQ(1, slab.get_slab_count()) << "Only the first slab should remain after all blocks are released";
+   EXPECT_EQ(first, slab.allocate()) << "Blocks should be carved out from the start of the first slab";
+   EXPECT_EQ(1, slab.get_used());
+
+   // clearing an allocator without slabs should not carve blocks out of a missing slab
+   slab_allocator_t<24, 8> empty;
+
+   empty.clear();
+
+   EXPECT_EQ(0, empty.get_slab_count());
+   EXPECT_NE(nullptr, empty.allocate());
+   EXPECT_EQ(1, empty.get_slab_count());
+}
+
+}
@@ -0,0 +1,95 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   ut_topnodes.cpp
+*/
+#include "pch.h"
+
+#include "../top_nodes.h"
+
+#include <vector>
+#include <algorithm>
+
+namespace sswtest {
+
+///
+/// @brief  Tests that the highest values are selected from values added in an order
+///         that replaces selected nodes often and that they are sorted from the top.
+///
+TEST(TopNodesTest, SelectHighestValues)
+{
+   top_nodes_t top_nodes;
+   std::vector<uint64_t> values;
+
+   top_nodes.reset(10);
+
+   // interleave increasing and decreasing values
+   for(uint64_t i = 1; i <= 500; i++) {
+      values.push_back(i * 3);
+      values.push_back(10000 - i * 7);
+   }
+
+   for(size_t i = 0; i < values.size(); i++)
+      top_nodes.add(values[i], i + 1);
+
+   ASSERT_EQ(10, top_nodes.size()) << "No more than the requested number of nodes should be selected";
+
+   top_nodes.sort();
+
+   std::sort(values.begin(), values.end(), [] (uint64_t value1, uint64_t value2) {return value1 > value2;});
+
+   for(size_t i = 0; i < top_nodes.size(); i++) {
+      EXPECT_EQ(values[i], top_nodes.get_value(i)) << "Selected values should be sorted in descending order";
+
+      // node IDs were assigned in the order of values, starting from one
+      EXPECT_EQ(i * 2 + 2, top_nodes.get_nodeid(i)) << "Each value should be reported with its node ID";
+   }
+}
+
+///
+/// @brief  Tests that nodes with equal values are ranked by node IDs in either order
+///         and that a selection with no capacity ignores all nodes.
+///
+TEST(TopNodesTest, EqualValues)
+{
+   top_nodes_t top_nodes;
+
+   // descending node IDs
+   top_nodes.reset(3);
+
+   for(uint64_t nodeid = 1; nodeid <= 6; nodeid++)
+      top_nodes.add(nodeid == 2 ? 20 : 10, nodeid);
+
+   top_nodes.sort();
+
+   ASSERT_EQ(3, top_nodes.size());
+   EXPECT_EQ(2, top_nodes.get_nodeid(0)) << "The highest value should be ranked first";
+   EXPECT_EQ(6, top_nodes.get_nodeid(1)) << "Equal values should be ranked by descending node IDs";
+   EXPECT_EQ(5, top_nodes.get_nodeid(2)) << "Equal values should be ranked by descending node IDs";
+
+   // ascending node IDs
+   top_nodes.reset(3, true);
+
+   for(uint64_t nodeid = 6; nodeid >= 1; nodeid--)
+      top_nodes.add(nodeid == 5 ? 20 : 10, nodeid);
+
+   top_nodes.sort();
+
+   ASSERT_EQ(3, top_nodes.size());
+   EXPECT_EQ(5, top_nodes.get_nodeid(0)) << "The highest value should be ranked first";
+   EXPECT_EQ(1, top_nodes.get_nodeid(1)) << "Equal values should be ranked by ascending node IDs";
+   EXPECT_EQ(2, top_nodes.get_nodeid(2)) << "Equal values should be ranked by ascending node IDs";
+
+   // no capacity
+   top_nodes.reset(0);
+
+   top_nodes.add(10, 1);
+
+   EXPECT_EQ(0, top_nodes.size()) << "A selection without capacity should ignore all nodes";
+}
+
+}
@@ -11,7 +11,13 @@
 
 #include "../tstamp.h"
 #include "../tstring.h"
+#include "../tstamp_cache.h"
+#include "../config.h"
+
 #include <ctime>
+#include <chrono>
+#include <cstdio>
+#include <vector>
 
 //
 // TimeStampTest
@@ -492,5 +498,170 @@ TEST_F(TimeStampTest, CompareSameComponentsDiffTimeZones)
    EXPECT_EQ(tstamp_utc, tstamp);
 }
 
+///
+/// @brief  Converts time stamps with and without a time stamp cache and checks
+///         that the results are the same.
+///
+/// Time stamps are generated `step` seconds apart, starting at `start`, and are
+/// converted in the order they were generated, like log record time stamps.
+///
+static void check_tstamp_cache(const config_t& config, const tstamp_t& start, u_int count, u_int step)
+{
+   tstamp_cache_t tstamp_cache(config);
+   tm_ranges_t::iterator dst_iter = config.dst_ranges.begin();
+   tstamp_t tstamp(start);
+
+   for(u_int index = 0; index < count; index++) {
+      tstamp_t cached(tstamp), expected(tstamp);
+
+      int64_t time = tstamp_cache.convert(cached);
+
+      if(config.local_time != expected.islocal()) {
+         if(config.local_time)
+            expected.tolocal(config.get_utc_offset(expected, dst_iter));
+         else
+            expected.toutc();
+      }
+
+      ASSERT_EQ(expected.mktime(), time) << "Serial time mismatch for " << tstamp.format().c_str();
+
+      ASSERT_TRUE(expected.year == cached.year && expected.month == cached.month && expected.day == cached.day &&
+            expected.hour == cached.hour && expected.min == cached.min && expected.sec == cached.sec &&
+            expected.utc == cached.utc && expected.offset == cached.offset) << "Converted time stamp mismatch for " << tstamp.format().c_str() << 
+            " (expected " << expected.format().c_str() << ", actual " << cached.format().c_str() << ")";
+
+      tstamp.shift(step);
+   }
+
+   EXPECT_GT(tstamp_cache.get_hits(), tstamp_cache.get_misses()) << "Most time stamps should be converted within the cached hour";
+}
+
+///
+/// @brief  Tests that UTC time stamps converted to local time within the cached
+///         hour match those converted from scratch across DST transitions.
+///
+TEST_F(TimeStampTest, CachedConversionDST)
+{
+   config_t config;
+
+   // EST/EDT with a DST range set up the same way config_t::proc_dst_ranges does it
+   config.local_time = true;
+   config.utc_offset = -300;
+   config.dst_offset = 60;
+
+   tstamp_t dst_end(2021, 11, 7, 2, 0, 0, -300);
+   dst_end.tolocal(config.utc_offset + config.dst_offset);
+
+   ASSERT_TRUE(config.dst_ranges.add_range(tstamp_t(2021, 3, 14, 2, 0, 0, -300), dst_end));
+
+   // DST starts at 7 AM UTC
+   check_tstamp_cache(config, tstamp_t(2021, 3, 13, 20, 0, 0), 10000, 7);
+
+   // DST ends at 6 AM UTC
+   check_tstamp_cache(config, tstamp_t(2021, 11, 6, 20, 0, 0), 10000, 7);
+
+   // a step that isn't a divisor of an hour with time stamps at different minutes within the hour
+   check_tstamp_cache(config, tstamp_t(2021, 3, 14, 6, 59, 59), 10000, 13);
+
+   // one log record every 3 seconds for two days across the start and the end of DST
+   check_tstamp_cache(config, tstamp_t(2021, 3, 13, 7, 0, 0), 2 * 86400 / 3, 3);
+   check_tstamp_cache(config, tstamp_t(2021, 11, 6, 6, 0, 0), 2 * 86400 / 3, 3);
+
+   // DST that starts and ends at 30 minutes past an hour (e.g. 7:30 AM UTC)
+   config.dst_ranges = tm_ranges_t();
+
+   dst_end.reset(2021, 11, 7, 2, 30, 0, -300);
+   dst_end.tolocal(config.utc_offset + config.dst_offset);
+
+   ASSERT_TRUE(config.dst_ranges.add_range(tstamp_t(2021, 3, 14, 2, 30, 0, -300), dst_end));
+
+   check_tstamp_cache(config, tstamp_t(2021, 3, 13, 20, 0, 0), 10000, 7);
+   check_tstamp_cache(config, tstamp_t(2021, 11, 6, 20, 0, 0), 10000, 7);
+}
+
+///
+/// @brief  Tests that local time stamps with a half-hour UTC offset are converted
+///         to UTC within the cached hour, which starts at 30 minutes past an hour
+///         in UTC and may end on the next day.
+///
+TEST_F(TimeStampTest, CachedConversionToUTC)
+{
+   config_t config;
+
+   config.local_time = false;
+
+   check_tstamp_cache(config, tstamp_t(2021, 12, 31, 20, 0, 0, 330), 10000, 11);
+
+   // local time stamps are not converted if reports are in local time
+   config.local_time = true;
+
+   check_tstamp_cache(config, tstamp_t(2021, 12, 31, 20, 0, 0, 330), 10000, 11);
+}
+
+///
+/// @brief  Reports the time it takes to convert time stamps across DST transitions
+///         with and without a time stamp cache.
+///
+/// This test only fails if cached and uncached conversions differ, which is also
+/// checked in `CachedConversionDST`. It is disabled and may be run with
+/// `--gtest_also_run_disabled_tests` and `--gtest_filter=TimeStampTest.DISABLED_CachedConversionTiming`.
+///
+TEST_F(TimeStampTest, DISABLED_CachedConversionTiming)
+{
+   config_t config;
+   std::vector<tstamp_t> tstamps;
+
+   config.local_time = true;
+   config.utc_offset = -300;
+   config.dst_offset = 60;
+
+   tstamp_t dst_end(2021, 11, 7, 2, 0, 0, -300);
+   dst_end.tolocal(config.utc_offset + config.dst_offset);
+
+   config.dst_ranges.add_range(tstamp_t(2021, 3, 14, 2, 0, 0, -300), dst_end);
+
+   // one log record every 3 seconds across the start and the end of DST
+   for(const tstamp_t& start : {tstamp_t(2021, 3, 13, 7, 0, 0), tstamp_t(2021, 11, 6, 6, 0, 0)}) {
+      tstamp_t tstamp(start);
+
+      for(u_int index = 0; index < 2 * 86400 / 3; index++, tstamp.shift(3))
+         tstamps.push_back(tstamp);
+   }
+
+   int64_t checksum1 = 0, checksum2 = 0;
+
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+   for(int pass = 0; pass < 10; pass++) {
+      tm_ranges_t::iterator dst_iter = config.dst_ranges.begin();
+
+      for(const tstamp_t& tstamp : tstamps) {
+         tstamp_t converted(tstamp);
+         converted.tolocal(config.get_utc_offset(converted, dst_iter));
+         checksum1 += converted.mktime() + converted.hour;
+      }
+   }
+
+   double elapsed1 = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+   start = std::chrono::steady_clock::now();
+
+   for(int pass = 0; pass < 10; pass++) {
+      tstamp_cache_t tstamp_cache(config);
+
+      for(const tstamp_t& tstamp : tstamps) {
+         tstamp_t converted(tstamp);
+         checksum2 += tstamp_cache.convert(converted) + converted.hour;
+      }
+   }
+
+   double elapsed2 = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+   EXPECT_EQ(checksum1, checksum2);
+
+   printf("[          ] uncached: %.3f us per time stamp\n", elapsed1 / (10 * tstamps.size()));
+   printf("[          ] cached: %.3f us per time stamp\n", elapsed2 / (10 * tstamps.size()));
+}
+
 }
 
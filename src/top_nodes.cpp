@@ -0,0 +1,88 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   top_nodes.cpp
+*/
+#include "pch.h"
+
+#include "top_nodes.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+top_nodes_t::top_nodes_t(void) :
+      capacity(0),
+      asc_nodeids(false),
+      sorted(false)
+{
+}
+
+///
+/// @brief  Returns `true` if `entry1` should be reported before `entry2`.
+///
+bool top_nodes_t::ranks_above(const entry_t& entry1, const entry_t& entry2) const
+{
+   if(entry1.value != entry2.value)
+      return entry1.value > entry2.value;
+
+   return asc_nodeids ? entry1.nodeid < entry2.nodeid : entry1.nodeid > entry2.nodeid;
+}
+
+void top_nodes_t::reset(size_t capacity, bool asc_nodeids)
+{
+   entries.clear();
+
+   this->capacity = capacity;
+   this->asc_nodeids = asc_nodeids;
+
+   sorted = false;
+}
+
+void top_nodes_t::clear(void)
+{
+   std::vector<entry_t>().swap(entries);
+
+   sorted = false;
+}
+
+///
+/// The heap comparison puts the lowest ranked node on top of the heap, so a new
+/// node is only compared against the top node once the selection is full, which
+/// is enough to reject most nodes in a table that is much larger than `capacity`.
+///
+void top_nodes_t::add(uint64_t value, uint64_t nodeid)
+{
+   entry_t entry = {value, nodeid};
+   auto heap_cmp = [this] (const entry_t& entry1, const entry_t& entry2) {return ranks_above(entry1, entry2);};
+
+   if(sorted)
+      throw std::logic_error("Cannot add nodes to a sorted selection of top nodes");
+
+   if(entries.size() < capacity) {
+      entries.push_back(entry);
+      std::push_heap(entries.begin(), entries.end(), heap_cmp);
+      return;
+   }
+
+   // ignore nodes that don't rank above the lowest ranked selected node
+   if(!capacity || !ranks_above(entry, entries.front()))
+      return;
+
+   std::pop_heap(entries.begin(), entries.end(), heap_cmp);
+   entries.back() = entry;
+   std::push_heap(entries.begin(), entries.end(), heap_cmp);
+}
+
+void top_nodes_t::sort(void)
+{
+   if(sorted)
+      return;
+
+   std::sort_heap(entries.begin(), entries.end(), [this] (const entry_t& entry1, const entry_t& entry2) {return ranks_above(entry1, entry2);});
+
+   sorted = true;
+}
@@ -0,0 +1,78 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   top_nodes.h
+*/
+#ifndef TOP_NODES_H
+#define TOP_NODES_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+///
+/// @brief  Selects IDs of a fixed number of top-ranked nodes in a single pass
+///         over a table
+///
+/// Nodes are ranked by a value, such as a hit count. Nodes with equal values are
+/// ranked in the order a reverse iterator over a secondary index for the same value
+/// returns them, which is by descending node IDs for indexes that sort duplicates
+/// by node ID and by ascending node IDs for those that use a reverse key comparison.
+///
+/// While nodes are being added, selected nodes are kept in a heap, with the lowest
+/// ranked node on top, so each node is ranked against the selection in logarithmic
+/// time and only the selected node IDs are kept in memory. After all nodes have been
+/// added, `sort` orders selected nodes from the highest rank, so they can be looked
+/// up by their IDs in the order they should be reported.
+///
+/// This class is not thread-safe.
+///
+class top_nodes_t {
+   private:
+      struct entry_t {
+         uint64_t    value;            ///< The value nodes are ranked by.
+         uint64_t    nodeid;           ///< The node ID.
+      };
+
+   private:
+      std::vector<entry_t> entries;    ///< A heap of selected nodes or, after `sort`, selected nodes from the highest rank.
+      size_t         capacity;         ///< The maximum number of nodes to select.
+      bool           asc_nodeids;      ///< Rank nodes with equal values by ascending node IDs?
+      bool           sorted;           ///< Have selected nodes been sorted?
+
+   private:
+      bool ranks_above(const entry_t& entry1, const entry_t& entry2) const;
+
+   public:
+      top_nodes_t(void);
+
+      /// Removes all selected nodes and sets up the selection of up to `capacity` nodes.
+      void reset(size_t capacity, bool asc_nodeids = false);
+
+      /// Removes all selected nodes and releases their memory.
+      void clear(void);
+
+      /// Ranks the node `nodeid` with the value `value` against selected nodes and keeps it if it ranks among them.
+      void add(uint64_t value, uint64_t nodeid);
+
+      /// Orders selected nodes from the highest rank. No nodes may be added after this call.
+      void sort(void);
+
+      /// Returns the number of selected nodes.
+      size_t size(void) const {return entries.size();}
+
+      /// Returns the maximum number of nodes to select.
+      size_t get_capacity(void) const {return capacity;}
+
+      /// Returns the ID of the selected node at `index`, in the order of ranks if selected nodes were sorted.
+      uint64_t get_nodeid(size_t index) const {return entries[index].nodeid;}
+
+      /// Returns the value of the selected node at `index`, in the order of ranks if selected nodes were sorted.
+      uint64_t get_value(size_t index) const {return entries[index].value;}
+};
+
+#endif // TOP_NODES_H
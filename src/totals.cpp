@@ -12,6 +12,9 @@
 #include "totals.h"
 #include "serialize.h"
 #include "preserve.h"
+#include "util_math.h"
+
+#include <algorithm>
 
 totals_t::totals_t(void) : keynode_t<uint32_t>(1)
 {
@@ -142,6 +145,127 @@ void totals_t::init_counters(void)
    t_grp_agents = 0;
 }
 
+///
+/// Adds totals from another database for the same month to these totals.
+///
+/// Averages are combined using their respective counters in both sets of totals
+/// as weights and maximums are set to the larger of the two values.
+///
+/// Counters of unique items, such as `t_hosts` or `t_url`, are added up, the same
+/// as all other counters, and the caller is expected to decrement them for each
+/// item that is found in both databases.
+///
+void totals_t::merge(const totals_t& totals)
+{
+   // the first and the last day and the time stamp only reflect databases with data
+   if(!totals.cur_tstamp.null) {
+      if(cur_tstamp.null) {
+         f_day = totals.f_day;
+         l_day = totals.l_day;
+         cur_tstamp = totals.cur_tstamp;
+      }
+      else {
+         f_day = std::min(f_day, totals.f_day);
+         l_day = std::max(l_day, totals.l_day);
+
+         if(totals.cur_tstamp > cur_tstamp)
+            cur_tstamp = totals.cur_tstamp;
+      }
+   }
+
+   // combine averages before their weights are updated
+   if(totals.t_hit)
+      a_hitptime = AVG2(a_hitptime, t_hit, totals.a_hitptime, totals.t_hit);
+
+   if(totals.t_file)
+      a_fileptime = AVG2(a_fileptime, t_file, totals.a_fileptime, totals.t_file);
+
+   if(totals.t_page)
+      a_pageptime = AVG2(a_pageptime, t_page, totals.a_pageptime, totals.t_page);
+
+   if(totals.t_hvisits_end)
+      t_visit_avg = AVG2(t_visit_avg, t_hvisits_end, totals.t_visit_avg, totals.t_hvisits_end);
+
+   if(totals.t_visits_conv)
+      t_vconv_avg = AVG2(t_vconv_avg, t_visits_conv, totals.t_vconv_avg, totals.t_visits_conv);
+
+   m_hitptime = std::max(m_hitptime, totals.m_hitptime);
+   m_fileptime = std::max(m_fileptime, totals.m_fileptime);
+   m_pageptime = std::max(m_pageptime, totals.m_pageptime);
+
+   t_visit_max = std::max(t_visit_max, totals.t_visit_max);
+   t_vconv_max = std::max(t_vconv_max, totals.t_vconv_max);
+
+   max_v_hits = std::max(max_v_hits, totals.max_v_hits);
+   max_v_files = std::max(max_v_files, totals.max_v_files);
+   max_v_pages = std::max(max_v_pages, totals.max_v_pages);
+   max_v_xfer = std::max(max_v_xfer, totals.max_v_xfer);
+
+   max_hv_hits = std::max(max_hv_hits, totals.max_hv_hits);
+   max_hv_files = std::max(max_hv_files, totals.max_hv_files);
+   max_hv_pages = std::max(max_hv_pages, totals.max_hv_pages);
+   max_hv_xfer = std::max(max_hv_xfer, totals.max_hv_xfer);
+
+   hm_hit = std::max(hm_hit, totals.hm_hit);
+
+   t_hit += totals.t_hit;
+   t_file += totals.t_file;
+   t_page += totals.t_page;
+   t_xfer += totals.t_xfer;
+
+   t_hosts += totals.t_hosts;
+   t_hosts_conv += totals.t_hosts_conv;
+   t_url += totals.t_url;
+   t_ref += totals.t_ref;
+   t_agent += totals.t_agent;
+   t_user += totals.t_user;
+   t_err += totals.t_err;
+   t_downloads += totals.t_downloads;
+   t_search += totals.t_search;
+
+   t_dlcount += totals.t_dlcount;
+   t_srchits += totals.t_srchits;
+
+   t_entry += totals.t_entry;
+   t_exit += totals.t_exit;
+   u_entry += totals.u_entry;
+   u_exit += totals.u_exit;
+
+   t_rhits += totals.t_rhits;
+   t_rfiles += totals.t_rfiles;
+   t_rpages += totals.t_rpages;
+   t_rerrors += totals.t_rerrors;
+   t_rhosts += totals.t_rhosts;
+   t_rxfer += totals.t_rxfer;
+
+   t_visits += totals.t_visits;
+   t_rvisits += totals.t_rvisits;
+   t_visits_end += totals.t_visits_end;
+   t_rvisits_end += totals.t_rvisits_end;
+   t_svisits_end += totals.t_svisits_end;
+   t_hvisits_end += totals.t_hvisits_end;
+   t_visits_conv += totals.t_visits_conv;
+
+   t_spmhits += totals.t_spmhits;
+   t_sfiles += totals.t_sfiles;
+   t_spages += totals.t_spages;
+   t_shosts += totals.t_shosts;
+   t_sxfer += totals.t_sxfer;
+
+   t_grp_hosts += totals.t_grp_hosts;
+   t_grp_urls += totals.t_grp_urls;
+   t_grp_users += totals.t_grp_users;
+   t_grp_refs += totals.t_grp_refs;
+   t_grp_agents += totals.t_grp_agents;
+
+   ht_hits += totals.ht_hits;
+   ht_files += totals.ht_files;
+   ht_pages += totals.ht_pages;
+   ht_xfer += totals.ht_xfer;
+   ht_visits += totals.ht_visits;
+   ht_hosts += totals.ht_hosts;
+}
+
 //
 // serialization
 //
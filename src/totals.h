@@ -118,6 +118,8 @@ class totals_t : public keynode_t<uint32_t>, public datanode_t<totals_t> {
 
       void init_counters(void);
 
+      void merge(const totals_t& totals);
+
       //
       // serialization
       //
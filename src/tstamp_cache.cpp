@@ -0,0 +1,121 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   tstamp_cache.cpp
+*/
+#include "pch.h"
+
+#include "tstamp_cache.h"
+#include "config.h"
+
+tstamp_cache_t::tstamp_cache_t(const config_t& config) :
+      config(config),
+      dst_iter(config.dst_ranges.begin()),
+      time(0),
+      target_secs(0),
+      valid(false),
+      hits(0),
+      misses(0)
+{
+}
+
+///
+/// @brief  Returns `true` if `tstamp` has the same date, hour and time zone as
+///         the cached hour.
+///
+bool tstamp_cache_t::is_cached(const tstamp_t& tstamp) const
+{
+   return valid && !tstamp.null &&
+         tstamp.hour == source.hour && tstamp.day == source.day &&
+         tstamp.month == source.month && tstamp.year == source.year &&
+         tstamp.utc == source.utc && tstamp.offset == source.offset;
+}
+
+///
+/// @brief  Returns the local UTC offset for the UTC time stamp `tstamp` and sets
+///         `uniform` to `false` if the offset changes within the hour that starts
+///         at `hour_start`.
+///
+/// The current DST range is only advanced for `tstamp`. The hour boundaries are
+/// evaluated against all DST ranges because the current one may have ended within
+/// the hour.
+///
+int tstamp_cache_t::get_utc_offset(const tstamp_t& tstamp, const tstamp_t& hour_start, bool& uniform)
+{
+   int offset = config.get_utc_offset(tstamp, dst_iter);
+
+   if(config.dst_offset) {
+      tm_ranges_t::iterator probe = config.dst_ranges.begin();
+      tstamp_t hour_end(hour_start);
+
+      hour_end.min = hour_end.sec = 59;
+
+      if(config.get_utc_offset(hour_start, probe) != offset || config.get_utc_offset(hour_end, probe) != offset)
+         uniform = false;
+   }
+
+   return offset;
+}
+
+///
+/// @brief  Converts `tstamp` to the time zone used in reports and returns its
+///         serial time.
+///
+/// UTC time stamps are converted to local time using the configured UTC offset
+/// and DST ranges if reports use local time and local time stamps are converted
+/// to UTC otherwise. Local time stamps are not converted to a different offset.
+///
+int64_t tstamp_cache_t::convert(tstamp_t& tstamp)
+{
+   if(is_cached(tstamp)) {
+      u_int secs = tstamp.min * 60 + tstamp.sec;
+      u_int day_secs = target_secs + secs;
+
+      // minutes and seconds added to the start of the hour must not cross into the next day
+      if(day_secs < 86400) {
+         hits++;
+
+         if(target.utc)
+            tstamp.reset(target.year, target.month, target.day, day_secs / 3600, day_secs / 60 % 60, day_secs % 60);
+         else
+            tstamp.reset(target.year, target.month, target.day, day_secs / 3600, day_secs / 60 % 60, day_secs % 60, target.offset);
+
+         return time + secs;
+      }
+   }
+
+   misses++;
+
+   tstamp_t hour_start(tstamp);
+   bool cacheable = !tstamp.null;
+
+   hour_start.min = hour_start.sec = 0;
+
+   source = hour_start;
+
+   if(config.local_time != tstamp.islocal()) {
+      if(config.local_time) {
+         // hours in which DST starts or ends are not cached
+         int offset = get_utc_offset(tstamp, hour_start, cacheable);
+
+         tstamp.tolocal(offset);
+         hour_start.tolocal(offset);
+      }
+      else {
+         tstamp.toutc();
+         hour_start.toutc();
+      }
+   }
+
+   if((valid = cacheable) == true) {
+      target = hour_start;
+      target_secs = target.hour * 3600 + target.min * 60 + target.sec;
+      time = hour_start.mktime();
+   }
+
+   return tstamp.mktime();
+}
@@ -0,0 +1,68 @@
+/*
+   webalizer - a web server log analysis program
+
+   Copyright (c) 2004-2021, Stone Steps Inc. (www.stonesteps.ca)
+
+   See COPYING and Copyright files for additional licensing and copyright information
+
+   tstamp_cache.h
+*/
+#ifndef TSTAMP_CACHE_H
+#define TSTAMP_CACHE_H
+
+#include "tstamp.h"
+#include "tmranges.h"
+
+#include <cstdint>
+
+class config_t;
+
+///
+/// @brief  Converts log record time stamps to the time zone used in reports and
+///         computes their serial time, reusing the results for the previous hour
+///
+/// Consecutive log records almost always have the same date and hour, so the date
+/// math for converting a time stamp between UTC and local time and for computing
+/// its serial time is done once for the first time stamp within an hour and only
+/// minutes and seconds are added for the following time stamps.
+///
+/// Hours that contain a DST transition are not cached, so each time stamp within
+/// these hours is converted with its own UTC offset.
+///
+/// This class is not thread-safe.
+///
+class tstamp_cache_t {
+   private:
+      const config_t&   config;
+
+      tm_ranges_t::iterator dst_iter;     ///< The current DST range.
+
+      tstamp_t       source;              ///< The start of the cached hour, as found in log records.
+      tstamp_t       target;              ///< `source` converted to the report time zone.
+      int64_t        time;                ///< Serial time of `source`.
+      u_int          target_secs;         ///< Seconds since the midnight of `target`.
+      bool           valid;               ///< Are `source`, `target` and `time` set?
+
+      uint64_t       hits;                ///< Number of time stamps converted within the cached hour.
+      uint64_t       misses;              ///< Number of time stamps converted from scratch.
+
+   private:
+      bool is_cached(const tstamp_t& tstamp) const;
+
+      int get_utc_offset(const tstamp_t& tstamp, const tstamp_t& hour_start, bool& uniform);
+
+   public:
+      tstamp_cache_t(const config_t& config);
+
+      tstamp_cache_t(const tstamp_cache_t&) = delete;
+
+      tstamp_cache_t& operator = (const tstamp_cache_t&) = delete;
+
+      int64_t convert(tstamp_t& tstamp);
+
+      uint64_t get_hits(void) const {return hits;}
+
+      uint64_t get_misses(void) const {return misses;}
+};
+
+#endif // TSTAMP_CACHE_H
@@ -14,6 +14,9 @@
 #include "config.h"
 #include "exception.h"
 #include "util_url.h"
+#include "util_math.h"
+
+#include <algorithm>
 
 // -----------------------------------------------------------------------
 //
@@ -139,6 +142,29 @@ bool unode_t::match_key(const string_t& url, const string_t& srchargs) const
    return true;
 }
 
+///
+/// Adds counters of `unode`, which must have the same URL, to this node. Average
+/// processing times are combined using request counts of both nodes as weights.
+///
+void unode_t::merge(const unode_t& unode)
+{
+   if(unode.count)
+      avgtime = AVG2(avgtime, count, unode.avgtime, unode.count);
+
+   maxtime = std::max(maxtime, unode.maxtime);
+
+   count += unode.count;
+   files += unode.files;
+   entry += unode.entry;
+   exit += unode.exit;
+   xfer += unode.xfer;
+
+   urltype |= unode.urltype;
+
+   if(unode.target)
+      target = true;
+}
+
 //
 // serialization
 //
@@ -54,6 +54,8 @@ struct unode_t : public base_node<unode_t> {
 
          void reset(uint64_t nodeid = 0);
 
+         void merge(const unode_t& unode);
+
          u_char update_url_type(u_char type);
 
          char get_url_type_ind(void) const;
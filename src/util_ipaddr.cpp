@@ -12,6 +12,271 @@
 
 #include "util_ipaddr.h"
 
+///
+/// @brief  Parses an IPv4 address in the dotted-decimal notation between `cp` and
+///         `end` into four bytes in `out`.
+///
+static bool parse_ipv4(const char *cp, const char *end, u_char *out)
+{
+   for(size_t index = 0; index < 4; index++) {
+      u_int value = 0;
+      size_t dcnt = 0;
+
+      if(index) {
+         if(cp == end || *cp != '.')
+            return false;
+         cp++;
+      }
+
+      // reject leading zeros, which some parsers interpret as octal numbers
+      if(end - cp > 1 && cp[0] == '0' && string_t::isdigit(cp[1]))
+         return false;
+
+      for(; cp < end && string_t::isdigit(*cp); cp++) {
+         if(++dcnt > 3)
+            return false;
+         value = value * 10 + (*cp - '0');
+      }
+
+      if(!dcnt || value > 255)
+         return false;
+
+      out[index] = (u_char) value;
+   }
+
+   return cp == end;
+}
+
+///
+/// @brief  Parses an IPv6 address between `cp` and `end` into 16 bytes in `out`.
+///
+static bool parse_ipv6(const char *cp, const char *end, u_char *out)
+{
+   size_t count = 0;                      // number of bytes parsed
+   size_t gap = ipaddr_t::size;           // offset of compressed zeros (none if ipaddr_t::size)
+
+   // a leading colon must be a part of a double colon
+   if(cp < end && *cp == ':') {
+      if(end - cp < 2 || cp[1] != ':')
+         return false;
+
+      cp += 2;
+      gap = 0;
+   }
+
+   while(cp < end) {
+      const char *group = cp;
+      u_int value = 0;
+      size_t xcnt = 0;
+
+      for(; cp < end && string_t::isxdigit(*cp); cp++) {
+         if(++xcnt > 4)
+            return false;
+         value = (value << 4) | (string_t::isdigit(*cp) ? *cp - '0' : (*cp | 0x20) - 'a' + 10);
+      }
+
+      // an IPv4 address may only be in the last 32 bits
+      if(cp < end && *cp == '.') {
+         if(count > ipaddr_t::size - 4 || !parse_ipv4(group, end, out + count))
+            return false;
+
+         count += 4;
+         break;
+      }
+
+      if(!xcnt || count == ipaddr_t::size)
+         return false;
+
+      out[count++] = (u_char) (value >> 8);
+      out[count++] = (u_char) value;
+
+      if(cp == end)
+         break;
+
+      if(*cp++ != ':' || cp == end)
+         return false;
+
+      // compressed zeros may only occur once and must replace at least one group
+      if(*cp == ':') {
+         if(gap != ipaddr_t::size || count == ipaddr_t::size)
+            return false;
+
+         gap = count;
+
+         cp++;
+      }
+   }
+
+   if(gap == ipaddr_t::size)
+      return count == ipaddr_t::size;
+
+   // compressed zeros must replace at least one group
+   if(count == ipaddr_t::size)
+      return false;
+
+   memmove(out + ipaddr_t::size - (count - gap), out + gap, count - gap);
+   memset(out + gap, 0, ipaddr_t::size - count);
+
+   return true;
+}
+
+///
+/// @brief  Writes four bytes in `bytes` in the dotted-decimal notation into `cp`
+///         and returns a pointer past the last character written.
+///
+static char *format_ipv4(const u_char *bytes, char *cp)
+{
+   for(size_t index = 0; index < 4; index++) {
+      u_int value = bytes[index];
+
+      if(index)
+         *cp++ = '.';
+
+      if(value >= 100)
+         *cp++ = (char) ('0' + value / 100);
+
+      if(value >= 10)
+         *cp++ = (char) ('0' + value / 10 % 10);
+
+      *cp++ = (char) ('0' + value % 10);
+   }
+
+   return cp;
+}
+
+///
+/// @brief  Writes a 16-bit IPv6 group in lower case hex digits without leading zeros
+///         into `cp` and returns a pointer past the last character written.
+///
+static char *format_ipv6_group(u_int group, char *cp)
+{
+   static const char hex_digits[] = "0123456789abcdef";
+   bool digits = false;
+
+   for(int shift = 12; shift >= 0; shift -= 4) {
+      u_int digit = (group >> shift) & 0xF;
+
+      if(digit || digits || !shift) {
+         *cp++ = hex_digits[digit];
+         digits = true;
+      }
+   }
+
+   return cp;
+}
+
+///
+/// @brief  Parses a text IPv4 or IPv6 address into its binary form.
+///
+/// If `str` is not an IP address, the address is reset and `false` is returned.
+///
+bool ipaddr_t::parse(const char *str, size_t slen)
+{
+   const char *end = str + slen;
+
+   if(!str || !slen) {
+      reset();
+      return false;
+   }
+
+   if(memchr(str, ':', slen)) {
+      if(parse_ipv6(str, end, bytes)) {
+         family = IPV6;
+         return true;
+      }
+   }
+   else if(parse_ipv4(str, end, bytes + size - 4)) {
+      memset(bytes, 0, size - 6);
+      bytes[size-6] = bytes[size-5] = 0xFF;
+      family = IPV4;
+      return true;
+   }
+
+   reset();
+
+   return false;
+}
+
+///
+/// @brief  Writes the canonical text form of this address into `str` and returns
+///         the number of characters written, not including the null character.
+///
+/// IPv4 addresses are written in the dotted-decimal notation. IPv6 addresses are
+/// written as described in RFC 5952 - hex digits are in lower case without leading
+/// zeros, the first of the longest runs of two or more zero groups is replaced with
+/// a double colon and IPv4-mapped addresses end with an IPv4 address in the dotted-
+/// decimal notation. Any two spellings of the same address yield the same text.
+///
+/// If the address is empty or `bufsize` is less than `max_text_size`, nothing is
+/// written and zero is returned.
+///
+size_t ipaddr_t::to_string(char *str, size_t bufsize) const
+{
+   char *cp = str;
+
+   if(family == NONE || !str || bufsize < max_text_size)
+      return 0;
+
+   if(family == IPV4)
+      cp = format_ipv4(get_ipv4_bytes(), cp);
+   else {
+      u_int groups[size / 2];
+      size_t zstart = 0, zlen = 0;        // first longest run of zero groups
+      bool sep = false;                   // write a colon before the next group?
+
+      // ::ffff:0:0/96 addresses are written with the last 32 bits as an IPv4 address
+      bool mapped = !memcmp(bytes, "\0\0\0\0\0\0\0\0\0\0\xFF\xFF", size - 4);
+      size_t gcount = mapped ? size / 2 - 2 : size / 2;
+
+      for(size_t index = 0; index < gcount; index++)
+         groups[index] = (u_int) bytes[index * 2] << 8 | bytes[index * 2 + 1];
+
+      for(size_t index = 0; index < gcount; index++) {
+         size_t run = 0;
+
+         while(index + run < gcount && !groups[index + run])
+            run++;
+
+         if(run > zlen) {
+            zstart = index;
+            zlen = run;
+         }
+
+         index += run;
+      }
+
+      // a single zero group is not compressed
+      if(zlen < 2)
+         zstart = gcount;
+
+      for(size_t index = 0; index < gcount; ) {
+         if(index == zstart) {
+            *cp++ = ':';
+            *cp++ = ':';
+            index += zlen;
+            sep = false;
+            continue;
+         }
+
+         if(sep)
+            *cp++ = ':';
+
+         cp = format_ipv6_group(groups[index++], cp);
+         sep = true;
+      }
+
+      if(mapped) {
+         if(sep)
+            *cp++ = ':';
+         cp = format_ipv4(get_ipv4_bytes(), cp);
+      }
+   }
+
+   *cp = 0;
+
+   return cp - str;
+}
+
 bool is_ipv4_address(const char *cp)
 {
    size_t dcnt, gcnt;    // digit and group counts
@@ -12,6 +12,59 @@
 #ifndef UTIL_IPADDR_H
 #define UTIL_IPADDR_H
 
+#include "types.h"
+
+#include <cstddef>
+#include <cstring>
+
+///
+/// @brief  A binary IPv4 or IPv6 address
+///
+/// IPv4 addresses are stored as IPv4-mapped IPv6 addresses (`::ffff:a.b.c.d`), so
+/// all addresses are 16 bytes long and may be hashed and compared as such. The
+/// address family is compared as well, so an IPv4 address is not the same as its
+/// IPv4-mapped IPv6 form (e.g. `1.2.3.4` and `::ffff:1.2.3.4`), which keeps them
+/// apart, the same way their text forms are.
+///
+/// Only addresses in the forms accepted by `inet_pton` are parsed. IPv4 groups
+/// cannot have leading zeros and IPv6 zone identifiers are not supported.
+///
+class ipaddr_t {
+   public:
+      static constexpr size_t size = 16;  ///< Address size, in bytes.
+
+      static constexpr size_t max_text_size = 46;  ///< Text address buffer size, including the null character (`INET6_ADDRSTRLEN`).
+
+      /// Address families.
+      enum family_t : u_char {NONE, IPV4, IPV6};
+
+   private:
+      u_char      bytes[size];            ///< IPv6 or IPv4-mapped IPv6 address in network byte order.
+      family_t    family;                 ///< Address family (`NONE` if the address is empty).
+
+   public:
+      ipaddr_t(void) {reset();}
+
+      void reset(void) {memset(bytes, 0, sizeof(bytes)); family = NONE;}
+
+      bool parse(const char *str, size_t slen);
+
+      size_t to_string(char *str, size_t bufsize) const;
+
+      bool isempty(void) const {return family == NONE;}
+
+      family_t get_family(void) const {return family;}
+
+      const u_char *get_bytes(void) const {return bytes;}
+
+      /// Returns the IPv4 address bytes of an IPv4 address.
+      const u_char *get_ipv4_bytes(void) const {return bytes + size - 4;}
+
+      bool operator == (const ipaddr_t& other) const {return family == other.family && !memcmp(bytes, other.bytes, sizeof(bytes));}
+
+      bool operator != (const ipaddr_t& other) const {return !(*this == other);}
+};
+
 bool is_ipv4_address(const char *str);
 bool is_ipv6_address(const char *str);
 bool is_ip_address(const char *str);
@@ -18,9 +18,125 @@
 #include <algorithm>
 #include <stdexcept>
 
+//
+// SSE2 is a part of the x64 instruction set. 32-bit builds use it only if the compiler
+// is configured to generate SSE2 instructions.
+//
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NORM_URL_SSE2
+#include <emmintrin.h>
+#endif
+
+///
+/// @brief  The size of a UTF-8 character and the range of its second byte, indexed
+///         by the first byte of the character
+///
+/// Bytes other than the second one must be within the `\x80`-`\xBF` range. A zero
+/// size indicates a byte that cannot start a UTF-8 character.
+///
+struct utf8_lead_t {
+   u_char   size;
+   u_char   lo;
+   u_char   hi;
+};
+
+///
+/// @brief  A table of UTF-8 lead bytes
+///
+struct utf8_lead_table_t {
+   utf8_lead_t leads[256];
+
+   public:
+      utf8_lead_table_t(void)
+      {
+         for(u_int chr = 0; chr < 256; chr++) {
+            utf8_lead_t& lead = leads[chr];
+
+            lead.lo = 0x80;
+            lead.hi = 0xBF;
+
+            if(chr <= 0x7F)
+               lead.size = 1;
+            else if(chr >= 0xC2 && chr <= 0xDF)
+               lead.size = 2;
+            else if(chr >= 0xE0 && chr <= 0xEF)
+               lead.size = 3;
+            else if(chr >= 0xF0 && chr <= 0xF4)
+               lead.size = 4;
+            else
+               lead.size = 0;
+         }
+
+         // exclude overlong sequences, surrogates and characters above U+10FFFF
+         leads[0xE0].lo = 0xA0;
+         leads[0xED].hi = 0x9F;
+         leads[0xF0].lo = 0x90;
+         leads[0xF4].hi = 0x8F;
+      }
+};
+
 static char *to_hex(unsigned char cp, char *out);
 static char from_hex(char c);
 
+static const utf8_lead_table_t utf8_lead_table;
+
+///
+/// @brief  Returns the number of bytes in a UTF-8 character or a zero if the sequence
+///         is not a valid UTF-8 character.
+///
+/// This function returns the same values as `utf8size`, but evaluates the first byte
+/// with a single table look-up.
+///
+static inline size_t utf8_char_size(const char *cp)
+{
+   const utf8_lead_t& lead = utf8_lead_table.leads[(u_char) *cp];
+
+   if(lead.size <= 1)
+      return lead.size;
+
+   if((u_char) cp[1] < lead.lo || (u_char) cp[1] > lead.hi)
+      return 0;
+
+   if(lead.size >= 3 && !in_range<'\x80', '\xBF'>(cp[2]))
+      return 0;
+
+   if(lead.size == 4 && !in_range<'\x80', '\xBF'>(cp[3]))
+      return 0;
+
+   return lead.size;
+}
+
+///
+/// @brief  Returns the offset of the first 16-byte block in `str` that contains
+///         a character that may need to be normalized.
+///
+/// Blocks that contain only printable ASCII characters other than `%` are skipped
+/// with SSE2 instructions. The block at the returned offset and any characters
+/// following the last whole block must be evaluated by the caller.
+///
+static inline size_t skip_plain_blocks(const char *str, size_t slen)
+{
+   size_t offset = 0;
+
+#ifdef NORM_URL_SSE2
+   const __m128i space = _mm_set1_epi8(' ');
+   const __m128i del = _mm_set1_epi8('\x7F');
+   const __m128i pct = _mm_set1_epi8('%');
+
+   for(; slen - offset >= 16; offset += 16) {
+      __m128i data = _mm_loadu_si128((const __m128i*) (str + offset));
+
+      // signed comparison also matches bytes with the high bit set (i.e. non-ASCII)
+      __m128i special = _mm_or_si128(_mm_cmplt_epi8(data, space), _mm_or_si128(_mm_cmpeq_epi8(data, del), _mm_cmpeq_epi8(data, pct)));
+
+      if(_mm_movemask_epi8(special))
+         break;
+   }
+#endif
+
+   return offset;
+}
+
 char *to_hex(unsigned char cp, char *out)
 {
    if(!out)
@@ -119,16 +235,17 @@ void norm_url_str(string_t& str, string_t::char_buffer_t& strbuf)
 
    //
    // Look for a URL-encoded sequence, a control character or a non-UTF-8 character. 
-   // All characters up to such character do not need to be examined again.
+   // All characters up to such character do not need to be examined again. Most
+   // strings are plain ASCII, which is skipped in whole blocks.
    //
-   for(cp1 = str.c_str(); *cp1; cp1 += chsz) {
+   for(cp1 = str.c_str() + skip_plain_blocks(str.c_str(), str.length()); *cp1; cp1 += chsz) {
       if((unsigned char) *cp1 < '\x20' || (unsigned char) *cp1 == '\x7F')
          break;
 
       if(*cp1 == '%')
          break;
 
-      if((chsz = utf8size(cp1)) == 0)
+      if((chsz = utf8_char_size(cp1)) == 0)
          break;
    }
 
@@ -192,16 +309,20 @@ void norm_url_str(string_t& str, string_t::char_buffer_t& strbuf)
 
    // convert all non-UTF-8 characters as if they are in CP1252
    while(*cp2) {
+      chsz = utf8_char_size(cp2);
+
       //
       // Check if we have enough room in the buffer for the next sequence, which can 
       // be up to 4 bytes for a UTF-8 character or 2 bytes for a CP1252 character 
-      // converted to UTF-8, plus the null terminator.
+      // converted to UTF-8, plus the null terminator. Checking the actual size keeps 
+      // strings that became shorter in their original buffer, which may be a view 
+      // into a log line.
       //
-      if(buf.capacity() - (bcp - buf) < 5)
+      if(buf.capacity() - (bcp - buf) < (chsz ? chsz : 2) + 1)
          bcp = realloc_buffer(buf, bcp);
 
       // interpret non-UTF-8 characters as CP1252 (Latin1)
-      if((chsz = utf8size(cp2)) == 0) {
+      if(chsz == 0) {
          cp1252utf8(cp2, 1, bcp, 2, &chsz);
          bcp += chsz;
          cp2++;
@@ -38,6 +38,7 @@
 #include "html_output.h"
 #include "console.h"
 #include "init_seq_guard.h"
+#include "tstamp_cache.h"
 
 #include <ctime>
 #include <cstdio>
@@ -77,7 +78,7 @@ bool webalizer_t::abort_signal = false;   // true if Ctrl-C was pressed
 ///
 /// @brief  Constructs an instance of a log processor.
 ///
-webalizer_t::webalizer_t(const config_t& config) : config(config), parser(config), state(config, &end_visit_cb, &end_download_cb, this), dns_resolver(config)
+webalizer_t::webalizer_t(const config_t& config) : config(config), parser(config), parse_pipeline(config), state(config, &end_visit_cb, &end_download_cb, this), dns_resolver(config), agent_cache(config.ua_cache_size)
 {
    // preallocate all character buffers we need for log processing
    buffer_allocator.release_buffer(string_t::char_buffer_t(BUFSIZE));
@@ -138,7 +139,7 @@ void webalizer_t::initialize(void)
    //
    // Initialize report generator
    //
-   if(!config.compact_db && !config.end_month && !config.db_info) {
+   if(!config.compact_db && !config.end_month && !config.db_info && !config.merge_db) {
       if(!init_output_engines()) {
          throw exception_t(0, "Cannot initialize output engine");
       }
@@ -158,7 +159,7 @@ void webalizer_t::initialize(void)
    //
    // restore state, if required
    //
-   if(config.prep_report || config.end_month || config.incremental || config.db_info) {
+   if(config.prep_report || config.end_month || config.incremental || config.db_info || config.merge_db) {
       state.restore_state();
    }
 
@@ -187,7 +188,7 @@ void webalizer_t::cleanup(void)
       parser.cleanup_parser();
    }
    
-   if(!config.compact_db && !config.end_month && !config.db_info)
+   if(!config.compact_db && !config.end_month && !config.db_info && !config.merge_db)
       cleanup_output_engines();
 
    state.cleanup();
@@ -628,6 +629,54 @@ void webalizer_t::mangle_user_agent(string_t& agent)
    agent = buffer;
 }
 
+///
+/// @brief  Returns the name of the robot pattern matching the original user agent
+///         in `ua_entry` or `nullptr` if the user agent is not a robot.
+///
+const string_t *webalizer_t::get_robot_agent(agent_cache_t::entry_t& ua_entry) const
+{
+   if(!ua_entry.robot_set) {
+      ua_entry.robot = config.robots.isinglist(ua_entry.agent);
+      ua_entry.robot_set = true;
+   }
+
+   return ua_entry.robot;
+}
+
+///
+/// @brief  Returns the original user agent in `ua_entry` mangled according to
+///         the configured mangler and mangling level.
+///
+const string_t& webalizer_t::get_mangled_agent(agent_cache_t::entry_t& ua_entry)
+{
+   if(!ua_entry.mangled_set) {
+      ua_entry.mangled = ua_entry.agent;
+
+      if (config.use_classic_mangler)
+         mangle_user_agent(ua_entry.mangled);
+      else
+         filter_user_agent(ua_entry.mangled);
+
+      ua_entry.mangled_set = true;
+   }
+
+   return ua_entry.mangled;
+}
+
+///
+/// @brief  Returns the name of the group pattern matching the user agent in
+///         `ua_entry`, after it has been mangled, if mangling is enabled.
+///
+const string_t *webalizer_t::get_agent_group(agent_cache_t::entry_t& ua_entry)
+{
+   if(!ua_entry.group_set) {
+      ua_entry.group = config.group_agents.isinglist(config.mangle_agent ? get_mangled_agent(ua_entry) : ua_entry.agent);
+      ua_entry.group_set = true;
+   }
+
+   return ua_entry.group;
+}
+
 ///
 /// @brief  Removes various parts of the user agent string based on the configured
 ///         level of mangling.
@@ -929,6 +978,27 @@ int webalizer_t::compact_database(void)
    return 0;
 }
 
+///
+/// @brief  Merges state databases for the same month into the selected state
+///         database.
+///
+/// The selected state database is created if it doesn't exist. Neither database
+/// may have active visits or downloads, so visits split between databases would
+/// not be counted twice.
+///
+int webalizer_t::merge_databases(void)
+{
+   if(state.database.get_vcount() || state.database.get_dacount())
+      throw exception_t(0, string_t::_format("Cannot merge into a database with active visits or downloads (%s)", config.get_db_path().c_str()));
+
+   for(const string_t& db_name : config.merge_db_names)
+      state.merge_state(db_name);
+
+   state.save_state();
+
+   return 0;
+}
+
 ///
 /// @brief  Runs the appropriate handler for the active command.
 ///
@@ -960,6 +1030,10 @@ int webalizer_t::run(void)
       retcode = database_info();
       ptms.mnt_time += elapsed(start_ts, msecs());
    }
+   else if(config.merge_db) {
+      retcode = merge_databases();
+      ptms.mnt_time += elapsed(start_ts, msecs());
+   }
    else
       retcode = proc_logfile(ptms, lrcnt);
 
@@ -971,7 +1045,7 @@ int webalizer_t::run(void)
       tot_time = elapsed(start_ts, end_ts);
       proc_time = tot_time - ptms.dns_time - ptms.mnt_time - ptms.rpt_time;
 
-      if(!config.prep_report && !config.compact_db && !config.end_month && !config.db_info) {
+      if(!config.prep_report && !config.compact_db && !config.end_month && !config.db_info && !config.merge_db) {
          // output number of processed, ignored and bad records
          printf("%s %" PRIu64 " %s ", config.lang.msg_processed, lrcnt.total_rec, config.lang.msg_records);
          if (lrcnt.total_ignore) {
@@ -1003,12 +1077,20 @@ int webalizer_t::run(void)
                printf("%s: %" PRIu64 "%% (%" PRIu64 ":%" PRIu64 ")\n", config.lang.msg_dns_htrt, (uint64_t) (dns_resolver.dns_cached * 100. / (dns_resolver.dns_cached + dns_resolver.dns_resolved)), dns_resolver.dns_cached, dns_resolver.dns_resolved);
          }
 
+         // report user agent cache hits and misses
+         if(config.verbose && (agent_cache.get_hits() || agent_cache.get_misses()))
+            printf("%s: %" PRIu64 "%% (%" PRIu64 ":%" PRIu64 ")\n", config.lang.msg_ua_htrt, (uint64_t) (agent_cache.get_hits() * 100. / (agent_cache.get_hits() + agent_cache.get_misses())), agent_cache.get_hits(), agent_cache.get_misses());
+
+         // report database look-ups skipped by value filters and false positives
+         if(config.verbose && (state.database.get_filter_skips() || state.database.get_filter_false_positives()))
+            printf("%s: %" PRIu64 " (%" PRIu64 ")\n", config.lang.msg_db_fskip, state.database.get_filter_skips(), state.database.get_filter_false_positives());
+
          // report total DNS time
          printf("%s %.2f %s\n", config.lang.msg_dnstime, ptms.dns_time/1000., config.lang.msg_seconds);
       }
 
       // report total report generation time
-      if(!config.batch && !config.compact_db && !config.end_month && !config.db_info)
+      if(!config.batch && !config.compact_db && !config.end_month && !config.db_info && !config.merge_db)
          printf("%s %.2f %s\n", config.lang.msg_rpttime, ptms.rpt_time/1000., config.lang.msg_seconds);
 
       // report maintenance and total run time
@@ -1034,7 +1116,7 @@ void webalizer_t::prep_logfiles(logfile_list_t& logfiles)
    while(iter != config.log_fnames.end()) {
       const string_t& fname = *iter++;
       // VC++ Intellisense erroneously highlights make_path as trying to create a string with `const string_t&&`
-      std::unique_ptr<logfile_t> logfile(new logfile_t(fname.length() && !is_abs_path(fname) ? (const string_t&) make_path(config.cur_dir, fname) : fname));
+      std::unique_ptr<logfile_t> logfile(new logfile_t(fname.length() && !is_abs_path(fname) ? (const string_t&) make_path(config.cur_dir, fname) : fname, config.log_read_mode, config.log_buf_size, config.log_read_ahead, config.log_inflate_threads));
       
       // check if we can read the file
       if(!logfile->is_readable()) {
@@ -1057,31 +1139,53 @@ void webalizer_t::prep_logfiles(logfile_list_t& logfiles)
    }
 }
 
+///
+/// @brief  Inserts a log file state into the heap.
+///
+void webalizer_t::lfp_state_heap_t::push(const lfp_state_t& state)
+{
+   states.push_back(state);
+   states.back().seqnum = seqnum++;
+
+   std::push_heap(states.begin(), states.end(), is_later);
+}
+
+///
+/// @brief  Removes the log file state with the oldest log record from the heap
+///         and returns it to the caller.
+///
+webalizer_t::lfp_state_t webalizer_t::lfp_state_heap_t::pop(void)
+{
+   std::pop_heap(states.begin(), states.end(), is_later);
+
+   lfp_state_t state = states.back();
+   states.pop_back();
+
+   return state;
+}
+
 ///
 /// @brief  Prepares a log file processing state for each of the log files in the 
 ///         log file list. 
 ///
 /// This method reads the first valid log record from each log file and creates a 
 /// log file state instance containing a populated log record and the corresponding 
-/// log file. Each log file state instance is inserted into the state list in the 
+/// log file. Each log file state instance is inserted into the state heap in the 
 /// ascending order of log record time stamps. 
 ///
 /// Those log files that do not have valid log records are removed from the log file 
 /// list, so when the function returns, the number of log file states matches the 
 /// number of log files. 
 ///
-void webalizer_t::prep_lfstates(logfile_list_t& logfiles, lfp_state_list_t& lfp_states, logrec_list_t& logrecs, logrec_counts_t& lrcnt)
+void webalizer_t::prep_lfstates(logfile_list_t& logfiles, lfp_state_heap_t& lfp_states, logrec_list_t& logrecs, logrec_counts_t& lrcnt)
 {
-   string_t::char_buffer_t&& buffer = buffer_holder_t(buffer_allocator, BUFSIZE).buffer;
-   int parse_code;
    int errnum = 0;
-   size_t reclen;
    lfp_state_t wlfs;                   // working log file state
 
    //
    // Loop through the log lines of each log file until we find a valid log
    // record. Store the first good log record and the file pointer in a state
-   // and insert the state into the state list, ordered by the time stamp.
+   // and insert the state into the state heap, ordered by the time stamp.
    // Repeat the process for each log file. After this loop we will have same 
    // number of log files, log records and states in the lists and the working 
    // log file state structure (wlfs) will be empty.
@@ -1093,8 +1197,13 @@ void webalizer_t::prep_lfstates(logfile_list_t& logfiles, lfp_state_list_t& lfp_
          throw exception_t(0, string_t::_format("%s %s (%d)", config.lang.msg_log_err, (*i)->get_fname().c_str(), errnum));
       }
 
-      // read the log record into the buffer
-      if((reclen = read_log_line(buffer, **i, lrcnt)) == 0) {
+      // allocate a log record and set up the state structure
+      wlfs.logfile = *i;
+      wlfs.logrec = new log_struct;
+      logrecs.push_back(wlfs.logrec);
+
+      // read the first valid log record, skipping bad records and log file directives
+      if(!get_log_record(**i, *wlfs.logrec, lrcnt)) {
          // report if there's no more data
          printf("%s %s\n", config.lang.msg_log_done, (*i)->get_fname().c_str());
 
@@ -1104,10 +1213,8 @@ void webalizer_t::prep_lfstates(logfile_list_t& logfiles, lfp_state_list_t& lfp_
          i = logfiles.erase(i);
          
          // delete the last log record and remove it from the list
-         if(wlfs.logrec) {
-            delete logrecs.back();
-            logrecs.pop_back();
-         }
+         delete logrecs.back();
+         logrecs.pop_back();
 
          // do not leave dangling poiters behind
          wlfs.reset();
@@ -1115,25 +1222,6 @@ void webalizer_t::prep_lfstates(logfile_list_t& logfiles, lfp_state_list_t& lfp_
          continue;
       }
       
-      // allocate a log record and set up the state structure
-      if(!wlfs.logrec) {
-         wlfs.logfile = *i;
-         wlfs.logrec = new log_struct;
-         logrecs.push_back(wlfs.logrec);
-      }
-
-      // parse the log line
-      if((parse_code = parse_log_record(buffer, reclen, *wlfs.logrec, wlfs.logfile->get_id(), lrcnt.total_rec)) == PARSE_CODE_ERROR) {
-         lrcnt.total_bad++;
-         continue;
-      }
-      
-      // skip log file directives, etc
-      if(parse_code == PARSE_CODE_IGNORE) {
-         lrcnt.total_ignore++;
-         continue;
-      }
-      
       //
       // There's a limit on how many files can be opened simulteneously. If we 
       // reached the maximum, close the file here and it will be opened again 
@@ -1146,10 +1234,8 @@ void webalizer_t::prep_lfstates(logfile_list_t& logfiles, lfp_state_list_t& lfp_
          (*i)->close();
       }
       
-      // find the spot in the list and insert the record (earlier timestamps first)
-      lfp_state_list_t::iterator j = lfp_states.begin();
-      while(j != lfp_states.end() && wlfs.logrec->tstamp > j->logrec->tstamp) j++;
-      lfp_states.insert(j, wlfs);
+      // insert the state into the heap (earlier timestamps first)
+      lfp_states.push(wlfs);
 
       // reset the working state and move onto the next log file
       wlfs.reset();
@@ -1169,7 +1255,7 @@ void webalizer_t::prep_lfstates(logfile_list_t& logfiles, lfp_state_list_t& lfp_
 /// Otherwise, if the number of log file states is less than the number of log 
 /// files and the log file in `wlfs` has at least one valid log record, then a 
 /// new log record is read and the new log file state is inserted into the state
-/// list according to the log record time stamp. The first state from the list 
+/// heap according to the log record time stamp. The first state from the heap 
 /// is then returned to the caller in `wlfs`, as described in the first paragraph.
 ///
 /// If there are no more valid records in the log file in `wlfs`, the matching 
@@ -1180,12 +1266,9 @@ void webalizer_t::prep_lfstates(logfile_list_t& logfiles, lfp_state_list_t& lfp_
 /// determied by how many of them have log records in approximately same range
 /// and how close log records are to each other. 
 ///
-bool webalizer_t::get_logrec(lfp_state_t& wlfs, logfile_list_t& logfiles, lfp_state_list_t& lfp_states, logrec_list_t& logrecs, logrec_counts_t& lrcnt)
+bool webalizer_t::get_logrec(lfp_state_t& wlfs, logfile_list_t& logfiles, lfp_state_heap_t& lfp_states, logrec_list_t& logrecs, logrec_counts_t& lrcnt)
 {
-   string_t::char_buffer_t&& buffer = buffer_holder_t(buffer_allocator, BUFSIZE).buffer;
-   int parse_code;
    int errnum = 0;
-   size_t reclen;
 
    //
    // If we have fewer states than log files, then we either need to add a 
@@ -1199,7 +1282,7 @@ bool webalizer_t::get_logrec(lfp_state_t& wlfs, logfile_list_t& logfiles, lfp_st
       }
 
       // use logfile from wlfs, which was populated in the previous iteration
-      if((reclen = read_log_line(buffer, *wlfs.logfile, lrcnt)) == 0) {
+      if(!get_log_record(*wlfs.logfile, *wlfs.logrec, lrcnt)) {
          logfile_list_t::iterator i;
             
          // report that we are done with this log file
@@ -1216,22 +1299,9 @@ bool webalizer_t::get_logrec(lfp_state_t& wlfs, logfile_list_t& logfiles, lfp_st
             
          break;
       }
-         
-      // parse the log line
-      if((parse_code = parse_log_record(buffer, reclen, *wlfs.logrec, wlfs.logfile->get_id(), lrcnt.total_rec)) == PARSE_CODE_ERROR) {
-         lrcnt.total_bad++;
-         continue;
-      }
-         
-      if(parse_code == PARSE_CODE_IGNORE) {
-         lrcnt.total_ignore++;
-         continue;
-      }
 
-      // find the spot in the list and insert the record (earlier timestamps first)
-      lfp_state_list_t::iterator j = lfp_states.begin();
-      while(j != lfp_states.end() && wlfs.logrec->tstamp > j->logrec->tstamp) j++;
-      lfp_states.insert(j, wlfs);
+      // insert the state into the heap (earlier timestamps first)
+      lfp_states.push(wlfs);
       wlfs.reset();
    }
    
@@ -1240,11 +1310,10 @@ bool webalizer_t::get_logrec(lfp_state_t& wlfs, logfile_list_t& logfiles, lfp_st
       return false;
 
    //
-   // Get the first state and remove it from the list. The log file in the  
+   // Get the first state and remove it from the heap. The log file in the  
    // working state lets us keep track of which log file needs to be read from.
    //
-   wlfs = lfp_states.front();
-   lfp_states.pop_front();
+   wlfs = lfp_states.pop();
 
    return true;
 }
@@ -1277,11 +1346,11 @@ int webalizer_t::proc_logfile(proc_times_t& ptms, logrec_counts_t& lrcnt)
    bool check_dup = false;             // check for duplicate time stamps for initial log records?
 
    lfp_state_t wlfs;                   // working log file state
-   lfp_state_list_t lfp_states;        // log file states ordered by log time
+   lfp_state_heap_t lfp_states;        // log file states ordered by log time
    logfile_list_t logfiles;            // owns log files
    logrec_list_t logrecs;              // contains one log record per log file; owns log records
    
-   tm_ranges_t::iterator dst_iter = config.dst_ranges.begin();
+   tstamp_cache_t tstamp_cache(config);   // converts time stamps to the report time zone
 
    // check for duplicates only if we processed any log records in the past
    check_dup = config.incremental && !state.totals.cur_tstamp.null;
@@ -1292,6 +1361,16 @@ int webalizer_t::proc_logfile(proc_times_t& ptms, logrec_counts_t& lrcnt)
    // populate the list of log files and make sure they are readable
    prep_logfiles(logfiles);
 
+   //
+   // Start parser threads, if configured. Worker parsers are copied from the 
+   // parser snapshot, which is updated every time the main parser processes
+   // a log file directive.
+   //
+   if(config.parser_threads) {
+      parser_snapshot = std::make_shared<const parser_t>(parser);
+      parse_pipeline.start(config.parser_threads, logfiles.size());
+   }
+
    // populate log file states, so we have one log record per log file, ordered by time
    prep_lfstates(logfiles, lfp_states, logrecs, lrcnt);
 
@@ -1323,19 +1402,14 @@ int webalizer_t::proc_logfile(proc_times_t& ptms, logrec_counts_t& lrcnt)
          // UTCOffset, which may not even be set, in which case it will appear that the time 
          // stamp is adjusted to UTC, while it is actually local time and may be DST adjusted.
          //
-         if(config.local_time != log_rec.tstamp.islocal()) {
-            if(config.local_time)
-               log_rec.tstamp.tolocal(config.get_utc_offset(log_rec.tstamp, dst_iter));
-            else
-               log_rec.tstamp.toutc();
-         }
+         // Hold onto the time stamp value, so we don't have to do time math more than we
+         // need. Time stamps within the same hour reuse the time math for the previous one.
+         //
+         htab_tstamp = tstamp_cache.convert(log_rec.tstamp);
 
          /* get current records timestamp (seconds since epoch) */
          tstamp_t& rec_tstamp = log_rec.tstamp;
 
-         // hold onto the time stamp value, so we don't have to do time math more than we need
-         htab_tstamp = rec_tstamp.mktime();
-
          //
          // Skip log records that we processed in the past, but not the first few that have 
          // the same time stamp (i.e. the first good log record sets cur_tstamp in the state 
@@ -1436,7 +1510,7 @@ int webalizer_t::proc_logfile(proc_times_t& ptms, logrec_counts_t& lrcnt)
                if(!config.batch) {
                   database_t::status_t status;
                   stime = msecs();
-                  if(!(status = state.database.attach_indexes(true)).success())
+                  if(!(status = state.attach_indexes(true)).success())
                      throw exception_t(0, string_t::_format("Cannot create secondary database indexes (%s)", status.err_msg().c_str()));
                   write_monthly_report();                /* generate HTML for month */
                   ptms.rpt_time += elapsed(stime, msecs());
@@ -1521,6 +1595,12 @@ int webalizer_t::proc_logfile(proc_times_t& ptms, logrec_counts_t& lrcnt)
          // 7. Country totals do not include robot activity.
          //
          
+         //
+         // Look up the original user agent in the cache, so robot and group patterns
+         // are matched and the user agent is mangled only once for each user agent.
+         //
+         agent_cache_t::entry_t& ua_entry = agent_cache.get_entry(log_rec.agent);
+
          // do not look up robot agent for proxy requests
          if(config.log_type != LOG_SQUID) {
             //
@@ -1528,7 +1608,7 @@ int webalizer_t::proc_logfile(proc_times_t& ptms, logrec_counts_t& lrcnt)
             // check, so we avoid a look-up if matches some other ignore criteria.
             //
             if(config.ignore_robots)
-               ragent = (!spammer) ? config.robots.isinglist(log_rec.agent) : nullptr;
+               ragent = (!spammer) ? get_robot_agent(ua_entry) : nullptr;
          }
 
          //
@@ -1566,15 +1646,18 @@ int webalizer_t::proc_logfile(proc_times_t& ptms, logrec_counts_t& lrcnt)
          if(config.log_type != LOG_SQUID) {
             // if not ignored, check if a robot and set ragent (ignore spammers)
             if(!config.ignore_robots)
-               ragent = (!spammer) ? config.robots.isinglist(log_rec.agent) : nullptr;
+               ragent = (!spammer) ? get_robot_agent(ua_entry) : nullptr;
          }
 
          /* Do we need to mangle? */
          if(config.mangle_agent) {
-            if (config.use_classic_mangler)
-               mangle_user_agent(log_rec.agent);
-            else
-               filter_user_agent(log_rec.agent);
+            const string_t& mangled = get_mangled_agent(ua_entry);
+
+            // a view into the log line cannot grow, so release it if the mangled agent doesn't fit
+            if(mangled.length() > log_rec.agent.capacity())
+               log_struct::release_field(log_rec.agent);
+
+            log_rec.agent = mangled;
          }
             
          /* Bump response code totals */
@@ -1606,7 +1689,7 @@ int webalizer_t::proc_logfile(proc_times_t& ptms, logrec_counts_t& lrcnt)
          // put_hnode sets newvisit and must be called before any other put_xnode 
          // function.
          //
-         hptr = put_hnode(log_rec.hostname, rec_tstamp, htab_tstamp, log_rec.xfer_size, fileurl, pageurl, 
+         hptr = put_hnode(log_rec.hostname, log_rec.hostaddr, rec_tstamp, htab_tstamp, log_rec.xfer_size, fileurl, pageurl, 
             spammer, ragent != nullptr, target, newvisit, newhost, newthost, newspammer);
 
          // 
@@ -1799,7 +1882,7 @@ int webalizer_t::proc_logfile(proc_times_t& ptms, logrec_counts_t& lrcnt)
             put_rnode(*sptr, 0, OBJ_GRP, 1ul, newvisit, newrgrp);
 
          /* User Agent Grouping */
-         if((sptr = config.group_agents.isinglist(log_rec.agent))!=nullptr)
+         if((sptr = get_agent_group(ua_entry))!=nullptr)
             put_anode(*sptr, 0, OBJ_GRP, log_rec.xfer_size, newvisit, false, newagrp);
 
          // group robots
@@ -1844,6 +1927,16 @@ int webalizer_t::proc_logfile(proc_times_t& ptms, logrec_counts_t& lrcnt)
    /* DONE READING LOG FILES - final processing */
    /*********************************************/
    
+   // report hash table load before nodes are saved in the database
+   if(config.debug_mode && config.verbose > 1)
+      state.print_htab_stats();
+
+   // stop parser threads and discard any unprocessed log records
+   if(parse_pipeline.is_active()) {
+      parse_pipeline.stop();
+      parser_snapshot.reset();
+   }
+
    // if there are any unprocessed log files, close them (e.g. Ctrl-C was pressed)
    for(logfile_list_t::iterator i = logfiles.begin(); i != logfiles.end(); i++) {
       if(*i && (*i)->is_open())
@@ -1906,7 +1999,7 @@ int webalizer_t::proc_logfile(proc_times_t& ptms, logrec_counts_t& lrcnt)
          if(!config.batch) {
             database_t::status_t status;
             stime = msecs();
-            if(!(status = state.database.attach_indexes(true)).success())
+            if(!(status = state.attach_indexes(true)).success())
                throw exception_t(0, string_t::_format("Cannot create secondary database indexes (%s)", status.err_msg().c_str()));
             write_monthly_report();             /* write monthly HTML file  */
             write_main_index();                 /* write main HTML file     */
@@ -2332,8 +2425,13 @@ void webalizer_t::unpack_inactive_hnode_cb(hnode_t& hnode, bool active, void *ar
 ///
 /// @brief  Adds or updates a host node in the state database.
 ///
+/// If `hostaddr` isn't empty, it must contain the binary form of `ipaddr`, which
+/// is used to look up the host node in the hash table. The state database is
+/// always searched using `ipaddr`.
+///
 storable_t<hnode_t> *webalizer_t::put_hnode(
                const string_t& ipaddr,          // IP address
+               const ipaddr_t& hostaddr,        // binary IP address (empty if not an IP address)
                const tstamp_t& tstamp,          // timestamp 
                int64_t  htab_tstamp,            // serial time stamp
                uint64_t xfer,                   // xfer size 
@@ -2355,12 +2453,19 @@ storable_t<hnode_t> *webalizer_t::put_hnode(
 
    newnode = newvisit = newthost = newspammer = false;
 
-   hashval = hnode_t::hash_key(ipaddr);
+   if(!hostaddr.isempty()) {
+      hashval = hnode_t::hash_key(hostaddr);
+      cptr = state.hm_htab.find_node(hashval, OBJ_REG, htab_tstamp, hostaddr);
+   }
+   else {
+      hashval = hnode_t::hash_key(ipaddr);
+      cptr = state.hm_htab.find_node(hashval, OBJ_REG, htab_tstamp, ipaddr);
+   }
 
    /* check if hashed */
-   if((cptr = state.hm_htab.find_node(hashval, OBJ_REG, htab_tstamp, ipaddr)) == nullptr) {
+   if(cptr == nullptr) {
       /* not hashed */
-      cptr = new storable_t<hnode_t>(ipaddr);
+      cptr = state.hm_htab.new_node(ipaddr, hostaddr);
       if(!state.database.get_hnode_by_value<void*>(*cptr, &unpack_inactive_hnode_cb, this)) {
          cptr->nodeid = state.database.get_hnode_id();
          cptr->flag = OBJ_REG;
@@ -2473,7 +2578,7 @@ storable_t<hnode_t> *webalizer_t::put_hnode(
    /* check if hashed */
    if((cptr = state.hm_htab.find_node(hashval, OBJ_GRP, htab_tstamp, grpname)) == nullptr) {
       /* not hashed */
-      cptr = new storable_t<hnode_t>(grpname);
+      cptr = state.hm_htab.new_node(grpname);
       if(!state.database.get_hnode_by_value(*cptr)) {
          cptr->nodeid = state.database.get_hnode_id();
          cptr->flag  = OBJ_GRP;
@@ -2530,7 +2635,7 @@ rnode_t *webalizer_t::put_rnode(const string_t& str, int64_t htab_tstamp, nodety
    /* check if hashed */
    if((nptr = state.rm_htab.find_node(hashval, type, htab_tstamp, str)) == nullptr) {
       /* not hashed */
-      nptr = new storable_t<rnode_t>(str);
+      nptr = state.rm_htab.new_node(str);
       if(!state.database.get_rnode_by_value(*nptr)) {
          nptr->nodeid = state.database.get_rnode_id();
          nptr->flag  = type;
@@ -2578,7 +2683,7 @@ storable_t<unode_t> *webalizer_t::put_unode(const string_t& str, int64_t htab_ts
    /* check if hashed */
    if((cptr = state.um_htab.find_node(hashval, type, htab_tstamp, str, srchargs)) == nullptr) {
       /* not hashed */
-      cptr = new storable_t<unode_t>(str, srchargs);
+      cptr = state.um_htab.new_node(str, srchargs);
       // check if in the database
       if(!state.database.get_unode_by_value(*cptr)) {
          cptr->nodeid = state.database.get_unode_id();
@@ -2647,7 +2752,7 @@ rcnode_t *webalizer_t::put_rcnode(const string_t& method, int64_t htab_tstamp, c
    /* check if hashed */
    if((nptr = state.rc_htab.find_node(hashval, OBJ_REG, htab_tstamp, respcode, method, url)) == nullptr) {
       /* not hashed */
-      nptr = new storable_t<rcnode_t>(method, url, respcode);
+      nptr = state.rc_htab.new_node(method, url, respcode);
 
       if(!state.database.get_rcnode_by_value(*nptr)) {
          nptr->nodeid = state.database.get_rcnode_id();
@@ -2685,7 +2790,7 @@ anode_t *webalizer_t::put_anode(const string_t& str, int64_t htab_tstamp, nodety
    /* check if hashed */
    if((cptr = state.am_htab.find_node(hashval, type, htab_tstamp, str)) == nullptr) {
       /* not hashed */
-      cptr = new storable_t<anode_t>(str, robot);
+      cptr = state.am_htab.new_node(str, robot);
       if(!state.database.get_anode_by_value(*cptr)) {
          cptr->nodeid = state.database.get_anode_id();
          cptr->flag = type;
@@ -2736,7 +2841,7 @@ snode_t *webalizer_t::put_snode(const string_t& str, int64_t htab_tstamp, u_shor
    /* check if hashed */
    if((nptr = state.sr_htab.find_node(hashval, OBJ_REG, htab_tstamp, str)) == nullptr) {
       /* not hashed */
-      nptr = new storable_t<snode_t>(str);
+      nptr = state.sr_htab.new_node(str);
       if(!state.database.get_snode_by_value(*nptr)) {
          nptr->nodeid = state.database.get_snode_id();
          nptr->count = 1;
@@ -2792,7 +2897,7 @@ inode_t *webalizer_t::put_inode(const string_t& str,   /* ident str */
    /* check if hashed */
    if((nptr = state.im_htab.find_node(hashval, type, htab_tstamp, str)) == nullptr) {
       /* not hashed */
-      nptr = new storable_t<inode_t>(str);
+      nptr = state.im_htab.new_node(str);
       if(!state.database.get_inode_by_value(*nptr)) {
          nptr->nodeid = state.database.get_inode_id();
          nptr->flag  = type;
@@ -2853,7 +2958,7 @@ dlnode_t *webalizer_t::put_dlnode(const string_t& name, int64_t htab_tstamp, u_i
    hashval = dlnode_t::hash_key(hnode.string, name);
 
    if((nptr = state.dl_htab.find_node(hashval, OBJ_REG, htab_tstamp, hnode.string, name)) == nullptr) {
-      nptr = new storable_t<dlnode_t>(name, hnode);
+      nptr = state.dl_htab.new_node(name, hnode);
       if(!state.database.get_dlnode_by_value<void *, const storable_t<hnode_t>&>(*nptr, &state_t::unpack_dlnode_cached_host_cb, &state, (const storable_t<hnode_t>&) hnode)) {
          nptr->set_host(&hnode);
 
@@ -3312,6 +3417,10 @@ int webalizer_t::read_log_line(string_t::char_buffer_t& buffer, logfile_t& logfi
 {
    int reclen = 0, errnum = 0;
 
+   // block-oriented read modes hand out line views that need to be copied
+   if(logfile.get_read_mode() != LOG_READ_STDIO)
+      return read_log_line_view(buffer, logfile, lrcnt);
+
    // read the line ad check if there's no more data; EOF is checked in logfile_t::get_line
    while((reclen = logfile.get_line(buffer, (u_int) buffer.capacity(), &errnum)) != 0) {
       
@@ -3366,6 +3475,53 @@ int webalizer_t::read_log_line(string_t::char_buffer_t& buffer, logfile_t& logfi
    return reclen;
 }
 
+///
+/// @brief  Reads the next log line view from a log file opened in one of the 
+///         block-oriented read modes and copies it into the supplied buffer.
+///
+/// The parser modifies the record text, so the line is copied into the record
+/// buffer, which costs one `memcpy` per line instead of a `fgets` call. A line
+/// that does not fit into the record buffer is reported as a bad record, just
+/// like in the stream read mode.
+///
+int webalizer_t::read_log_line_view(string_t::char_buffer_t& buffer, logfile_t& logfile, logrec_counts_t& lrcnt)
+{
+   const char *line;
+   size_t linelen;
+   int reclen = 0, errnum = 0;
+
+   while((reclen = logfile.get_line(line, linelen, &errnum)) != 0) {
+      if(reclen == -1)
+         throw exception_t(0, string_t::_format("%s: %s (%d)", config.lang.msg_file_err, logfile.get_fname().c_str(), errnum));
+
+      // live IIS log files are zero-padded to a 64K boundary
+      if(config.log_type == LOG_IIS && *line == 0)
+         return 0;
+
+      lrcnt.total_rec++;
+
+      // if the line fits into the buffer, copy it and return
+      if(linelen < buffer.capacity()) {
+         memcpy(buffer.get_buffer(), line, linelen);
+         buffer[linelen] = 0;
+         return reclen;
+      }
+
+      lrcnt.total_bad++;              /* bump bad record counter      */
+
+      // oversized record - report record number, file name and the record if running in debug mode
+      if (config.verbose) {
+         fprintf(stderr,"%s (%" PRIu64 " - %s)",config.lang.msg_big_rec, lrcnt.total_rec, logfile.get_fname().c_str());
+         if (config.debug_mode) 
+            fprintf(stderr,":\n%.*s\n", (int) (line[linelen-1] == '\n' ? linelen-1 : linelen), line);
+         else 
+            fprintf(stderr,"\n");
+      }
+   }
+
+   return reclen;
+}
+
 ///
 /// @brief  Parses the log record text in the buffer and, if it's valid, populates
 ///         the log record structure.
@@ -3383,18 +3539,174 @@ int webalizer_t::parse_log_record(string_t::char_buffer_t& buffer, size_t reclen
    if(config.debug_mode)
       lrecstr = buffer;
 
-   if((parse_code = parser.parse_record(buffer, reclen, logrec)) == PARSE_CODE_ERROR) {
+   if((parse_code = parser.parse_record(buffer, reclen, logrec)) == PARSE_CODE_ERROR)
+      report_bad_record(fileid, recnum, lrecstr);
+   
+   return parse_code;
+}
 
-      /* really bad record... */
-      if (config.verbose)
-      {
-         fprintf(stderr,"%s (%u:%" PRIu64 ")", config.lang.msg_bad_rec, fileid, recnum);
-         if (config.debug_mode) fprintf(stderr,":\n%s\n", lrecstr.c_str());
-         else fprintf(stderr,"\n");
+///
+/// @brief  Reports a log record that could not be parsed.
+///
+/// The original log record text in `lrecstr` is only reported in debug mode.
+///
+void webalizer_t::report_bad_record(u_int fileid, uint64_t recnum, const string_t& lrecstr) const
+{
+   /* really bad record... */
+   if (config.verbose)
+   {
+      fprintf(stderr,"%s (%u:%" PRIu64 ")", config.lang.msg_bad_rec, fileid, recnum);
+      if (config.debug_mode) fprintf(stderr,":\n%s\n", lrecstr.c_str());
+      else fprintf(stderr,"\n");
+   }
+}
+
+///
+/// @brief  Reads log lines from the log file until a valid log record is found
+///         and returns `true` or returns `false` if there are no more log records.
+///
+/// Bad log records and log file directives are counted in `lrcnt` and skipped.
+///
+/// If parser threads are configured, log lines are read in batches and parsed on
+/// parser threads ahead of time and valid log records are moved into `logrec` in
+/// the same order as they appear in the log file.
+///
+/// String fields of `logrec` may be views into its own line buffer or into the
+/// buffer of a parse batch, which remain valid until `get_log_record` is called
+/// again for the same log file.
+///
+bool webalizer_t::get_log_record(logfile_t& logfile, log_struct& logrec, logrec_counts_t& lrcnt)
+{
+   int parse_code;
+
+   if(!parse_pipeline.is_active()) {
+      size_t reclen;
+
+      // log record fields may be views into the log line, so each log record keeps its own line buffer
+      if(logrec.linebuf.isnull())
+         logrec.linebuf = string_t::char_buffer_t(BUFSIZE);
+
+      while((reclen = read_log_line(logrec.linebuf, logfile, lrcnt)) != 0) {
+         // parse the log line
+         if((parse_code = parse_log_record(logrec.linebuf, reclen, logrec, logfile.get_id(), lrcnt.total_rec)) == PARSE_CODE_ERROR) {
+            lrcnt.total_bad++;
+            continue;
+         }
+
+         // skip log file directives, etc
+         if(parse_code == PARSE_CODE_IGNORE) {
+            lrcnt.total_ignore++;
+            continue;
+         }
+
+         return true;
+      }
+
+      return false;
+   }
+
+   parse_pipeline_t::file_queue_t& file_queue = parse_pipeline.get_file_queue(logfile.get_id());
+   parse_pipeline_t::batch_t *batch;
+
+   while(true) {
+      // keep a few batches of this log file queued for parsing
+      while(!file_queue.eof && file_queue.batches.size() < parse_pipeline_t::FILE_QUEUE_DEPTH) {
+         batch = parse_pipeline.get_batch();
+
+         file_queue.eof = !fill_parse_batch(logfile, *batch, lrcnt);
+
+         // a batch may be empty if it ended on a log file directive
+         if(batch->is_empty()) {
+            parse_pipeline.release_batch(batch);
+            continue;
+         }
+
+         parse_pipeline.submit(batch);
+         file_queue.batches.push_back(batch);
+      }
+
+      if(file_queue.batches.empty())
+         return false;
+
+      // wait for the oldest batch of this log file and consume its log records in order
+      batch = file_queue.batches.front();
+
+      parse_pipeline.wait(*batch);
+
+      while(batch->next < batch->lines.size()) {
+         size_t index = batch->next++;
+         const parse_pipeline_t::batch_t::line_t& line = batch->lines[index];
+
+         if(line.parse_code == PARSE_CODE_ERROR) {
+            report_bad_record(logfile.get_id(), line.recnum, config.debug_mode ? batch->orig_lines[index] : string_t());
+            lrcnt.total_bad++;
+            continue;
+         }
+
+         if(line.parse_code == PARSE_CODE_IGNORE) {
+            lrcnt.total_ignore++;
+            continue;
+         }
+
+         // swap log records, so the batch log record can reuse string memory
+         std::swap(logrec, batch->logrecs[index]);
+
+         return true;
       }
+
+      file_queue.batches.pop_front();
+      parse_pipeline.release_batch(batch);
    }
-   
-   return parse_code;
+}
+
+///
+/// @brief  Reads log lines from the log file into a parse batch until the batch
+///         is full, a log file directive is found or there is no more data.
+///
+/// Log file directives change the parser state and are parsed on the main thread
+/// as soon as they are read. Subsequent log lines are placed into a new batch with
+/// an updated parser snapshot.
+///
+/// Returns `false` if there are no more log lines in the log file.
+///
+bool webalizer_t::fill_parse_batch(logfile_t& logfile, parse_pipeline_t::batch_t& batch, logrec_counts_t& lrcnt)
+{
+   char *bufptr;
+   size_t bufsize;
+   int reclen;
+
+   batch.parser = parser_snapshot;
+
+   // each log line gets a full record buffer, so long records are handled as before
+   while((bufptr = batch.get_free_space(bufsize)) != nullptr && bufsize >= BUFSIZE) {
+      string_t::char_buffer_t buffer(bufptr, BUFSIZE, true);
+
+      if((reclen = read_log_line(buffer, logfile, lrcnt)) == 0)
+         return false;
+
+      if(parser.is_directive(buffer)) {
+         log_struct logrec;
+
+         if(parse_log_record(buffer, reclen, logrec, logfile.get_id(), lrcnt.total_rec) == PARSE_CODE_ERROR)
+            lrcnt.total_bad++;
+         else
+            lrcnt.total_ignore++;
+
+         parser_snapshot = std::make_shared<const parser_t>(parser);
+
+         // log lines in this batch must be parsed with the previous parser state
+         if(!batch.is_empty())
+            return true;
+
+         batch.parser = parser_snapshot;
+
+         continue;
+      }
+
+      batch.add_line(reclen, lrcnt.total_rec);
+   }
+
+   return true;
 }
 
 #include "database_tmpl.cpp"
@@ -19,12 +19,14 @@
 #include "graphs.h"
 #include "output.h"
 #include "parser.h"
+#include "parse_pipeline.h"
 #include "history.h"
 #include "preserve.h"
 #include "dns_resolv.h"
 #include "database.h"
 #include "hashtab_nodes.h"
 #include "logfile.h"
+#include "agent_cache.h"
 #include "pool_allocator.h"
 #include "p2_buffer_allocator.h"
 
@@ -108,20 +110,58 @@ class webalizer_t {
       struct lfp_state_t {
          logfile_t   *logfile;
          log_struct  *logrec;
+         uint64_t    seqnum;           ///< Insertion sequence number, to break time stamp ties
          
          public:
-         lfp_state_t(void) : logfile(nullptr), logrec(nullptr) {} 
+         lfp_state_t(void) : logfile(nullptr), logrec(nullptr), seqnum(0) {} 
          
-         lfp_state_t(logfile_t *logfile, log_struct *logrec) : logfile(logfile), logrec(logrec) {}
+         lfp_state_t(logfile_t *logfile, log_struct *logrec) : logfile(logfile), logrec(logrec), seqnum(0) {}
          
-         lfp_state_t(const lfp_state_t& otherme) : logfile(otherme.logfile), logrec(otherme.logrec) {}
+         lfp_state_t(const lfp_state_t& otherme) : logfile(otherme.logfile), logrec(otherme.logrec), seqnum(otherme.seqnum) {}
          
-         lfp_state_t& operator = (const lfp_state_t& otherme) {logfile = otherme.logfile; logrec = otherme.logrec; return *this;}
+         lfp_state_t& operator = (const lfp_state_t& otherme) {logfile = otherme.logfile; logrec = otherme.logrec; seqnum = otherme.seqnum; return *this;}
          
-         void reset(void) {logfile = nullptr; logrec = nullptr;}
+         void reset(void) {logfile = nullptr; logrec = nullptr; seqnum = 0;}
       };
 
-      typedef std::list<lfp_state_t, pool_allocator_t<lfp_state_t, FOPEN_MAX>> lfp_state_list_t;
+      ///
+      /// @brief  A binary heap of log file parser states ordered by log record time 
+      ///         stamps
+      ///
+      /// The state with the oldest log record is always at the top of the heap, so
+      /// inserting a state and removing the oldest one takes O(log(n)) time for `n`
+      /// log files.
+      ///
+      /// States with equal time stamps are ordered by their insertion sequence, with
+      /// the most recently inserted state first. This keeps log records from the same
+      /// log file together when time stamps are equal and produces the same order of
+      /// log records as a sorted list in which each state is inserted in front of all 
+      /// states with the same time stamp.
+      ///
+      class lfp_state_heap_t {
+         private:
+            std::vector<lfp_state_t> states;
+            uint64_t    seqnum;        ///< Next insertion sequence number
+
+         private:
+            /// Returns `true` if `state1` should be processed after `state2`.
+            static bool is_later(const lfp_state_t& state1, const lfp_state_t& state2)
+            {
+               int64_t diff = state1.logrec->tstamp.compare(state2.logrec->tstamp);
+               return diff > 0 || (diff == 0 && state1.seqnum < state2.seqnum);
+            }
+
+         public:
+            lfp_state_heap_t(void) : seqnum(0) {}
+
+            size_t size(void) const {return states.size();}
+
+            bool empty(void) const {return states.empty();}
+
+            void push(const lfp_state_t& state);
+
+            lfp_state_t pop(void);
+      };
       typedef std::list<log_struct*, pool_allocator_t<log_struct*, FOPEN_MAX>> logrec_list_t;
       typedef std::list<logfile_t*, pool_allocator_t<logfile_t*, FOPEN_MAX>> logfile_list_t;
 
@@ -178,9 +218,13 @@ class webalizer_t {
       const config_t& config;                      ///< Read-only application configuration object
       
       parser_t    parser;                          ///< Log record parser
+      parse_pipeline_t parse_pipeline;             ///< Log record parser threads
+      std::shared_ptr<const parser_t> parser_snapshot; ///< Parser state for the next parse batch
       state_t     state;                           ///< Monthly state database
       dns_resolver_t dns_resolver;                 ///< DNS and GeoIP resolver database
 
+      agent_cache_t agent_cache;                   ///< Mangled user agents and their robot and group names
+
       std::vector<output_t*> output;               ///< Report generators
 
       buffer_allocator_t buffer_allocator;         ///< Pooled buffer allocator
@@ -206,24 +250,33 @@ class webalizer_t {
       void proc_index_alias(string_t& url);
       void mangle_user_agent(string_t& agent);
       void filter_user_agent(string_t& agent);
+      const string_t *get_robot_agent(agent_cache_t::entry_t& ua_entry) const;
+      const string_t& get_mangled_agent(agent_cache_t::entry_t& ua_entry);
+      const string_t *get_agent_group(agent_cache_t::entry_t& ua_entry);
 
       int prep_report(void);
       int end_month(void);
       int database_info(void);
       int compact_database(void);
+      int merge_databases(void);
       int proc_logfile(proc_times_t& ptms, logrec_counts_t& lrcnt);
 
       void prep_logfiles(logfile_list_t& logfiles);
-      void prep_lfstates(logfile_list_t& logfiles, lfp_state_list_t& lfp_states, logrec_list_t& logrecs, logrec_counts_t& lrcnt);
-      bool get_logrec(lfp_state_t& wlfs, logfile_list_t& logfiles, lfp_state_list_t& lfp_states, logrec_list_t& logrecs, logrec_counts_t& lrcnt);
+      void prep_lfstates(logfile_list_t& logfiles, lfp_state_heap_t& lfp_states, logrec_list_t& logrecs, logrec_counts_t& lrcnt);
+      bool get_logrec(lfp_state_t& wlfs, logfile_list_t& logfiles, lfp_state_heap_t& lfp_states, logrec_list_t& logrecs, logrec_counts_t& lrcnt);
       
       int read_log_line(string_t::char_buffer_t& buffer, logfile_t& logfile, logrec_counts_t& lrcnt); 
+      int read_log_line_view(string_t::char_buffer_t& buffer, logfile_t& logfile, logrec_counts_t& lrcnt);
       int parse_log_record(string_t::char_buffer_t& buffer, size_t reclen, log_struct& logrec, u_int fileid, uint64_t recnum);
+      void report_bad_record(u_int fileid, uint64_t recnum, const string_t& lrecstr) const;
+
+      bool get_log_record(logfile_t& logfile, log_struct& logrec, logrec_counts_t& lrcnt);
+      bool fill_parse_batch(logfile_t& logfile, parse_pipeline_t::batch_t& batch, logrec_counts_t& lrcnt);
 
       //
       // put_xnode methods
       //
-      storable_t<hnode_t> *put_hnode(const string_t& ipaddr, const tstamp_t& tstamp, int64_t relts, uint64_t xfer, bool fileurl, bool pageurl, bool spammer, bool robot, bool target, bool& newvisit, bool& newnode, bool& newthost, bool& newspammer);
+      storable_t<hnode_t> *put_hnode(const string_t& ipaddr, const ipaddr_t& hostaddr, const tstamp_t& tstamp, int64_t relts, uint64_t xfer, bool fileurl, bool pageurl, bool spammer, bool robot, bool target, bool& newvisit, bool& newnode, bool& newthost, bool& newspammer);
       storable_t<hnode_t> *put_hnode(const string_t& grpname, int64_t relts, uint64_t hits, uint64_t files, uint64_t pages, uint64_t xfer, uint64_t visitlen, bool& newnode);
 
       rnode_t *put_rnode(const string_t&, int64_t relts, nodetype_t type, uint64_t, bool newvisit, bool& newnode);